@@ -35,6 +35,8 @@ public:
   using Kernel<equation>::R0;                                   //!< Radius of root cell
   using TreeStructure<equation>::buffer;                        //!< Buffer for MPI communication & sorting
   using TreeStructure<equation>::getLevel;                      //!< Get level from cell index
+  using TreeStructure<equation>::getLevelOffset;                //!< Get offset of cell index for a given level
+  using TreeStructure<equation>::getMorton;                     //!< Interleave bits of 3-D cell index
 
 protected:
 //! Max level for bottom up tree build
@@ -52,27 +54,33 @@ protected:
     return level;                                               // Return max level
   }
 
+//! Get cell index of position at given level
+  bigint getIndex(const vect &X, int level) {
+    real r = R0 / (1 << (level-1));                             // Radius at given level
+    vec<3,int> nx;                                              // 3-D cell index
+    for( int d=0; d!=3; ++d ) {                                 // Loop over dimension
+      nx[d] = int( ( X[d] - (X0[d]-R0) ) / r );                 //  3-D cell index
+      nx[d] &= (1 << level) - 1;                                //  Keep bits within this level
+    }                                                           // End loop over dimension
+    return getMorton(nx) + getLevelOffset(level);               // Cell index including level offset
+  }
+
 public:
 //! Set cell index of all bodies
   void setIndex(Bodies &bodies, int level=-1, int begin=0, int end=0, bool update=false) {
     startTimer("Set index");                                    // Start timer
-    bigint i;                                                   // Levelwise cell index
     if( level == -1 ) level = getMaxLevel(bodies);              // Decide max level
-    bigint off = ((1 << 3*level) - 1) / 7;                      // Offset for each level
+    assert( level <= MAXLEVEL );                                // Cell index must fit in bigint
+    bigint off = getLevelOffset(level);                         // Offset for each level
     real r = R0 / (1 << (level-1));                             // Radius at finest level
     vec<3,int> nx;                                              // 3-D cell index
     if( end == 0 ) end = bodies.size();                         // Default size is all bodies
     for( int b=begin; b!=end; ++b ) {                           // Loop over bodies
       for( int d=0; d!=3; ++d ) {                               //  Loop over dimension
         nx[d] = int( ( bodies[b].X[d] - (X0[d]-R0) ) / r );     //   3-D cell index
+        nx[d] &= (1 << level) - 1;                              //   Keep bits within this level
       }                                                         //  End loop over dimension
-      i = 0;                                                    //  Initialize cell index
-      for( int l=0; l!=level; ++l ) {                           //  Loop over levels of tree
-        for( int d=0; d!=3; ++d ) {                             //   Loop over dimension
-          i += nx[d] % 2 << (3 * l + d);                        //    Accumulate cell index
-          nx[d] >>= 1;                                          //    Bitshift 3-D cell index
-        }                                                       //   End loop over dimension
-      }                                                         //  End loop over levels
+      bigint i = getMorton(nx);                                 //  Levelwise cell index
       if( !update ) {                                           //  If this not an update
         bodies[b].ICELL = i+off;                                //   Store index in bodies
       } else if( i+off > bodies[b].ICELL ) {                    //  If the new cell index is larger
@@ -88,15 +96,15 @@ public:
     int maxLevel = getMaxLevel(bodies);                         // Max level for bottom up tree build
     for( int l=maxLevel; l>0; --l ) {                           // Loop upwards from bottom level
       int level = getLevel(bodies[0].ICELL);                    //  Current level
-      bigint cOff = ((1 << 3 * level) - 1) / 7;                 //  Current ce;; index offset
-      bigint pOff = ((1 << 3 * (l-1)) - 1) / 7;                 //  Parent cell index offset
+      bigint cOff = getLevelOffset(level);                      //  Current cell index offset
+      bigint pOff = getLevelOffset(l-1);                        //  Parent cell index offset
       bigint index = ((bodies[0].ICELL-cOff) >> 3*(level-l+1)) + pOff;// Current cell index
       int begin = 0;                                            //  Begin cell index for bodies in cell
       int size = 0;                                             //  Number of bodies in cell
       int b = 0;                                                //  Current body index
       for( B_iter B=bodies.begin(); B!=bodies.end(); ++B,++b ) {//  Loop over bodies
         level = getLevel(B->ICELL);                             //   Level of twig
-        cOff = ((1 << 3*level) - 1) / 7;                        //   Offset of twig
+        cOff = getLevelOffset(level);                           //   Offset of twig
         bigint p = ((B->ICELL-cOff) >> 3*(level-l+1)) + pOff;   //   Cell index of parent cell
         if( p != index ) {                                      //   If it's a new parent cell
           if( size < NCRIT ) {                                  //    If parent cell has few enough bodies
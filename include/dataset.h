@@ -56,6 +56,7 @@ public:
       B->TRG = 0;                                               //  Clear previous target values (IeqJ is dummy)
       if( EPS2 != 0 ) B->TRG[0] = -B->SRC / std::sqrt(EPS2) * IeqJ;//  Initialize potential (0 if I != J)
     }                                                           // End loop over bodies
+    this->clearVanDerWaals();                                   // Clear Van der Waals target values of combined mode
   }
 
 //! Read target values from file
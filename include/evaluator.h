@@ -35,28 +35,40 @@ private:
 protected:
   C_iter      CiB;                                              //!< icells begin per call
   C_iter      CiE;                                              //!< icells end per call
-  Lists       listM2L;                                          //!< M2L interaction list
-  Lists       listM2P;                                          //!< M2P interaction list
-  Lists       listP2P;                                          //!< P2P interaction list
+  InteractionList listM2L;                                      //!< M2L interaction list with periodic image flags
+  InteractionList listM2P;                                      //!< M2P interaction list with periodic image flags
+  InteractionList listP2P;                                      //!< P2P interaction list with periodic image flags
 
   int         Iperiodic;                                        //!< Periodic image flag (using each bit for images)
   const int   Icenter;                                          //!< Periodic image flag at center
-  Maps        flagM2L;                                          //!< Existance of periodic image for M2L
-  Maps        flagM2P;                                          //!< Existance of periodic image for M2P
-  Maps        flagP2P;                                          //!< Existance of periodic image for P2P
 
   real        NP2P;                                             //!< Number of P2P kernel calls
   real        NM2P;                                             //!< Number of M2P kernel calls
   real        NM2L;                                             //!< Number of M2L kernel calls
+  int         GRAINSIZE;                                        //!< Minimum bodies in target cell to spawn a task
+  Cells       periodicCells;                                    //!< Periodic center cells that own coefficients
 
 public:
+  using Kernel<equation>::registerTimer;                        //!< Get id of timer event
+  using Kernel<equation>::registerLevelTimers;                  //!< Get ids of per-level timer events
   using Kernel<equation>::startTimer;                           //!< Start timer for given event
   using Kernel<equation>::stopTimer;                            //!< Stop timer for given event
   using Kernel<equation>::writeTrace;                           //!< Write traces of all events
+  using Kernel<equation>::X0;                                   //!< Center of root cell
   using Kernel<equation>::R0;                                   //!< Radius of root cell
+  using Kernel<equation>::getNumM;                              //!< Get number of multipole coefficients per cell
+  using Kernel<equation>::getM;                                 //!< Get multipole coefficients of cell
+  using Kernel<equation>::getL;                                 //!< Get local coefficients of cell
+  using Kernel<equation>::newCoef;                              //!< Allocate zeroed coefficients for cell
+  using Kernel<equation>::copyCoef;                             //!< Give cell its own copy of its coefficients
+  using Kernel<equation>::freeCoef;                             //!< Release coefficients of cell
   using Kernel<equation>::Ci0;                                  //!< Begin iterator for target cells
   using Kernel<equation>::Cj0;                                  //!< Begin iterator for source cells
   using Kernel<equation>::ALPHA;                                //!< Scaling parameter for Ewald summation
+  using Kernel<equation>::CUTOFF;                               //!< Cutoff radius of Ewald real part
+  using Kernel<equation>::ERFCTABLE;                            //!< Cubic pieces of erfc(s) and exp(-s^2) for Ewald real part
+  using Kernel<equation>::ERFCSCALE;                            //!< Inverse width of pieces in ERFCTABLE
+  using Kernel<equation>::insideCutoff;                         //!< Check if cell pair is inside Van der Waals cutoff
   using Kernel<equation>::keysHost;                             //!< Offsets for rangeHost
   using Kernel<equation>::rangeHost;                            //!< Offsets for sourceHost
   using Kernel<equation>::constHost;                            //!< Constants on host
@@ -73,6 +85,7 @@ public:
   using Kernel<equation>::M2L;                                  //!< Evaluate M2L kernel
   using Kernel<equation>::M2P;                                  //!< Evaluate M2P kernel
   using Kernel<equation>::P2P;                                  //!< Evaluate P2P kernel
+  using Kernel<equation>::P2PMutual;                            //!< Evaluate P2P kernel for both cells
   using Kernel<equation>::L2L;                                  //!< Evaluate L2L kernel
   using Kernel<equation>::L2P;                                  //!< Evaluate L2P kernel
   using Kernel<equation>::EwaldReal;                            //!< Evaluate Ewald real part
@@ -101,25 +114,6 @@ private:
   inline void interact(C_iter Ci, C_iter Cj, Quark *quark);     //!< interact() function using QUARK
 #endif
 
-//! Traverse a single tree using a stack
-  void traverseStack(C_iter Ci, C_iter C) {
-    CellStack cellStack;                                        // Stack of cells
-    cellStack.push(C);                                          // Push pair to queue
-    while( !cellStack.empty() ) {                               // While traversal stack is not empty
-      C = cellStack.top();                                      //  Get cell from top of stack
-      cellStack.pop();                                          //  Pop traversal stack
-      for( C_iter Cj=Cj0+C->CHILD; Cj!=Cj0+C->CHILD+C->NCHILD; ++Cj ) {// Loop over cell's children
-        vect dX = Ci->X - Cj->X - Xperiodic;                    //   Distance vector from source to target
-        real Rq = std::sqrt(norm(dX));                          //   Scalar distance
-        if( Rq * THETA < Ci->R + Cj->R && Cj->NCHILD == 0 ) {   //   If twigs are close
-          evalEwaldReal(Ci,Cj);                                 //    Ewald real part
-        } else if( Cj->NCHILD != 0 ) {                          //   If cells are not twigs
-          cellStack.push(Cj);                                   //    Push source cell to stack
-        }                                                       //   End if for twig cells
-      }                                                         //  End loop over cell's children
-    }                                                           // End while loop for traversal stack
-  }
-
 //! Traverse a pair of trees using a queue
   void traverseQueue(Pair pair) {
     PairQueue pairQueue;                                        // Queue of interacting cell pairs
@@ -157,6 +151,118 @@ private:
 #endif
   }
 
+//! Dual tree traversal of a cell pair with OpenMP tasks (each task owns the target subtree it descends into)
+  void traverseTask(C_iter Ci, C_iter Cj) {
+    if(splitFirst(Ci,Cj)) {                                     // If target cell is larger
+      for( C_iter CiC=Ci0+Ci->CHILD; CiC!=Ci0+Ci->CHILD+Ci->NCHILD; ++CiC ) {// Loop over target cell's children
+        if( CiC->NDLEAF > GRAINSIZE ) {                         //   If child is large enough
+#pragma omp task firstprivate(CiC,Cj)
+          interact(CiC,Cj);                                     //    Spawn task on disjoint target subtree
+        } else {                                                //   If child is small
+          interact(CiC,Cj);                                     //    Calculate interaction in this task
+        }                                                       //   Endif for grain size
+      }                                                         //  End loop over target cell's children
+#pragma omp taskwait
+    } else {                                                    // If source cell is larger
+      for( C_iter CjC=Cj0+Cj->CHILD; CjC!=Cj0+Cj->CHILD+Cj->NCHILD; ++CjC ) {// Loop over source cell's children
+        interact(Ci,CjC);                                       //   Same target, so stay in this task
+      }                                                         //  End loop over source cell's children
+    }                                                           // End if for which cell to split
+  }
+
+//! Use multipole acceptance criteria to determine whether to approximate, do P2P, or descend with tasks
+  void interact(C_iter Ci, C_iter Cj) {
+    vect dX = Ci->X - Cj->X - Xperiodic;                        // Distance vector from source to target
+    real Rq = std::sqrt(norm(dX));                              // Scalar distance
+    if( Rq * THETA > Ci->R + Cj->R && !insideCutoff(Ci,Cj) ) {  // If distance if far enough
+      approximate(Ci,Cj);                                       //  Use approximate kernels, e.g. M2L, M2P
+    } else if(Ci->NCHILD == 0 && Cj->NCHILD == 0) {             // Else if both cells are leafs
+      evalP2P(Ci,Cj);                                           //  Use P2P
+    } else {                                                    // If cells are close but not leafs
+      traverseTask(Ci,Cj);                                      //  Descend into the pair
+    }                                                           // End if for multipole acceptance
+  }
+
+//! Traverse a pair of trees with task parallelism
+  void traverseParallel(Pair pair) {
+#pragma omp parallel
+#pragma omp single
+    traverseTask(pair.first,pair.second);                       // Root task
+  }
+
+//! Mutual interaction between two distinct cells of the same tree (both cells are updated)
+  void interactMutual(C_iter Ci, C_iter Cj) {
+    vect dX = Ci->X - Cj->X - Xperiodic;                        // Distance vector between cells
+    real Rq = std::sqrt(norm(dX));                              // Scalar distance
+    if( Rq * THETA > Ci->R + Cj->R && !insideCutoff(Ci,Cj) ) {  // If distance is far enough
+      approximate(Ci,Cj);                                       //  Approximate kernels from Cj to Ci
+      approximate(Cj,Ci);                                       //  Approximate kernels from Ci to Cj
+    } else if(Ci->NCHILD == 0 && Cj->NCHILD == 0) {             // Else if both cells are leafs
+      evalP2PMutual(Ci,Cj);                                     //  Use P2P once for both cells
+    } else if(Ci->NCHILD != 0 && Cj->NCHILD != 0 && Ci->NDLEAF + Cj->NDLEAF > GRAINSIZE) {// If pair is large
+      int n = std::max(Ci->NCHILD,Cj->NCHILD);                  //  Number of rounds
+      for( int shift=0; shift!=n; ++shift ) {                   //  Loop over rounds of disjoint child pairs
+        for( int i=0; i!=n; ++i ) {                             //   Loop over children of Ci
+          int j = (i + shift) % n;                              //    Each child of Cj appears once per round
+          if( i >= Ci->NCHILD || j >= Cj->NCHILD ) continue;    //    Skip padding
+          C_iter CiC = Ci0 + Ci->CHILD + i;                     //    Child of Ci
+          C_iter CjC = Ci0 + Cj->CHILD + j;                     //    Child of Cj
+          if( CiC->NDLEAF + CjC->NDLEAF > GRAINSIZE ) {         //    If child pair is large enough
+#pragma omp task firstprivate(CiC,CjC)
+            interactMutual(CiC,CjC);                            //     Task owns both child subtrees
+          } else {                                              //    If child pair is small
+            interactMutual(CiC,CjC);                            //     Calculate in this task
+          }                                                     //    Endif for grain size
+        }                                                       //   End loop over children of Ci
+#pragma omp taskwait
+      }                                                         //  End loop over rounds
+    } else if(splitFirst(Ci,Cj)) {                              // Else if Ci is larger
+      for( C_iter CiC=Ci0+Ci->CHILD; CiC!=Ci0+Ci->CHILD+Ci->NCHILD; ++CiC ) {// Loop over Ci's children
+        interactMutual(CiC,Cj);                                 //   Same cells, so stay in this task
+      }                                                         //  End loop over Ci's children
+    } else {                                                    // Else if Cj is larger
+      for( C_iter CjC=Ci0+Cj->CHILD; CjC!=Ci0+Cj->CHILD+Cj->NCHILD; ++CjC ) {// Loop over Cj's children
+        interactMutual(Ci,CjC);                                 //   Same cells, so stay in this task
+      }                                                         //  End loop over Cj's children
+    }                                                           // End if for multipole acceptance
+  }
+
+//! Mutual interaction of a cell with itself, scheduling child pairs in rounds that touch disjoint subtrees
+  void traverseSelf(C_iter C) {
+    if( C->NCHILD == 0 ) {                                      // If cell is a leaf
+      evalP2PMutual(C,C);                                       //  Use P2P once for each pair of bodies
+      return;                                                   //  Nothing to split
+    }                                                           // Endif for leaf
+    C_iter C0 = Ci0 + C->CHILD;                                 // First child
+    int n = C->NCHILD;                                          // Number of children
+    for( int i=0; i!=n; ++i ) {                                 // Loop over children
+      C_iter CC = C0 + i;                                       //  Child iterator
+      if( CC->NDLEAF > GRAINSIZE ) {                            //  If child is large enough
+#pragma omp task firstprivate(CC)
+        traverseSelf(CC);                                       //   Spawn task on disjoint subtree
+      } else {                                                  //  If child is small
+        traverseSelf(CC);                                       //   Calculate in this task
+      }                                                         //  Endif for grain size
+    }                                                           // End loop over children
+#pragma omp taskwait
+    int m = n + (n & 1);                                        // Pad to even number of children
+    for( int round=0; round<m-1; ++round ) {                    // Loop over rounds of round-robin schedule
+      for( int k=0; k<m/2; ++k ) {                              //  Loop over pairs in this round
+        int i = k == 0 ? m-1 : (round + k) % (m-1);             //   First child of pair
+        int j = (round + m - 1 - k) % (m-1);                    //   Second child of pair
+        if( i >= n || j >= n ) continue;                        //   Skip padding
+        C_iter Ci = C0 + i, Cj = C0 + j;                        //   Pair of children
+        if( Ci->NDLEAF + Cj->NDLEAF > GRAINSIZE ) {             //   If pair is large enough
+#pragma omp task firstprivate(Ci,Cj)
+          interactMutual(Ci,Cj);                                //    Task owns both child subtrees
+        } else {                                                //   If pair is small
+          interactMutual(Ci,Cj);                                //    Calculate in this task
+        }                                                       //   Endif for grain size
+      }                                                         //  End loop over pairs in this round
+#pragma omp taskwait
+    }                                                           // End loop over rounds
+  }
+
 //! Get range of periodic images
   int getPeriodicRange() {
     int prange = 0;                                             //  Range of periodic images
@@ -167,15 +273,95 @@ private:
   }
 
 protected:
+//! Number of threads that may push into interaction lists
+  int getMaxThreads() {
+#if QUARK
+    return 1;                                                   // QUARK tasks share a single buffer
+#else
+    return omp_get_max_threads();                               // One buffer per OpenMP thread
+#endif
+  }
+
+//! Index of the calling thread's interaction list buffer
+  int getThreadNum() {
+#if QUARK
+    return 0;                                                   // QUARK tasks share a single buffer
+#else
+    return omp_get_thread_num();                                // OpenMP thread number
+#endif
+  }
+
+//! Order target cells by decreasing cost of their interaction lists, and return the union of image flags
+  int getTargetOrder(const InteractionList &list, Cells &cells, bool targetBodies, bool sourceBodies,
+                     std::vector<int> &order) {
+    std::vector<std::pair<real,int> > costs;                    // Negated cost and offset of target cells
+    int images = 0;                                             // Union of periodic image flags
+    for( int i=0; i<int(cells.size()); ++i ) {                  // Loop over target cells
+      if( list.size(i) == 0 ) continue;                         //  Skip cells without interactions
+      real cost = 0;                                            //  Initialize cost of target cell
+      for( const Interaction *I=list.begin(i); I!=list.end(i); ++I ) {// Loop over interaction list
+        int numImages = 0;                                      //   Number of images of this source
+        for( int flag=I->IPERIODIC; flag; flag&=flag-1 ) ++numImages;// Count bits of periodic image flag
+        cost += numImages * (sourceBodies ? (Cj0+I->CELL)->NDLEAF : 1);// Work is proportional to source size
+        images |= I->IPERIODIC;                                 //   Accumulate periodic image flags
+      }                                                         //  End loop over interaction list
+      if( targetBodies ) cost *= cells[i].NDLEAF;               //  Work is proportional to target size
+      costs.push_back(std::make_pair(-cost,i));                 //  Negate so that sort is descending
+    }                                                           // End loop over target cells
+    std::sort(costs.begin(),costs.end());                       // Sort by decreasing cost
+    order.resize(costs.size());                                 // One entry per target cell with interactions
+    for( int n=0; n<int(costs.size()); ++n ) order[n] = costs[n].second;// Copy offsets of target cells
+    return images;                                              // Return union of periodic image flags
+  }
+
 //! Get level from cell index
   int getLevel(bigint index) {
-    int i = index;                                              // Copy to dummy index
-    int level = -1;                                             // Initialize level counter
-    while( i >= 0 ) {                                           // While cell index is non-negative
-      level++;                                                  //  Increment level
-      i -= 1 << 3*level;                                        //  Subtract number of cells in that level
-    }                                                           // End while loop for cell index
-    return level;                                               // Return the level
+    bigint i = 7 * index + 1;                                   // 8^level <= 7 * index + 1 < 8^(level+1)
+    return (63 - __builtin_clzll(i)) / 3;                       // Position of leading bit gives the level
+  }
+
+//! Get offset of cell index for a given level (number of cells in all coarser levels)
+  bigint getLevelOffset(int level) {
+    return ((bigint(1) << 3 * level) - 1) / 7;                  // (8^level - 1) / 7
+  }
+
+//! Interleave bits of 3-D cell index into Morton code
+  bigint getMorton(vec<3,int> nx) {
+    bigint index = 0;                                           // Initialize Morton code
+    for( int d=0; d!=3; ++d ) {                                 // Loop over dimensions
+      bigint i = nx[d] & 0x1fffff;                              //  21 bits per dimension
+      i = (i | i << 32) & 0x1f00000000ffffULL;                  //  Spread bits with magic numbers
+      i = (i | i << 16) & 0x1f0000ff0000ffULL;
+      i = (i | i << 8)  & 0x100f00f00f00f00fULL;
+      i = (i | i << 4)  & 0x10c30c30c30c30c3ULL;
+      i = (i | i << 2)  & 0x1249249249249249ULL;
+      index |= i << d;                                          //  Accumulate interleaved bits
+    }                                                           // End loop over dimensions
+    return index;                                               // Return Morton code
+  }
+
+//! De-interleave Morton code into 3-D cell index
+  vec<3,int> getIndex3D(bigint index) {
+    vec<3,int> nx;                                              // 3-D cell index
+    for( int d=0; d!=3; ++d ) {                                 // Loop over dimensions
+      bigint i = (index >> d) & 0x1249249249249249ULL;          //  Every third bit
+      i = (i ^ (i >> 2))  & 0x10c30c30c30c30c3ULL;              //  Compact bits with magic numbers
+      i = (i ^ (i >> 4))  & 0x100f00f00f00f00fULL;
+      i = (i ^ (i >> 8))  & 0x1f0000ff0000ffULL;
+      i = (i ^ (i >> 16)) & 0x1f00000000ffffULL;
+      i = (i ^ (i >> 32)) & 0x1fffff;
+      nx[d] = int(i);                                           //  Store compacted bits
+    }                                                           // End loop over dimensions
+    return nx;                                                  // Return 3-D cell index
+  }
+
+//! Get deepest level of cells
+  int getMaxLevel(Cells &cells) {
+    int maxLevel = 0;                                           // Initialize max level
+    for( C_iter C=cells.begin(); C!=cells.end(); ++C ) {        // Loop over cells
+      maxLevel = std::max(maxLevel,getLevel(C->ICELL));         //  Update max level
+    }                                                           // End loop over cells
+    return maxLevel;                                            // Return max level
   }
 
   void timeKernels();                                           //!< Time all kernels for auto-tuning
@@ -197,7 +383,7 @@ protected:
                     cell.X[0]  = C->X[0] + (ix * 6 + cx * 2) * C->R;//     Set new x coordinate for periodic image
                     cell.X[1]  = C->X[1] + (iy * 6 + cy * 2) * C->R;//     Set new y cooridnate for periodic image
                     cell.X[2]  = C->X[2] + (iz * 6 + cz * 2) * C->R;//     Set new z coordinate for periodic image
-                    cell.M     = C->M;                          //         Copy multipoles to new periodic image
+                    cell.ICOEF = C->ICOEF;                      //         Share multipoles with new periodic image
                     cell.NCLEAF = cell.NDLEAF = cell.NCHILD = 0;//         Initialize NCLEAF, NDLEAF, & NCHILD
                     jcells.push_back(cell);                     //         Push cell into periodic jcell vector
                   }                                             //        End loop over z periodic direction (child)
@@ -214,7 +400,7 @@ protected:
               cell.X[0] = C->X[0] + ix * 2 * C->R;              //      Set new x coordinate for periodic image
               cell.X[1] = C->X[1] + iy * 2 * C->R;              //      Set new y cooridnate for periodic image
               cell.X[2] = C->X[2] + iz * 2 * C->R;              //      Set new z coordinate for periodic image
-              cell.M = C->M;                                    //      Copy multipoles to new periodic image
+              cell.ICOEF = C->ICOEF;                            //      Share multipoles with new periodic image
               pjcells.push_back(cell);                          //      Push cell into periodic jcell vector
             }                                                   //     Endif for periodic center cell
           }                                                     //    End loop over z periodic direction
@@ -222,6 +408,9 @@ protected:
       }                                                         //  End loop over x periodic direction
       cell.X = C->X;                                            //  This is the center cell
       cell.R = 3 * C->R;                                        //  The cell size increases three times
+      cell.ICOEF = C->ICOEF;                                    //  Center cell starts from multipoles of previous one
+      copyCoef(cell);                                           //  Center cell accumulates into its own copy
+      periodicCells.push_back(cell);                            //  Keep track of copy to release after traversal
       pccells.pop_back();                                       //  Pop periodic center cell from vector
       pccells.push_back(cell);                                  //  Push cell into periodic cell vector
       C_iter Ci = pccells.end() - 1;                            //  Set current cell as target for M2M
@@ -251,14 +440,23 @@ protected:
 #endif
       }                                                         //  End loop over x periodic direction
     }                                                           // End loop over sublevels of tree
+#if QUEUE
+    listM2L.build(cells.size());                                // Merge periodic M2L entries into list
+    listM2P.build(cells.size());                                // Merge periodic M2P entries into list
+#endif
   }
 
 public:
 //! Constructor
-  Evaluator() : Icenter(1 << 13), NP2P(0), NM2P(0), NM2L(0) {}
+  Evaluator() : Icenter(1 << 13), NP2P(0), NM2P(0), NM2L(0), GRAINSIZE(4 * NCRIT) {}
 //! Destructor
   ~Evaluator() {}
 
+//! Reset number of P2P, M2P & M2L kernel calls (they accumulate over calls to downward)
+  void resetCounters() {
+    NP2P = NM2P = NM2L = 0;                                     // Reset kernel call counters
+  }
+
 //! Random distribution in [-1,1]^3 cube
   void cube(Bodies &bodies, int seed=0, int numSplit=1) {
     srand48(seed);                                              // Set seed for random number generator
@@ -319,27 +517,30 @@ public:
     initTarget(bodies);                                         // Initialize target values
   }
 
+//! Set minimum number of bodies in a target cell for spawning a traversal task
+  void setGrainSize(int grainSize) {
+    GRAINSIZE = grainSize;                                      // Set grain size
+  }
+
 //! Add single list for kernel unit test
   void addM2L(C_iter Cj) {
-    listM2L.resize(1);                                          // Resize vector of M2L interation lists
-    flagM2L.resize(1);                                          // Resize vector of M2L periodic image flags
-    listM2L[0].push_back(Cj);                                   // Push single cell into list
-    flagM2L[0][Cj] |= Icenter;                                  // Flip bit of periodic image flag
+    listM2L.initialize(1);                                      // Single thread pushes into M2L list
+    listM2L.push(0,0,Cj-Cj0,Icenter);                           // Push single cell into list
+    listM2L.build(1);                                           // Build list for single target
   }
 
 //! Add single list for kernel unit test
   void addM2P(C_iter Cj) {
-    listM2P.resize(1);                                          // Resize vector of M2P interation lists
-    flagM2P.resize(1);                                          // Resize vector of M2L periodic image flags
-    listM2P[0].push_back(Cj);                                   // Push single cell into list
-    flagM2P[0][Cj] |= Icenter;                                  // Flip bit of periodic image flag
+    listM2P.initialize(1);                                      // Single thread pushes into M2P list
+    listM2P.push(0,0,Cj-Cj0,Icenter);                           // Push single cell into list
+    listM2P.build(1);                                           // Build list for single target
   }
 
 //! Use multipole acceptance criteria to determine whether to approximate, do P2P, or subdivide
   void interact(C_iter Ci, C_iter Cj, PairQueue &pairQueue) {
     vect dX = Ci->X - Cj->X - Xperiodic;                        // Distance vector from source to target
     real Rq = std::sqrt(norm(dX));                              // Scalar distance
-    if( Rq * THETA > Ci->R + Cj->R ) {                          // If distance if far enough
+    if( Rq * THETA > Ci->R + Cj->R && !insideCutoff(Ci,Cj) ) {  // If distance if far enough
       approximate(Ci,Cj);                                       //  Use approximate kernels, e.g. M2L, M2P
     } else if(Ci->NCHILD == 0 && Cj->NCHILD == 0) {             // Else if both cells are leafs
       evalP2P(Ci,Cj);                                           //  Use P2P
@@ -359,18 +560,19 @@ public:
     Ci0 = cells.begin();                                        // Set begin iterator for target cells
     Cj0 = jcells.begin();                                       // Set begin iterator for source cells
 #if QUEUE
-    listM2L.resize(cells.size());                               // Resize M2L interaction list
-    listM2P.resize(cells.size());                               // Resize M2P interaction list
-    listP2P.resize(cells.size());                               // Resize P2P interaction list
-    flagM2L.resize(cells.size());                               // Resize M2L periodic image flag
-    flagM2P.resize(cells.size());                               // Resize M2P periodic image flag
-    flagP2P.resize(cells.size());                               // Resize P2P periodic image flag
+    listM2L.initialize(getMaxThreads());                        // Per-thread buffers for M2L interaction list
+    listM2P.initialize(getMaxThreads());                        // Per-thread buffers for M2P interaction list
+    listP2P.initialize(getMaxThreads());                        // Per-thread buffers for P2P interaction list
 #endif
     if( IMAGES == 0 ) {                                         // If free boundary condition
       Iperiodic = Icenter;                                      //  Set periodic image flag to center
       Xperiodic = 0;                                            //  Set periodic coordinate offset
       Pair pair(root,jroot);                                    //  Form pair of root cells
+#if QUARK
       traverseQueue(pair);                                      //  Traverse a pair of trees
+#else
+      traverseParallel(pair);                                   //  Traverse a pair of trees
+#endif
     } else {                                                    // If periodic boundary condition
       int I = 0;                                                //  Initialize index of periodic image
       for( int ix=-1; ix<=1; ++ix ) {                           //  Loop over x periodic direction
@@ -381,59 +583,144 @@ public:
             Xperiodic[1] = iy * 2 * R0;                         //     Coordinate offset for y periodic direction
             Xperiodic[2] = iz * 2 * R0;                         //     Coordinate offset for z periodic direction
             Pair pair(root,jroot);                              //     Form pair of root cells
+#if QUARK
             traverseQueue(pair);                                //     Traverse a pair of trees
+#else
+            traverseParallel(pair);                             //     Traverse a pair of trees
+#endif
           }                                                     //    End loop over z periodic direction
         }                                                       //   End loop over y periodic direction
       }                                                         //  End loop over x periodic direction
+    }                                                           // Endif for periodic boundary condition
 #if QUEUE
-      for( C_iter Ci=cells.begin(); Ci!=cells.end(); ++Ci ) {   //  Loop over target cells
-        listM2L[Ci-Ci0].sort();                                 //  Sort interaction list
-        listM2L[Ci-Ci0].unique();                               //  Eliminate duplicate periodic entries
-        listM2P[Ci-Ci0].sort();                                 //  Sort interaction list
-        listM2P[Ci-Ci0].unique();                               //  Eliminate duplicate periodic entries
-        listP2P[Ci-Ci0].sort();                                 //  Sort interaction list
-        listP2P[Ci-Ci0].unique();                               //  Eliminate duplicate periodic entries
-      }                                                         //  End loop over target cells
+    listM2L.build(cells.size());                                // Build M2L list and merge periodic entries
+    listM2P.build(cells.size());                                // Build M2P list and merge periodic entries
+    listP2P.build(cells.size());                                // Build P2P list and merge periodic entries
 #endif
-    }                                                           // Endif for periodic boundary condition
   }
 
-//! Traverse neighbor cells only (for cutoff based methods)
+//! Dual tree traversal of a tree with itself, evaluating each interaction once for both cells
+  void traverseMutual(Cells &cells) {
+#if QUARK
+    traverse(cells,cells);                                      // QUARK only schedules one-sided interactions
+#else
+    Ci0 = Cj0 = cells.begin();                                  // Targets and sources are the same cells
+#if QUEUE
+    listM2L.initialize(getMaxThreads());                        // Per-thread buffers for M2L interaction list
+    listM2P.initialize(getMaxThreads());                        // Per-thread buffers for M2P interaction list
+    listP2P.initialize(getMaxThreads());                        // Per-thread buffers for P2P interaction list
+#endif
+    Iperiodic = Icenter;                                        // Set periodic image flag to center
+    Xperiodic = 0;                                              // Set periodic coordinate offset
+#pragma omp parallel
+#pragma omp single
+    traverseSelf(cells.end()-1);                                // Root task
+#if QUEUE
+    listM2L.build(cells.size());                                // Build M2L list
+    listM2P.build(cells.size());                                // Build M2P list
+    listP2P.build(cells.size());                                // Build P2P list
+#endif
+#endif
+  }
+
+//! Find twig cell pairs within the Ewald real cutoff with a periodic cell list (CUTOFF = 0 uses the end of ERFCTABLE)
   void neighbor(Cells &cells, Cells &jcells) {
-    C_iter jroot = jcells.end() - 1;                            // Iterator for root source cell
     Ci0 = cells.begin();                                        // Set begin iterator for target cells
     Cj0 = jcells.begin();                                       // Set begin iterator for source cells
-    listP2P.resize(cells.size());                               // Resize P2P interaction list
-    flagP2P.resize(cells.size());                               // Resize P2P periodic image flag
-    for( C_iter Ci=cells.begin(); Ci!=cells.end(); ++Ci ) {     // Loop over target cells
-      if( Ci->NCHILD == 0 ) {                                   //  If cell is a twig
-        int I = 0;                                              //   Initialize index of periodic image
-        for( int ix=-1; ix<=1; ++ix ) {                         //   Loop over x periodic direction
-          for( int iy=-1; iy<=1; ++iy ) {                       //    Loop over y periodic direction
-            for( int iz=-1; iz<=1; ++iz, ++I ) {                //     Loop over z periodic direction
-              Iperiodic = 1 << I;                               //      Set periodic image flag
-              Xperiodic[0] = ix * 2 * R0;                       //      Coordinate offset for x periodic direction
-              Xperiodic[1] = iy * 2 * R0;                       //      Coordinate offset for y periodic direction
-              Xperiodic[2] = iz * 2 * R0;                       //      Coordinate offset for z periodic direction
-              traverseStack(Ci,jroot);                          //      Traverse the source tree
-            }                                                   //     End loop over z periodic direction
-          }                                                     //    End loop over y periodic direction
-        }                                                       //   End loop over x periodic direction
-        for( B_iter B=Ci->LEAF; B!=Ci->LEAF+Ci->NCLEAF; ++B) {  //   Loop over all leafs in cell
-          B->TRG[0] -= M_2_SQRTPI * B->SRC * ALPHA;             //    Self term of Ewald real part
-        }                                                       //   End loop over all leafs in cell
+    const real L = 2 * R0;                                      // Period
+    const real cutoff = CUTOFF > 0 ? CUTOFF : ERFCTABLE.size() / 8 / ERFCSCALE / ALPHA;// Real part cutoff
+    const vect Xmin = X0 - R0;                                  // Corner of periodic box
+    std::vector<int> twigs;                                     // Source twig cells
+    real Rmax = 0;                                              // Largest source twig radius
+    for( C_iter Cj=jcells.begin(); Cj!=jcells.end(); ++Cj ) {   // Loop over source cells
+      if( Cj->NCHILD == 0 && Cj->NDLEAF != 0 ) {                //  If cell is a twig with bodies
+        twigs.push_back(Cj-Cj0);                                //   Add to cell list
+        Rmax = std::max(Rmax,Cj->R);                            //   Update largest radius
       }                                                         //  End if for twig cells
-      listP2P[Ci-Ci0].sort();                                   //  Sort interaction list
-      listP2P[Ci-Ci0].unique();                                 //  Eliminate duplicate periodic entries
+    }                                                           // End loop over source cells
+    const int nbin = std::max(1,std::min(int(L / cutoff),int(std::cbrt(twigs.size())) + 1));// Bins per dimension
+    const real width = L / nbin;                                // Bin width
+    std::vector<int> bin(twigs.size()), binOffset(nbin*nbin*nbin+1,0), binCells(twigs.size());
+    for( int n=0; n<int(twigs.size()); ++n ) {                  // Loop over source twigs
+      int b = 0;                                                //  Bin of twig
+      for( int d=0; d<3; ++d ) {                                //  Loop over dimensions
+        int ib = int((Cj0[twigs[n]].X[d] - Xmin[d]) / width);   //   Bin index of center
+        b = b * nbin + std::max(0,std::min(ib,nbin-1));         //   Clamp to box
+      }                                                         //  End loop over dimensions
+      bin[n] = b;                                               //  Store bin
+      binOffset[b+1]++;                                         //  Count twigs in bin
+    }                                                           // End loop over source twigs
+    for( int b=0; b<nbin*nbin*nbin; ++b ) binOffset[b+1] += binOffset[b];// Scan counts
+    std::vector<int> next(binOffset.begin(),binOffset.end()-1); // Fill position of each bin
+    for( int n=0; n<int(twigs.size()); ++n ) binCells[next[bin[n]]++] = twigs[n];// Bucket twigs by bin
+
+    listP2P.initialize(getMaxThreads());                        // Clear lists and buffers
+    listP2P.OFFSET.assign(cells.size()+1,0);                    // Rows are written directly without build
+    for( int pass=0; pass<2; ++pass ) {                         // Count pairs, then fill them
+      if( pass == 1 ) {                                         //  Before filling
+        for( int i=0; i<int(cells.size()); ++i ) listP2P.OFFSET[i+1] += listP2P.OFFSET[i];// Scan counts
+        listP2P.LIST.resize(listP2P.OFFSET.back());             //   Allocate entries
+      }                                                         //  Endif for fill pass
+#pragma omp parallel for schedule(dynamic)
+      for( int i=0; i<int(cells.size()); ++i ) {                //  Loop over target cells
+        C_iter Ci = Ci0 + i;                                    //   Target cell iterator
+        if( Ci->NCHILD != 0 ) continue;                         //   Only twigs have neighbors
+        const real reach = Ci->R + Rmax + cutoff;               //   Farthest center of a neighbor
+        int lo[3], hi[3];                                       //   Range of bins to search
+        for( int d=0; d<3; ++d ) {                              //   Loop over dimensions
+          lo[d] = int(std::floor((Ci->X[d] - reach - Xmin[d]) / width));// First bin
+          hi[d] = int(std::floor((Ci->X[d] + reach - Xmin[d]) / width));// Last bin
+          if( hi[d] - lo[d] + 1 >= nbin ) {                     //    If range wraps around the box
+            lo[d] = 0;                                          //     Visit every bin once
+            hi[d] = nbin - 1;                                   //     without periodic copies
+          }                                                     //    Endif for wrapping range
+        }                                                       //   End loop over dimensions
+        int count = 0;                                          //   Number of neighbors
+        Interaction *entry = pass ? &listP2P.LIST[0] + listP2P.OFFSET[i] : NULL;// Row of target
+        for( int ix=lo[0]; ix<=hi[0]; ++ix ) {                  //   Loop over x bins
+          for( int iy=lo[1]; iy<=hi[1]; ++iy ) {                //    Loop over y bins
+            for( int iz=lo[2]; iz<=hi[2]; ++iz ) {              //     Loop over z bins
+              int b = ((ix + nbin) % nbin * nbin + (iy + nbin) % nbin) * nbin + (iz + nbin) % nbin;
+              for( int n=binOffset[b]; n<binOffset[b+1]; ++n ) {//      Loop over twigs in bin
+                C_iter Cj = Cj0 + binCells[n];                  //       Source cell iterator
+                real R2 = 0;                                    //       Squared gap between cell boxes
+                int I = 0;                                      //       Index of periodic image
+                for( int d=0; d<3; ++d ) {                      //       Loop over dimensions
+                  real dX = Ci->X[d] - Cj->X[d];                //        Distance between centers
+                  int image = int(std::floor(dX / L + .5f));    //        Nearest periodic image
+                  real gap = std::abs(dX - image * L) - Ci->R - Cj->R;// Gap between cell boxes
+                  if( gap > 0 ) R2 += gap * gap;                //        Accumulate squared gap
+                  I = I * 3 + std::max(-1,std::min(image,1)) + 1;//       Image index as in the 27 image loop
+                }                                               //       End loop over dimensions
+                if( R2 >= cutoff * cutoff ) continue;           //       Skip twigs beyond cutoff
+                if( pass ) {                                    //       If filling
+                  entry[count].CELL = Cj - Cj0;                 //        Source cell
+                  entry[count].IPERIODIC = 1 << I;              //        Periodic image flag
+                }                                               //       Endif for fill pass
+                count++;                                        //       Count neighbor
+              }                                                 //      End loop over twigs in bin
+            }                                                   //     End loop over z bins
+          }                                                     //    End loop over y bins
+        }                                                       //   End loop over x bins
+        if( pass == 0 ) listP2P.OFFSET[i+1] = count;            //   Store row length when counting
+      }                                                         //  End loop over target cells
+    }                                                           // End loop over passes
+#pragma omp parallel for
+    for( int i=0; i<int(cells.size()); ++i ) {                  // Loop over target cells
+      C_iter Ci = Ci0 + i;                                      //  Target cell iterator
+      if( Ci->NCHILD != 0 ) continue;                           //  Only twigs own their leafs
+      for( B_iter B=Ci->LEAF; B!=Ci->LEAF+Ci->NCLEAF; ++B ) {   //  Loop over all leafs in cell
+        B->TRG[0] -= M_2_SQRTPI * B->SRC * ALPHA;               //   Self term of Ewald real part
+      }                                                         //  End loop over all leafs in cell
     }                                                           // End loop over target cells
   }
 
   void setSourceBody();                                         //!< Set source buffer for bodies (for GPU)
   void setSourceCell(bool isM);                                 //!< Set source buffer for cells (for GPU)
-  void setTargetBody(Lists lists, Maps flags);                  //!< Set target buffer for bodies (for GPU)
-  void setTargetCell(Lists lists, Maps flags);                  //!< Set target buffer for cells (for GPU)
-  void getTargetBody(Lists &lists);                             //!< Get body values from target buffer (for GPU)
-  void getTargetCell(Lists &lists, bool isM);                   //!< Get cell values from target buffer (for GPU)
+  void setTargetBody(const InteractionList &list, C_iter CjB);  //!< Set target buffer for bodies (for GPU)
+  void setTargetCell(const InteractionList &list, C_iter CjB);  //!< Set target buffer for cells (for GPU)
+  void getTargetBody(const InteractionList &list);              //!< Get body values from target buffer (for GPU)
+  void getTargetCell(const InteractionList &list, bool isM);    //!< Get cell values from target buffer (for GPU)
   void clearBuffers();                                          //!< Clear GPU buffers
 
   void evalP2P(Bodies &ibodies, Bodies &jbodies, bool onCPU=false);//!< Evaluate all P2P kernels (all pairs)
@@ -445,11 +732,11 @@ public:
   void evalM2P(C_iter Ci, C_iter Cj);                           //!< Evaluate on CPU, queue on GPU
   void evalM2P(Cells &cells);                                   //!< Evaluate queued M2P kernels
   void evalP2P(C_iter Ci, C_iter Cj);                           //!< Evaluate on CPU, queue on GPU
+  void evalP2PMutual(C_iter Ci, C_iter Cj);                     //!< Evaluate once for both cells on CPU, queue both on GPU
   void evalP2P(Cells &cells);                                   //!< Evaluate queued P2P kernels (near field)
   void evalL2L(Cells &cells);                                   //!< Evaluate all L2L kernels
   void evalL2P(Cells &cells);                                   //!< Evaluate all L2P kernels
-  void evalEwaldReal(C_iter Ci, C_iter Cj);                     //!< Evaluate on CPU, queue on GPU
-  void evalEwaldReal(Cells &cells);                             //!< Evaluate queued Ewald real kernels
+  void evalEwaldReal(Cells &cells);                             //!< Evaluate Ewald real kernels of neighbor lists
 };
 
 #if CPU
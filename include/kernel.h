@@ -33,9 +33,35 @@ protected:
   int                  ATOMS;                                   //!< Number of atom types in Van der Waals
   std::vector<real>    RSCALE;                                  //!< Scaling parameter for Van der Waals
   std::vector<real>    GSCALE;                                  //!< Scaling parameter for Van der Waals
+  bool                 CUTOFFSKIP;                              //!< Skip Van der Waals cell pairs outside R2MAX
+  bool                 COULOMBVDW;                              //!< Add Van der Waals within R2MAX to Laplace P2P
+  bool                 VDWCUTOFF;                               //!< Van der Waals kernel uses P2P for all cell pairs within R2MAX
+  std::vector<int>     VDWITYPE;                                //!< Atom types of target bodies (tree order, combined mode only)
+  std::vector<int>     VDWJTYPE;                                //!< Atom types of source bodies (tree order, combined mode only)
+  mutable std::vector<vec<4,real> > VDWTRG;                     //!< Van der Waals potential+force of target bodies (tree order)
+  B_iter               VDWI0;                                   //!< First target body of atom types
+  B_iter               VDWJ0;                                   //!< First source body of atom types
+  std::vector<int>     EXCLUDEOFFSET;                           //!< Offsets of excluded sources of each target body
+  std::vector<int>     EXCLUDE;                                 //!< Excluded sources (tree order, sorted for each target)
+  mutable std::vector<char> EXCLUDESKIP;                        //!< Excluded pairs already skipped by P2P
+  B_iter               EXCLUDEI0;                               //!< First target body of exclusion lists
+  B_iter               EXCLUDEJ0;                               //!< First source body of exclusion lists
+  int                  EXCLUDENJ;                               //!< Number of source bodies of exclusion lists
+  mutable BodiesSoA    SOAI;                                    //!< Target bodies in tree order during the downward phase
+  mutable BodiesSoA    SOAJ;                                    //!< Source bodies in tree order (empty if same as targets)
+  B_iter               SOAI0;                                   //!< First target body of structure of arrays
+  B_iter               SOAJ0;                                   //!< First source body of structure of arrays
   real                 KSIZE;                                   //!< Number of waves in Ewald summation
   real                 ALPHA;                                   //!< Scaling parameter for Ewald summation
   real                 SIGMA;                                   //!< Scaling parameter for Ewald summation
+  real                 CUTOFF;                                  //!< Cutoff radius of Ewald real part (0 for erfc below tolerance)
+  std::vector<real>    ERFCTABLE;                               //!< Cubic pieces of erfc(s) and exp(-s^2) for Ewald real part
+  real                 ERFCSCALE;                               //!< Inverse width of pieces in ERFCTABLE
+  int                  SPMEGRID;                                //!< Grid points per dimension of SPME (0 for DFT)
+  int                  SPMEORDER;                               //!< Order of B-splines in SPME
+  SIMDType             SIMDLEVEL;                               //!< SIMD instruction set used by P2P kernels
+  bool                 ROTATEM2L;                               //!< Use rotation based M2L for spherical expansions
+  int                  ORDER;                                   //!< Order of expansions used by the kernels
 
   std::vector<int>     keysHost;                                //!< Offsets for rangeHost
   std::vector<int>     rangeHost;                               //!< Offsets for sourceHost
@@ -58,6 +84,9 @@ protected:
   real *prefactor;                                              //!< \f$ \sqrt{ \frac{(n - |m|)!}{(n + |m|)!} } \f$
   real *Anm;                                                    //!< \f$ (-1)^n / \sqrt{ \frac{(n + m)!}{(n - m)!} } \f$
   complex *Cnm;                                                 //!< M2L translation matrix \f$ C_{jn}^{km} \f$
+  mutable Coefs        multipoles;                              //!< Multipole coefficients of all cells
+  mutable Coefs        locals;                                  //!< Local coefficients of all cells
+  std::vector<int>     freeCoefs;                               //!< Indices of released coefficient slots
 public:
   vect X0;                                                      //!< Center of root cell
   real R0;                                                      //!< Radius of root cell
@@ -71,6 +100,54 @@ private:
     return std::sqrt( dx*dx + dy*dy + dz*dz );
   }
 
+//! Detect widest SIMD instruction set supported by this build and CPU
+  static SIMDType getSIMDSupport() {
+#if SIMD && (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    __builtin_cpu_init();                                       // Initialize CPU feature detection
+    if( __builtin_cpu_supports("avx512f") ) return SIMDAVX512;  // AVX-512F
+    if( __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ) return SIMDAVX2;// AVX2 + FMA
+    if( __builtin_cpu_supports("sse4.1") ) return SIMDSSE;      // SSE4.1
+#endif
+    return SIMDNone;                                            // Scalar fallback
+  }
+
+//! Wigner small-d matrix element \f$ d^n_{mk}(\theta) \f$
+  static double wignerD(int n, int m, int k, double theta) {
+    double c = std::cos(theta / 2);                             // cos(theta / 2)
+    double s = std::sin(theta / 2);                             // sin(theta / 2)
+    double fact[2*PMAX];                                        // Factorials up to (2n)!
+    fact[0] = 1;                                                // Initialize factorial
+    for( int i=1; i<=2*n; ++i ) fact[i] = fact[i-1] * i;        // i!
+    double d = 0;                                               // Initialize sum
+    for( int l=std::max(0,k-m); l<=std::min(n-m,n+k); ++l ) {   // Loop over terms of Wigner's formula
+      d += ODDEVEN(m-k+l) * std::pow(c,2*n-m+k-2*l) * std::pow(s,m-k+2*l)
+         / (fact[n+k-l] * fact[l] * fact[m-k+l] * fact[n-m-l]);
+    }                                                           // End loop over terms
+    return d * std::sqrt(fact[n+m] * fact[n-m] * fact[n+k] * fact[n-k]);
+  }
+
+//! Coefficients of rotation by theta about the y axis, forward (multipoles) then backward (locals)
+  void setRotation(double theta, std::vector<real> &rotation) const {
+    int size = ORDER * (ORDER + 1) * (2 * ORDER + 1) / 3;       // Two reals for each of (n+1)^2 pairs per n
+    rotation.resize(2 * size);                                  // Forward and backward directions
+    real *forward = &rotation[0];                               // Forward rotation coefficients
+    real *backward = forward + size;                            // Backward rotation coefficients
+    for( int n=0; n!=ORDER; ++n ) {                             // Loop over n
+      for( int k=0; k<=n; ++k ) {                               //  Loop over output order k
+        for( int m=0; m<=n; ++m ) {                             //   Loop over input order m
+          real mk = wignerD(n,m,k,theta);                       //    Coefficient of M_n^m in rotated M_n^k
+          real km = wignerD(n,k,m,theta);                       //    Coefficient of L_n^m in rotated L_n^k
+          real mkc = m == 0 ? 0 : ODDEVEN(m) * wignerD(n,-m,k,theta);// Coefficient of M_n^-m = conj(M_n^m)
+          real kmc = m == 0 ? 0 : ODDEVEN(m) * wignerD(n,k,-m,theta);// Coefficient of L_n^-m = conj(L_n^m)
+          *forward++  = mk + mkc;                               //    Applied to real part of M_n^m
+          *forward++  = mk - mkc;                               //    Applied to imaginary part of M_n^m
+          *backward++ = km + kmc;                               //    Applied to real part of L_n^m
+          *backward++ = km - kmc;                               //    Applied to imaginary part of L_n^m
+        }                                                       //   End loop over input order m
+      }                                                         //  End loop over output order k
+    }                                                           // End loop over n
+  }
+
 protected:
   void setCenter(C_iter C) const {
     real m = 0;
@@ -80,8 +157,8 @@ protected:
       X += B->X * std::abs(B->SRC);
     }
     for( C_iter c=Cj0+C->CHILD; c!=Cj0+C->CHILD+C->NCHILD; ++c ) {
-      m += std::abs(c->M[0]);
-      X += c->X * std::abs(c->M[0]);
+      m += std::abs(getM(c)[0]);
+      X += c->X * std::abs(getM(c)[0]);
     }
     X /= m;
     C->R = getBmax(X,C);
@@ -96,7 +173,7 @@ protected:
     real fact = 1;                                              // Initialize 2 * m + 1
     real pn = 1;                                                // Initialize Legendre polynomial Pn
     real rhom = 1;                                              // Initialize rho^m
-    for( int m=0; m!=P; ++m ) {                                 // Loop over m in Ynm
+    for( int m=0; m!=ORDER; ++m ) {                             // Loop over m in Ynm
       complex eim = std::exp(I * real(m * beta));               //  exp(i * m * beta)
       real p = pn;                                              //  Associated Legendre polynomial Pnm
       int npn = m * m + 2 * m;                                  //  Index of Ynm for m > 0
@@ -108,7 +185,7 @@ protected:
       YnmTheta[npn] = rhom * (p - (m + 1) * x * p1) / y * prefactor[npn] * eim;// theta derivative of r^n * Ynm
       rhom *= rho;                                              //  rho^m
       real rhon = rhom;                                         //  rho^n
-      for( int n=m+1; n!=P; ++n ) {                             //  Loop over n in Ynm
+      for( int n=m+1; n!=ORDER; ++n ) {                         //  Loop over n in Ynm
         int npm = n * n + n + m;                                //   Index of Ynm for m > 0
         int nmm = n * n + n - m;                                //   Index of Ynm for m < 0
         Ynm[npm] = rhon * p * prefactor[npm] * eim;             //   rho^n * Ynm
@@ -132,7 +209,7 @@ protected:
     real fact = 1;                                              // Initialize 2 * m + 1
     real pn = 1;                                                // Initialize Legendre polynomial Pn
     real rhom = 1.0 / rho;                                      // Initialize rho^(-m-1)
-    for( int m=0; m!=P; ++m ) {                                 // Loop over m in Ynm
+    for( int m=0; m!=ORDER; ++m ) {                             // Loop over m in Ynm
       complex eim = std::exp(I * real(m * beta));               //  exp(i * m * beta)
       real p = pn;                                              //  Associated Legendre polynomial Pnm
       int npn = m * m + 2 * m;                                  //  Index of Ynm for m > 0
@@ -144,7 +221,7 @@ protected:
       YnmTheta[npn] = rhom * (p - (m + 1) * x * p1) / y * prefactor[npn] * eim;// theta derivative of r^n * Ynm
       rhom /= rho;                                              //  rho^(-m-1)
       real rhon = rhom;                                         //  rho^(-n-1)
-      for( int n=m+1; n!=P; ++n ) {                             //  Loop over n in Ynm
+      for( int n=m+1; n!=ORDER; ++n ) {                         //  Loop over n in Ynm
         int npm = n * n + n + m;                                //   Index of Ynm for m > 0
         int nmm = n * n + n - m;                                //   Index of Ynm for m < 0
         Ynm[npm] = rhon * p * prefactor[npm] * eim;             //   rho^n * Ynm for m > 0
@@ -160,30 +237,151 @@ protected:
     }                                                           // End loop over m in Ynm
   }
 
+//! Get rotation coefficients for polar angle theta, cached per thread (scratch is used once the cache is full)
+  const real *getRotation(real theta, std::vector<real> &rotation) const {
+    static thread_local Rotations cache;                        // Cache of this thread, shared by all kernels
+    const int bytes = 4 * ORDER * (ORDER + 1) * (2 * ORDER + 1) / 3 * sizeof(real);// Size of one entry
+    const int angle = int(theta * 1e6 + .5);                    // Quantize polar angle to a micro radian
+    const int key = angle * (PMAX + 1) + ORDER;                 // Coefficients depend on order
+    RO_iter R = cache.find(key);                                // Look up polar angle in cache
+    if( R != cache.end() ) return &R->second[0];                // Return cached coefficients
+    if( cache.size() * bytes >= (16 << 20) ) {                  // If cache is full (irregular cell centers)
+      setRotation(angle * 1e-6,rotation);                       //  Calculate coefficients into scratch vector
+      return &rotation[0];                                      //  Return scratch coefficients
+    }                                                           // Endif for full cache
+    std::vector<real> &cached = cache[key];                     // Insert new entry into cache
+    setRotation(angle * 1e-6,cached);                           // Calculate coefficients into cache
+    return &cached[0];                                          // Return cached coefficients
+  }
+
 public:
 //! Constructor
-  KernelBase() : Ci0(), Cj0(), ATOMS(), RSCALE(), GSCALE(), KSIZE(), ALPHA(), SIGMA(),
-                 keysHost(), rangeHost(), sourceHost(), targetHost(), constHost(),
+  KernelBase() : Ci0(), Cj0(), ATOMS(), RSCALE(), GSCALE(), CUTOFFSKIP(true), COULOMBVDW(false), VDWCUTOFF(false),
+                 VDWITYPE(), VDWJTYPE(), VDWTRG(), VDWI0(), VDWJ0(),
+                 EXCLUDEOFFSET(), EXCLUDE(), EXCLUDESKIP(), EXCLUDEI0(), EXCLUDEJ0(), EXCLUDENJ(0), SOAI(), SOAJ(), SOAI0(), SOAJ0(), KSIZE(), ALPHA(), SIGMA(), CUTOFF(0), ERFCTABLE(), ERFCSCALE(0), SPMEGRID(0), SPMEORDER(6),
+                 SIMDLEVEL(getSIMDSupport()), ROTATEM2L(true), ORDER(P), keysHost(), rangeHost(), sourceHost(), targetHost(), constHost(),
                  sourceBegin(), sourceSize(), targetBegin(),
                  keysDevcSize(0), rangeDevcSize(0),
                  sourceDevcSize(0), targetDevcSize(0),
                  keysDevc(), rangeDevc(), sourceDevc(), targetDevc(),
-                 factorial(), prefactor(), Anm(), Cnm(),
+                 factorial(), prefactor(), Anm(), Cnm(), multipoles(), locals(), freeCoefs(),
                  X0(0), R0(-1/EPS) {}
 //! Destructor
   ~KernelBase() {}
 //! Copy constructor
-  KernelBase(const KernelBase&) : Sort(), Ci0(), Cj0(), ATOMS(), RSCALE(), GSCALE(), KSIZE(), ALPHA(), SIGMA(),
-                 keysHost(), rangeHost(), sourceHost(), targetHost(), constHost(),
+  KernelBase(const KernelBase&) : Sort(), Ci0(), Cj0(), ATOMS(), RSCALE(), GSCALE(), CUTOFFSKIP(true), COULOMBVDW(false), VDWCUTOFF(false),
+                 VDWITYPE(), VDWJTYPE(), VDWTRG(), VDWI0(), VDWJ0(),
+                 EXCLUDEOFFSET(), EXCLUDE(), EXCLUDESKIP(), EXCLUDEI0(), EXCLUDEJ0(), EXCLUDENJ(0), SOAI(), SOAJ(), SOAI0(), SOAJ0(), KSIZE(), ALPHA(), SIGMA(), CUTOFF(0), ERFCTABLE(), ERFCSCALE(0), SPMEGRID(0), SPMEORDER(6),
+                 SIMDLEVEL(getSIMDSupport()), ROTATEM2L(true), ORDER(P), keysHost(), rangeHost(), sourceHost(), targetHost(), constHost(),
                  sourceBegin(), sourceSize(), targetBegin(),
                  keysDevcSize(0), rangeDevcSize(0),
                  sourceDevcSize(0), targetDevcSize(0),
                  keysDevc(), rangeDevc(), sourceDevc(), targetDevc(),
-                 factorial(), prefactor(), Anm(), Cnm(),
+                 factorial(), prefactor(), Anm(), Cnm(), multipoles(), locals(), freeCoefs(),
                  X0(0), R0(-1/EPS) {}
 //! Overload assignment
   KernelBase &operator=(const KernelBase) {return *this;}
 
+//! Set SIMD instruction set (capped by what the CPU supports)
+  void setSIMD(SIMDType simd) {SIMDLEVEL = std::min(simd,getSIMDSupport());}
+//! Get SIMD instruction set
+  SIMDType getSIMD() const {return SIMDLEVEL;}
+//! Get number of targets per vector in P2P kernels
+  int getSIMDWidth() const {
+    const int bytes = SIMDLEVEL == SIMDAVX512 ? 64 : SIMDLEVEL == SIMDAVX2 ? 32 : SIMDLEVEL == SIMDSSE ? 16 : 0;
+    return std::max(bytes / int(sizeof(real)),1);               // Lanes of real in a register
+  }
+
+//! Set order of expansions (up to PMAX for spherical expansions on CPU, P otherwise)
+  void setOrder(int order) {
+#if Spherical && CPU
+    assert( 0 < order && order <= PMAX );                       // Tables are allocated for PMAX
+#else
+    assert( order == P );                                       // Order is fixed at compile time
+#endif
+    ORDER = order;                                              // Set order of expansions
+    clearCoef();                                                // Coefficient strides depend on order
+  }
+//! Get order of expansions
+  int getOrder() const {return ORDER;}
+
+//! Get number of multipole coefficients per cell
+  int getNumM() const {
+#if Cartesian
+    return MTERM;
+#else
+    return ORDER * (ORDER + 1) / 2;
+#endif
+  }
+//! Get number of local coefficients per cell
+  int getNumL() const {
+#if Cartesian
+    return LTERM;
+#else
+    return ORDER * (ORDER + 1) / 2;
+#endif
+  }
+
+//! Get number of cells that have coefficients allocated
+  int getNumCoef() const {return multipoles.size() / getNumM() - freeCoefs.size();}
+
+//! Get multipole coefficients of cell (valid until the next newCoef or copyCoef)
+  Coef *getM(const Cell &cell) const {return &multipoles[cell.ICOEF*getNumM()];}
+//! Get multipole coefficients of cell
+  Coef *getM(C_iter C) const {return getM(*C);}
+//! Get local coefficients of cell (valid until the next newCoef or copyCoef)
+  Coef *getL(const Cell &cell) const {return &locals[cell.ICOEF*getNumL()];}
+//! Get local coefficients of cell
+  Coef *getL(C_iter C) const {return getL(*C);}
+
+//! Allocate zeroed multipole and local coefficients for cell, reusing released slots first
+//! Copies of a cell (e.g. jcells = cells) share its slot; only one of them may release it
+  void newCoef(Cell &cell) {
+    if( freeCoefs.empty() ) {                                   // If no slot was released
+      cell.ICOEF = multipoles.size() / getNumM();               //  Index of next free coefficients
+      multipoles.resize(multipoles.size()+getNumM(),Coef(0));   //  Append zeroed multipole coefficients
+      locals.resize(locals.size()+getNumL(),Coef(0));           //  Append zeroed local coefficients
+    } else {                                                    // Else reuse a released slot
+      cell.ICOEF = freeCoefs.back();                            //  Index of released coefficients
+      freeCoefs.pop_back();                                     //  Slot is taken
+      std::fill(getM(cell),getM(cell)+getNumM(),Coef(0));       //  Zero multipole coefficients
+      std::fill(getL(cell),getL(cell)+getNumL(),Coef(0));       //  Zero local coefficients
+    }                                                           // Endif for released slot
+  }
+//! Give cell its own copy of the coefficients it currently points to
+  void copyCoef(Cell &cell) {
+    int icoef = cell.ICOEF;                                     // Index of coefficients to copy
+    newCoef(cell);                                              // Allocate new coefficients
+    std::copy(multipoles.begin()+icoef*getNumM(),multipoles.begin()+(icoef+1)*getNumM(),
+              multipoles.begin()+cell.ICOEF*getNumM());         // Copy multipole coefficients
+    std::copy(locals.begin()+icoef*getNumL(),locals.begin()+(icoef+1)*getNumL(),
+              locals.begin()+cell.ICOEF*getNumL());             // Copy local coefficients
+  }
+//! Release coefficients of cell for reuse by the next newCoef
+  void freeCoef(Cell &cell) {
+    if( 0 <= cell.ICOEF && cell.ICOEF < int(multipoles.size()) / getNumM() ) {// If slot is still in the pool
+      freeCoefs.push_back(cell.ICOEF);                          //  Put slot on free list
+    }                                                           // Endif for slot in pool
+    cell.ICOEF = -1;                                            // Cell has no coefficients
+  }
+//! Release coefficients of all cells
+  void freeCoef(Cells &cells) {
+    for( C_iter C=cells.begin(); C!=cells.end(); ++C ) {        // Loop over cells
+      freeCoef(*C);                                             //  Release coefficients of cell
+    }                                                           // End loop over cells
+  }
+//! Release coefficients of all cells (invalidates ICOEF of existing cells)
+  void clearCoef() {
+    multipoles.clear();                                         // Clear multipole coefficients
+    locals.clear();                                             // Clear local coefficients
+    freeCoefs.clear();                                          // Clear free list
+  }
+
+//! Switch between rotation based O(p^3) and direct O(p^4) M2L for spherical expansions
+  void setM2LRotation(bool rotate) {ROTATEM2L = rotate;}
+//! Get whether M2L uses rotations
+  bool getM2LRotation() const {return ROTATEM2L;}
+
 //! Set center of root cell
   void setX0(vect x0) {X0 = x0;}
 //! Set radius of root cell
@@ -230,17 +428,17 @@ public:
 //! Precalculate M2L translation matrix
   void preCalculation() {
     const complex I(0.,1.);                                     // Imaginary unit
-    factorial = new real  [P];                                  // Factorial
-    prefactor = new real  [P*P];                                // sqrt( (n - |m|)! / (n + |m|)! )
-    Anm       = new real  [P*P];                                // (-1)^n / sqrt( (n + m)! / (n - m)! )
-    Cnm       = new complex [P*P*P*P];                          // M2L translation matrix Cjknm
+    factorial = new real  [PMAX];                               // Factorial
+    prefactor = new real  [PMAX*PMAX];                          // sqrt( (n - |m|)! / (n + |m|)! )
+    Anm       = new real  [PMAX*PMAX];                          // (-1)^n / sqrt( (n + m)! / (n - m)! )
+    Cnm       = new complex [PMAX*PMAX*PMAX*PMAX];              // M2L translation matrix Cjknm
 
     factorial[0] = 1;                                           // Initialize factorial
-    for( int n=1; n!=P; ++n ) {                                 // Loop to P
+    for( int n=1; n!=PMAX; ++n ) {                              // Loop to PMAX
       factorial[n] = factorial[n-1] * n;                        //  n!
-    }                                                           // End loop to P
+    }                                                           // End loop to PMAX
 
-    for( int n=0; n!=P; ++n ) {                                 // Loop over n in Anm
+    for( int n=0; n!=PMAX; ++n ) {                              // Loop over n in Anm
       for( int m=-n; m<=n; ++m ) {                              //  Loop over m in Anm
         int nm = n*n+n+m;                                       //   Index of Anm
         int nabsm = abs(m);                                     //   |m|
@@ -257,10 +455,14 @@ public:
       }                                                         //  End loop over m in Anm
     }                                                           // End loop over n in Anm
 
-    for( int j=0, jk=0, jknm=0; j!=P; ++j ) {                   // Loop over j in Cjknm
+    for( int j=0, jk=0, jknm=0; j!=PMAX; ++j ) {                // Loop over j in Cjknm
       for( int k=-j; k<=j; ++k, ++jk ){                         //  Loop over k in Cjknm
-        for( int n=0, nm=0; n!=P; ++n ) {                       //   Loop over n in Cjknm
+        for( int n=0, nm=0; n!=PMAX; ++n ) {                    //   Loop over n in Cjknm
           for( int m=-n; m<=n; ++m, ++nm, ++jknm ) {            //    Loop over m in Cjknm
+            if( j+n >= PMAX ) {                                 //     If C_{j+n}^{m-k} is beyond truncation
+              Cnm[jknm] = 0;                                    //      M2L never uses this entry
+              continue;                                         //      Skip to next m
+            }                                                   //     Endif for truncation
             const int jnkm = (j+n)*(j+n)+j+n+m-k;               //     Index C_{j+n}^{m-k}
             Cnm[jknm] = std::pow(I,real(abs(k-m)-abs(k)-abs(m)))//     Cjknm
                       * real(ODDEVEN(j)*Anm[nm]*Anm[jk]/Anm[jnkm]) * EPS;
@@ -278,10 +480,116 @@ public:
     delete[] Cnm;                                               // Free M2L translation matrix Cjknm
   }
 
-//! Set paramters for Van der Waals
-  void setVanDerWaals(int atoms, double *rscale, double *gscale) {
+//! Minimum R^2 between the boxes of two cells (including periodic offset)
+  real getR2min(C_iter Ci, C_iter Cj) const {
+    real R2 = 0;                                                // Minimum R^2 between the two cells
+    for( int d=0; d!=3; ++d ) {                                 // Loop over dimensions
+      real gap = std::abs(Ci->X[d] - Cj->X[d] - Xperiodic[d]) - Ci->R - Cj->R;// Gap between cell boxes
+      if( gap > 0 ) R2 += gap * gap;                            //  Accumulate squared gap
+    }                                                           // End loop over dimensions
+    return R2;                                                  // Zero if boxes overlap
+  }
+
+//! Check if Van der Waals (alone or combined with Coulomb) has to use P2P between two cells
+  bool insideCutoff(C_iter Ci, C_iter Cj) const {
+    return (COULOMBVDW || VDWCUTOFF) && getR2min(Ci,Cj) < R2MAX;// Van der Waals has no multipole expansion
+  }
+
+//! Set paramters for Van der Waals (cutoffSkip drops cell pairs whose boxes are farther apart than sqrt(R2MAX))
+  void setVanDerWaals(int atoms, double *rscale, double *gscale, bool cutoffSkip=true) {
+    CUTOFFSKIP = cutoffSkip;                                    // Set flag for cutoff-aware cell pair skip
+    VDWCUTOFF = true;                                           // Cell pairs within the cutoff are never accepted by the MAC
+    setAtomTypes(atoms,rscale,gscale);                          // Set parameters of atom type pairs
+  }
+
+//! Set paramters for Van der Waals computed within the Laplace P2P kernel (atom types are set by setVanDerWaalsTypes)
+  void setCoulombVanDerWaals(int atoms, double *rscale, double *gscale) {
+    COULOMBVDW = true;                                          // Laplace P2P also evaluates Van der Waals
+    setAtomTypes(atoms,rscale,gscale);                          // Set parameters of atom type pairs
+  }
+
+//! Set atom types of the combined mode, once the trees are built (atypei and atypej in caller's order)
+  void setVanDerWaalsTypes(Bodies &bodies, Bodies &jbodies, const int *atypei, const int *atypej) {
+    const int ni = bodies.size(), nj = jbodies.size();          // Number of target and source bodies
+    VDWITYPE.resize(ni);                                        // Resize target atom types
+    VDWJTYPE.resize(nj);                                        // Resize source atom types
+    for( int b=0; b<ni; ++b ) VDWITYPE[b] = atypei[bodies[b].IBODY];// Target atom types in tree order
+    for( int b=0; b<nj; ++b ) VDWJTYPE[b] = atypej[jbodies[b].IBODY];// Source atom types in tree order
+    VDWTRG.assign(ni,vec<4,real>(0));                           // Clear Van der Waals target values
+    VDWI0 = bodies.begin();                                     // First target body
+    VDWJ0 = jbodies.begin();                                    // First source body
+  }
+
+//! Clear Van der Waals target values of the combined mode
+  void clearVanDerWaals() {
+    VDWTRG.assign(VDWTRG.size(),vec<4,real>(0));                // Types are kept for the next evaluation
+  }
+
+//! Van der Waals potential+force of a target body of the combined mode
+  const vec<4,real> &getVanDerWaals(B_iter B) const {
+    return VDWTRG[B-VDWI0];                                     // Side array is in tree order
+  }
+
+//! Check if the atom types of both cells are known to the combined mode
+  bool hasVanDerWaalsTypes(C_iter Ci, C_iter Cj) const {
+    const int ibegin = Ci->LEAF - VDWI0;                        // First target in tree order
+    const int jbegin = Cj->LEAF - VDWJ0;                        // First source in tree order
+    if( ibegin < 0 || ibegin+Ci->NDLEAF > int(VDWITYPE.size()) ) return false;// Targets are not in the side arrays
+    return jbegin >= 0 && jbegin+Cj->NDLEAF <= int(VDWJTYPE.size());// Sources are in the side arrays
+  }
+
+//! Copy n bodies starting at begin into a structure of arrays and clear its targets (in parallel)
+  void gatherSoA(BodiesSoA &soa, B_iter begin, int n) const {
+    soa.resize(n);                                              // Resize arrays (keeps capacity)
+#pragma omp parallel for
+    for( int i=0; i<n; ++i ) {                                  // Loop over bodies
+      for( int d=0; d!=3; ++d ) soa.X[d][i] = begin[i].X[d];    //  Copy position
+      soa.SRC[i] = begin[i].SRC;                                //  Copy source
+      for( int d=0; d!=4; ++d ) soa.TRG[d][i] = 0;              //  Initialize target values
+    }                                                           // End loop over bodies
+  }
+
+//! Gather bodies of the target and source trees once into structures of arrays for the P2P kernels
+  void gatherBodies(Cells &cells, Cells &jcells) {
+    C_iter Ci = cells.end() - 1, Cj = jcells.end() - 1;        // Root cells
+    gatherSoA(SOAI,Ci->LEAF,Ci->NDLEAF);                        // Gather target bodies
+    SOAI0 = Ci->LEAF;                                           // First target body
+    if( Cj->LEAF == Ci->LEAF && Cj->NDLEAF == Ci->NDLEAF ) {    // If sources are the targets
+      SOAJ.resize(0);                                           //  Sources are read from target arrays
+    } else {                                                    // If sources are different bodies
+      gatherSoA(SOAJ,Cj->LEAF,Cj->NDLEAF);                      //  Gather source bodies
+    }                                                           // Endif for same bodies
+    SOAJ0 = Cj->LEAF;                                           // First source body
+  }
+
+//! Add target values of the structure of arrays back to the bodies
+  void scatterBodies() {
+    const int ni = SOAI.size();                                 // Number of target bodies
+#pragma omp parallel for
+    for( int i=0; i<ni; ++i ) {                                 // Loop over target bodies in tree order
+      for( int d=0; d!=4; ++d ) SOAI0[i].TRG[d] += SOAI.TRG[d][i];//  Accumulate target values
+    }                                                           // End loop over target bodies
+    SOAI.resize(0);                                             // Keep capacity for the next evaluation
+    SOAJ.resize(0);                                             // Keep capacity for the next evaluation
+  }
+
+//! Check if the bodies of both cells are in the structures of arrays
+  bool hasBodiesSoA(C_iter Ci, C_iter Cj) const {
+    if( SOAI.size() == 0 ) return false;                        // Not in the downward phase
+    const long ibegin = Ci->LEAF - SOAI0;                       // First target in structure of arrays
+    const long jbegin = Cj->LEAF - SOAJ0;                       // First source in structure of arrays
+    if( ibegin < 0 || ibegin+Ci->NDLEAF > SOAI.size() ) return false;// Targets are not in the arrays
+    return jbegin >= 0 && jbegin+Cj->NDLEAF <= getSourcesSoA().size();// Sources are in the arrays
+  }
+
+//! Structure of arrays holding the source bodies
+  BodiesSoA &getSourcesSoA() const {
+    return SOAJ.size() == 0 && SOAJ0 == SOAI0 ? SOAI : SOAJ;    // Targets double as sources
+  }
+
+//! Set scaling parameters of all atom type pairs
+  void setAtomTypes(int atoms, double *rscale, double *gscale) {
 //    assert(atoms <= 16);                                        // Change GPU constant memory alloc if needed
-    THETA = .1;                                                 // Force opening angle to be small
     ATOMS = atoms;                                              // Set number of atom types
     RSCALE.resize(ATOMS*ATOMS);                                 // Resize rscale vector
     GSCALE.resize(ATOMS*ATOMS);                                 // Resize gscale vector
@@ -291,11 +599,151 @@ public:
     }                                                           // End loop over scale vector
   }
 
-//! Set paramters for Ewald summation
-  void setEwald(real ksize, real alpha, real sigma) {
+//! Set pairs excluded from the interaction, once the trees are built (numex[i] sources of target i in natex, numbered from base)
+  void setExclusions(Bodies &bodies, Bodies &jbodies, const int *numex, const int *natex, int base=0, bool symmetric=false) {
+    const int ni = bodies.size(), nj = jbodies.size();          // Number of target and source bodies
+    assert( !symmetric || ni == nj );                           // Reverse pairs need sources to be targets
+    std::vector<int> itree(ni), jtree(nj);                      // Position in tree order of caller's index
+    for( int b=0; b<ni; ++b ) itree[bodies[b].IBODY] = b;       // Invert target permutation
+    for( int b=0; b<nj; ++b ) jtree[jbodies[b].IBODY] = b;      // Invert source permutation
+    std::vector<int> offset(ni+1,0);                            // Offsets of natex for caller's index
+    for( int i=0; i<ni; ++i ) offset[i+1] = offset[i] + numex[i];// Scan number of exclusions
+    EXCLUDEOFFSET.assign(ni+1,0);                               // Initialize offsets in tree order
+    for( int i=0; i<ni; ++i ) {                                 // Loop over targets in caller's order
+      EXCLUDEOFFSET[itree[i]+1] += numex[i];                    //  Count exclusions of target
+      if( symmetric ) {                                         //  If pairs apply in both directions
+        for( int e=offset[i]; e<offset[i+1]; ++e ) EXCLUDEOFFSET[itree[natex[e]-base]+1]++;// Count reverse pairs at source
+      }                                                         //  Endif for symmetric
+    }                                                           // End loop over targets
+    for( int i=0; i<ni; ++i ) EXCLUDEOFFSET[i+1] += EXCLUDEOFFSET[i];// Scan counts into offsets
+    EXCLUDE.resize(EXCLUDEOFFSET[ni]);                          // Allocate excluded sources
+    std::vector<int> next(EXCLUDEOFFSET.begin(),EXCLUDEOFFSET.end()-1);// Next free slot of each target
+    for( int i=0; i<ni; ++i ) {                                 // Loop over targets in caller's order
+      for( int e=offset[i]; e<offset[i+1]; ++e ) {              //  Loop over exclusions of target
+        const int j = natex[e] - base;                          //   Caller's index of excluded source
+        EXCLUDE[next[itree[i]]++] = jtree[j];                   //   Source in tree order
+        if( symmetric ) EXCLUDE[next[itree[j]]++] = jtree[i];   //   Reverse pair
+      }                                                         //  End loop over exclusions
+    }                                                           // End loop over targets
+#pragma omp parallel for
+    for( int i=0; i<ni; ++i ) {                                 // Loop over targets in tree order
+      std::sort(EXCLUDE.begin()+EXCLUDEOFFSET[i],EXCLUDE.begin()+EXCLUDEOFFSET[i+1]);// Sort sources of target
+      next[i] = std::unique(EXCLUDE.begin()+EXCLUDEOFFSET[i],EXCLUDE.begin()+EXCLUDEOFFSET[i+1])
+              - EXCLUDE.begin();                                //  End of pairs listed once
+    }                                                           // End loop over targets
+    int e = 0;                                                  // Number of pairs listed once
+    for( int i=0; i<ni; ++i ) {                                 // Loop over targets in tree order
+      const int begin = EXCLUDEOFFSET[i];                       //  Old offset of target
+      EXCLUDEOFFSET[i] = e;                                     //  New offset of target
+      for( int k=begin; k<next[i]; ++k ) EXCLUDE[e++] = EXCLUDE[k];// Compact sources of target
+    }                                                           // End loop over targets
+    EXCLUDEOFFSET[ni] = e;                                      // End of last target
+    EXCLUDE.resize(e);                                          // Drop duplicate pairs
+    EXCLUDESKIP.assign(EXCLUDE.size(),0);                       // No pair has been skipped yet
+    EXCLUDEI0 = bodies.begin();                                 // First target body
+    EXCLUDEJ0 = jbodies.begin();                                // First source body
+    EXCLUDENJ = nj;                                             // Number of source bodies
+  }
+
+//! Remove all excluded pairs
+  void clearExclusions() {
+    EXCLUDEOFFSET.clear();                                      // Clear offsets
+    EXCLUDE.clear();                                            // Clear excluded sources
+    EXCLUDESKIP.clear();                                        // Clear skip flags
+  }
+
+//! Check if any pair is excluded
+  bool hasExclusions() const {return !EXCLUDE.empty();}
+//! Get number of excluded sources of target body i (tree order)
+  int getNumExclusions(int i) const {return EXCLUDEOFFSET[i+1] - EXCLUDEOFFSET[i];}
+//! Get excluded sources of target body i (tree order, sorted)
+  const int *getExclusions(int i) const {return &EXCLUDE[0] + EXCLUDEOFFSET[i];}
+
+//! Check if the pair with the current periodic offset is the nearest image (the one that is excluded)
+  bool isNearestImage(B_iter Bi, B_iter Bj) const {
+    if( IMAGES == 0 ) return true;                              // Only one image without periodic boundary
+    for( int d=0; d!=3; ++d ) {                                 // Loop over dimensions
+      real dx = Bi->X[d] - Bj->X[d] - Xperiodic[d];             //  Distance with periodic offset
+      if( dx < -R0 || dx >= R0 ) return false;                  //  Closer image exists
+    }                                                           // End loop over dimensions
+    return true;                                                // Nearest image
+  }
+
+//! Mark excluded pairs between two cells as skipped, in bit i%width of word (i/width)*nj+j of mask
+  bool skipExclusions(C_iter Ci, C_iter Cj, int width, std::vector<unsigned> &mask) const {
+    if( EXCLUDE.empty() ) return false;                         // No exclusions
+    const int ni = Ci->NDLEAF, nj = Cj->NDLEAF;                 // Number of target and source bodies
+    const int ibegin = Ci->LEAF - EXCLUDEI0;                    // First target in tree order
+    const int jbegin = Cj->LEAF - EXCLUDEJ0;                    // First source in tree order
+    if( ibegin < 0 || ibegin+ni >= int(EXCLUDEOFFSET.size()) ) return false;// Targets are not in the lists
+    if( jbegin < 0 || jbegin+nj > EXCLUDENJ ) return false;     // Sources are not in the lists (e.g. received cells)
+    bool found = false;                                         // Excluded pair found
+    for( int i=0; i<ni; ++i ) {                                 // Loop over target bodies
+      const int *begin = &EXCLUDE[0] + EXCLUDEOFFSET[ibegin+i]; //  First excluded source of target
+      const int *end = &EXCLUDE[0] + EXCLUDEOFFSET[ibegin+i+1]; //  Last excluded source of target
+      for( const int *J=std::lower_bound(begin,end,jbegin); J!=end && *J<jbegin+nj; ++J ) {// Loop over sources in cell
+        if( !isNearestImage(EXCLUDEI0+ibegin+i,EXCLUDEJ0+*J) ) continue;// Other images are not excluded
+        if( !found ) mask.assign((ni+width-1)/width*nj,0);      //   Clear mask for first excluded pair
+        found = true;                                           //   Mask has bits set
+        mask[i/width*nj+*J-jbegin] |= 1u << (i % width);        //   Set bit of pair
+        EXCLUDESKIP[J-&EXCLUDE[0]] = 1;                         //   Do not subtract pair after traversal
+      }                                                         //  End loop over sources in cell
+    }                                                           // End loop over target bodies
+    return found;                                               // Caller has to pass mask to P2P
+  }
+
+//! Set paramters for Ewald summation (tolerance is the absolute error of the tabulated erfc and exp)
+  void setEwald(real ksize, real alpha, real sigma, real cutoff=0, real tolerance=1e-6) {
+#if !CPU
+    assert( cutoff == 0 );                                      // GPU real part uses erfc without cutoff or tables
+#endif
     KSIZE = ksize;                                              // Set number of waves
     ALPHA = alpha;                                              // Set scaling parameter
     SIGMA = sigma;                                              // Set scaling parameter
+    CUTOFF = cutoff;                                            // Set cutoff of real part
+    double smax = 0;                                            // Table ends where erfc falls below tolerance
+    while( erfc(smax) > tolerance ) smax += .125;               // This is also the default real part cutoff
+    double h = std::pow(32. * tolerance,.25);                   // Hermite error h^4/384 max|f''''| with max|f''''| < 12
+    int n = int(std::ceil(smax / h));                           // Number of pieces
+    h = smax / n;                                               // Width of pieces
+    ERFCSCALE = 1 / h;                                          // Pieces per unit of alpha * R
+    ERFCTABLE.resize(8*n);                                      // Four coefficients for each function
+    for( int i=0; i<n; ++i ) {                                  // Loop over pieces
+      double s0 = i * h, s1 = s0 + h;                           //  Ends of piece
+      double e0 = std::exp(-s0 * s0), e1 = std::exp(-s1 * s1);  //  exp(-s^2) at ends
+      double f[2][4] = {{erfc(s0), erfc(s1), -M_2_SQRTPI * e0 * h, -M_2_SQRTPI * e1 * h},
+                        {e0, e1, -2 * s0 * e0 * h, -2 * s1 * e1 * h}};// Values and scaled derivatives
+      for( int k=0; k<2; ++k ) {                                //  Loop over erfc and exp
+        real *c = &ERFCTABLE[8*i+4*k];                          //   Coefficients of cubic in fraction of piece
+        c[0] = f[k][0];                                         //   Value at start
+        c[1] = f[k][2];                                         //   Slope at start
+        c[2] = 3 * (f[k][1] - f[k][0]) - 2 * f[k][2] - f[k][3]; //   Hermite quadratic term
+        c[3] = 2 * (f[k][0] - f[k][1]) + f[k][2] + f[k][3];     //   Hermite cubic term
+      }                                                         //  End loop over erfc and exp
+    }                                                           // End loop over pieces
+  }
+
+//! Use smooth particle mesh Ewald with a power of two grid for the wave part (grid = 0 for DFT)
+  void setSPME(int grid, int order=6) {
+    SPMEGRID = grid;                                            // Set grid points per dimension
+    SPMEORDER = order;                                          // Set order of B-splines
+  }
+
+//! Add the dipole correction of the Ewald wave part (potential term shared among charged bodies)
+  void dipoleCorrection(Bodies &bodies) const {
+    vect dipole = 0;                                            // Dipole moment of the box
+    int charged = 0;                                            // Number of bodies with nonzero charge
+    for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {      // Loop over bodies
+      dipole += (B->X - R0) * B->SRC;                           //  Accumulate dipole moment
+      if( B->SRC != 0 ) charged++;                              //  Count charged bodies
+    }                                                           // End loop over bodies
+    const real coef = M_PI / (6 * R0 * R0 * R0);                // Scale of dipole correction
+    for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {      // Loop over bodies
+      if( B->SRC != 0 ) B->TRG[0] += coef * norm(dipole) / charged / B->SRC;// Potential (energy is sum of SRC * TRG[0])
+      for( int d=0; d!=3; ++d ) {                               //  Loop over dimensions
+        B->TRG[d+1] += coef * dipole[d];                        //   Force
+      }                                                         //  End loop over dimensions
+    }                                                           // End loop over bodies
   }
 
 };
@@ -309,10 +757,19 @@ public:
   void M2L(C_iter Ci, C_iter Cj) const;                         //!< Evaluate M2L kernel on CPU
   void M2P(C_iter Ci, C_iter Cj) const;                         //!< Evaluate M2P kernel on CPU
   void P2P(C_iter Ci, C_iter Cj) const;                         //!< Evaluate P2P kernel on CPU
+  void P2P(BodiesSoA &ibodies, int ibegin, int iend,
+           const BodiesSoA &jbodies, int jbegin, int jend,
+           const unsigned *exclude=0) const;                    //!< Evaluate P2P kernel on structure of arrays
+  void P2PMutual(C_iter Ci, C_iter Cj) const;                   //!< Evaluate P2P kernel on CPU for both cells
+  void P2PMutual(BodiesSoA &ibodies, int ibegin, int iend,
+                 BodiesSoA &jbodies, int jbegin, int jend) const;//!< Evaluate P2P kernel on structure of arrays for both sides
+  void P2PCoulombVanDerWaals(C_iter Ci, C_iter Cj, bool mutual) const;//!< Evaluate Laplace + Van der Waals P2P kernel on CPU
+  void subtractExclusions() const;                              //!< Subtract excluded pairs that P2P did not skip
   void L2L(C_iter Ci) const;                                    //!< Evaluate L2L kernel on CPU
   void L2P(C_iter Ci) const;                                    //!< Evaluate L2P kernel on CPU
   void EwaldReal(C_iter Ci, C_iter Cj) const;                   //!< Evaluate Ewald real part on CPU
   void EwaldWave(Bodies &bodies) const;                         //!< Evaluate Ewald wave part on CPU
+  void EwaldSPME(Bodies &bodies) const;                         //!< Evaluate Ewald wave part by SPME on CPU
   void P2M();                                                   //!< Evaluate P2M kernel on GPU
   void M2M();                                                   //!< Evaluate M2M kernel on GPU
   void M2L();                                                   //!< Evaluate M2L kernel on GPU
@@ -22,22 +22,104 @@ THE SOFTWARE.
 #ifndef logger_h
 #define logger_h
 #include <sys/time.h>
+#include <time.h>
 #include "types.h"
 
 //! Timer and Trace logger
 class Logger {
 private:
+  static const int MAXTIMER = 1024;                             //!< Max number of registered timer events
+  static const int MAXTHREAD = 1024;                            //!< Max number of threads that time events
+  static const int MAXINTERN = 64;                              //!< Size of per-thread event name cache
   std::ofstream   timerFile;                                    //!< File ID to store log
-  Timer           beginTimer;                                   //!< Timer base value
-  Timer           timer;                                        //!< Stores timings for all events
+  Timer           timerID;                                      //!< Map of event name to timer id
+  TimerEvents     events;                                       //!< Registered timer events
+  TimerThreads    threads;                                      //!< Timer accumulators per thread slot
   Traces          traces;                                       //!< Stores traces for all events
   pthread_mutex_t mutex;                                        //!< Pthread communicator
 
+  Logger(const Logger&);                                        // Not copyable (owns per-thread accumulators)
+  Logger &operator=(const Logger&);                             // Not assignable
+
 //! Timer function
   double get_time() const {
-    struct timeval tv;                                          // Time value
-    gettimeofday(&tv, NULL);                                    // Get time of day in seconds and microseconds
-    return double(tv.tv_sec+tv.tv_usec*1e-6);                   // Combine seconds and microseconds and return
+    struct timespec ts;                                         // Time value
+    clock_gettime(CLOCK_MONOTONIC, &ts);                        // Get monotonic time in seconds and nanoseconds
+    return double(ts.tv_sec+ts.tv_nsec*1e-9);                   // Combine seconds and nanoseconds and return
+  }
+
+//! Process-wide slot of the calling thread, unique even across nested teams and QUARK workers
+  static int getThreadSlot() {
+    static int numSlots = 0;                                    // Number of slots handed out so far
+    static thread_local int slot = __sync_fetch_and_add(&numSlots,1);// Claim a slot on first use by this thread
+    assert( slot < MAXTHREAD );                                 // Fail loudly instead of dropping timings
+    return slot;                                                // Return slot of this thread
+  }
+
+//! Timer accumulators of the calling thread, allocated on first use
+  TimerThread &getThread() {
+    TimerThread *&thread = threads[getThreadSlot()];            // Only this thread writes its own entry
+    if( thread == NULL ) {                                      // If this thread has not timed anything yet
+      thread = new TimerThread;                                 //  Allocate accumulators
+      thread->BEGIN.assign(MAXTIMER,0);                         //  Timer base values
+      thread->TIME.assign(MAXTIMER,0);                          //  Accumulated times
+      thread->COUNT.assign(MAXTIMER,0);                         //  Call counts
+      thread->NAME.resize(MAXINTERN);                           //  Interned event names
+      thread->ID.assign(MAXINTERN,-1);                          //  Interned ids (empty)
+    }                                                           // Endif for new thread
+    return *thread;                                             // Return accumulators
+  }
+
+//! Timer id of event name, from the calling thread's cache (locks only on a miss)
+  int internTimer(const char *event) {
+    unsigned hash = 2166136261u;                                // FNV-1a offset basis
+    for( const char *c=event; *c; ++c ) hash = (hash ^ (unsigned char)*c) * 16777619u;// FNV-1a over name
+    TimerThread &thread = getThread();                          // Accumulators of this thread
+    int i = hash % MAXINTERN;                                   // Cache entry of this name
+    if( thread.ID[i] < 0 || thread.NAME[i] != event ) {         // If name is not cached
+      thread.ID[i] = registerTimer(event);                      //  Look up (or register) id under the mutex
+      thread.NAME[i] = event;                                   //  Cache name
+    }                                                           // Endif for cache miss
+    return thread.ID[i];                                        // Return timer id
+  }
+
+//! Total time of an event summed over threads
+  double sumTime(int id) const {
+    double time = 0;                                            // Initialize time
+    for( int t=0; t<MAXTHREAD; ++t ) if( threads[t] ) time += threads[t]->TIME[id];// Sum over threads
+    return time;                                                // Return total time
+  }
+
+//! Total number of calls of an event summed over threads
+  long sumCount(int id) const {
+    long count = 0;                                             // Initialize count
+    for( int t=0; t<MAXTHREAD; ++t ) if( threads[t] ) count += threads[t]->COUNT[id];// Sum over threads
+    return count;                                               // Return total count
+  }
+
+//! Print one event with indentation for its depth
+  void printEvent(std::ostream &os, int id) const {
+    std::string name = std::string(2*events[id].DEPTH,' ') + events[id].NAME;// Indent nested events
+    os << std::setw(stringLength) << std::left                  // Set format
+       << name << " : " << sumTime(id) << std::endl;            // Print event and timer
+  }
+
+//! Print an event and its nested events
+  void printTree(std::ostream &os, int id) const {
+    if( sumCount(id) != 0 ) printEvent(os,id);                  // Print event if it was timed
+    for( int i=0; i<int(events.size()); ++i ) {                 // Loop over events
+      if( events[i].PARENT == id ) printTree(os,i);             //  Recurse into nested events
+    }                                                           // End loop over events
+  }
+
+//! Escape a string for JSON
+  std::string jsonString(const std::string &str) const {
+    std::string out = "\"";                                     // Opening quote
+    for( int i=0; i<int(str.size()); ++i ) {                    // Loop over characters
+      if( str[i] == '"' || str[i] == '\\' ) out += '\\';        //  Escape quotes and backslashes
+      out += str[i];                                            //  Append character
+    }                                                           // End loop over characters
+    return out + "\"";                                          // Closing quote
   }
 
 public:
@@ -46,60 +128,142 @@ public:
 
 //! Constructor
   Logger() : timerFile("time.dat"),                             // Open timer log file
-             beginTimer(), timer(), traces(), mutex(),          // Initializing class variables (empty)
+             timerID(), events(),                               // Initializing class variables (empty)
+             threads(MAXTHREAD,(TimerThread*)NULL),             // No thread has timed anything yet
+             traces(), mutex(),                                 // Initializing class variables (empty)
              stringLength(20),                                  // Max length of event name
              printNow(false) {                                  // Don't print timings by default
     pthread_mutex_init(&mutex,NULL);                            // Initialize pthread communicator
   }
 //! Destructor
   ~Logger() {
+    for( int t=0; t<MAXTHREAD; ++t ) delete threads[t];         // Free per-thread accumulators
+    pthread_mutex_destroy(&mutex);                              // Finalize pthread communicator
     timerFile.close();                                          // Close timer log file
   }
 
+//! Get id of event, registering it as nested in parent if it is new
+  int registerTimer(std::string event, int parent=-1) {
+    pthread_mutex_lock(&mutex);                                 // Lock shared variable access
+    TI_iter E = timerID.find(event);                            // Look up event name
+    int id;                                                     // Timer id
+    if( E != timerID.end() ) {                                  // If event is already registered
+      id = E->second;                                           //  Use its id
+    } else {                                                    // If event is new
+      id = events.size();                                       //  Next free id
+      assert( id < MAXTIMER );                                  //  Per-thread accumulators are fixed size
+      TimerEvent timerEvent;                                    //  Define new event
+      timerEvent.NAME = event;                                  //  Event name
+      timerEvent.PARENT = parent;                               //  Enclosing event
+      timerEvent.DEPTH = parent < 0 ? 0 : events[parent].DEPTH + 1;// Nesting depth
+      events.push_back(timerEvent);                             //  Register event
+      timerID[event] = id;                                      //  Map name to id
+    }                                                           // Endif for registered event
+    pthread_mutex_unlock(&mutex);                               // Unlock shared variable access
+    return id;                                                  // Return timer id
+  }
+
+//! Get ids of per-level events nested in parent, for levels 0 to maxLevel
+  void registerLevelTimers(int parent, int maxLevel, std::vector<int> &ids) {
+    ids.resize(maxLevel+1);                                     // One timer per level
+    for( int level=0; level<=maxLevel; ++level ) {              // Loop over levels
+      std::stringstream name;                                   //  Declare event name
+      name << events[parent].NAME << ": " << level;             //  Set event name with level
+      ids[level] = registerTimer(name.str(),parent);            //  Register nested event
+    }                                                           // End loop over levels
+  }
+
+//! Start timer for given event id
+  inline void startTimer(int id) {
+    getThread().BEGIN[id] = get_time();                         // Store time in this thread's slot
+  }
+
+//! Stop timer for given event id
+  inline double stopTimer(int id, bool print=false) {
+    double endTimer = get_time();                               // Get time and store in endTimer
+    TimerThread &thread = getThread();                          // Accumulators of this thread
+    double time = endTimer - thread.BEGIN[id];                  // Event time
+    thread.TIME[id] += time;                                    // Accumulate event time to this thread
+    thread.COUNT[id]++;                                         // Count call of event in this thread
+    if(print) printEvent(std::cout,id);                         // Print event and timer to screen
+    return time;                                                // Return the event time
+  }
+
+//! Add to counter of given event id without timing
+  inline void addCount(int id, long count=1) {
+    getThread().COUNT[id] += count;                             // Accumulate count to this thread
+  }
+
+//! Start timer for given event
+  inline void startTimer(const char *event) {
+    startTimer(internTimer(event));                             // Look up id and start timer
+  }
+
 //! Start timer for given event
-  inline void startTimer(std::string event) {
-    beginTimer[event] = get_time();                             // Get time of day and store in beginTimer
+  inline void startTimer(const std::string &event) {
+    startTimer(internTimer(event.c_str()));                     // Look up id and start timer
   }
 
 //! Stop timer for given event
-  double stopTimer(std::string event, bool print=false) {
-    double endTimer = get_time();                               // Get time of day and store in endTimer
-    timer[event] += endTimer - beginTimer[event];               // Accumulate event time to timer
-    if(print) std::cout << std::setw(stringLength) << std::left // Set format
-                        << event << " : " << timer[event] << std::endl;// Print event and timer to screen
-    return endTimer - beginTimer[event];                        // Return the event time
+  inline double stopTimer(const char *event, bool print=false) {
+    return stopTimer(internTimer(event),print);                 // Look up id and stop timer
+  }
+
+//! Stop timer for given event
+  inline double stopTimer(const std::string &event, bool print=false) {
+    return stopTimer(internTimer(event.c_str()),print);         // Look up id and stop timer
   }
 
 //! Erase entry in timer
   inline void eraseTimer(std::string event) {
-    timer.erase(event);                                         // Erase event from timer
+    TI_iter E = timerID.find(event);                            // Look up event name
+    if( E == timerID.end() ) return;                            // Nothing to erase
+    for( int t=0; t<MAXTHREAD; ++t ) {                          // Loop over thread slots
+      if( threads[t] == NULL ) continue;                        //  Skip slots that never timed
+      threads[t]->TIME[E->second] = 0;                          //  Clear time
+      threads[t]->COUNT[E->second] = 0;                         //  Clear count
+    }                                                           // End loop over thread slots
   }
 
 //! Erase all events in timer
   inline void resetTimer() {
-    timer.clear();                                              // Clear timer
+    for( int t=0; t<MAXTHREAD; ++t ) {                          // Loop over thread slots
+      if( threads[t] == NULL ) continue;                        //  Skip slots that never timed
+      std::fill(threads[t]->TIME.begin(),threads[t]->TIME.end(),0);// Clear times
+      std::fill(threads[t]->COUNT.begin(),threads[t]->COUNT.end(),0);// Clear counts
+    }                                                           // End loop over thread slots
   }
 
 //! Print timings of a specific event
   inline void printTime(std::string event) {
-    std::cout << std::setw(stringLength) << std::left           // Set format
-              << event << " : " << timer[event] << std::endl;   // Print event and timer
+    printEvent(std::cout,registerTimer(event));                 // Print event and timer
   }
 
-//! Print timings of all events
+//! Print timings of all events, nested events indented below their parent
   inline void printAllTime() {
-    for( TI_iter E=timer.begin(); E!=timer.end(); ++E ) {       // Loop over all events
-      std::cout << std::setw(stringLength) << std::left         //  Set format
-                << E->first << " : " << E->second << std::endl; //  Print event and timer
-    }                                                           // End loop over all events
+    for( int i=0; i<int(events.size()); ++i ) {                 // Loop over events
+      if( events[i].PARENT < 0 ) printTree(std::cout,i);        //  Print top level events and their children
+    }                                                           // End loop over events
   }
 
-//! Write timings of all events
+//! Write timings of all events to time.dat, and all fields to time.json
   inline void writeTime() {
-    for( TI_iter E=timer.begin(); E!=timer.end(); ++E ) {       // Loop over all events
+    for( TI_iter E=timerID.begin(); E!=timerID.end(); ++E ) {   // Loop over all events
+      if( sumCount(E->second) == 0 ) continue;                  //  Skip events that were not timed
       timerFile << std::setw(stringLength) << std::left         //  Set format
-                << E->first << " " << E->second << std::endl;   //  Print event and timer
+                << E->first << " " << sumTime(E->second) << std::endl;// Print event and timer
     }                                                           // End loop over all events
+    std::ofstream jsonFile("time.json");                        // Open machine-readable timer file
+    jsonFile << "[\n";                                          // Begin array of events
+    for( int i=0; i<int(events.size()); ++i ) {                 // Loop over events
+      jsonFile << "  {\"name\": " << jsonString(events[i].NAME) //  Event name
+               << ", \"parent\": " << (events[i].PARENT < 0 ? std::string("null") : jsonString(events[events[i].PARENT].NAME))
+               << ", \"depth\": " << events[i].DEPTH            //  Nesting depth
+               << ", \"time\": " << sumTime(i)                  //  Time summed over threads
+               << ", \"count\": " << sumCount(i) << "}"         //  Number of calls
+               << (i+1 < int(events.size()) ? ",\n" : "\n");    //  Separator
+    }                                                           // End loop over events
+    jsonFile << "]\n";                                          // End array of events
   }
 
 //! Start PAPI event
@@ -53,8 +53,13 @@ public:
   using Kernel<equation>::sortBodies;                           //!< Sort bodies according to cell index
   using Kernel<equation>::sortCells;                            //!< Sort cells according to cell index
   using Kernel<equation>::R0;                                   //!< Radius of root cell
+  using Kernel<equation>::getNumM;                              //!< Get number of multipole coefficients per cell
+  using Kernel<equation>::getM;                                 //!< Get multipole coefficients of cell
+  using Kernel<equation>::newCoef;                              //!< Allocate zeroed coefficients for cell
+  using Kernel<equation>::freeCoef;                             //!< Release coefficients of cell
   using TreeStructure<equation>::buffer;                        //!< Buffer for MPI communication & sorting
   using TreeStructure<equation>::getLevel;                      //!< Get level from cell index
+  using TreeStructure<equation>::getLevelOffset;                //!< Get offset of cell index for a given level
   using TreeStructure<equation>::getCenter;                     //!< Get cell center and radius from cell index
   using TreeStructure<equation>::bodies2twigs;                  //!< Group bodies into twig cells
   using TreeStructure<equation>::twigs2cells;                   //!< Link twigs bottomup to create all cells in tree
@@ -71,6 +76,21 @@ public:
   using Partition<equation>::MPI_COMM;                          //!< Hypercube communicators
 
 private:
+//! Set compact cell type from cell
+  void cell2jcell(JCell &cell, const Cell &C) {
+    assert( getNumM() * sizeof(Coef) <= sizeof(cell.M) );       // LET messages carry orders up to P
+    cell.ICELL = C.ICELL;                                       // Set index of compact cell type
+    cell.M = 0;                                                 // Zero multipoles beyond run-time order
+    std::copy(getM(C),getM(C)+getNumM(),&cell.M[0]);            // Set multipoles of compact cell type
+  }
+
+//! Set cell from compact cell type
+  void jcell2cell(Cell &cell, const JCell &JC) {
+    cell.ICELL = JC.ICELL;                                      // Set index of cell
+    newCoef(cell);                                              // Allocate coefficients of cell
+    std::copy(&JC.M[0],&JC.M[0]+getNumM(),getM(cell));          // Set multipoles of cell
+  }
+
 //! Gather bounds of other domain
   void gatherBounds() {
     xminAll.resize(MPISIZE);                                    // Resize buffer for gathering xmin
@@ -317,15 +337,13 @@ private:
       } else {                                                  //  If the cell is far or a twig
         assert( R0 / (1 << level) + 1e-5 > CC->R );             //   Can't send cells that are larger than local root
         JCell cell;                                             //   Set compact cell type for sending
-        cell.ICELL = CC->ICELL;                                 //   Set index of compact cell type
-        cell.M     = CC->M;                                     //   Set Multipoles of compact cell type
+        cell2jcell(cell,*CC);                                   //   Set index and multipoles of compact cell type
         sendCells.push_back(cell);                              //    Push cell into send buffer vector
       }                                                         //  Endif for interaction
     }                                                           // End loop over child cells
     if( C->ICELL == 0 && C->NCHILD == 0 ) {                     // If the root cell has no children
       JCell cell;                                               //  Set compact cell type for sending
-      cell.ICELL = C->ICELL;                                    //  Set index of compact cell type
-      cell.M     = C->M;                                        //  Set Multipoles of compact cell type
+      cell2jcell(cell,*C);                                      //  Set index and multipoles of compact cell type
       sendCells.push_back(cell);                                //  Push cell into send buffer vector
     }                                                           // Endif for root cells children
   }
@@ -415,8 +433,7 @@ private:
   void send2twigs(Bodies &bodies, Cells &twigs, int offTwigs) {
     for( JC_iter JC=sendCells.begin(); JC!=sendCells.begin()+offTwigs; ++JC ) {// Loop over send buffer
       Cell cell;                                                //  Cell structure
-      cell.ICELL = JC->ICELL;                                   //  Set index of cell
-      cell.M     = JC->M;                                       //  Set multipole of cell
+      jcell2cell(cell,*JC);                                     //  Set index and multipole of cell
       cell.CHILD = cell.NCLEAF = cell.NDLEAF = cell.NCHILD = 0; //  Set number of leafs and children
       cell.LEAF  = bodies.end();                                //  Set pointer to first leaf
       getCenter(cell);                                          //  Set center and radius
@@ -429,8 +446,7 @@ private:
   void recv2twigs(Bodies &bodies, Cells &twigs) {
     for( JC_iter JC=recvCells.begin(); JC!=recvCells.end(); ++JC ) {// Loop over recv buffer
       Cell cell;                                                //  Cell structure
-      cell.ICELL = JC->ICELL;                                   //  Set index of cell
-      cell.M     = JC->M;                                       //  Set multipole of cell
+      jcell2cell(cell,*JC);                                     //  Set index and multipole of cell
       cell.CHILD = cell.NCLEAF = cell.NDLEAF = cell.NCHILD = 0; //  Set number of leafs and children
       cell.LEAF  = bodies.end();                                //  Set pointer to first leaf
       getCenter(cell);                                          //  Set center and radius
@@ -445,23 +461,30 @@ private:
     stopTimer("Sort resize",printNow);                          // Stop timer
     sortCells(twigs,cbuffer);                                   // Sort twigs in ascending order
     startTimer("Ziptwigs");                                     // Start timer
-    bigint index = 1e8;                                         // Initialize index counter
+    bigint index = ~bigint(0);                                  // Initialize index counter to an invalid index
     while( !twigs.empty() ) {                                   // While twig vector is not empty
       if( twigs.back().ICELL != index ) {                       //  If twig's index is different from previous
         cells.push_back(twigs.back());                          //   Push twig into cell vector
         index = twigs.back().ICELL;                             //   Update index counter
       } else if ( twigs.back().NDLEAF == 0 || !last ) {         //  Elseif twig-twig collision
-        cells.back().M += twigs.back().M;                       //   Accumulate the multipole
+        Coef *M = getM(cells.back());                           //   Multipole of cell
+        Coef *MT = getM(twigs.back());                          //   Multipole of twig
+        for( int i=0; i!=getNumM(); ++i ) M[i] += MT[i];        //   Accumulate the multipole
+        freeCoef(twigs.back());                                 //   Merged twig releases its coefficients
       } else if ( cells.back().NDLEAF == 0 ) {                  //  Elseif twig-body collision
-        Mset M;                                                 //   Multipole for temporary storage
-        M = cells.back().M;                                     //   Save multipoles from cells
+        int icoef = cells.back().ICOEF;                         //   Save multipoles from cells
         cells.back() = twigs.back();                            //   Copy twigs to cells
-        cells.back().M = M;                                     //   Copy back multipoles to cells
-        twigs.back().M = M - twigs.back().M;                    //   Take the difference of the two
-        if( std::abs(twigs.back().M[0]/M[0]) > EPS ) {          //   If the difference is non-zero
+        cells.back().ICOEF = icoef;                             //   Copy back multipoles to cells
+        Coef *M = getM(cells.back());                           //   Multipole of cell
+        Coef *MT = getM(twigs.back());                          //   Multipole of twig (its own slot)
+        for( int i=0; i!=getNumM(); ++i ) MT[i] = M[i] - MT[i]; //   Take the difference of the two
+        if( std::abs(MT[0]/M[0]) > EPS ) {                      //   If the difference is non-zero
           sticks.push_back(twigs.back());                       //    Save this difference in the sticks vector
+        } else {                                                //   Else difference is dropped
+          freeCoef(twigs.back());                               //    Release coefficients of twig
         }                                                       //   Endif for non-zero difference
-      } else {                                                  //  Else body-body collision (don't do anything)
+      } else {                                                  //  Else body-body collision
+        freeCoef(twigs.back());                                 //   Release coefficients of twig
       }                                                         //  Endif for collision type
       twigs.pop_back();                                         //  Pop last element from twig vector
     }                                                           // End while for twig vector
@@ -479,6 +502,8 @@ private:
     while( !twigs.empty() ) {                                   // While twig vector is not empty
       if( twigs.back().NDLEAF == 0 ) {                          //  If twig has no leafs
         cells.push_back(twigs.back());                          //   Push twig into cell vector
+      } else {                                                  //  Else twig is rebuilt from bodies
+        freeCoef(twigs.back());                                 //   Release coefficients of twig
       }                                                         //  Endif for no leafs
       twigs.pop_back();                                         //  Pop last element from twig vector
     }                                                           // End while for twig vector
@@ -493,7 +518,10 @@ private:
     for( C_iter C=twigs.begin(); C!=twigs.end(); ++C ) {        // Loop over cells
       if( sticks.size() > 0 ) {                                 //  If stick vector is not empty
         if( C->ICELL == sticks.back().ICELL ) {                 //   If twig's index is equal to stick's index
-          C->M += sticks.back().M;                              //    Accumulate multipole
+          Coef *M = getM(C);                                    //    Multipole of twig
+          Coef *MS = getM(sticks.back());                       //    Multipole of stick
+          for( int i=0; i!=getNumM(); ++i ) M[i] += MS[i];      //    Accumulate multipole
+          freeCoef(sticks.back());                              //    Release coefficients of stick
           sticks.pop_back();                                    //    Pop last element from stick vector
         }                                                       //   Endif for twig's index
       }                                                         //  Endif for stick vector
@@ -514,9 +542,9 @@ private:
   void sticks2send(Cells &sticks, int &offTwigs) {
     while( !sticks.empty() ) {                                  // While stick vector is not empty
       JCell cell;                                               //  Cell structure
-      cell.ICELL = sticks.back().ICELL;                         //  Set index of cell
-      cell.M     = sticks.back().M;                             //  Set multipole of cell
+      cell2jcell(cell,sticks.back());                           //  Set index and multipole of cell
       sendCells.push_back(cell);                                //  Push cell into send buffer
+      freeCoef(sticks.back());                                  //  Release coefficients of stick
       sticks.pop_back();                                        //  Pop last element of stick vector
     }                                                           // End while for stick vector
     offTwigs = sendCells.size();                                // Keep track of current send buffer size
@@ -530,8 +558,8 @@ private:
     int numCells = 0;
     for( JC_iter JC=sendCells.begin(); JC!=sendCells.end(); ++JC ) {
       int level = getLevel(JC->ICELL);
-      int index = JC->ICELL - ((1 << 3*level) - 1) / 7;
-      int octant = index / (1 << 3 * (level - maxLevel));
+      bigint index = JC->ICELL - getLevelOffset(level);
+      int octant = index >> 3 * (level - maxLevel);
       if( octant != octant0 ) {
         octant0 = octant;
         numCells++;
@@ -546,7 +574,7 @@ private:
     real localMass = 0;
     for( C_iter C=cells.begin(); C!=cells.end(); ++C ) {
       if( C->NCHILD == 0 ) {
-        localMass += std::abs(C->M[0]);
+        localMass += std::abs(getM(C)[0]);
       }
     }
     real globalMass;
@@ -695,7 +723,7 @@ public:
       if( l == LEVEL - 1 ) {                                    //  If at last level
         complex SUM = 0;                                        //   Initialize accumulator
         for(C_iter C=twigs.begin(); C!=twigs.end(); ++C) {      //   Loop over twigs
-          if( C->NDLEAF == 0 ) SUM += C->M[0];                  //    Add multipoles of empty twigs
+          if( C->NDLEAF == 0 ) SUM += getM(C)[0];               //    Add multipoles of empty twigs
         }                                                       //   End loop over twigs
         print("Before recv   : ",0);                            //   Print identifier
         print(SUM);                                             //   Print sum of multipoles
@@ -706,7 +734,7 @@ public:
       if( l == LEVEL - 1 ) {                                    //  If at last level
         complex SUM = 0;                                        //   Initialize accumulator
         for(C_iter C=twigs.begin(); C!=twigs.end(); ++C) {      //   Loop over twigs
-          SUM += C->M[0];                                       //    Add multipoles
+          SUM += getM(C)[0];                                    //    Add multipoles
         }                                                       //   End loop over twigs
         print("After merge   : ",0);                            //   Print identifier
         print(SUM);                                             //   Print sum of multipoles
@@ -724,7 +752,7 @@ public:
 
 #ifdef DEBUG
     print("M[0] @ root   : ",0);                                // Print identifier
-    print((cells.end()-1)->M[0]);                               // Print monopole of root (should be 1 for test)
+    print(getM(cells.end()-1)[0]);                              // Print monopole of root (should be 1 for test)
     print("bodies.size() : ",0);                                // Print identifier
     print(bodies.size());                                       // Print size of body vector
 #endif
@@ -736,10 +764,10 @@ public:
   void eraseLocalTree(Cells &cells) {
     int level = int(log(MPISIZE-1) / M_LN2 / 3) + 1;            // Level of process root cell
     if( MPISIZE == 1 ) level = 0;                               // Account for serial case
-    int off = ((1 << 3 * level) - 1) / 7;                       // Levelwise offset of ICELL
-    int size = (1 << 3 * level) / MPISIZE;                      // Number of cells to remove
-    unsigned begin = MPIRANK * size + off;                      // Begin index of cells to remove
-    unsigned end = (MPIRANK + 1) * size + off;                  // End index of cells to remove
+    bigint off = getLevelOffset(level);                         // Levelwise offset of ICELL
+    bigint size = (bigint(1) << 3 * level) / MPISIZE;           // Number of cells to remove
+    bigint begin = MPIRANK * size + off;                        // Begin index of cells to remove
+    bigint end = (MPIRANK + 1) * size + off;                    // End index of cells to remove
     for( C_iter C=cells.begin(); C!=cells.end(); ++C ) {        // Loop over cells
       int nchild = 0;                                           //  Initialize child cell counter
       for( int c=0; c!=C->NCHILD; ++c ) {                       //  Loop over child cells
@@ -49,6 +49,7 @@ public:
   using Kernel<equation>::R0;                                   //!< Radius of root cell
   using TreeStructure<equation>::buffer;                        //!< Buffer for MPI communication & sorting
   using TreeStructure<equation>::getLevel;                      //!< Get level from cell index
+  using TreeStructure<equation>::getLevelOffset;                //!< Get offset of cell index for a given level
   using BottomUp<equation>::getMaxLevel;                        //!< Max level for bottom up tree build
 
 private:
@@ -478,8 +479,8 @@ public:
       scnt[i] = 0;                                              //  Initialize send counts
     }                                                           // End loop over ranks
     for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {      // Loop over bodies
-      int index = B->ICELL - ((1 << 3*level) - 1) / 7;          //  Get levelwise index
-      int irank = index / (int(pow(8,level)) / MPISIZE);        //  Get rank which the cell belongs to
+      bigint index = B->ICELL - getLevelOffset(level);          //  Get levelwise index
+      int irank = index / ((bigint(1) << 3*level) / MPISIZE);   //  Get rank which the cell belongs to
       scnt[irank]++;                                            //  Fill send count bucket
     }                                                           // End loop over bodies
     MPI_Alltoall(scnt,1,MPI_INT,rcnt,1,MPI_INT,MPI_COMM_WORLD); // Communicate send count to get recv count
@@ -30,9 +30,67 @@ public:
   using Kernel<equation>::sortBodies;                           //!< Sort bodies according to cell index
   using Kernel<equation>::preCalculation;                       //!< Precalculate M2L translation matrix
   using Kernel<equation>::postCalculation;                      //!< Free temporary allocations
+  using Kernel<equation>::getM;                                 //!< Get multipole coefficients of cell
+  using Kernel<equation>::freeCoef;                             //!< Release coefficients of cell
+  using Kernel<equation>::X0;                                   //!< Center of root cell
+  using Kernel<equation>::R0;                                   //!< Radius of root cell
+  using Kernel<equation>::printNow;                             //!< Switch to print timings
+  using Kernel<equation>::startTimer;                           //!< Start timer for given event
+  using Kernel<equation>::stopTimer;                            //!< Stop timer for given event
+  using Evaluator<equation>::getLevel;                          //!< Get level from cell index
+  using Evaluator<equation>::evalP2M;                           //!< Evaluate P2M kernel
+  using Evaluator<equation>::evalM2M;                           //!< Evaluate M2M kernel
   using TreeStructure<equation>::buffer;                        //!< Buffer for MPI communication & sorting
   using TreeStructure<equation>::bodies2twigs;                  //!< Group bodies into twig cells
   using TreeStructure<equation>::twigs2cells;                   //!< Link twigs bottomup to create all cells in tree
+  using BottomUp<equation>::getIndex;                           //!< Get cell index of position at given level
+
+private:
+//! Compare bodies by cell index in descending order
+  static bool descending(const Body &lhs, const Body &rhs) {
+    return lhs.ICELL > rhs.ICELL;                               // Larger cell index comes first
+  }
+
+//! Normalize Cartesian multipoles by the monopole
+  void normalize(Cells &cells) {
+    for( C_iter C=cells.begin(); C!=cells.end(); ++C ) {        // Loop over cells
+#if Cartesian
+      Coef *M = getM(C);                                        //  Multipole of cell
+      for( int i=1; i<MTERM; ++i ) M[i] /= M[0];                //  Divide by monopole
+#endif
+    }                                                           // End loop over cells
+  }
+
+//! Update leafs of existing cells to re-sorted bodies, keeping the topology
+//! Returns false if a twig lost all its bodies or a body moved to a cell that is not a twig
+  bool relink(Bodies &bodies, Cells &cells) {
+    std::vector<std::pair<bigint,int> > twigs;                  // Cell index and offset of twigs
+    for( int c=0; c!=int(cells.size()); ++c ) {                 // Loop over cells
+      if( cells[c].NCHILD == 0 ) {                              //  If cell is a twig
+        twigs.push_back(std::make_pair(cells[c].ICELL,c));      //   Keep its index and offset
+      }                                                         //  Endif for twig
+    }                                                           // End loop over cells
+    std::sort(twigs.begin(),twigs.end());                       // Sort twigs in ascending order
+    B_iter B = bodies.begin();                                  // Bodies are in descending order
+    for( int t=twigs.size()-1; t>=0; --t ) {                    // Loop over twigs in descending order
+      C_iter C = cells.begin() + twigs[t].second;               //  Iterator of twig
+      if( B == bodies.end() || B->ICELL != C->ICELL ) return false;// Twig lost its bodies or a new twig is needed
+      C->LEAF = B;                                              //  Set iterator of first leaf
+      while( B != bodies.end() && B->ICELL == C->ICELL ) ++B;   //  Skip bodies of this twig
+      C->NCLEAF = C->NDLEAF = B - C->LEAF;                      //  Set number of leafs
+    }                                                           // End loop over twigs
+    if( B != bodies.end() ) return false;                       // Some bodies are in a cell that is not a twig
+    for( C_iter C=cells.begin(); C!=cells.end(); ++C ) {        // Loop over cells bottomup
+      if( C->NCHILD != 0 ) {                                    //  If cell is not a twig
+        C->LEAF = cells[C->CHILD].LEAF;                         //   First leaf is the first leaf of first child
+        C->NDLEAF = 0;                                          //   Initialize number of decendant leafs
+        for( int c=0; c!=C->NCHILD; ++c ) {                     //   Loop over child cells
+          C->NDLEAF += cells[C->CHILD+c].NDLEAF;                //    Accumulate number of decendant leafs
+        }                                                       //   End loop over child cells
+      }                                                         //  Endif for twig
+    }                                                           // End loop over cells
+    return true;                                                // Topology was kept
+  }
 
 public:
 //! Constructor
@@ -46,9 +104,11 @@ public:
 
 //! Topdown tree constructor interface. Input: bodies, Output: cells
   void topdown(Bodies &bodies, Cells &cells) {
+    freeCoef(cells);                                            // Release coefficients of previous tree
+    cells.clear();                                              // Clear previous tree
     TopDown<equation>::grow(bodies);                            // Grow tree structure topdown
 
-    TopDown<equation>::setIndex();                              // Set index of cells
+    TopDown<equation>::setIndex(bodies);                        // Set index of cells
 
     buffer.resize(bodies.size());                               // Resize sort buffer
     sortBodies(bodies,buffer,false);                            // Sort bodies in descending order
@@ -58,15 +118,14 @@ public:
 
     Cells sticks;                                               // Sticks are twigs from other processes that are not twigs in the current process
     twigs2cells(twigs,cells,sticks);                            // Turn twigs to cells
-#if Cartesian
-    for( C_iter C=cells.begin(); C!=cells.end(); ++C ) {
-      for( int i=1; i<MTERM; ++i ) C->M[i] /= C->M[0];
-    }
-#endif
+    freeCoef(sticks);                                           // Sticks are not sent anywhere
+    normalize(cells);                                           // Normalize multipoles
   }
 
 //! Bottomup tree constructor interface. Input: bodies, Output: cells
   void bottomup(Bodies &bodies, Cells &cells) {
+    freeCoef(cells);                                            // Release coefficients of previous tree
+    cells.clear();                                              // Clear previous tree
     BottomUp<equation>::setIndex(bodies);                       // Set index of cells
 
     buffer.resize(bodies.size());                               // Resize sort buffer
@@ -85,11 +144,65 @@ public:
 
     Cells sticks;                                               // Sticks are twigs from other processes not twigs here
     twigs2cells(twigs,cells,sticks);                            // Turn twigs to cells
-#if Cartesian
-    for( C_iter C=cells.begin(); C!=cells.end(); ++C ) {
-      for( int i=1; i<MTERM; ++i ) C->M[i] /= C->M[0];
-    }
-#endif
+    freeCoef(sticks);                                           // Sticks are not sent anywhere
+    normalize(cells);                                           // Normalize multipoles
+  }
+
+//! Refit tree to moved bodies, keeping the Morton order and cell topology of the previous build
+//! Bodies that left their twig are sorted back in; cells are rebuilt only if the set of twigs changed
+//! Returns false without touching cells if more than a fraction threshold of bodies left their twig
+//! or a body left the root cell, in which case a full rebuild is needed
+  bool refit(Bodies &bodies, Cells &cells, real threshold=.1) {
+    startTimer("Refit");                                        // Start timer
+    int numBodies = bodies.size();                              // Number of bodies
+    int level = getLevel(bodies.front().ICELL);                 // Level of twigs
+    int numMoved = 0, numOutside = 0;                           // Number of bodies that left their twig/root
+    if( level != getLevel(bodies.back().ICELL) ) numOutside++;  // Only trees with twigs at a single level
+#pragma omp parallel for reduction(+:numMoved,numOutside)
+    for( int b=0; b<numBodies; ++b ) {                          // Loop over bodies
+      for( int d=0; d!=3; ++d ) {                               //  Loop over dimensions
+        if( bodies[b].X[d] < X0[d]-R0 || X0[d]+R0 <= bodies[b].X[d] ) numOutside++;// Check for bodies outside root
+      }                                                         //  End loop over dimensions
+      if( getIndex(bodies[b].X,level) != bodies[b].ICELL ) numMoved++;// Count bodies that left their twig
+    }                                                           // End loop over bodies
+    if( numOutside != 0 || numMoved > threshold * numBodies ) { // If displacement is too large
+      stopTimer("Refit",printNow);                              //  Stop timer & print
+      return false;                                             //  Caller has to rebuild tree
+    }                                                           // Endif for displacement
+    if( numMoved != 0 ) {                                       // If some bodies left their twigs
+      buffer.resize(numBodies);                                 //  Resize sort buffer
+      int numStayed = 0;                                        //  Number of bodies that stayed in their twigs
+      numMoved = 0;                                             //  Reset number of bodies that moved
+      for( int b=0; b!=numBodies; ++b ) {                       //  Loop over bodies
+        bigint index = getIndex(bodies[b].X,level);             //   Cell index of new position
+        if( index == bodies[b].ICELL ) {                        //   If body stayed in its twig
+          bodies[numStayed++] = bodies[b];                      //    Keep it in order
+        } else {                                                //   Else body moved to another twig
+          bodies[b].ICELL = index;                              //    Update cell index
+          buffer[numMoved++] = bodies[b];                       //    Move it out of the way
+        }                                                       //   Endif for moved body
+      }                                                         //  End loop over bodies
+      std::copy(buffer.begin(),buffer.begin()+numMoved,bodies.begin()+numStayed);// Moved bodies go to the end
+      sortBodies(bodies,buffer,false,numStayed,numBodies);      //  Sort moved bodies in descending order
+      std::merge(bodies.begin(),bodies.begin()+numStayed,bodies.begin()+numStayed,bodies.end(),
+                 buffer.begin(),descending);                    //  Merge the two sorted runs
+      std::copy(buffer.begin(),buffer.begin()+numBodies,bodies.begin());// Copy merged bodies back
+    }                                                           // Endif for moved bodies
+    if( numMoved == 0 || relink(bodies,cells) ) {               // If the twigs are the same as before
+      evalP2M(cells);                                           //  Evaluate all P2M kernels on existing cells
+      evalM2M(cells,cells);                                     //  Evaluate all M2M kernels
+    } else {                                                    // Else twigs have changed
+      freeCoef(cells);                                          //  Release coefficients of previous cells
+      cells.clear();                                            //  Clear previous cells
+      Cells twigs;                                              //  Twigs are cells at the bottom of tree
+      bodies2twigs(bodies,twigs);                               //  Turn bodies to twigs
+      Cells sticks;                                             //  Sticks are twigs from other processes not twigs here
+      twigs2cells(twigs,cells,sticks);                          //  Turn twigs to cells
+      freeCoef(sticks);                                         //  Sticks are not sent anywhere
+    }                                                           // Endif for same twigs
+    normalize(cells);                                           // Normalize multipoles
+    stopTimer("Refit",printNow);                                // Stop timer & print
+    return true;                                                // Tree was refitted
   }
 };
 
@@ -23,53 +23,91 @@ THE SOFTWARE.
 #define sort_h
 #include "logger.h"
 
-//! Custom bucket sort for body and cell structures
+//! Custom radix sort for body and cell structures
 class Sort : public Logger {
 private:
-  std::vector<int> bucket;                                      //!< Bucket for sorting
+  std::vector<int> bucket;                                      //!< Per-thread histograms for sorting
 
-//! Get bucket size for sorting
+//! Get range of cell indices
   template<typename T>
-  void getBucketSize(T &values, int begin, int end, bigint &Imin, int &numBucket) {
-    typename T::iterator V0 = values.begin()+begin;             // Get begin iterator
-    typename T::iterator VN = values.begin()+end;               // Get end iterator
-    Imin = V0->ICELL;                                           // Initialize minimum index
-    bigint Imax = V0->ICELL;                                    // Initialize maximum index
-    for( typename T::iterator V=V0; V!=VN; ++V ) {              // Loop over vector
-      if     ( V->ICELL < Imin ) Imin = V->ICELL;               //  Set minimum index
-      else if( V->ICELL > Imax ) Imax = V->ICELL;               //  Set maximum index
+  void getIndexRange(T &values, int begin, int end, bigint &Imin, bigint &Imax) {
+    bigint imin = values[begin].ICELL;                          // Initialize minimum index
+    bigint imax = values[begin].ICELL;                          // Initialize maximum index
+#pragma omp parallel for reduction(min:imin) reduction(max:imax) if(end-begin > 16384)
+    for( int i=begin; i<end; ++i ) {                            // Loop over vector
+      imin = std::min(imin,values[i].ICELL);                    //  Set minimum index
+      imax = std::max(imax,values[i].ICELL);                    //  Set maximum index
     }                                                           // End loop over vector
-    numBucket = Imax - Imin + 1;                                // Use range of indices as bucket size
-    if( numBucket > int(bucket.size()) ) {                      // If bucket size needs to be enlarged
-      bucket.resize(numBucket);                                 //  Resize bucket vector
-    }                                                           // Endif for resize
+    Imin = imin;                                                // Minimum index
+    Imax = imax;                                                // Maximum index
   }
 
-//! Bucket sort for small indices
+//! LSD radix sort on cell index, ping-ponging between values and buffer
   template<typename T>
-  void sortICELL(T &values, T &buffer, bigint Imin,
-                 int numBucket, bool ascend, int begin, int end) {
-    startTimer("Fill bucket");                                  // Start timer
-    for( int i=0; i!=numBucket; ++i ) bucket[i] = 0;            // Initialize bucket
-    for( int i=begin; i!=end; ++i ) bucket[values[i].ICELL-Imin]++;// Fill bucket
-    for( int i=1; i!=numBucket; ++i ) bucket[i] += bucket[i-1]; // Scan bucket
-    stopTimer("Fill bucket");                                   // Stop timer
-    startTimer("Empty bucket");                                 // Start timer
-    for( int i=end-1; i>=begin; --i ) {                         // Loop over data backwards
-      bucket[values[i].ICELL-Imin]--;                           //  Empty bucket
-      int inew = bucket[values[i].ICELL-Imin]+begin;            //  Permutation index
-      buffer[inew] = values[i];                                 //  Fill buffer
-    }                                                           // End loop over data
-    stopTimer("Empty bucket");                                  // Stop timer
-    startTimer("Copy value");                                   // Start timer
-    if( ascend ) {                                              // If sorting in ascending order
-//#pragma omp parallel for
-      for( int i=begin; i<end; ++i ) values[i] = buffer[i];     //  Copy back bodiess in order
-    } else {                                                    // If sorting in descending order
-//#pragma omp parallel for
-      for( int i=begin; i<end; ++i ) values[end-i+begin-1] = buffer[i];// Copy back bodiess in reverse order
-    }                                                           // Endif for sorting order
-    stopTimer("Copy value");                                    // Stop timer
+  void sortICELL(T &values, T &buffer, bool ascend, int begin, int end) {
+    if( begin == end ) return;                                  // Don't do anything if range is empty
+    const int maxBits = 11;                                     // Maximum bits per digit (2048 buckets per thread)
+    bigint Imin, Imax;                                          // Range of cell indices
+    getIndexRange(values,begin,end,Imin,Imax);                  // Get range of cell indices
+    int numBits = 0;                                            // Number of significant bits of ICELL - Imin
+    while( numBits < int(8*sizeof(bigint)) && ((Imax - Imin) >> numBits) != 0 ) numBits++;
+    int numPass = 2 * ((numBits + 2 * maxBits - 1) / (2 * maxBits));// Even number of passes ends in values
+    if( numPass == 0 ) numPass = 2;                             // Still need two passes for descending order
+    int digitBits = (numBits + numPass - 1) / numPass;          // Bits per digit
+    int numDigit = 1 << digitBits;                              // Buckets per digit
+#if QUARK
+    int numThreads = 1;                                         // QUARK builds don't use OpenMP threads
+#else
+    int numThreads = end - begin > 16384 ? omp_get_max_threads() : 1;// Don't spawn threads for small ranges
+#endif
+    bucket.resize(numThreads * numDigit);                       // Resize per-thread histograms
+    T *source = &values, *target = &buffer;                     // Ping-pong buffers
+    for( int pass=0; pass!=numPass; ++pass ) {                  // Loop over digits from least significant
+      int shift = pass * digitBits;                             //  Shift of current digit
+      bool reverse = pass == numPass - 1 && !ascend;            //  Reverse order in the last pass if descending
+#pragma omp parallel num_threads(numThreads)
+      {                                                         //  Begin parallel region
+#pragma omp master
+        startTimer("Fill bucket");                              //   Start timer
+#if QUARK
+        int nthreads = 1, thread = 0;                           //   Single thread
+#else
+        int nthreads = omp_get_num_threads();                   //   Actual number of threads
+        int thread = omp_get_thread_num();                      //   Thread number
+#endif
+        int ibegin = begin + int((long long)(end - begin) * thread / nthreads);// Begin of range for this thread
+        int iend = begin + int((long long)(end - begin) * (thread + 1) / nthreads);// End of range for this thread
+        int *hist = &bucket[thread*numDigit];                   //   Histogram of this thread
+        for( int d=0; d!=numDigit; ++d ) hist[d] = 0;           //   Initialize histogram
+        for( int i=ibegin; i!=iend; ++i ) {                     //   Loop over range of this thread
+          hist[(((*source)[i].ICELL - Imin) >> shift) & (numDigit - 1)]++;// Fill histogram
+        }                                                       //   End loop over range of this thread
+#pragma omp barrier
+#pragma omp single
+        {                                                       //   Scan histograms on one thread
+          int offset = 0;                                       //    Initialize offset
+          for( int d=0; d!=numDigit; ++d ) {                    //    Loop over digits
+            for( int t=0; t!=nthreads; ++t ) {                  //     Loop over threads (keeps sort stable)
+              int count = bucket[t*numDigit+d];                 //      Count of this digit in thread t
+              bucket[t*numDigit+d] = offset;                    //      Offset of this digit in thread t
+              offset += count;                                  //      Increment offset
+            }                                                   //     End loop over threads
+          }                                                     //    End loop over digits
+        }                                                       //   Implicit barrier
+#pragma omp master
+        {                                                       //   Timers on the encountering thread
+          stopTimer("Fill bucket");                             //    Stop timer
+          startTimer("Empty bucket");                           //    Start timer
+        }                                                       //   End master
+        for( int i=ibegin; i!=iend; ++i ) {                     //   Loop over range of this thread
+          int inew = hist[(((*source)[i].ICELL - Imin) >> shift) & (numDigit - 1)]++;// Permutation index
+          if( reverse ) inew = end - begin - 1 - inew;          //   Reverse for descending order
+          (*target)[begin+inew] = (*source)[i];                 //   Scatter to target buffer
+        }                                                       //   End loop over range of this thread
+      }                                                         //  End parallel region
+      stopTimer("Empty bucket");                                //  Stop timer
+      std::swap(source,target);                                 //  Swap ping-pong buffers
+    }                                                           // End loop over digits
   }
 
 public:
@@ -80,27 +118,22 @@ public:
 
 //! Sort bodies accoring to cell index
   void sortBodies(Bodies &bodies, Bodies &buffer, bool ascend=true, int begin=0, int end=0) {
-    startTimer("Sort bodies");                                  // Start timer
     if( bodies.size() == 0 ) return;                            // Don't do anything if vector is empty
     if( end == 0 ) end = bodies.size();                         // Default range is the whole vector
-    int numBucket = 0;                                          // Initialize bucket size
-    bigint Imin = 0;                                            // Initialize minimum index
-    getBucketSize(bodies,begin,end,Imin,numBucket);             // Get bucket size for sorting
+    startTimer("Sort bodies");                                  // Start timer
+    if( buffer.size() < bodies.size() ) buffer.resize(bodies.size());// Resize sort buffer if necessary
+    sortICELL(bodies,buffer,ascend,begin,end);                  // Call radix sort
     stopTimer("Sort bodies");                                   // Stop timer
-    sortICELL(bodies,buffer,Imin,numBucket,ascend,begin,end);   // Call bucket sort for small indices
   }
 
 //! Sort cells according to cell index
   void sortCells(Cells &cells, Cells &buffer, bool ascend=true, int begin=0, int end=0) {
-    startTimer("Sort cells");                                   // Start timer
     if( cells.size() == 0 ) return;                             // Don't do anything if vector is empty
     if( end == 0 ) end = cells.size();                          // Default rage is the whole vector
-    int numBucket = 0;                                          // Initialize bucket size
-    bigint Imin = 0;                                            // Initialize minimum index
-    getBucketSize(cells,begin,end,Imin,numBucket);              // Get bucket size for sorting
-    stopTimer("Sort cells");                                    // Stop timer
+    startTimer("Sort cells");                                   // Start timer
     if( buffer.size() < cells.size() ) buffer.resize(cells.size());// Resize sort buffer if necessary
-    sortICELL(cells,buffer,Imin,numBucket,ascend,begin,end);    // Call bucket sort for small indices
+    sortICELL(cells,buffer,ascend,begin,end);                   // Call radix sort
+    stopTimer("Sort cells");                                    // Stop timer
   }
 };
 
@@ -32,20 +32,25 @@ public:
   using Kernel<equation>::stopTimer;                            //!< Stop timer for given event
   using Kernel<equation>::X0;                                   //!< Center of root cell
   using Kernel<equation>::R0;                                   //!< Radius of root cell
+  using Evaluator<equation>::GRAINSIZE;                         //!< Minimum bodies in target cell to spawn a task
+  using TreeStructure<equation>::buffer;                        //!< Buffer for MPI communication & sorting
+  using TreeStructure<equation>::getLevelOffset;                //!< Get offset of cell index for a given level
 
 private:
 //! Nodes are primitive cells
   struct Node {
     int LEVEL;                                                  //!< Level of node
-    int ICHILD;                                                 //!< Flag of empty child nodes
+    int NCHILD;                                                 //!< Number of child nodes
+    int CHILD;                                                  //!< Index offset of first child node
     int NLEAF;                                                  //!< Number of leafs in node
+    int LEAF;                                                   //!< Index offset of first leaf in bodies
     bigint I;                                                   //!< Cell index
-    bigint CHILD[8];                                            //!< Iterator offset of child nodes
-    B_iter LEAF[NCRIT];                                         //!< Iterator for leafs
     vect X;                                                     //!< Node center
     real R;                                                     //!< Node radius
   };
   std::vector<Node> nodes;                                      //!< Nodes in the tree
+  int numNodes;                                                 //!< Number of nodes in use
+  bool overflow;                                                //!< Preallocated nodes ran out during grow
 
 //! Calculate octant from position
   int getOctant(const vect X, int i) {
@@ -56,95 +61,113 @@ private:
     return octant;                                              // Return octant
   }
 
-//! Add child node and link it
-  void addChild(const int octant, int i) {
-    bigint pOff = ((1 << 3* nodes[i].LEVEL   ) - 1) / 7;        // Parent cell index offset
-    bigint cOff = ((1 << 3*(nodes[i].LEVEL+1)) - 1) / 7;        // Current cell index offset
+//! Set child node from its parent node
+  void setChild(const int octant, int i, int c, int leaf, int nleaf) {
+    assert( nodes[i].LEVEL < MAXLEVEL );                        // Cell index must fit in bigint
+    bigint pOff = getLevelOffset(nodes[i].LEVEL);               // Parent cell index offset
+    bigint cOff = getLevelOffset(nodes[i].LEVEL+1);             // Current cell index offset
     vect x = nodes[i].X;                                        // Initialize new center position with old center
     real r = nodes[i].R/2;                                      // Initialize new size
     for( int d=0; d!=3; ++d ) {                                 // Loop over dimensions
       x[d] += r * (((octant & 1 << d) >> d) * 2 - 1);           //  Calculate new center position
     }                                                           // End loop over dimensions
-    Node node;                                                  // Node structure
-    node.NLEAF = node.ICHILD = 0;                               // Initialize child node counters
+    Node &node = nodes[c];                                      // Child node
+    node.NCHILD = node.CHILD = 0;                               // Initialize child node counters
+    node.NLEAF = nleaf;                                         // Number of leafs in child node
+    node.LEAF = leaf;                                           // Index offset of first leaf in child node
     node.X = x;                                                 // Initialize child node center
     node.R = r;                                                 // Initialize child node radius
     node.LEVEL = nodes[i].LEVEL + 1;                            // Level of child node
     node.I = ((nodes[i].I-pOff) << 3) + octant + cOff;          // Cell index of child node
-    nodes[i].ICHILD |= (1 << octant);                           // Flip bit of octant
-    nodes[i].CHILD[octant] = nodes.end()-nodes.begin();         // Link child node to its parent
-    nodes.push_back(node);                                      // Push child node into vector
   }
 
-//! Add leaf to node
-  void addLeaf(B_iter b, int i) {
-    nodes[i].LEAF[nodes[i].NLEAF] = b;                          // Assign body iterator to leaf
-    nodes[i].NLEAF++;                                           // Increment leaf counter
-  }
-
-//! Split node and reassign leafs to child nodes
-  void splitNode(int i) {
-    for( int l=0; l!=NCRIT; ++l ) {                             // Loop over leafs in parent node
-      int octant = getOctant(nodes[i].LEAF[l]->X,i);            //  Find the octant where the body belongs
-      if( !(nodes[i].ICHILD & (1 << octant)) ) {                //  If child doesn't exist in this octant
-        addChild(octant,i);                                     //   Add new child to list
-      }                                                         //  Endif for octant
-      int c = nodes[i].CHILD[octant];                           //  Set counter for child node
-      addLeaf(nodes[i].LEAF[l],c);                              //  Add leaf to child
-      if( nodes[c].NLEAF >= NCRIT ) {                           //  If there are still too many leafs
-        splitNode(c);                                           //   Split the node into smaller ones
-      }                                                         //  Endif for too many leafs
+//! Split node by partitioning its leafs into octants (B0: current leafs, B1: other array)
+  void splitNode(B_iter B0, B_iter B1, int i, bool swapped) {
+    int begin = nodes[i].LEAF, end = begin + nodes[i].NLEAF;    // Range of leafs in node
+    if( nodes[i].NLEAF < NCRIT ) {                              // If node has few enough leafs
+      if( swapped ) std::copy(B0+begin,B0+end,B1+begin);        //  Leafs must end up in bodies
+      return;                                                   //  Node is a leaf
+    }                                                           // Endif for few enough leafs
+    int size[8] = {0,0,0,0,0,0,0,0};                            // Number of leafs in each octant
+    for( int b=begin; b!=end; ++b ) {                           // Loop over leafs
+      size[getOctant(B0[b].X,i)]++;                             //  Count leafs in octant
     }                                                           // End loop over leafs
-  }
-
-//! Traverse tree
-  void traverse(typename std::vector<Node>::iterator N) {
-    if( N->NLEAF >= NCRIT ) {                                   // If node has children
-      for( int i=0; i!=8; ++i ) {                               // Loop over children
-        if( N->ICHILD & (1 << i) ) {                            //  If child exists in this octant
-          traverse(nodes.begin()+N->CHILD[i]);                  //   Recursively search child node
-        }                                                       //  Endif for octant
-      }                                                         // End loop over children
-    } else {                                                    //  If child doesn't exist
-      for( int i=0; i!=N->NLEAF; ++i ) {                        //   Loop over leafs
-        N->LEAF[i]->ICELL = N->I;                               //    Store cell index in bodies
-      }                                                         //   End loop over leafs
-    }                                                           //  Endif for child existence
+    int offset[8], nchild = 0;                                  // Leaf offset of each octant, number of children
+    for( int octant=0, o=begin; octant!=8; ++octant ) {         // Loop over octants
+      offset[octant] = o;                                       //  Leaf offset of octant
+      o += size[octant];                                        //  Increment leaf offset
+      nchild += size[octant] != 0;                              //  Count non-empty octants
+    }                                                           // End loop over octants
+    int c;                                                      // Index offset of first child node
+#pragma omp atomic capture
+    { c = numNodes; numNodes += nchild; }                       // Reserve contiguous child nodes
+    if( c + nchild > int(nodes.size()) ) {                      // If preallocated nodes are not enough
+#pragma omp atomic write
+      overflow = true;                                          //  Flag grow() to retry with more nodes
+      if( swapped ) std::copy(B0+begin,B0+end,B1+begin);        //  Leafs must end up in bodies
+      return;                                                   //  Leave node unsplit
+    }                                                           // Endif for overflow
+    nodes[i].CHILD = c;                                         // Link children to node
+    nodes[i].NCHILD = nchild;                                   // Set number of children
+    for( int octant=0; octant!=8; ++octant ) {                  // Loop over octants
+      if( size[octant] != 0 ) {                                 //  If octant is not empty
+        setChild(octant,i,c++,offset[octant],size[octant]);     //   Set child node
+      }                                                         //  Endif for empty octant
+    }                                                           // End loop over octants
+    for( int b=begin; b!=end; ++b ) {                           // Loop over leafs
+      B1[offset[getOctant(B0[b].X,i)]++] = B0[b];               //  Scatter leaf to its octant (stable)
+    }                                                           // End loop over leafs
+    for( c=nodes[i].CHILD; c!=nodes[i].CHILD+nchild; ++c ) {    // Loop over child nodes
+      if( nodes[c].NLEAF > GRAINSIZE ) {                        //  If child is large enough
+#pragma omp task firstprivate(c)
+        splitNode(B1,B0,c,!swapped);                            //   Spawn task on disjoint range of leafs
+      } else {                                                  //  If child is small
+        splitNode(B1,B0,c,!swapped);                            //   Split child in this task
+      }                                                         //  Endif for grain size
+    }                                                           // End loop over child nodes
+#pragma omp taskwait
   }
 
 public:
-//! Grow tree from root
+//! Constructor
+  TopDown() : nodes(), numNodes(0), overflow(false) {}
+
+//! Grow tree from root by partitioning bodies in place
   void grow(Bodies &bodies) {
     startTimer("Grow tree");                                    // Start timer
-    int octant;                                                 // In which octant is the body located?
-    Node node;                                                  // Node structure
-    node.LEVEL = node.NLEAF = node.ICHILD = node.I = 0;         // Initialize root node counters
-    node.X = X0;                                                // Initialize root node center
-    node.R = R0;                                                // Initialize root node radius
-    nodes.push_back(node);                                      // Push child node into vector
-    for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {      // Loop over bodies
-      int i = 0;                                                //  Reset node counter
-      while( nodes[i].NLEAF >= NCRIT ) {                        //  While the nodes have children
-        nodes[i].NLEAF++;                                       //   Increment the cumulative leaf counter
-        octant = getOctant(B->X,i);                             //   Find the octant where the body belongs
-        if( !(nodes[i].ICHILD & (1 << octant)) ) {              //   If child doesn't exist in this octant
-          addChild(octant,i);                                   //    Add new child to list
-        }                                                       //   Endif for child existence
-        i = nodes[i].CHILD[octant];                             //    Update node iterator to child
-      }                                                         //  End while loop
-      addLeaf(B,i);                                             //  Add body to node as leaf
-      if( nodes[i].NLEAF >= NCRIT ) {                           //  If there are too many leafs
-        splitNode(i);                                           //   Split the node into smaller ones
-      }                                                         //  Endif for splitting
-    }                                                           // End loop over bodies
+    buffer.resize(bodies.size());                               // Resize partition buffer
+    int maxNodes = 1 + 8 * MAXLEVEL * (bodies.size() / NCRIT + 1);// Bound on nodes (at most N/NCRIT splits per level)
+    do {                                                        // Loop until preallocated nodes are enough
+      nodes.resize(maxNodes);                                   //  Preallocate nodes
+      Node &root = nodes[0];                                    //  Root node
+      root.LEVEL = root.NCHILD = root.CHILD = root.LEAF = 0;    //  Initialize root node counters
+      root.NLEAF = bodies.size();                               //  Root node has all bodies
+      root.I = 0;                                               //  Root cell index
+      root.X = X0;                                              //  Initialize root node center
+      root.R = R0;                                              //  Initialize root node radius
+      numNodes = 1;                                             //  Only root node is used
+      overflow = false;                                         //  Reset overflow flag
+#pragma omp parallel
+#pragma omp single
+      splitNode(bodies.begin(),buffer.begin(),0,false);         //  Split nodes recursively
+      maxNodes *= 2;                                            //  Double nodes in case of a retry
+    } while( overflow );                                        // End loop until nodes are enough
+    nodes.resize(numNodes);                                     // Drop unused nodes
     stopTimer("Grow tree",printNow);                            // Stop timer
   }
 
 //! Store cell index of all bodies
-  void setIndex() {
+  void setIndex(Bodies &bodies) {
     startTimer("Set index");                                    // Start timer
-    traverse(nodes.begin());                                    // Traverse tree
-    stopTimer("Set index",printNow);                            // Stop timer 
+#pragma omp parallel for
+    for( int i=0; i<numNodes; ++i ) {                           // Loop over nodes
+      if( nodes[i].NCHILD == 0 ) {                              //  If node is a leaf
+        for( int b=nodes[i].LEAF; b!=nodes[i].LEAF+nodes[i].NLEAF; ++b ) {// Loop over leafs
+          bodies[b].ICELL = nodes[i].I;                         //    Store cell index in bodies
+        }                                                       //   End loop over leafs
+      }                                                         //  Endif for leaf
+    }                                                           // End loop over nodes
+    stopTimer("Set index",printNow);                            // Stop timer
   }
 };
 
@@ -32,16 +32,31 @@ public:
   using Kernel<equation>::printNow;                             //!< Switch to print timings
   using Kernel<equation>::startTimer;                           //!< Start timer for given event
   using Kernel<equation>::stopTimer;                            //!< Stop timer for given event
-  using Kernel<equation>::sortCells;                            //!< Sort cells according to cell index
   using Kernel<equation>::X0;                                   //!< Center of root cell
   using Kernel<equation>::R0;                                   //!< Radius of root cell
+  using Kernel<equation>::getNumM;                              //!< Get number of multipole coefficients per cell
+  using Kernel<equation>::getNumL;                              //!< Get number of local coefficients per cell
+  using Kernel<equation>::getM;                                 //!< Get multipole coefficients of cell
+  using Kernel<equation>::getL;                                 //!< Get local coefficients of cell
+  using Kernel<equation>::newCoef;                              //!< Allocate zeroed coefficients for cell
+  using Kernel<equation>::copyCoef;                             //!< Give cell its own copy of its coefficients
+  using Kernel<equation>::freeCoef;                             //!< Release coefficients of cell
+  using Kernel<equation>::hasExclusions;                        //!< Check if any pair is excluded
+  using Kernel<equation>::subtractExclusions;                   //!< Subtract excluded pairs that P2P did not skip
+  using Kernel<equation>::gatherBodies;                         //!< Gather bodies into structures of arrays for P2P
+  using Kernel<equation>::scatterBodies;                        //!< Add P2P results of structures of arrays to bodies
+  using Evaluator<equation>::periodicCells;                     //!< Periodic center cells that own coefficients
   using Evaluator<equation>::NP2P;                              //!< Number of P2P kernel calls
   using Evaluator<equation>::NM2P;                              //!< Number of M2P kernel calls
   using Evaluator<equation>::NM2L;                              //!< Number of M2L kernel calls
   using Evaluator<equation>::getLevel;                          //!< Get level from cell index
+  using Evaluator<equation>::getLevelOffset;                    //!< Get offset of cell index for a given level
+  using Evaluator<equation>::getMorton;                         //!< Interleave bits of 3-D cell index
+  using Evaluator<equation>::getIndex3D;                        //!< De-interleave Morton code
   using Evaluator<equation>::timeKernels;                       //!< Time all kernels for auto-tuning
   using Evaluator<equation>::upwardPeriodic;                    //!< Upward phase for periodic cells
   using Evaluator<equation>::traverse;                          //!< Traverse tree to get interaction list
+  using Evaluator<equation>::traverseMutual;                    //!< Traverse tree with itself for mutual interactions
   using Evaluator<equation>::traversePeriodic;                  //!< Traverse tree for periodic images
   using Evaluator<equation>::neighbor;                          //!< Traverse source tree to get neighbor list
   using Evaluator<equation>::evalP2M;                           //!< Evaluate P2M kernel
@@ -53,24 +68,50 @@ public:
   using Evaluator<equation>::evalL2P;                           //!< Evaluate L2P kernel
   using Evaluator<equation>::evalEwaldReal;                     //!< Evaluate Ewald real part
   using Evaluator<equation>::EwaldWave;                         //!< Evalaute Ewald wave part
+  using Evaluator<equation>::EwaldSPME;                         //!< Evaluate Ewald wave part by SPME
+  using Evaluator<equation>::SPMEGRID;                          //!< Grid points per dimension of SPME (0 for DFT)
+  using Evaluator<equation>::setEwald;                          //!< Set paramters for Ewald summation
 
 private:
 //! Get parent cell index from current cell index
   bigint getParent(bigint index) {
     int level = getLevel(index);                                // Get level from cell index
-    bigint cOff = ((1 << 3 *  level   ) - 1) / 7;               // Cell index offset of current level
-    bigint pOff = ((1 << 3 * (level-1)) - 1) / 7;               // Cell index offset of parent level
+    bigint cOff = getLevelOffset(level);                        // Cell index offset of current level
+    bigint pOff = getLevelOffset(level-1);                      // Cell index offset of parent level
     bigint i = ((index-cOff) >> 3) + pOff;                      // Cell index of parent cell
     return i;                                                   // Return cell index of parent cell
   }
 
+//! Merge twigs of the current level into the parent cells of the level below
+  void mergeTwigs(Cells &cells, Cells &twigs, int &t, int dt, int level, int begin, int &end) {
+    int numTwigs = 0;                                           // Initialize number of twigs in this level
+    int size = twigs.size();                                    // Number of twigs
+    for( int i=t; 0<=i && i<size && getLevel(twigs[i].ICELL)==level; i+=dt ) {// Loop over twigs in this level
+      numTwigs++;                                               //  Increment twig counter
+    }                                                           // End loop over twigs in this level
+    cells.resize(end+numTwigs);                                 // Make room for the twigs at the end of cells
+    int i = end - 1;                                            // Last parent cell (smallest index)
+    int j = t + (numTwigs - 1) * dt;                            // Last twig in this level (smallest index)
+    for( int w=end+numTwigs-1; w>=begin && j!=t-dt; --w ) {     // Merge both descending runs from the back
+      if( i >= begin && cells[i].ICELL <= twigs[j].ICELL ) {    //  If parent cell is smaller (twigs go first if equal)
+        cells[w] = cells[i--];                                  //   Move parent cell
+      } else {                                                  //  Else twig is smaller
+        cells[w] = twigs[j];                                    //   Copy twig
+        j -= dt;                                                //   Go to next larger twig
+      }                                                         //  Endif for smaller cell
+    }                                                           // End loop over merged cells
+    t += numTwigs * dt;                                         // Skip twigs of this level
+    end += numTwigs;                                            // Increment cell counter
+  }
+
 //! Merge sticks with cells (levelwise)
   void unique(Cells &cells, Cells &sticks, int begin, int &end) {
     int c_old = begin;                                          // Initialize old cell counter
-    for( int c=begin; c!=end; ++c ) {                           // Loop over cells in level
+    for( int c=begin+1; c<end; ++c ) {                          // Loop over cells in level
       if( cells[c].ICELL != cells[c_old].ICELL ) {              //  If current cell index is different from previous
-        c_old = c;                                              //   Update old cell counter
-      } else if( c != c_old ) {                                 //  If cell index is repeated
+        c_old++;                                                //   Update old cell counter
+        if( c != c_old ) cells[c_old] = cells[c];               //   Compact cell into first free slot
+      } else {                                                  //  If cell index is repeated
         if( cells[c].NCHILD != 0 ) {                            //   Stick-cell collision
           cells[c_old].NCHILD = cells[c].NCHILD;                //    Copy number of children
           cells[c_old].NCLEAF = cells[c].NCLEAF;                //    Copy number of leafs
@@ -79,69 +120,62 @@ private:
           cells[c_old].CHILD = cells[c].CHILD;                  //    Copy child link
           cells[c_old].LEAF = cells[c].LEAF;                    //    Copy iterator of first leaf
           sticks.push_back(cells[c_old]);                       //    Push stick into vector
+          copyCoef(sticks.back());                              //    Stick keeps its own multipole
         }                                                       //   Endif for collision type
-        cells[c_old].M += cells[c].M;                           //   Accumulate multipole
-        cells.erase(cells.begin()+c);                           //   Erase colliding cell
-        c--;                                                    //   Decrement counter to account for erase
-        end--;                                                  //   Decrement end to account for erase
+        Coef *Mold = getM(cells[c_old]);                        //   Multipole of remaining cell
+        Coef *M = getM(cells[c]);                               //   Multipole of colliding cell
+        for( int i=0; i!=getNumM(); ++i ) Mold[i] += M[i];      //   Accumulate multipole
+        freeCoef(cells[c]);                                     //   Merged duplicate releases its coefficients
       }                                                         //  Endif for repeated cell index
     }                                                           // End loop over cells in level
+    if( begin != end ) end = c_old + 1;                         // New end of compacted level
+    cells.resize(end);                                          // Drop merged duplicates at the end
   }
 
 //! Form parent-child mutual link
   void linkParent(Cells &cells, int &begin, int &end) {
-    Cell parent;                                                // Parent cell
-    Cells parents;                                              // Parent cell vector;
-    int oldend = end;                                           // Save old end counter
-    parent.ICELL = getParent(cells[begin].ICELL);               // Set cell index
-    parent.M = 0;                                               // Initialize multipole coefficients
-    parent.L = 0;                                               // Initlalize local coefficients
-    parent.NCLEAF = parent.NDLEAF = parent.NCHILD = 0;          // Initialize NCLEAF, NDLEAF, & NCHILD
-    parent.LEAF = cells[begin].LEAF;                            // Set pointer to first leaf
-    parent.CHILD = begin;                                       // Link to child
-    getCenter(parent);                                          // Set cell center and radius
-    for( int i=begin; i!=oldend; ++i ) {                        // Loop over cells at this level
-      if( getParent(cells[i].ICELL) != parent.ICELL ) {         //  If it belongs to a new parent cell
-        cells.push_back(parent);                                //   Push cells into vector
-        end++;                                                  //   Increment cell counter
-        parent.ICELL = getParent(cells[i].ICELL);               //   Set cell index
-        parent.M = 0;                                           //   Initialize multipole coefficients
-        parent.L = 0;                                           //   Initialize local coefficients
-        parent.NCLEAF = parent.NDLEAF = parent.NCHILD = 0;      //   Initialize NCLEAF, NDLEAF, & NCHILD
-        parent.LEAF = cells[i].LEAF;                            //   Set pointer to first leaf
-        parent.CHILD = i;                                       //   Link to child
-        getCenter(parent);                                      //   Set cell center and radius
-      }                                                         //  Endif for new parent cell
-      for( int c=0; c!=cells[i].NCHILD; ++c ) {                 //  Loop over child cells
-        (cells.begin()+cells[i].CHILD+c)->PARENT = i;           //   Link child to current
-      }                                                         //  End loop over child cells
-      cells[i].PARENT = end;                                    //  Link to current to parent
-      parent.NDLEAF += cells[i].NDLEAF;                         //  Add nleaf of child to parent
-      parents.push_back(parent);                                //  Push parent cell into vector
-      parent = parents.back();                                  //  Copy information from vector
-      parents.pop_back();                                       //  Pop parent cell from vector
-      parent.NCHILD++;                                          //  Increment child counter
+    std::vector<int> first;                                     // First child of each parent cell
+    bigint index = -1;                                          // Cell index of previous parent
+    for( int i=begin; i!=end; ++i ) {                           // Loop over cells at this level
+      bigint parent = getParent(cells[i].ICELL);                //  Cell index of parent cell
+      if( parent != index ) first.push_back(i);                 //  It belongs to a new parent cell
+      index = parent;                                           //  Update previous parent
     }                                                           // End loop over cells at this level
-    cells.push_back(parent);                                    // Push cells into vector
-    end++;                                                      // Increment cell counter
+    const int oldend = end, numParents = first.size();          // Parents are appended after this level
+    first.push_back(oldend);                                    // End of children of last parent
+    cells.resize(oldend+numParents);                            // Size cell vector for parents of this level
+#pragma omp parallel for
+    for( int p=0; p<numParents; ++p ) {                         // Loop over parent cells
+      Cell &parent = cells[oldend+p];                           //  Parent cell
+      parent.ICELL = getParent(cells[first[p]].ICELL);          //  Set cell index
+      parent.NCLEAF = parent.NDLEAF = 0;                        //  Initialize NCLEAF & NDLEAF
+      parent.NCHILD = first[p+1] - first[p];                    //  Set number of children
+      parent.LEAF = cells[first[p]].LEAF;                       //  Set pointer to first leaf
+      parent.CHILD = first[p];                                  //  Link to child
+      getCenter(parent);                                        //  Set cell center and radius
+      for( int i=first[p]; i!=first[p+1]; ++i ) {               //  Loop over child cells
+        cells[i].PARENT = oldend + p;                           //   Link child to parent
+        parent.NDLEAF += cells[i].NDLEAF;                       //   Add nleaf of child to parent
+        for( int c=0; c!=cells[i].NCHILD; ++c ) {               //   Loop over grandchild cells
+          cells[cells[i].CHILD+c].PARENT = i;                   //    Link grandchild to child
+        }                                                       //   End loop over grandchild cells
+      }                                                         //  End loop over child cells
+    }                                                           // End loop over parent cells
+    for( int p=0; p<numParents; ++p ) {                         // Loop over parent cells
+      newCoef(cells[oldend+p]);                                 //  Allocate zeroed multipole & local coefficients
+    }                                                           // End loop over parent cells
     begin = oldend;                                             // Set new begin index to old end index
+    end = oldend + numParents;                                  // Set new end index after parents
   }
 
 protected:
 //! Get cell center and radius from cell index
   void getCenter(Cell &cell) {
     int level = getLevel(cell.ICELL);                           // Get level from cell index
-    bigint index = cell.ICELL - ((1 << 3*level) - 1) / 7;       // Subtract cell index offset of current level
+    bigint index = cell.ICELL - getLevelOffset(level);          // Subtract cell index offset of current level
     cell.R = R0 / (1 << level);                                 // Cell radius
-    int d = level = 0;                                          // Initialize dimension and level
-    vec<3,int> nx = 0;                                          // Initialize 3-D cell index
-    while( index != 0 ) {                                       // Deinterleave bits while index is nonzero
-      nx[d] += (index % 2) * (1 << level);                      //  Add deinterleaved bit to 3-D cell index
-      index >>= 1;                                              //  Right shift the bits
-      d = (d+1) % 3;                                            //  Increment dimension
-      if( d == 0 ) level++;                                     //  If dimension is 0 again, increment level
-    }                                                           // End while loop for deinterleaving bits
-    for( d=0; d!=3; ++d ) {                                     // Loop over dimensions
+    vec<3,int> nx = getIndex3D(index);                          // Deinterleave bits into 3-D cell index
+    for( int d=0; d!=3; ++d ) {                                 // Loop over dimensions
       cell.X[d] = (X0[d]-R0) + (2 *nx[d] + 1) * cell.R;         //  Calculate cell center from 3-D cell index
     }                                                           // End loop over dimensions
   }
@@ -154,6 +188,7 @@ public:
     bigint index = bodies[0].ICELL;                             // Initialize cell index
     B_iter firstLeaf = bodies.begin();                          // Initialize body iterator for first leaf
     Cell cell;                                                  // Cell structure
+    cell.ICOEF = -1;                                            // Coefficients are allocated by P2M
     for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {      // Loop over bodies
       if( B->ICELL != index ) {                                 //  If it belongs to a new cell
         cell.NCLEAF = nleaf;                                    //   Set number of child leafs
@@ -182,55 +217,56 @@ public:
     evalP2M(twigs);                                             // Evaluate all P2M kernels
   }
 
-//! Link twigs bottomup to create all cells in tree
+//! Link twigs bottomup to create all cells in tree (twigs must be sorted by cell index)
   void twigs2cells(Cells &twigs, Cells &cells, Cells &sticks) {
+    startTimer("Twigs2cells");                                  // Start timer
     int begin = 0, end = 0;                                     // Initialize range of cell vector
-    int level = getLevel(twigs.back().ICELL);                   // Initialize level of tree
-    startTimer("Sort resize");                                  // Start timer
-    Cells cbuffer;                                              // Sort buffer for cells
-    cbuffer.resize(2*twigs.size());                             // Resize sort buffer for cells
-    stopTimer("Sort resize");                                   // Stop timer
-    while( !twigs.empty() ) {                                   // Keep poppig twigs until the vector is empty
-      while( getLevel(twigs.back().ICELL) != level ) {          //  While cell belongs to a higher level
-        sortCells(cells,cbuffer,false,begin,end);               //   Sort cells at this level
-        startTimer("Twigs2cells");                              //   Start timer
-        unique(cells,sticks,begin,end);                         //   Get rid of duplicate cells
-        linkParent(cells,begin,end);                            //   Form parent-child mutual link
-        level--;                                                //   Go up one level
-        stopTimer("Twigs2cells");                               //   Stop timer
-      }                                                         //  End while for higher level
-      startTimer("Twigs2cells");                                //  Start timer
-      cells.push_back(twigs.back());                            //  Push cells into vector
-      twigs.pop_back();                                         //  Pop twigs from vector
-      end++;                                                    //  Increment cell counter
-      stopTimer("Twigs2cells");                                 //  Stop timer
-    }                                                           // End while for popping twigs
-    for( int l=level; l>0; --l ) {                              // Once all the twigs are done, do the rest
-      sortCells(cells,cbuffer,false,begin,end);                 //  Sort cells at this level
-      startTimer("Twigs2cells");                                //  Start timer
+    int dt = twigs.front().ICELL < twigs.back().ICELL ? -1 : 1; // Direction from deepest to shallowest twig
+    int t = dt == 1 ? 0 : twigs.size() - 1;                     // Start from the deepest twig
+    int level = getLevel(twigs[t].ICELL);                       // Initialize level of tree
+    for( ; level>0; --level ) {                                 // Loop over levels from the bottom up
+      mergeTwigs(cells,twigs,t,dt,level,begin,end);             //  Merge twigs with cells at this level
       unique(cells,sticks,begin,end);                           //  Get rid of duplicate cells
       linkParent(cells,begin,end);                              //  Form parent-child mutual link
-      stopTimer("Twigs2cells");                                 //  Stop timer
     }                                                           // End loop over levels
-    startTimer("Twigs2cells");                                  // Start timer
+    mergeTwigs(cells,twigs,t,dt,level,begin,end);               // Twig at root if there is one
     unique(cells,sticks,begin,end);                             // Just in case there is a collision at root
+    twigs.clear();                                              // All twigs are now cells
     stopTimer("Twigs2cells",printNow);                          // Stop timer & print
     evalM2M(cells,cells);                                       // Evaluate all M2M kernels
   }
 
 //! Downward phase (M2L,M2P,P2P,L2L,L2P evaluation)
+//! Passing the same vector as cells and jcells evaluates each interaction once for both cells
   void downward(Cells &cells, Cells &jcells, bool periodic=true) {
+    bool mutual = &cells == &jcells;                            // Targets are the sources
+    if( mutual && IMAGES != 0 ) {                               // If periodic images have to be appended
+      Cells pjcells = cells;                                    //  Periodic images need a separate source vector
+      downward(cells,pjcells,periodic);                         //  One-sided downward phase
+      return;                                                   //  Done
+    }                                                           // Endif for periodic images
 #if HYBRID
     timeKernels();                                              // Time all kernels for auto-tuning
 #endif
-    for( C_iter C=cells.begin(); C!=cells.end(); ++C ) C->L = 0;// Initialize local coefficients
+    for( C_iter C=cells.begin(); C!=cells.end(); ++C ) {        // Loop over cells
+      std::fill(getL(C),getL(C)+getNumL(),Coef(0));             //  Initialize local coefficients
+    }                                                           // End loop over cells
+#if !QUEUE
+    startTimer("Gather SoA");                                   // Start timer
+    gatherBodies(cells,jcells);                                 // Gather bodies once for all P2P kernels
+    stopTimer("Gather SoA",printNow);                           // Stop timer & print
+#endif
     if( IMAGES != 0 ) {                                         // If periodic boundary condition
       startTimer("Upward P");                                   //  Start timer
       upwardPeriodic(jcells);                                   //  Upward phase for periodic images
       stopTimer("Upward P",printNow);                           //  Stop timer & print
     }                                                           // Endif for periodic boundary condition
     startTimer("Traverse");                                     // Start timer
-    traverse(cells,jcells);                                     // Traverse tree to get interaction list
+    if( mutual ) {                                              // If targets are the sources
+      traverseMutual(cells);                                    //  Traverse tree with itself
+    } else {                                                    // If targets and sources are different
+      traverse(cells,jcells);                                   //  Traverse tree to get interaction list
+    }                                                           // Endif for mutual traversal
     stopTimer("Traverse",printNow);                             // Stop timer & print
     if( IMAGES != 0 && periodic ) {                             // If periodic boundary condition
       startTimer("Traverse P");                                 // Start timer
@@ -241,9 +277,21 @@ public:
     evalM2L(cells);                                             // Evaluate queued M2L kernels (only GPU)
     evalM2P(cells);                                             // Evaluate queued M2P kernels (only GPU)
     evalP2P(cells);                                             // Evaluate queued P2P kernels (only GPU)
+#else
+    scatterBodies();                                            // Add P2P results to bodies
 #endif
+    if( IMAGES != 0 ) {                                         // If periodic images were appended
+      jcells.resize(jcells.size()-26*27*periodicCells.size());  //  Remove periodic images from source cells
+      freeCoef(periodicCells);                                  //  Release coefficients of periodic center cells
+      periodicCells.clear();                                    //  Clear periodic center cells
+    }                                                           // Endif for periodic images
     evalL2L(cells);                                             // Evaluate all L2L kernels
     evalL2P(cells);                                             // Evaluate all L2P kernels
+    if( hasExclusions() ) {                                     // If some pairs are excluded
+      startTimer("Exclusions");                                 //  Start timer
+      subtractExclusions();                                     //  Subtract excluded pairs that P2P did not skip
+      stopTimer("Exclusions",printNow);                         //  Stop timer & print
+    }                                                           // Endif for excluded pairs
     if(printNow) std::cout << "P2P: "  << NP2P
                            << " M2P: " << NM2P
                            << " M2L: " << NM2L << std::endl;
@@ -252,13 +300,124 @@ public:
 //! Calculate Ewald summation
   void Ewald(Bodies &bodies, Cells &cells, Cells &jcells) {
     startTimer("Ewald wave");                                   // Start timer
-    EwaldWave(bodies);                                          // Ewald wave part
+    if( SPMEGRID ) {                                            // If SPME grid is set
+      EwaldSPME(bodies);                                        //  Ewald wave part by particle mesh
+    } else {                                                    // Else use DFT
+      EwaldWave(bodies);                                        //  Ewald wave part
+    }                                                           // Endif for SPME
     stopTimer("Ewald wave",printNow);                           // Stop timer & print
     startTimer("Ewald real");                                   // Start timer
     neighbor(cells,jcells);                                     // Neighbor calculation for real part
-    evalEwaldReal(cells);                                       // Evaluate queued Ewald real kernels (only GPU)
+    evalEwaldReal(cells);                                       // Evaluate Ewald real kernels of neighbor lists
     stopTimer("Ewald real",printNow);                           // Stop timer & print
   }
+
+//! Set alpha, ksize and cutoff of Ewald summation for a relative RMS force and potential error at the lowest cost
+//! A coarse trial Ewald on sampled twigs gives the RMS force and potential, and the time per body pair and wave
+//! Errors are the truncation estimates of Kolafa & Perram; returns the predicted time of Ewald with DFT wave part
+  real tuneEwald(Bodies &bodies, Cells &cells, real accuracy, real sigma=.25/M_PI) {
+    const int N = bodies.size();                                // Number of bodies
+    const double L = 2 * R0;                                    // Period
+    const double V = L * L * L;                                 // Volume
+    double Q = 0;                                               // Sum of squared charges
+    for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) Q += B->SRC * B->SRC;// Accumulate squared charges
+    std::vector<vec<4,real> > trg(N);                           // Target values of bodies
+    for( int i=0; i<N; ++i ) trg[i] = bodies[i].TRG;            // Save target values overwritten by the trial
+
+    int numTwigs = 0;                                           // Number of twig cells
+    for( C_iter C=cells.begin(); C!=cells.end(); ++C ) numTwigs += C->NCHILD == 0;// Count twig cells
+    const int stride = std::max(1,numTwigs/64);                 // Stride of sampled twigs
+    Cells sample;                                               // Sampled target twigs
+    int numSample = 0, t = 0;                                   // Bodies in sampled twigs, twig counter
+    for( C_iter C=cells.begin(); C!=cells.end(); ++C ) {        // Loop over cells
+      if( C->NCHILD == 0 && t++ % stride == 0 ) {               //  If twig is sampled
+        sample.push_back(*C);                                   //   Add to sample
+        numSample += C->NDLEAF;                                 //   Count its bodies
+      }                                                         //  Endif for sampled twig
+    }                                                           // End loop over cells
+
+    const int Kt = 6;                                           // Wave number of trial
+    const double alphat = M_PI * Kt / (2 * L);                  // Wave part error of trial ~ exp(-4)
+    const double rct = 2 / alphat;                              // Real part error of trial ~ exp(-4)
+    setEwald(Kt,alphat,sigma,rct);                              // Set trial parameters
+    startTimer("Ewald wave");                                   // Start timer
+    EwaldWave(bodies);                                          // Ewald wave part of all bodies
+    const double timeWave = stopTimer("Ewald wave") / (N * 2 * M_PI / 3 * Kt * Kt * Kt);// Time per body and wave
+    startTimer("Ewald real");                                   // Start timer
+    neighbor(sample,cells);                                     // Neighbor list of sampled twigs
+    evalEwaldReal(sample);                                      // Ewald real part as Ewald() calls it
+    const double timeReal = stopTimer("Ewald real");            // Time of real part for sampled twigs
+    this->eraseTimer("Ewald wave");                             // Erase entry from timer to avoid timer overlap
+    this->eraseTimer("Ewald real");                             // Erase entry from timer to avoid timer overlap
+    this->eraseTimer("evalEwaldReal");                          // Erase entry from timer to avoid timer overlap
+    double F2 = 0, P2 = 0;                                      // Sum of squared force and potential
+    for( C_iter C=sample.begin(); C!=sample.end(); ++C ) {      // Loop over sampled twigs
+      for( B_iter B=C->LEAF; B!=C->LEAF+C->NDLEAF; ++B ) {      //  Loop over bodies in twig
+        P2 += B->TRG[0] * B->TRG[0];                            //   Squared potential
+        F2 += B->TRG[1] * B->TRG[1] + B->TRG[2] * B->TRG[2] + B->TRG[3] * B->TRG[3];// Squared force
+      }                                                         //  End loop over bodies in twig
+    }                                                           // End loop over sampled twigs
+    for( int i=0; i<N; ++i ) bodies[i].TRG = trg[i];            // Restore target values
+    const double tolF = accuracy * std::sqrt(F2 / numSample) / 2;// Force error allowed for each part
+    const double tolP = accuracy * std::sqrt(P2 / numSample) / 2;// Potential error allowed for each part
+
+    const int numCut = 65;                                      // Number of cutoffs to scan
+    const double rmin = std::min(L / std::cbrt(N),double(R0));  // Smallest cutoff is the mean spacing
+    std::vector<double> cut2(numCut);                           // Squared cutoffs
+    for( int i=0; i<numCut; ++i ) {                             // Loop over cutoffs up to nearest image limit
+      double rc = rmin * std::pow(R0 / rmin,i / (numCut - 1.)); //  Cutoff
+      cut2[i] = rc * rc;                                        //  Squared cutoff
+    }                                                           // End loop over cutoffs
+    std::vector<double> pairs(numCut+1,0);                      // Body pairs of twigs first inside each cutoff
+    double pairsTrial = 0;                                      // Body pairs of twigs inside trial cutoff
+    for( C_iter Ci=sample.begin(); Ci!=sample.end(); ++Ci ) {   // Loop over sampled twigs
+      for( C_iter Cj=cells.begin(); Cj!=cells.end(); ++Cj ) {   //  Loop over source cells
+        if( Cj->NCHILD != 0 ) continue;                         //   Only twigs are neighbors
+        real R2 = 0;                                            //   Squared gap between cell boxes as in neighbor()
+        for( int d=0; d<3; ++d ) {                              //   Loop over dimensions
+          real dX = Ci->X[d] - Cj->X[d];                        //    Distance between centers
+          real gap = std::abs(dX - std::floor(dX / L + .5f) * L) - Ci->R - Cj->R;// Gap to nearest image
+          if( gap > 0 ) R2 += gap * gap;                        //    Accumulate squared gap
+        }                                                       //   End loop over dimensions
+        double n = double(Ci->NDLEAF) * Cj->NDLEAF;             //   Body pairs including leaf overreach
+        pairs[std::upper_bound(cut2.begin(),cut2.end(),R2) - cut2.begin()] += n;// First cutoff that includes twig
+        if( R2 < rct * rct ) pairsTrial += n;                   //   Twig is inside trial cutoff
+      }                                                         //  End loop over source cells
+    }                                                           // End loop over sampled twigs
+    for( int i=1; i<numCut; ++i ) pairs[i] += pairs[i-1];       // Pairs inside each cutoff
+
+    double best = HUGE_VAL, alpha = 0, cutoff = 0;              // Cheapest parameters
+    int kmax = 0;                                               // Wave number of cheapest parameters
+    for( int i=0; i<numCut; ++i ) {                             // Loop over cutoffs
+      const double rc = std::sqrt(cut2[i]);                     //  Cutoff
+      const double c = std::sqrt(Q / (V * rc));                 //  Scale of real part errors
+      double s = 1;                                             //  alpha * cutoff
+      while( s < 6 && c * std::exp(-s * s) * std::max(2 / tolF,rc / (s * s) / tolP) > 1 ) s += .01;// Real part errors
+      const double a = s / rc;                                  //  Smallest alpha for real part errors
+      int K = 1;                                                //  Wave number
+      for( ; K<1000; ++K ) {                                    //  Loop over wave numbers
+        double x = M_PI * K / (a * L);                          //   Scaled wave number
+        double e = std::exp(-x * x);                            //   Decay of truncated waves
+        double waveF = 2 * a * std::sqrt(Q / (M_PI * K)) / L * e;// Force error of wave part
+        double waveP = a * e * std::sqrt(Q / (M_PI * M_PI * M_PI * K * K * K)// Potential error of wave part
+                     + Q / N * 4 * a * a * L * L / (M_PI * M_PI * M_PI * M_PI * K * K));// and lost self energy
+        if( waveF <= tolF && waveP <= tolP ) break;             //   Stop at smallest K for wave part errors
+      }                                                         //  End loop over wave numbers
+      double cost = timeReal / std::max(pairsTrial,1.) * pairs[i] * N / numSample// Predicted time of real part
+                  + timeWave * N * 2 * M_PI / 3 * K * K * K;    //  and of wave part
+      if( cost < best ) {                                       //  If cheaper
+        best = cost;                                            //   Store cost
+        alpha = a;                                              //   Store alpha
+        kmax = K;                                               //   Store wave number
+        cutoff = rc;                                            //   Store cutoff
+      }                                                         //  Endif for cheaper
+    }                                                           // End loop over cutoffs
+    setEwald(kmax,alpha,sigma,cutoff,std::min(1e-6,.01*accuracy));// Set tuned parameters
+    if(printNow) std::cout << "alpha: " << alpha
+                           << " ksize: " << kmax
+                           << " cutoff: " << cutoff << std::endl;
+    return best;                                                // Predicted time
+  }
 };
 
 #endif
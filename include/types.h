@@ -37,7 +37,9 @@ THE SOFTWARE.
 #include <iostream>
 #include <list>
 #include <map>
+#include <new>
 #include <queue>
+#include <sstream>
 #include <stack>
 #include <string>
 #include <unistd.h>
@@ -54,8 +56,12 @@ THE SOFTWARE.
 #include <omp.h>
 #endif
 
-typedef unsigned           bigint;                              //!< Big integer type
+typedef unsigned long long bigint;                              //!< Big integer type (64-bit cell index)
+#if FP64
+typedef double             real;                                //!< Real number type on CPU
+#else
 typedef float              real;                                //!< Real number type on CPU
+#endif
 typedef float              gpureal;                             //!< Real number type on GPU
 typedef std::complex<real> complex;                             //!< Complex number type
 typedef vec<3,real>        vect;                                //!< 3-D vector type
@@ -83,8 +89,14 @@ extern int PAPIEVENT;                                           //!< PAPI event
 #endif
 #endif
 
-const int  P        = 10;                                       //!< Order of expansions
+const int  P        = 10;                                       //!< Order of expansions (default order, and order of Mset/Lset)
+#if Spherical && CPU
+const int  PMAX     = 16;                                       //!< Maximum order of expansions set at run time
+#else
+const int  PMAX     = P;                                        //!< Maximum order of expansions (order is fixed)
+#endif
 const int  NCRIT    = 1024;                                     //!< Number of bodies per cell
+const int  MAXLEVEL = 20;                                       //!< Deepest tree level a 64-bit cell index can hold
 const int  MAXBODY  = 50000;                                    //!< Maximum number of bodies per GPU kernel
 const int  MAXCELL  = 10000000;                                 //!< Maximum number of bodies/coefs in cell per GPU kernel
 const real CLET     = 2;                                        //!< LET opening critetia
@@ -94,20 +106,57 @@ const real R2MIN    = 0.0001;                                   //!< Minimum val
 const real R2MAX    = 100.0;                                    //!< Maximum value for L-J R^2
 const int  GPUS     = 3;                                        //!< Number of GPUs per node
 const int  THREADS  = 64;                                       //!< Number of threads per thread-block
+const int  SIMDALIGN = 64;                                      //!< Byte alignment of structure of arrays
 
 const int MTERM = P*(P+1)*(P+2)/6;                              //!< Number of Cartesian mutlipole terms
 const int LTERM = (P+1)*(P+2)*(P+3)/6;                          //!< Number of Cartesian local terms
 const int NTERM = P*(P+1)/2;                                    //!< Number of Spherical multipole/local terms
 
 #if Cartesian
+typedef real                                   Coef;            //!< Expansion coefficient type for Cartesian
 typedef vec<MTERM,real>                        Mset;            //!< Multipole coefficient type for Cartesian
 typedef vec<LTERM,real>                        Lset;            //!< Local coefficient type for Cartesian
 #elif Spherical
+typedef complex                                Coef;            //!< Expansion coefficient type for spherical
 typedef vec<NTERM,complex>                     Mset;            //!< Multipole coefficient type for spherical
 typedef vec<NTERM,complex>                     Lset;            //!< Local coefficient type for spherical
 #endif
+typedef std::vector<Coef>                      Coefs;           //!< Vector of expansion coefficients
 typedef std::vector<bigint>                    Bigints;         //!< Vector of big integer types
 
+//! Allocator with fixed byte alignment (for SIMD loads)
+template<typename T, int ALIGN>
+struct AlignedAllocator {
+  typedef T              value_type;                            //!< Value type
+  typedef T*             pointer;                               //!< Pointer type
+  typedef const T*       const_pointer;                         //!< Constant pointer type
+  typedef T&             reference;                             //!< Reference type
+  typedef const T&       const_reference;                       //!< Constant reference type
+  typedef std::size_t    size_type;                             //!< Size type
+  typedef std::ptrdiff_t difference_type;                       //!< Difference type
+  template<typename U>
+  struct rebind {                                               //!< Rebind allocator to other value type
+    typedef AlignedAllocator<U,ALIGN> other;                    //!< Rebound allocator type
+  };
+  AlignedAllocator() {}                                         //!< Constructor
+  template<typename U>
+  AlignedAllocator(const AlignedAllocator<U,ALIGN>&) {}         //!< Copy constructor from other value type
+  pointer address(reference x) const { return &x; }             //!< Address of reference
+  const_pointer address(const_reference x) const { return &x; } //!< Address of constant reference
+  pointer allocate(size_type n, const void* = 0) {              //!< Allocate aligned memory
+    void *ptr = NULL;                                           // Pointer to allocated memory
+    if( posix_memalign(&ptr, ALIGN, n * sizeof(T)) ) throw std::bad_alloc();// Allocate with alignment
+    return static_cast<pointer>(ptr);                           // Return typed pointer
+  }
+  void deallocate(pointer p, size_type) { free(p); }            //!< Free aligned memory
+  size_type max_size() const { return size_type(-1) / sizeof(T); }//!< Maximum number of elements
+  void construct(pointer p, const T &value) { new(p) T(value); }//!< Construct element in place
+  void destroy(pointer p) { p->~T(); }                          //!< Destroy element in place
+  bool operator==(const AlignedAllocator&) const { return true; }//!< All instances are interchangeable
+  bool operator!=(const AlignedAllocator&) const { return false; }//!< All instances are interchangeable
+};
+typedef std::vector<real,AlignedAllocator<real,SIMDALIGN> > Reals;//!< Vector of aligned real numbers
+
 //! Structure for pthread based trace
 struct Trace {
   pthread_t thread;
@@ -118,8 +167,35 @@ struct Trace {
 typedef std::map<pthread_t,double>             ThreadTrace;     //!< Map of pthread id to traced value
 typedef std::map<pthread_t,int>                ThreadMap;       //!< Map of pthread id to thread id
 typedef std::queue<Trace>                      Traces;          //!< Queue of traces
-typedef std::map<std::string,double>           Timer;           //!< Map of timer event name to timed value
-typedef std::map<std::string,double>::iterator TI_iter;         //!< Iterator for timer event name map
+typedef std::map<std::string,int>              Timer;           //!< Map of timer event name to timer id
+typedef std::map<std::string,int>::iterator    TI_iter;         //!< Iterator for timer event name map
+
+//! Structure of registered timer events
+struct TimerEvent {
+  std::string NAME;                                             //!< Event name
+  int         PARENT;                                           //!< Id of enclosing event (-1 at top level)
+  int         DEPTH;                                            //!< Nesting depth of event
+};
+typedef std::vector<TimerEvent>                TimerEvents;     //!< Vector of registered timer events
+
+//! Structure of timer accumulators owned by one thread
+struct TimerThread {
+  std::vector<double>      BEGIN;                               //!< Timer base value per event
+  std::vector<double>      TIME;                                //!< Accumulated time per event
+  std::vector<long>        COUNT;                               //!< Number of calls per event
+  std::vector<std::string> NAME;                                //!< Interned event names, hashed by content
+  std::vector<int>         ID;                                  //!< Timer id of interned event names (-1 if empty)
+};
+typedef std::vector<TimerThread*>              TimerThreads;    //!< Vector of per-thread timer accumulators
+typedef std::map<int,std::vector<real> >       Rotations;       //!< Map of quantized polar angle to M2L rotation coefficients
+typedef std::map<int,std::vector<real> >::iterator RO_iter;     //!< Iterator for rotation coefficient map
+
+enum SIMDType {                                                 //!< SIMD instruction set enumeration
+  SIMDNone,                                                     //!< Scalar kernels
+  SIMDSSE,                                                      //!< SSE4.1 kernels (4 lanes)
+  SIMDAVX2,                                                     //!< AVX2 + FMA kernels (8 lanes)
+  SIMDAVX512                                                    //!< AVX-512F kernels (16 lanes)
+};
 
 enum Equation {                                                 //!< Equation type enumeration
   Laplace,                                                      //!< Laplace potential + force
@@ -147,6 +223,35 @@ struct Body : public JBody {
 typedef std::vector<Body>              Bodies;                  //!< Vector of bodies
 typedef std::vector<Body>::iterator    B_iter;                  //!< Iterator for body vector
 
+//! Structure of arrays for bodies (used by vectorized kernels)
+struct BodiesSoA {
+  Reals X[3];                                                   //!< Position x,y,z
+  Reals SRC;                                                    //!< Scalar source values
+  Reals TRG[4];                                                 //!< Scalar+vector target values
+//! Number of bodies
+  int size() const {
+    return SRC.size();                                          // Size of source array
+  }
+//! Resize all arrays
+  void resize(int n) {
+    for( int d=0; d!=3; ++d ) X[d].resize(n);                   // Resize positions
+    SRC.resize(n);                                              // Resize sources
+    for( int d=0; d!=4; ++d ) TRG[d].resize(n);                 // Resize targets
+  }
+//! Copy positions and sources of bodies in [begin,end) into the arrays and clear the targets
+  void gather(B_iter begin, B_iter end) {
+    resize(end-begin);                                          // Resize arrays to range (keeps capacity)
+    for( int i=0; i!=size(); ++i ) {                            // Loop over bodies
+      B_iter B = begin + i;                                     //  Body iterator
+      for( int d=0; d!=3; ++d ) X[d][i] = B->X[d];              //  Copy position
+      SRC[i] = B->SRC;                                          //  Copy source
+    }                                                           // End loop over bodies
+    for( int d=0; d!=4; ++d ) {                                 // Loop over target values
+      std::fill(TRG[d].begin(),TRG[d].end(),0);                 //  Initialize target values
+    }                                                           // End loop over target values
+  }
+};
+
 //! Linked list of leafs (only used in fast/topdown.h)
 struct Leaf {
   int I;                                                        //!< Unique index for every leaf
@@ -189,8 +294,7 @@ struct Cell {
   real     R;                                                   //!< Cell radius
   real     RMAX;                                                //!< Max cell radius
   real     RCRIT;                                               //!< Critical cell radius
-  Mset     M;                                                   //!< Multipole coefficients
-  Lset     L;                                                   //!< Local coefficients
+  int      ICOEF;                                               //!< Index of multipole/local coefficients
 };
 typedef std::vector<Cell>              Cells;                   //!< Vector of cells
 typedef std::vector<Cell>::iterator    C_iter;                  //!< Iterator for cell vector
@@ -199,12 +303,105 @@ typedef std::stack<C_iter>             CellStack;               //!< Stack of ce
 typedef std::pair<C_iter,C_iter>       Pair;                    //!< Pair of interacting cells
 typedef std::deque<Pair>               PairQueue;               //!< Queue of interacting cell pairs
 typedef std::stack<Pair>               PairStack;               //!< Stack of interacting cell pairs
-typedef std::list<C_iter>              List;                    //!< Interaction list
-typedef std::list<C_iter>::iterator    LC_iter;                 //!< Iterator for interaction list
-typedef std::vector<List>              Lists;                   //!< Vector of interaction lists
-typedef std::map<C_iter,int>           Map;                     //!< Map of interaction lists
-typedef std::map<C_iter,int>::iterator MC_iter;                 //!< Iterator for interation list map
-typedef std::vector<Map>               Maps;                    //!< Vector of map of interaction lists
+typedef std::map<C_iter,int>           Map;                     //!< Map of cell iterator to buffer offset
+typedef std::map<C_iter,int>::iterator MC_iter;                 //!< Iterator for cell iterator map
+
+//! Single entry of an interaction list
+struct Interaction {
+  int CELL;                                                     //!< Offset of source cell from its begin iterator
+  int IPERIODIC;                                                //!< Periodic image flag (using each bit for images)
+};
+typedef std::vector<Interaction>       Interactions;            //!< Vector of interaction list entries
+typedef std::pair<int,Interaction>     TargetInteraction;       //!< Pair of target cell offset and entry
+typedef std::vector<TargetInteraction> TargetInteractions;      //!< Unsorted entries pushed by one thread
+
+//! Interaction lists of all target cells in compressed sparse row format
+struct InteractionList {
+  std::vector<int>                OFFSET;                       //!< Begin of each target cell's entries in LIST
+  Interactions                    LIST;                         //!< Entries of all target cells, contiguous
+  std::vector<TargetInteractions> BUFFER;                       //!< Per-thread entries not yet built into LIST
+
+//! Compare entries by source cell
+  static bool compareCell(const Interaction &a, const Interaction &b) {
+    return a.CELL < b.CELL;                                     // Order by source cell offset
+  }
+//! Set number of threads that push entries, and clear everything
+  void initialize(int numThreads) {
+    BUFFER.resize(numThreads);                                  // One buffer per thread
+    clear();                                                    // Clear lists and buffers
+  }
+//! Clear lists and buffers
+  void clear() {
+    OFFSET.clear();                                             // Clear offsets
+    LIST.clear();                                               // Clear entries
+    for( int t=0; t<int(BUFFER.size()); ++t ) BUFFER[t].clear();// Clear per-thread buffers
+  }
+//! Queue entry (j,flag) for target cell i from thread
+  void push(int thread, int i, int j, int flag) {
+    Interaction entry = {j, flag};                              // Source cell and periodic image flag
+    BUFFER[thread].push_back(TargetInteraction(i,entry));       // Append to this thread's buffer
+  }
+//! Number of entries of target cell i
+  int size(int i) const {
+    return i+1 < int(OFFSET.size()) ? OFFSET[i+1] - OFFSET[i] : 0;// Zero for targets beyond the built range
+  }
+//! First entry of target cell i
+  const Interaction *begin(int i) const {
+    return size(i) ? &LIST[0] + OFFSET[i] : NULL;               // Pointer to first entry
+  }
+//! One past the last entry of target cell i
+  const Interaction *end(int i) const {
+    return size(i) ? &LIST[0] + OFFSET[i+1] : NULL;             // Pointer past last entry
+  }
+//! Merge buffered entries into the CSR lists, sorting each row and OR-ing flags of duplicate sources
+  void build(int numCells) {
+    int numRows = OFFSET.empty() ? 0 : int(OFFSET.size()) - 1; // Number of rows already built
+    numCells = std::max(numCells,numRows);                      // Never drop existing rows
+    std::vector<int> offset(numCells+1,0);                      // New row offsets
+    for( int i=0; i<numRows; ++i ) offset[i+1] = size(i);       // Count existing entries
+    for( int t=0; t<int(BUFFER.size()); ++t ) {                 // Loop over threads
+      for( int n=0; n<int(BUFFER[t].size()); ++n ) {            //  Loop over buffered entries
+        offset[BUFFER[t][n].first+1]++;                         //   Count entry for its target
+      }                                                         //  End loop over buffered entries
+    }                                                           // End loop over threads
+    for( int i=0; i<numCells; ++i ) offset[i+1] += offset[i];   // Prefix sum of counts
+    Interactions list(offset[numCells]);                        // New contiguous entries
+    std::vector<int> fill(offset.begin(),offset.end()-1);       // Insertion point of each row
+    for( int i=0; i<numRows; ++i ) {                            // Loop over existing rows
+      fill[i] = std::copy(begin(i),end(i),list.begin()+fill[i]) - list.begin();// Copy existing entries
+    }                                                           // End loop over existing rows
+    for( int t=0; t<int(BUFFER.size()); ++t ) {                 // Loop over threads
+      for( int n=0; n<int(BUFFER[t].size()); ++n ) {            //  Loop over buffered entries
+        list[fill[BUFFER[t][n].first]++] = BUFFER[t][n].second; //   Scatter entry into its row
+      }                                                         //  End loop over buffered entries
+      TargetInteractions().swap(BUFFER[t]);                     //  Release buffer memory
+    }                                                           // End loop over threads
+    std::vector<int> count(numCells);                           // Number of unique entries per row
+#pragma omp parallel for schedule(dynamic,64)
+    for( int i=0; i<numCells; ++i ) {                           // Loop over rows
+      Interactions::iterator first = list.begin() + offset[i];  //  First entry of row
+      Interactions::iterator last = list.begin() + offset[i+1]; //  Last entry of row
+      std::sort(first,last,compareCell);                        //  Sort row by source cell
+      Interactions::iterator out = first;                       //  Write position for unique entries
+      for( Interactions::iterator I=first; I!=last; ++I ) {     //  Loop over entries of row
+        if( out != first && (out-1)->CELL == I->CELL ) {        //   If duplicate source (periodic image)
+          (out-1)->IPERIODIC |= I->IPERIODIC;                   //    Merge periodic image flags
+        } else {                                                //   If new source
+          *out++ = *I;                                          //    Keep entry
+        }                                                       //   Endif for duplicate source
+      }                                                         //  End loop over entries of row
+      count[i] = out - first;                                   //  Number of unique entries
+    }                                                           // End loop over rows
+    OFFSET.resize(numCells+1);                                  // Resize offsets
+    OFFSET[0] = 0;                                              // First row starts at zero
+    for( int i=0; i<numCells; ++i ) {                           // Loop over rows
+      std::copy(list.begin()+offset[i],list.begin()+offset[i]+count[i],list.begin()+OFFSET[i]);// Compact row
+      OFFSET[i+1] = OFFSET[i] + count[i];                       //  Begin of next row
+    }                                                           // End loop over rows
+    list.resize(OFFSET[numCells]);                              // Drop merged duplicates
+    LIST.swap(list);                                            // Store new entries
+  }
+};
 
 //! Structure for Ewald summation
 struct Ewald {
@@ -713,6 +713,16 @@ inline void sumM2P(B_iter B, const Lset &C, const Mset &M) {
   Downward<0,0,1>::M2P(B,C,M);
 }
 
+//! View pooled multipole coefficients of a cell as Mset
+inline Mset &asMset(Coef *M) {
+  return *reinterpret_cast<Mset*>(M);
+}
+
+//! View pooled local coefficients of a cell as Lset
+inline Lset &asLset(Coef *L) {
+  return *reinterpret_cast<Lset*>(L);
+}
+
 template<>
 void Kernel<Laplace>::initialize() {}
 
@@ -727,7 +737,7 @@ void Kernel<Laplace>::P2M(C_iter Ci) {
     Lset M;
     M[0] = B->SRC;
     Terms<0,0,P-1>::power(M,dist);
-    for( int i=0; i<MTERM; ++i ) Ci->M[i] += M[i];
+    for( int i=0; i<MTERM; ++i ) getM(Ci)[i] += M[i];
   }
   Ci->RMAX = Rmax;
   Ci->RCRIT = std::min(Ci->R,Rmax);
@@ -745,9 +755,9 @@ void Kernel<Laplace>::M2M(C_iter Ci) {
     Lset C;
     C[0] = 1;
     Terms<0,0,P-1>::power(C,dist);
-    M = Cj->M;
-    for( int i=0; i<MTERM; ++i ) Ci->M[i] += C[i] * M[0];
-    Upward<0,0,P-1>::M2M(Ci->M,C,M);
+    M = asMset(getM(Cj));
+    for( int i=0; i<MTERM; ++i ) getM(Ci)[i] += C[i] * M[0];
+    Upward<0,0,P-1>::M2M(asMset(getM(Ci)),C,M);
   }
   Ci->RCRIT = std::min(Ci->R,Rmax);
 }
@@ -756,10 +766,10 @@ template<>
 void Kernel<Laplace>::M2L(C_iter Ci, C_iter Cj) const {
   vect dist = Ci->X - Cj->X - Xperiodic;
   real invR2 = 1 / norm(dist);
-  real invR  = Cj->M[0] * std::sqrt(invR2);
+  real invR  = getM(Cj)[0] * std::sqrt(invR2);
   Lset C;
   getCoef<P>(C,dist,invR2,invR);
-  sumM2L<P>(Ci->L,C,Cj->M);
+  sumM2L<P>(asLset(getL(Ci)),C,asMset(getM(Cj)));
 }
 
 template<>
@@ -767,10 +777,10 @@ void Kernel<Laplace>::M2P(C_iter Ci, C_iter Cj) const {
   for( B_iter B=Ci->LEAF; B!=Ci->LEAF+Ci->NDLEAF; ++B ) {
     vect dist = B->X - Cj->X - Xperiodic;
     real invR2 = 1 / norm(dist);
-    real invR  = Cj->M[0] * std::sqrt(invR2);
+    real invR  = getM(Cj)[0] * std::sqrt(invR2);
     Lset C;
     getCoef<P>(C,dist,invR2,invR);
-    sumM2P(B,C,Cj->M);
+    sumM2P(B,C,asMset(getM(Cj)));
   }
 }
 
@@ -782,9 +792,11 @@ void Kernel<Laplace>::L2L(C_iter Ci) const {
   C[0] = 1;
   Terms<0,0,P>::power(C,dist);
 
-  Ci->L += Cj->L;
-  for( int i=1; i<LTERM; ++i ) Ci->L[0] += C[i] * Cj->L[i];
-  Downward<0,0,P-1>::L2L(Ci->L,C,Cj->L);
+  Lset &LI = asLset(getL(Ci));
+  const Lset &LJ = asLset(getL(Cj));
+  LI += LJ;
+  for( int i=1; i<LTERM; ++i ) LI[0] += C[i] * LJ[i];
+  Downward<0,0,P-1>::L2L(LI,C,LJ);
 }
 
 template<>
@@ -795,7 +807,7 @@ void Kernel<Laplace>::L2P(C_iter Ci) const {
     C[0] = 1;
     Terms<0,0,P>::power(C,dist);
 
-    L = Ci->L;
+    L = asLset(getL(Ci));
     B->TRG[0] += L[0];
     B->TRG[1] += L[1];
     B->TRG[2] += L[2];
@@ -809,3 +821,4 @@ template<>
 void Kernel<Laplace>::finalize() {}
 
 #include "../kernel/CPUEwaldLaplace.cxx"
+#include "../kernel/CPUSPMELaplace.cxx"
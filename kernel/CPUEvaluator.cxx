@@ -22,13 +22,10 @@ THE SOFTWARE.
 
 template<Equation equation>
 void Evaluator<equation>::evalP2P(Bodies &ibodies, Bodies &jbodies, bool) {// Evaluate all P2P kernels for periodic
-  Cells cells;                                                  // Cells to put target and source bodies
-  cells.resize(2);                                              // Resize cells to put target and source bodies
-  cells[0].LEAF = ibodies.begin();                              // Iterator of first target leaf
-  cells[0].NDLEAF = ibodies.size();                             // Number of target leafs
-  cells[1].LEAF = jbodies.begin();                              // Iterator of first source leaf
-  cells[1].NDLEAF = jbodies.size();                             // Number of source leafs
-  C_iter Ci = cells.begin(), Cj = cells.begin()+1;              // Iterator of target and source cells
+  BodiesSoA isoa, jsoa;                                         // Structure of arrays for target/source bodies
+  isoa.gather(ibodies.begin(),ibodies.end());                   // Gather target bodies
+  jsoa.gather(jbodies.begin(),jbodies.end());                   // Gather source bodies
+  const int block = 64;                                         // Number of targets per work item
   int prange = getPeriodicRange();                              // Get range of periodic images
   for( int ix=-prange; ix<=prange; ++ix ) {                     // Loop over x periodic direction
     for( int iy=-prange; iy<=prange; ++iy ) {                   //  Loop over y periodic direction
@@ -36,18 +33,27 @@ void Evaluator<equation>::evalP2P(Bodies &ibodies, Bodies &jbodies, bool) {// Ev
         Xperiodic[0] = ix * 2 * R0;                             //    Shift x position
         Xperiodic[1] = iy * 2 * R0;                             //    Shift y position
         Xperiodic[2] = iz * 2 * R0;                             //    Shift z position
-        P2P(Ci,Cj);                                             //    Perform P2P kernel
+#pragma omp parallel for schedule(dynamic)
+        for( int i=0; i<isoa.size(); i+=block ) {               //    Loop over blocks of target bodies
+          P2P(isoa,i,std::min(i+block,isoa.size()),jsoa,0,jsoa.size());// Perform P2P kernel
+        }                                                       //    End loop over blocks of target bodies
       }                                                         //   End loop over z periodic direction
     }                                                           //  End loop over y periodic direction
   }                                                             // End loop over x periodic direction
+  for( B_iter B=ibodies.begin(); B!=ibodies.end(); ++B ) {      // Loop over target bodies
+    for( int d=0; d!=4; ++d ) B->TRG[d] += isoa.TRG[d][B-ibodies.begin()];// Accumulate target values
+  }                                                             // End loop over target bodies
 }
 
 template<Equation equation>
-void Evaluator<equation>::evalP2M(Cells &cells) {               // Evaluate all P2M kernels
+void Evaluator<equation>::evalP2M(Cells &cells) {             // Evaluate all P2M kernels
   startTimer("evalP2M");                                        // Start timer
   for( C_iter C=cells.begin(); C!=cells.end(); ++C ) {          // Loop over cells
-    C->M = 0;                                                   //  Initialize multipole coefficients
-    C->L = 0;                                                   //  Initialize local coefficients
+    if( C->ICOEF < 0 ) {                                        //  If cell has no coefficients yet
+      newCoef(*C);                                              //   Allocate zeroed multipole & local coefficients
+    } else {                                                    //  Else reuse coefficients of cell
+      std::fill(getM(C),getM(C)+getNumM(),Coef(0));             //   Initialize multipole coefficients
+    }                                                           //  Endif for allocation
     if( C->NCHILD == 0 ) {                                      //  If cell is a twig
       P2M(C);                                                   //   Perform P2M kernel
     }                                                           //  Endif for twig
@@ -57,154 +63,181 @@ void Evaluator<equation>::evalP2M(Cells &cells) {               // Evaluate all
 
 template<Equation equation>
 void Evaluator<equation>::evalM2M(Cells &cells, Cells &jcells) {// Evaluate all M2M kernels
+  int timer = registerTimer("evalM2M");                         // Timer id of M2M
+  std::vector<int> levelTimer;                                  // Timer ids of M2M per level
+  registerLevelTimers(timer,getMaxLevel(cells),levelTimer);     // Register nested timers per level
+  startTimer(timer);                                            // Start timer
   Cj0 = jcells.begin();                                         // Set begin iterator
   for( C_iter Ci=cells.begin(); Ci!=cells.end(); ++Ci ) {       // Loop over target cells bottomup
-    int level = getLevel(Ci->ICELL);                            // Get current level
-    std::stringstream eventName;                                // Declare event name
-    eventName << "evalM2M: " << level << "   ";                 // Set event name with level
-    startTimer(eventName.str());                                // Start timer
-    M2M(Ci);                                                    // Perform M2M kernel
-    stopTimer(eventName.str());                                 // Stop timer
+    int level = getLevel(Ci->ICELL);                            //  Get current level
+    startTimer(levelTimer[level]);                              //  Start timer for level
+    M2M(Ci);                                                    //  Perform M2M kernel
+    stopTimer(levelTimer[level]);                               //  Stop timer for level
   }                                                             // End loop target over cells
+  stopTimer(timer);                                             // Stop timer
 }
 
 template<Equation equation>
 void Evaluator<equation>::evalM2L(C_iter Ci, C_iter Cj) {       // Evaluate single M2L kernel
 #if QUEUE
-  listM2L[Ci-Ci0].push_back(Cj);                                // Push source cell into M2L interaction list
-  flagM2L[Ci-Ci0][Cj] |= Iperiodic;                             // Flip bit of periodic image flag
+  listM2L.push(getThreadNum(),Ci-Ci0,Cj-Cj0,Iperiodic);         // Push source cell into M2L interaction list
 #else
   M2L(Ci,Cj);                                                   // Perform M2L kernel
 #endif
+#pragma omp atomic
   NM2L++;                                                       // Count M2L kernel execution
 }
 
 template<Equation equation>
 void Evaluator<equation>::evalM2L(Cells &cells) {               // Evaluate queued M2L kernels
+  int timer = registerTimer("evalM2L");                         // Timer id of M2L
+  std::vector<int> levelTimer;                                  // Timer ids of M2L per level
+  registerLevelTimers(timer,getMaxLevel(cells),levelTimer);     // Register nested timers per level
+  startTimer(timer);                                            // Start timer
   Ci0 = cells.begin();                                          // Set begin iterator
-  for( C_iter Ci=cells.begin(); Ci!=cells.end(); ++Ci ) {       // Loop over cells
-    int level = getLevel(Ci->ICELL);                            // Get current level
-    std::stringstream eventName;                                // Declare event name
-    eventName << "evalM2L: " << level << "   ";                 // Set event name with level
-    startTimer(eventName.str());                                // Start timer
-    while( !listM2L[Ci-Ci0].empty() ) {                         //  While M2L interaction list is not empty
-      C_iter Cj = listM2L[Ci-Ci0].back();                       //   Set source cell iterator
-      Iperiodic = flagM2L[Ci-Ci0][Cj];                          //   Set periodic image flag
-      int I = 0;                                                //   Initialize index of periodic image
-      for( int ix=-1; ix<=1; ++ix ) {                           //   Loop over x periodic direction
-        for( int iy=-1; iy<=1; ++iy ) {                         //    Loop over y periodic direction
-          for( int iz=-1; iz<=1; ++iz, ++I ) {                  //     Loop over z periodic direction
-            if( Iperiodic & (1 << I) ) {                        //      If periodic flag is on
-              Xperiodic[0] = ix * 2 * R0;                       //       Coordinate offset for x periodic direction
-              Xperiodic[1] = iy * 2 * R0;                       //       Coordinate offset for y periodic direction
-              Xperiodic[2] = iz * 2 * R0;                       //       Coordinate offset for z periodic direction
-              M2L(Ci,Cj);                                       //       Perform M2L kernel
-            }                                                   //      Endif for periodic flag
-          }                                                     //     End loop over x periodic direction
-        }                                                       //    End loop over y periodic direction
+  std::vector<int> order;                                       // Target cells in decreasing order of cost
+  int images = getTargetOrder(listM2L,cells,false,false,order);// Order targets by cost, get image flags
+  int Ip = 0;                                                   // Initialize index of periodic image
+  for( int ix=-1; ix<=1; ++ix ) {                               // Loop over x periodic direction
+    for( int iy=-1; iy<=1; ++iy ) {                             //  Loop over y periodic direction
+      for( int iz=-1; iz<=1; ++iz, ++Ip ) {                     //   Loop over z periodic direction
+        if( !(images & (1 << Ip)) ) continue;                   //    Skip images that no entry uses
+        Xperiodic[0] = ix * 2 * R0;                             //    Coordinate offset for x periodic direction
+        Xperiodic[1] = iy * 2 * R0;                             //    Coordinate offset for y periodic direction
+        Xperiodic[2] = iz * 2 * R0;                             //    Coordinate offset for z periodic direction
+#pragma omp parallel for schedule(dynamic)
+        for( int n=0; n<int(order.size()); ++n ) {              //    Loop over target cells (most costly first)
+          C_iter Ci = Ci0 + order[n];                           //     Target cell iterator
+          int level = getLevel(Ci->ICELL);                      //     Get current level
+          startTimer(levelTimer[level]);                        //     Start timer for level (per thread)
+          for( const Interaction *I=listM2L.begin(order[n]); I!=listM2L.end(order[n]); ++I ) {// Loop over interaction list
+            if( I->IPERIODIC & (1 << Ip) ) {                    //       If periodic flag is on
+              M2L(Ci,Cj0+I->CELL);                              //        Perform M2L kernel
+            }                                                   //       Endif for periodic flag
+          }                                                     //      End loop over interaction list
+          stopTimer(levelTimer[level]);                         //     Stop timer for level (per thread)
+        }                                                       //    End loop over target cells
       }                                                         //   End loop over z periodic direction
-      listM2L[Ci-Ci0].pop_back();                               //   Pop last element from M2L interaction list
-    }                                                           //  End while for M2L interaction list
-    stopTimer(eventName.str());                                 // Stop timer
-  }                                                             // End loop over cells topdown
+    }                                                           //  End loop over y periodic direction
+  }                                                             // End loop over x periodic direction
   listM2L.clear();                                              // Clear interaction lists
-  flagM2L.clear();                                              // Clear periodic image flags
+  stopTimer(timer);                                             // Stop timer
 }
 
 template<Equation equation>
 void Evaluator<equation>::evalM2P(C_iter Ci, C_iter Cj) {       // Evaluate single M2P kernel
 #if QUEUE
-  listM2P[Ci-Ci0].push_back(Cj);                                // Push source cell into M2P interaction list
-  flagM2P[Ci-Ci0][Cj] |= Iperiodic;                             // Flip bit of periodic image flag
+  listM2P.push(getThreadNum(),Ci-Ci0,Cj-Cj0,Iperiodic);         // Push source cell into M2P interaction list
 #else
   M2P(Ci,Cj);                                                   // Perform M2P kernel
 #endif
+#pragma omp atomic
   NM2P++;                                                       // Count M2P kernel execution
 }
 
 template<Equation equation>
 void Evaluator<equation>::evalM2P(Cells &cells) {               // Evaluate queued M2P kernels
+  int timer = registerTimer("evalM2P");                         // Timer id of M2P
+  std::vector<int> levelTimer;                                  // Timer ids of M2P per level
+  registerLevelTimers(timer,getMaxLevel(cells),levelTimer);     // Register nested timers per level
+  startTimer(timer);                                            // Start timer
   Ci0 = cells.begin();                                          // Set begin iterator
-  for( C_iter Ci=cells.begin(); Ci!=cells.end(); ++Ci ) {       // Loop over cells
-    int level = getLevel(Ci->ICELL);                            // Get current level
-    std::stringstream eventName;                                // Declare event name
-    eventName << "evalM2P: " << level << "   ";                 // Set event name with level
-    startTimer(eventName.str());                                // Start timer
-    while( !listM2P[Ci-Ci0].empty() ) {                         //  While M2P interaction list is not empty
-      C_iter Cj = listM2P[Ci-Ci0].back();                       //   Set source cell iterator
-      Iperiodic = flagM2P[Ci-Ci0][Cj];                          //   Set periodic image flag
-      int I = 0;                                                //   Initialize index of periodic image
-      for( int ix=-1; ix<=1; ++ix ) {                           //   Loop over x periodic direction
-        for( int iy=-1; iy<=1; ++iy ) {                         //    Loop over y periodic direction
-          for( int iz=-1; iz<=1; ++iz, ++I ) {                  //     Loop over z periodic direction
-            if( Iperiodic & (1 << I) ) {                        //      If periodic flag is on
-              Xperiodic[0] = ix * 2 * R0;                       //       Coordinate offset for x periodic direction
-              Xperiodic[1] = iy * 2 * R0;                       //       Coordinate offset for y periodic direction
-              Xperiodic[2] = iz * 2 * R0;                       //       Coordinate offset for z periodic direction
-              M2P(Ci,Cj);                                       //       Perform M2P kernel
-            }                                                   //      Endif for periodic flag
-          }                                                     //     End loop over x periodic direction
-        }                                                       //    End loop over y periodic direction
+  std::vector<int> order;                                       // Target cells in decreasing order of cost
+  int images = getTargetOrder(listM2P,cells,true,false,order);// Order targets by cost, get image flags
+  int Ip = 0;                                                   // Initialize index of periodic image
+  for( int ix=-1; ix<=1; ++ix ) {                               // Loop over x periodic direction
+    for( int iy=-1; iy<=1; ++iy ) {                             //  Loop over y periodic direction
+      for( int iz=-1; iz<=1; ++iz, ++Ip ) {                     //   Loop over z periodic direction
+        if( !(images & (1 << Ip)) ) continue;                   //    Skip images that no entry uses
+        Xperiodic[0] = ix * 2 * R0;                             //    Coordinate offset for x periodic direction
+        Xperiodic[1] = iy * 2 * R0;                             //    Coordinate offset for y periodic direction
+        Xperiodic[2] = iz * 2 * R0;                             //    Coordinate offset for z periodic direction
+#pragma omp parallel for schedule(dynamic)
+        for( int n=0; n<int(order.size()); ++n ) {              //    Loop over target cells (most costly first)
+          C_iter Ci = Ci0 + order[n];                           //     Target cell iterator
+          int level = getLevel(Ci->ICELL);                      //     Get current level
+          startTimer(levelTimer[level]);                        //     Start timer for level (per thread)
+          for( const Interaction *I=listM2P.begin(order[n]); I!=listM2P.end(order[n]); ++I ) {// Loop over interaction list
+            if( I->IPERIODIC & (1 << Ip) ) {                    //       If periodic flag is on
+              M2P(Ci,Cj0+I->CELL);                              //        Perform M2P kernel
+            }                                                   //       Endif for periodic flag
+          }                                                     //      End loop over interaction list
+          stopTimer(levelTimer[level]);                         //     Stop timer for level (per thread)
+        }                                                       //    End loop over target cells
       }                                                         //   End loop over z periodic direction
-      listM2P[Ci-Ci0].pop_back();                               //   Pop last element from M2P interaction list
-    }                                                           //  End while for M2P interaction list
-    stopTimer(eventName.str());                                 // Stop timer
-  }                                                             // End loop over cells topdown
+    }                                                           //  End loop over y periodic direction
+  }                                                             // End loop over x periodic direction
   listM2P.clear();                                              // Clear interaction lists
-  flagM2P.clear();                                              // Clear periodic image flags
+  stopTimer(timer);                                             // Stop timer
 }
 
 template<Equation equation>
 void Evaluator<equation>::evalP2P(C_iter Ci, C_iter Cj) {       // Evaluate single P2P kernel
 #if QUEUE
-  listP2P[Ci-Ci0].push_back(Cj);                                // Push source cell into P2P interaction list
-  flagP2P[Ci-Ci0][Cj] |= Iperiodic;                             // Flip bit of periodic image flag
+  listP2P.push(getThreadNum(),Ci-Ci0,Cj-Cj0,Iperiodic);         // Push source cell into P2P interaction list
 #else
   P2P(Ci,Cj);                                                   // Perform P2P kernel
 #endif
+#pragma omp atomic
   NP2P++;                                                       // Count P2P kernel execution
 }
 
+template<Equation equation>
+void Evaluator<equation>::evalP2PMutual(C_iter Ci, C_iter Cj) { // Evaluate single P2P kernel for both cells
+#if QUEUE
+  evalP2P(Ci,Cj);                                               // Queue P2P from Cj to Ci
+  if( Ci != Cj ) evalP2P(Cj,Ci);                                // Queue P2P from Ci to Cj
+#else
+  P2PMutual(Ci,Cj);                                             // Perform mutual P2P kernel
+#pragma omp atomic
+  NP2P++;                                                       // Count P2P kernel execution
+#endif
+}
+
 template<Equation equation>
 void Evaluator<equation>::evalP2P(Cells &cells) {               // Evaluate queued P2P kernels
   startTimer("evalP2P");                                        // Start timer
   Ci0 = cells.begin();                                          // Set begin iterator
-  for( C_iter Ci=cells.begin(); Ci!=cells.end(); ++Ci ) {       // Loop over cells
-    while( !listP2P[Ci-Ci0].empty() ) {                         //  While M2P interaction list is not empty
-      C_iter Cj = listP2P[Ci-Ci0].back();                       //   Set source cell iterator
-      Iperiodic = flagP2P[Ci-Ci0][Cj];                          //   Set periodic image flag
-      int I = 0;                                                //   Initialize index of periodic image
-      for( int ix=-1; ix<=1; ++ix ) {                           //   Loop over x periodic direction
-        for( int iy=-1; iy<=1; ++iy ) {                         //    Loop over y periodic direction
-          for( int iz=-1; iz<=1; ++iz, ++I ) {                  //     Loop over z periodic direction
-            if( Iperiodic & (1 << I) ) {                        //      If periodic flag is on
-              Xperiodic[0] = ix * 2 * R0;                       //       Coordinate offset for x periodic direction
-              Xperiodic[1] = iy * 2 * R0;                       //       Coordinate offset for y periodic direction
-              Xperiodic[2] = iz * 2 * R0;                       //       Coordinate offset for z periodic direction
-              P2P(Ci,Cj);                                       //       Perform P2P kernel
-            }                                                   //      Endif for periodic flag
-          }                                                     //     End loop over x periodic direction
-        }                                                       //    End loop over y periodic direction
+  std::vector<int> order;                                       // Target cells in decreasing order of cost
+  int images = getTargetOrder(listP2P,cells,true,true,order);// Order targets by cost, get image flags
+  int Ip = 0;                                                   // Initialize index of periodic image
+  for( int ix=-1; ix<=1; ++ix ) {                               // Loop over x periodic direction
+    for( int iy=-1; iy<=1; ++iy ) {                             //  Loop over y periodic direction
+      for( int iz=-1; iz<=1; ++iz, ++Ip ) {                     //   Loop over z periodic direction
+        if( !(images & (1 << Ip)) ) continue;                   //    Skip images that no entry uses
+        Xperiodic[0] = ix * 2 * R0;                             //    Coordinate offset for x periodic direction
+        Xperiodic[1] = iy * 2 * R0;                             //    Coordinate offset for y periodic direction
+        Xperiodic[2] = iz * 2 * R0;                             //    Coordinate offset for z periodic direction
+#pragma omp parallel for schedule(dynamic)
+        for( int n=0; n<int(order.size()); ++n ) {              //    Loop over target cells (most costly first)
+          C_iter Ci = Ci0 + order[n];                           //     Target cell iterator
+          for( const Interaction *I=listP2P.begin(order[n]); I!=listP2P.end(order[n]); ++I ) {// Loop over interaction list
+            if( I->IPERIODIC & (1 << Ip) ) {                    //       If periodic flag is on
+              P2P(Ci,Cj0+I->CELL);                              //        Perform P2P kernel
+            }                                                   //       Endif for periodic flag
+          }                                                     //      End loop over interaction list
+        }                                                       //    End loop over target cells
       }                                                         //   End loop over z periodic direction
-      listP2P[Ci-Ci0].pop_back();                               //   Pop last element from M2P interaction list
-    }                                                           //  End while for M2P interaction list
-  }                                                             // End loop over cells topdown
+    }                                                           //  End loop over y periodic direction
+  }                                                             // End loop over x periodic direction
   listP2P.clear();                                              // Clear interaction lists
-  flagP2P.clear();                                              // Clear periodic image flags
   stopTimer("evalP2P");                                         // Stop timer
 }
 
 template<Equation equation>
 void Evaluator<equation>::evalL2L(Cells &cells) {               // Evaluate all L2L kernels
+  int timer = registerTimer("evalL2L");                         // Timer id of L2L
+  std::vector<int> levelTimer;                                  // Timer ids of L2L per level
+  registerLevelTimers(timer,getMaxLevel(cells),levelTimer);     // Register nested timers per level
+  startTimer(timer);                                            // Start timer
   Ci0 = cells.begin();                                          // Set begin iterator
   for( C_iter Ci=cells.end()-2; Ci!=cells.begin()-1; --Ci ) {   // Loop over cells topdown (except root cell)
-    int level = getLevel(Ci->ICELL);                            // Get current level
-    std::stringstream eventName;                                // Declare event name
-    eventName << "evalL2L: " << level << "   ";                 // Set event name with level
-    startTimer(eventName.str());                                // Start timer
-    L2L(Ci);                                                    // Perform L2L kernel
-    stopTimer(eventName.str());                                 // Stop timer
+    int level = getLevel(Ci->ICELL);                            //  Get current level
+    startTimer(levelTimer[level]);                              //  Start timer for level
+    L2L(Ci);                                                    //  Perform L2L kernel
+    stopTimer(levelTimer[level]);                               //  Stop timer for level
   }                                                             // End loop over cells topdown
+  stopTimer(timer);                                             // Stop timer
 }
 
 template<Equation equation>
@@ -218,26 +251,19 @@ void Evaluator<equation>::evalL2P(Cells &cells) {               // Evaluate all
   stopTimer("evalL2P");                                         // Stop timer
 }
 
-template<Equation equation>
-void Evaluator<equation>::evalEwaldReal(C_iter Ci, C_iter Cj) { // Evaluate single Ewald real kernel
-  EwaldReal(Ci,Cj);                                             // Perform Ewald real kernel
-}
-
 template<Equation equation>
 void Evaluator<equation>::evalEwaldReal(Cells &cells) {         // Evaluate queued Ewald real kernels
   startTimer("evalEwaldReal");                                  // Start timer
   Ci0 = cells.begin();                                          // Set begin iterator
-#pragma omp parallel for
+#pragma omp parallel for schedule(dynamic)
   for( int i=0; i<int(cells.size()); ++i ) {                    // Loop over cells
     C_iter Ci = Ci0 + i;                                        //  Target cell iterator
-    while( !listP2P[i].empty() ) {                              //  While M2P interaction list is not empty
-      C_iter Cj = listP2P[i].back();                            //   Set source cell iterator
+    for( const Interaction *I=listP2P.begin(i); I!=listP2P.end(i); ++I ) {// Loop over P2P interaction list
+      C_iter Cj = Cj0 + I->CELL;                                //   Set source cell iterator
       EwaldReal(Ci,Cj);                                         //   Perform Ewald real kernel
-      listP2P[i].pop_back();                                    //   Pop last element from M2P interaction list
-    }                                                           //  End while for M2P interaction list
+    }                                                           //  End loop over P2P interaction list
   }                                                             // End loop over cells topdown
   listP2P.clear();                                              // Clear interaction lists
-  flagP2P.clear();                                              // Clear periodic image flags
   stopTimer("evalEwaldReal");                                   // Stop timer
 }
 
@@ -24,64 +24,229 @@ THE SOFTWARE.
 #undef KERNEL
 
 namespace {
-void dft(Ewalds &ewalds, Bodies &bodies, real R0) {
+const int EWALDBLOCK = 128;                                     // Bodies per block of wave tables
+
+//! Offsets of runs of consecutive n with the same l, m in the wave vector list
+std::vector<int> waveGroups(Ewalds &ewalds) {
+  std::vector<int> groups;                                      // Offsets of runs
+  for( int i=0; i<int(ewalds.size()); ++i ) {                   // Loop over waves
+    if( i == 0 || ewalds[i].K[0] != ewalds[i-1].K[0] || ewalds[i].K[1] != ewalds[i-1].K[1]
+        || ewalds[i].K[2] != ewalds[i-1].K[2] + 1 ) {           //  If run is broken
+      groups.push_back(i);                                      //   Start new run
+    }                                                           //  Endif for broken run
+  }                                                             // End loop over waves
+  groups.push_back(ewalds.size());                              // End of last run
+  return groups;                                                // Return offsets
+}
+
+//! Table of exp(i k x_d) for -kmax <= k <= kmax by complex recurrence (real, imag for each of nb bodies)
+void waveTable(B_iter B0, int nb, int kmax, real scale, std::vector<real> &table) {
+  int nk = 2 * kmax + 1;                                        // Wave numbers per dimension
+  table.resize(3*nk*2*EWALDBLOCK);                              // [d][k][real/imag][body]
+  for( int b=0; b<nb; ++b ) {                                   // Loop over bodies in block
+    for( int d=0; d<3; ++d ) {                                  //  Loop over dimensions
+      double th = B0[b].X[d] * scale;                           //   Phase of k = 1
+      std::complex<double> base(std::cos(th),std::sin(th)), e = 1;// Recurrence in double precision
+      for( int k=0; k<=kmax; ++k ) {                            //   Loop over non-negative wave numbers
+        real *p = &table[(d*nk+kmax+k)*2*EWALDBLOCK+b];         //    Entry of k
+        real *q = &table[(d*nk+kmax-k)*2*EWALDBLOCK+b];         //    Entry of -k
+        p[0] = q[0] = e.real();                                 //    Real parts
+        p[EWALDBLOCK] = e.imag();                               //    Imaginary part of k
+        q[EWALDBLOCK] = -e.imag();                              //    Conjugate for -k
+        e *= base;                                              //    Next wave number
+      }                                                         //   End loop over non-negative wave numbers
+    }                                                           //  End loop over dimensions
+  }                                                             // End loop over bodies in block
+}
+
+void dft(Ewalds &ewalds, Bodies &bodies, real R0, int kmax) {
   real scale = M_PI / R0;
-#pragma omp parallel for
-  for( int i=0; i<int(ewalds.size()); ++i ) {
-    E_iter E = ewalds.begin() + i;
-    E->REAL = E->IMAG = 0;
-    for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {
-      real th = 0;
-      for( int d=0; d<3; d++ ) th += E->K[d] * B->X[d] * scale;
-      E->REAL += B->SRC * cos(th);
-      E->IMAG += B->SRC * sin(th);
+  int nk = 2 * kmax + 1;
+  std::vector<int> groups = waveGroups(ewalds);
+  int nblock = (bodies.size() + EWALDBLOCK - 1) / EWALDBLOCK;
+  for( E_iter E=ewalds.begin(); E!=ewalds.end(); ++E ) E->REAL = E->IMAG = 0;
+#pragma omp parallel
+  {
+    std::vector<real> table, S(2*ewalds.size(),0), qr(EWALDBLOCK), qi(EWALDBLOCK);
+#pragma omp for schedule(dynamic)
+    for( int blk=0; blk<nblock; ++blk ) {                       // Loop over blocks of bodies
+      B_iter B0 = bodies.begin() + blk * EWALDBLOCK;            //  First body in block
+      int nb = std::min(EWALDBLOCK,int(bodies.end()-B0));       //  Bodies in block
+      waveTable(B0,nb,kmax,scale,table);                        //  exp(i k x) per dimension
+      for( int g=0; g<int(groups.size())-1; ++g ) {             //  Loop over runs of n
+        int l = ewalds[groups[g]].K[0], m = ewalds[groups[g]].K[1];
+        const real *xr = &table[(kmax+l)*2*EWALDBLOCK], *xi = xr + EWALDBLOCK;
+        const real *yr = &table[(nk+kmax+m)*2*EWALDBLOCK], *yi = yr + EWALDBLOCK;
+        for( int b=0; b<nb; ++b ) {                             //   Loop over bodies
+          qr[b] = B0[b].SRC * (xr[b] * yr[b] - xi[b] * yi[b]);  //    q exp(i(l x + m y))
+          qi[b] = B0[b].SRC * (xr[b] * yi[b] + xi[b] * yr[b]);
+        }                                                       //   End loop over bodies
+        for( int i=groups[g]; i<groups[g+1]; ++i ) {            //   Loop over n in run
+          int n = ewalds[i].K[2];
+          const real *zr = &table[(2*nk+kmax+n)*2*EWALDBLOCK], *zi = zr + EWALDBLOCK;
+          real re = 0, im = 0;
+#pragma omp simd reduction(+:re,im)
+          for( int b=0; b<nb; ++b ) {                           //    Loop over bodies
+            re += qr[b] * zr[b] - qi[b] * zi[b];                //     Real part of structure factor
+            im += qr[b] * zi[b] + qi[b] * zr[b];                //     Imaginary part of structure factor
+          }                                                     //    End loop over bodies
+          S[2*i+0] += re;
+          S[2*i+1] += im;
+        }                                                       //   End loop over n in run
+      }                                                         //  End loop over runs of n
+    }                                                           // End loop over blocks of bodies
+#pragma omp critical
+    for( int i=0; i<int(ewalds.size()); ++i ) {                 // Reduce partial structure factors
+      ewalds[i].REAL += S[2*i+0];
+      ewalds[i].IMAG += S[2*i+1];
     }
   }
 }
 
-void idft(Ewalds &ewalds, Bodies &bodies, real R0) {
+void idft(Ewalds &ewalds, Bodies &bodies, real R0, int kmax) {
   real scale = M_PI / R0;
-#pragma omp parallel for
-  for( int i=0; i<int(bodies.size()); ++i ) {
-    B_iter B = bodies.begin() + i;
-    vec<4,real> TRG = 0;
-    for( E_iter E=ewalds.begin(); E!=ewalds.end(); ++E ) {
-      real th = 0;
-      for( int d=0; d<3; d++ ) th += E->K[d] * B->X[d] * scale;
-      real dtmp = E->REAL * sin(th) - E->IMAG * cos(th);
-      TRG[0]   += E->REAL * cos(th) + E->IMAG * sin(th);
-      for( int d=0; d<3; d++ ) TRG[d+1] -= dtmp * E->K[d];
-    }
-    B->TRG = TRG;
+  int nk = 2 * kmax + 1;
+  std::vector<int> groups = waveGroups(ewalds);
+  int nblock = (bodies.size() + EWALDBLOCK - 1) / EWALDBLOCK;
+#pragma omp parallel
+  {
+    std::vector<real> table, er(EWALDBLOCK), ei(EWALDBLOCK), sum(EWALDBLOCK), TRG(4*EWALDBLOCK);
+#pragma omp for schedule(dynamic)
+    for( int blk=0; blk<nblock; ++blk ) {                       // Loop over blocks of bodies
+      B_iter B0 = bodies.begin() + blk * EWALDBLOCK;            //  First body in block
+      int nb = std::min(EWALDBLOCK,int(bodies.end()-B0));       //  Bodies in block
+      waveTable(B0,nb,kmax,scale,table);                        //  exp(i k x) per dimension
+      std::fill(TRG.begin(),TRG.end(),0);                       //  Potential and gradient of block
+      real *pot = &TRG[0], *gx = pot + EWALDBLOCK, *gy = gx + EWALDBLOCK, *gz = gy + EWALDBLOCK;
+      for( int g=0; g<int(groups.size())-1; ++g ) {             //  Loop over runs of n
+        int l = ewalds[groups[g]].K[0], m = ewalds[groups[g]].K[1];
+        const real *xr = &table[(kmax+l)*2*EWALDBLOCK], *xi = xr + EWALDBLOCK;
+        const real *yr = &table[(nk+kmax+m)*2*EWALDBLOCK], *yi = yr + EWALDBLOCK;
+        for( int b=0; b<nb; ++b ) {                             //   Loop over bodies
+          er[b] = xr[b] * yr[b] - xi[b] * yi[b];                //    exp(i(l x + m y))
+          ei[b] = xr[b] * yi[b] + xi[b] * yr[b];
+          sum[b] = 0;                                           //    Sum of imaginary parts for x, y gradient
+        }                                                       //   End loop over bodies
+        for( int i=groups[g]; i<groups[g+1]; ++i ) {            //   Loop over n in run
+          int n = ewalds[i].K[2];
+          real SR = ewalds[i].REAL, SI = ewalds[i].IMAG;
+          const real *zr = &table[(2*nk+kmax+n)*2*EWALDBLOCK], *zi = zr + EWALDBLOCK;
+#pragma omp simd
+          for( int b=0; b<nb; ++b ) {                           //    Loop over bodies
+            real cr = er[b] * zr[b] - ei[b] * zi[b];            //     cos(k x)
+            real ci = er[b] * zi[b] + ei[b] * zr[b];            //     sin(k x)
+            real tr = SR * cr + SI * ci;                        //     Real part of S exp(-i k x)
+            real ti = SI * cr - SR * ci;                        //     Imaginary part of S exp(-i k x)
+            pot[b] += tr;                                       //     Potential
+            sum[b] += ti;                                       //     Gradient without l, m
+            gz[b] += ti * n;                                    //     z gradient
+          }                                                     //    End loop over bodies
+        }                                                       //   End loop over n in run
+        for( int b=0; b<nb; ++b ) {                             //   Loop over bodies
+          gx[b] += sum[b] * l;                                  //    x gradient
+          gy[b] += sum[b] * m;                                  //    y gradient
+        }                                                       //   End loop over bodies
+      }                                                         //  End loop over runs of n
+      for( int b=0; b<nb; ++b ) {                               //  Loop over bodies
+        B0[b].TRG[0] = pot[b];
+        B0[b].TRG[1] = gx[b];
+        B0[b].TRG[2] = gy[b];
+        B0[b].TRG[3] = gz[b];
+      }                                                         //  End loop over bodies
+    }                                                           // End loop over blocks of bodies
   }
 }
 }
 
+namespace {
+//! Ewald real part of targets [0,ni) from sources [0,nj) with tabulated erfc and exp (pairs outside cutoff are masked)
+inline void EwaldRealTargets(const real *Xi, const real *Yi, const real *Zi,
+                             real *Pi, real *Fxi, real *Fyi, real *Fzi, int ni,
+                             const real *Xj, const real *Yj, const real *Zj, const real *Qj, int nj,
+                             const real *table, int ntable, real scale, real alpha, real cut2, real R0) {
+  const real L = 2 * R0;                                        // Period
+  const real invL = 1 / L;                                      // Inverse of period
+  const real alpha2 = M_2_SQRTPI * alpha;                       // Coefficient of exp term in force
+  for( int i=0; i<ni; ++i ) {                                   // Loop over target bodies
+    const real xi = Xi[i] - Xperiodic[0];                       //  Target x coordinate with periodic offset
+    const real yi = Yi[i] - Xperiodic[1];                       //  Target y coordinate with periodic offset
+    const real zi = Zi[i] - Xperiodic[2];                       //  Target z coordinate with periodic offset
+    real P0 = 0, F0 = 0, F1 = 0, F2 = 0;                        //  Initialize potential and force
+#pragma omp simd reduction(+:P0,F0,F1,F2)
+    for( int j=0; j<nj; ++j ) {                                 //  Loop over source bodies
+      real dx = xi - Xj[j];                                     //   x distance from source to target
+      real dy = yi - Yj[j];                                     //   y distance from source to target
+      real dz = zi - Zj[j];                                     //   z distance from source to target
+      dx -= L * std::floor(dx * invL + .5f);                    //   Nearest image in x without branches
+      dy -= L * std::floor(dy * invL + .5f);                    //   Nearest image in y without branches
+      dz -= L * std::floor(dz * invL + .5f);                    //   Nearest image in z without branches
+      real R2 = dx * dx + dy * dy + dz * dz;                    //   R^2
+      real R = std::sqrt(R2);                                   //   R
+      real t = R * alpha * scale;                               //   Position in table
+      bool inside = R2 > 0 && R2 < cut2 && t < ntable;          //   Exclude self and pairs beyond cutoff
+      real invR = inside ? 1 / R : 0;                           //   Masked 1 / R
+      int k = inside ? int(t) : 0;                              //   Piece of table
+      real f = t - k;                                           //   Fraction of piece
+      const real *c = table + 8 * k;                            //   Coefficients of piece
+      real erfcs = c[0] + f * (c[1] + f * (c[2] + f * c[3]));   //   erfc(alpha * R)
+      real exps = c[4] + f * (c[5] + f * (c[6] + f * c[7]));    //   exp(-(alpha * R)^2)
+      real pot = Qj[j] * erfcs * invR;                          //   Ewald real potential
+      real dtmp = (pot + Qj[j] * alpha2 * exps) * invR * invR;  //   Ewald real force over R
+      P0 += pot;                                                //   Accumulate potential
+      F0 -= dx * dtmp;                                          //   Accumulate x component of force
+      F1 -= dy * dtmp;                                          //   Accumulate y component of force
+      F2 -= dz * dtmp;                                          //   Accumulate z component of force
+    }                                                           //  End loop over source bodies
+    Pi[i] += P0;                                                //  Potential of target
+    Fxi[i] += F0;                                               //  x component of force of target
+    Fyi[i] += F1;                                               //  y component of force of target
+    Fzi[i] += F2;                                               //  z component of force of target
+  }                                                             // End loop over target bodies
+}
+
+#if SIMD
+//! Ewald real part vectorized with AVX2 + FMA
+__attribute__((target("avx2,fma")))
+void EwaldRealAVX2(const real *Xi, const real *Yi, const real *Zi,
+                   real *Pi, real *Fxi, real *Fyi, real *Fzi, int ni,
+                   const real *Xj, const real *Yj, const real *Zj, const real *Qj, int nj,
+                   const real *table, int ntable, real scale, real alpha, real cut2, real R0) {
+  EwaldRealTargets(Xi,Yi,Zi,Pi,Fxi,Fyi,Fzi,ni,Xj,Yj,Zj,Qj,nj,table,ntable,scale,alpha,cut2,R0);
+}
+
+//! Ewald real part vectorized with AVX-512
+__attribute__((target("avx512f")))
+void EwaldRealAVX512(const real *Xi, const real *Yi, const real *Zi,
+                     real *Pi, real *Fxi, real *Fyi, real *Fzi, int ni,
+                     const real *Xj, const real *Yj, const real *Zj, const real *Qj, int nj,
+                     const real *table, int ntable, real scale, real alpha, real cut2, real R0) {
+  EwaldRealTargets(Xi,Yi,Zi,Pi,Fxi,Fyi,Fzi,ni,Xj,Yj,Zj,Qj,nj,table,ntable,scale,alpha,cut2,R0);
+}
+#endif
+}
+
 template<>
 void Kernel<Laplace>::EwaldReal(C_iter Ci, C_iter Cj) const {   // Ewald real part on CPU
+  assert( !ERFCTABLE.empty() );                                 // setEwald builds the tables
+  if( Ci->NDLEAF == 0 || Cj->NDLEAF == 0 ) return;              // Nothing to do for empty cells
+  static thread_local BodiesSoA ibodies, jbodies;              // Per thread, capacity grows to the largest cell
+  ibodies.gather(Ci->LEAF,Ci->LEAF+Ci->NDLEAF);                 // Gather target bodies
+  jbodies.gather(Cj->LEAF,Cj->LEAF+Cj->NDLEAF);                 // Gather source bodies
+  real cut2 = CUTOFF > 0 ? CUTOFF * CUTOFF : 4 * R0 * R0;       // Squared cutoff (nearest images are closer than 2 R0)
+  void (*kernel)(const real*, const real*, const real*, real*, real*, real*, real*, int,
+                 const real*, const real*, const real*, const real*, int,
+                 const real*, int, real, real, real, real) = EwaldRealTargets;// Scalar kernel
+#if SIMD
+  if( SIMDLEVEL == SIMDAVX2 ) kernel = EwaldRealAVX2;           // Use AVX2 kernel
+  if( SIMDLEVEL == SIMDAVX512 ) kernel = EwaldRealAVX512;       // Use AVX-512 kernel
+#endif
+  kernel(&ibodies.X[0][0],&ibodies.X[1][0],&ibodies.X[2][0],
+         &ibodies.TRG[0][0],&ibodies.TRG[1][0],&ibodies.TRG[2][0],&ibodies.TRG[3][0],ibodies.size(),
+         &jbodies.X[0][0],&jbodies.X[1][0],&jbodies.X[2][0],&jbodies.SRC[0],jbodies.size(),
+         &ERFCTABLE[0],ERFCTABLE.size()/8,ERFCSCALE,ALPHA,cut2,R0);
   for( int i=0; i<Ci->NDLEAF; ++i ) {                           // Loop over target bodies
-    B_iter Bi = Ci->LEAF + i;                                   //  Target body iterator
-    for( B_iter Bj=Cj->LEAF; Bj!=Cj->LEAF+Cj->NDLEAF; ++Bj ) {  //  Loop over source bodies
-      vect dist = Bi->X - Bj->X - Xperiodic;                    //   Distance vector from source to target
-      for( int d=0; d<3; d++ ) {                                //   Loop over dimensions
-        if( dist[d] < -R0 ) dist[d] += 2 * R0;                  //    Wrap domain so that target is always at
-        if( dist[d] >= R0 ) dist[d] -= 2 * R0;                  //    the center of a [-R0,R0]^3 source cube
-      }                                                         //   End loop over dimensions
-      real R2 = norm(dist);                                     //   R^2
-      if( R2 != 0 ) {                                           //   Exclude self interaction
-        real R2s = R2 * ALPHA * ALPHA;                          //    (R * alpha)^2
-        real Rs = std::sqrt(R2s);                               //    R * alpha
-        real invRs = 1 / Rs;                                    //    1 / (R * alpha)
-        real invR2s = invRs * invRs;                            //    1 / (R * alpha)^2
-        real invR3s = invR2s * invRs;                           //    1 / (R * alpha)^3
-        real dtmp = Bj->SRC * (M_2_SQRTPI * exp(-R2s) * invR2s + erfc(Rs) * invR3s);
-        dtmp *= ALPHA * ALPHA * ALPHA;                          //    Scale temporary value
-        Bi->TRG[0] += Bj->SRC * erfc(Rs) * invRs * ALPHA;       //    Ewald real potential
-        Bi->TRG[1] -= dist[0] * dtmp;                           //    x component of Ewald real force
-        Bi->TRG[2] -= dist[1] * dtmp;                           //    y component of Ewald real force
-        Bi->TRG[3] -= dist[2] * dtmp;                           //    z component of Ewald real force
-      }                                                         //   End if for self interaction
-    }                                                           //  End loop over source bodies
+    B_iter B = Ci->LEAF + i;                                    //  Target body iterator
+    for( int d=0; d!=4; ++d ) B->TRG[d] += ibodies.TRG[d][i];   //  Accumulate target values
   }                                                             // End loop over target bodies
 }
 
@@ -114,27 +279,17 @@ void Kernel<Laplace>::EwaldWave(Bodies &bodies) const {         // Ewald wave pa
     }
   }
 
-  dft(ewalds,bodies,R0);
+  dft(ewalds,bodies,R0,kmax);
   for( E_iter E=ewalds.begin(); E!=ewalds.end(); ++E ) {
     real R2 = norm(E->K);
     real factor = coef * exp(-R2 * coef2) / R2;
     E->REAL *= factor;
     E->IMAG *= factor;
   }
-  idft(ewalds,bodies,R0);
+  idft(ewalds,bodies,R0,kmax);
   for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {
     for( int d=0; d<3; d++ ) B->TRG[d+1] *= scale;
   }
 
-  vect dipole = 0;
-  for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {
-    dipole += (B->X - R0) * B->SRC;
-  }
-  coef = M_PI / (6 * R0 * R0 * R0);
-  for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {
-    B->TRG[0] += coef * norm(dipole) / bodies.size() / B->SRC;
-    for( int d=0; d!=3; ++d ) {
-      B->TRG[d+1] += coef * dipole[d];
-    }
-  }
+  dipoleCorrection(bodies);
 }
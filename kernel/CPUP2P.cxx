@@ -23,63 +23,1388 @@ THE SOFTWARE.
 #include "kernel.h"
 #undef KERNEL
 
+namespace {
+//! Laplace interaction of one target with sources [jbegin,jend), accumulating into both sides
+inline void P2PLaplaceMutualScalar(real xi, real yi, real zi, real qi, real &P0, real &F0, real &F1, real &F2,
+                                   const real *Xj, const real *Yj, const real *Zj, const real *Qj,
+                                   real *Pj, real *Fxj, real *Fyj, real *Fzj, int jbegin, int jend) {
+#pragma omp simd reduction(+:P0,F0,F1,F2)
+  for( int j=jbegin; j<jend; ++j ) {                            // Loop over source bodies
+    real dx = xi - Xj[j];                                       //  x distance from source to target
+    real dy = yi - Yj[j];                                       //  y distance from source to target
+    real dz = zi - Zj[j];                                       //  z distance from source to target
+    real R2 = dx * dx + dy * dy + dz * dz + EPS2;               //  R^2
+    real invR2 = R2 == 0 ? 0 : 1 / R2;                          //  1 / R^2 (exclude self interaction)
+    real invR = std::sqrt(invR2);                               //  1 / R
+    real invRi = Qj[j] * invR;                                  //  potential on target
+    real invRj = qi * invR;                                     //  potential on source
+    real invR3i = invR2 * invRi;                                //  force on target
+    real invR3j = invR2 * invRj;                                //  force on source
+    P0 += invRi;                                                //  accumulate potential
+    F0 += dx * invR3i;                                          //  accumulate x component of force
+    F1 += dy * invR3i;                                          //  accumulate y component of force
+    F2 += dz * invR3i;                                          //  accumulate z component of force
+    Pj[j] += invRj;                                             //  potential of source
+    Fxj[j] += dx * invR3j;                                      //  x component of force on source (opposite sign)
+    Fyj[j] += dy * invR3j;                                      //  y component of force on source (opposite sign)
+    Fzj[j] += dz * invR3j;                                      //  z component of force on source (opposite sign)
+  }                                                             // End loop over source bodies
+}
+
+//! Structure of arrays with atom types and Van der Waals targets for the combined kernel
+struct CoulombVanDerWaalsSoA : public BodiesSoA {
+  std::vector<int> ATYPE;                                       //!< Atom types
+  Reals VDW[4];                                                 //!< Van der Waals potential+force
+//! Copy bodies in [begin,end) and their atom types into the arrays and clear the targets
+  void gather(B_iter begin, B_iter end, const int *atype) {
+    BodiesSoA::gather(begin,end);                               // Copy positions and sources, clear Coulomb targets
+    ATYPE.assign(atype,atype+size());                           // Copy atom types from side array
+    for( int d=0; d!=4; ++d ) VDW[d].assign(size(),0);          // Initialize Van der Waals target values
+  }
+//! Add both target values to bodies starting at begin and to the side array starting at vdw
+  void add(B_iter begin, vec<4,real> *vdw) const {
+    for( int i=0; i<size(); ++i ) {                             // Loop over bodies
+      for( int d=0; d!=4; ++d ) {                               //  Loop over target values
+        begin[i].TRG[d] += TRG[d][i];                           //   Accumulate Coulomb target values
+        vdw[i][d] += VDW[d][i];                                 //   Accumulate Van der Waals target values
+      }                                                         //  End loop over target values
+    }                                                           // End loop over bodies
+  }
+};
+}
+
+#if SIMD
+#include <immintrin.h>
+
+namespace {
+#if !FP64
+//! One source against 4 targets with SSE4.1 (keep is zero in lanes of excluded pairs)
+template<bool masked>
+__attribute__((target("sse4.1"),always_inline)) inline
+void P2PLaplaceSSEPair(__m128 xi, __m128 yi, __m128 zi, __m128 xj, __m128 yj, __m128 zj, __m128 qj, __m128 keep,
+                       __m128 &pot, __m128 &fx, __m128 &fy, __m128 &fz) {
+  __m128 dx = _mm_sub_ps(xi,xj);                                // x distance from source to target
+  __m128 dy = _mm_sub_ps(yi,yj);                                // y distance from source to target
+  __m128 dz = _mm_sub_ps(zi,zj);                                // z distance from source to target
+  __m128 R2 = _mm_add_ps(_mm_mul_ps(dx,dx),_mm_set1_ps(EPS2));  // R^2
+  R2 = _mm_add_ps(R2,_mm_mul_ps(dy,dy));                        // R^2
+  R2 = _mm_add_ps(R2,_mm_mul_ps(dz,dz));                        // R^2
+  __m128 invR = _mm_rsqrt_ps(R2);                               // Approximate 1 / R
+  invR = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f),invR),         // Newton-Raphson refinement
+                    _mm_sub_ps(_mm_set1_ps(3.0f),_mm_mul_ps(R2,_mm_mul_ps(invR,invR))));
+  invR = _mm_and_ps(invR,_mm_cmpgt_ps(R2,_mm_setzero_ps()));    // Exclude self interaction
+  if( masked ) invR = _mm_and_ps(invR,keep);                    // Skip excluded pairs
+  __m128 invR2 = _mm_mul_ps(invR,invR);                         // 1 / R^2
+  invR = _mm_mul_ps(invR,qj);                                   // potential
+  invR2 = _mm_mul_ps(invR2,invR);                               // force
+  pot = _mm_add_ps(pot,invR);                                   // accumulate potential
+  fx = _mm_add_ps(fx,_mm_mul_ps(dx,invR2));                     // accumulate x component of force
+  fy = _mm_add_ps(fy,_mm_mul_ps(dy,invR2));                     // accumulate y component of force
+  fz = _mm_add_ps(fz,_mm_mul_ps(dz,invR2));                     // accumulate z component of force
+}
+
+//! Laplace P2P on 4 targets x JT sources at a time with SSE4.1 (rsqrt + one Newton step, skips pairs set in exclude)
+template<bool masked>
+__attribute__((target("sse4.1")))
+void P2PLaplaceSSETiles(const real *Xi, const real *Yi, const real *Zi,
+                        real *Pi, real *Fxi, real *Fyi, real *Fzi, int ni,
+                        const real *Xj, const real *Yj, const real *Zj, const real *Qj, int nj,
+                        const unsigned *exclude) {
+  const int JT = 2;                                             // Sources per tile (16 registers)
+  const __m128 zero = _mm_setzero_ps();                         // 0.0
+  const __m128i bit = _mm_setr_epi32(1,2,4,8);                  // Exclusion bit of each lane
+  for( int i=0; i<ni; i+=4 ) {                                  // Loop over target bodies in blocks of 4
+    const int n = std::min(4,ni-i);                             //  Number of active lanes
+    const unsigned *E = masked ? exclude + i/4*nj : 0;          //  Exclusion words of block
+    float x[4] = {0}, y[4] = {0}, z[4] = {0};                   //  Target coordinates with padded tail
+    for( int l=0; l!=n; ++l ) {                                 //  Loop over active lanes
+      x[l] = Xi[i+l] - Xperiodic[0];                            //   Target x coordinate with periodic offset
+      y[l] = Yi[i+l] - Xperiodic[1];                            //   Target y coordinate with periodic offset
+      z[l] = Zi[i+l] - Xperiodic[2];                            //   Target z coordinate with periodic offset
+    }                                                           //  End loop over active lanes
+    const __m128 xi = _mm_loadu_ps(x);                          //  Target x coordinates
+    const __m128 yi = _mm_loadu_ps(y);                          //  Target y coordinates
+    const __m128 zi = _mm_loadu_ps(z);                          //  Target z coordinates
+    __m128 pot = zero, fx = zero, fy = zero, fz = zero;         //  Initialize potential and force
+    int j = 0;                                                  //  Source index
+    for( ; j+JT<=nj; j+=JT ) {                                  //  Loop over tiles of source bodies
+      __m128 xj[JT], yj[JT], zj[JT], qj[JT], keep[JT];          //   Source tile held in registers
+      for( int k=0; k!=JT; ++k ) {                              //   Loop over sources in tile
+        xj[k] = _mm_set1_ps(Xj[j+k]);                           //    Broadcast source x coordinate
+        yj[k] = _mm_set1_ps(Yj[j+k]);                           //    Broadcast source y coordinate
+        zj[k] = _mm_set1_ps(Zj[j+k]);                           //    Broadcast source z coordinate
+        qj[k] = _mm_set1_ps(Qj[j+k]);                           //    Broadcast source value
+        keep[k] = zero;                                         //    Lanes not excluded
+        if( masked ) keep[k] = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(E[j+k]),bit),
+                                                                _mm_setzero_si128()));
+      }                                                         //   End loop over sources in tile
+      for( int k=0; k!=JT; ++k ) {                              //   Loop over sources in tile
+        P2PLaplaceSSEPair<masked>(xi,yi,zi,xj[k],yj[k],zj[k],qj[k],keep[k],pot,fx,fy,fz);
+      }                                                         //   End loop over sources in tile
+    }                                                           //  End loop over tiles of source bodies
+    for( ; j<nj; ++j ) {                                        //  Loop over remaining source bodies
+      __m128 keep = zero;                                       //   Lanes not excluded
+      if( masked ) keep = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(E[j]),bit),
+                                                           _mm_setzero_si128()));
+      P2PLaplaceSSEPair<masked>(xi,yi,zi,_mm_set1_ps(Xj[j]),_mm_set1_ps(Yj[j]),_mm_set1_ps(Zj[j]),_mm_set1_ps(Qj[j]),
+                                keep,pot,fx,fy,fz);
+    }                                                           //  End loop over remaining source bodies
+    _mm_storeu_ps(x,pot);                                       //  Store potential
+    for( int l=0; l!=n; ++l ) Pi[i+l] += x[l];                  //  Accumulate potential of active lanes
+    _mm_storeu_ps(x,fx);                                        //  Store x component of force
+    for( int l=0; l!=n; ++l ) Fxi[i+l] -= x[l];                 //  Accumulate x force of active lanes
+    _mm_storeu_ps(x,fy);                                        //  Store y component of force
+    for( int l=0; l!=n; ++l ) Fyi[i+l] -= x[l];                 //  Accumulate y force of active lanes
+    _mm_storeu_ps(x,fz);                                        //  Store z component of force
+    for( int l=0; l!=n; ++l ) Fzi[i+l] -= x[l];                 //  Accumulate z force of active lanes
+  }                                                             // End loop over target bodies
+}
+
+//! One source against 8 targets with AVX2 + FMA (keep is zero in lanes of excluded pairs)
+template<bool masked>
+__attribute__((target("avx2,fma"),always_inline)) inline
+void P2PLaplaceAVX2Pair(__m256 xi, __m256 yi, __m256 zi, __m256 xj, __m256 yj, __m256 zj, __m256 qj, __m256 keep,
+                        __m256 &pot, __m256 &fx, __m256 &fy, __m256 &fz) {
+  __m256 dx = _mm256_sub_ps(xi,xj);                             // x distance from source to target
+  __m256 dy = _mm256_sub_ps(yi,yj);                             // y distance from source to target
+  __m256 dz = _mm256_sub_ps(zi,zj);                             // z distance from source to target
+  __m256 R2 = _mm256_fmadd_ps(dx,dx,_mm256_set1_ps(EPS2));      // R^2
+  R2 = _mm256_fmadd_ps(dy,dy,R2);                               // R^2
+  R2 = _mm256_fmadd_ps(dz,dz,R2);                               // R^2
+  __m256 invR = _mm256_rsqrt_ps(R2);                            // Approximate 1 / R
+  invR = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f),invR),// Newton-Raphson refinement
+                       _mm256_fnmadd_ps(R2,_mm256_mul_ps(invR,invR),_mm256_set1_ps(3.0f)));
+  invR = _mm256_and_ps(invR,_mm256_cmp_ps(R2,_mm256_setzero_ps(),_CMP_GT_OQ));// Exclude self interaction
+  if( masked ) invR = _mm256_and_ps(invR,keep);                 // Skip excluded pairs
+  __m256 invR2 = _mm256_mul_ps(invR,invR);                      // 1 / R^2
+  invR = _mm256_mul_ps(invR,qj);                                // potential
+  invR2 = _mm256_mul_ps(invR2,invR);                            // force
+  pot = _mm256_add_ps(pot,invR);                                // accumulate potential
+  fx = _mm256_fmadd_ps(dx,invR2,fx);                            // accumulate x component of force
+  fy = _mm256_fmadd_ps(dy,invR2,fy);                            // accumulate y component of force
+  fz = _mm256_fmadd_ps(dz,invR2,fz);                            // accumulate z component of force
+}
+
+//! Laplace P2P on 8 targets x JT sources at a time with AVX2 + FMA (masked tail, skips pairs set in exclude)
+template<bool masked>
+__attribute__((target("avx2,fma")))
+void P2PLaplaceAVX2Tiles(const real *Xi, const real *Yi, const real *Zi,
+                         real *Pi, real *Fxi, real *Fyi, real *Fzi, int ni,
+                         const real *Xj, const real *Yj, const real *Zj, const real *Qj, int nj,
+                         const unsigned *exclude) {
+  const int JT = 2;                                             // Sources per tile (16 registers)
+  const __m256 zero = _mm256_setzero_ps();                      // 0.0
+  const __m256i lane = _mm256_setr_epi32(0,1,2,3,4,5,6,7);      // Lane index
+  const __m256i bit = _mm256_setr_epi32(1,2,4,8,16,32,64,128);  // Exclusion bit of each lane
+  for( int i=0; i<ni; i+=8 ) {                                  // Loop over target bodies in blocks of 8
+    const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(ni-i),lane);// Mask of active lanes
+    const unsigned *E = masked ? exclude + i/8*nj : 0;          //  Exclusion words of block
+    const __m256 xi = _mm256_sub_ps(_mm256_maskload_ps(Xi+i,mask),_mm256_set1_ps(Xperiodic[0]));// Target x
+    const __m256 yi = _mm256_sub_ps(_mm256_maskload_ps(Yi+i,mask),_mm256_set1_ps(Xperiodic[1]));// Target y
+    const __m256 zi = _mm256_sub_ps(_mm256_maskload_ps(Zi+i,mask),_mm256_set1_ps(Xperiodic[2]));// Target z
+    __m256 pot = zero, fx = zero, fy = zero, fz = zero;         //  Initialize potential and force
+    int j = 0;                                                  //  Source index
+    for( ; j+JT<=nj; j+=JT ) {                                  //  Loop over tiles of source bodies
+      __m256 xj[JT], yj[JT], zj[JT], qj[JT], keep[JT];          //   Source tile held in registers
+      for( int k=0; k!=JT; ++k ) {                              //   Loop over sources in tile
+        xj[k] = _mm256_broadcast_ss(Xj+j+k);                    //    Broadcast source x coordinate
+        yj[k] = _mm256_broadcast_ss(Yj+j+k);                    //    Broadcast source y coordinate
+        zj[k] = _mm256_broadcast_ss(Zj+j+k);                    //    Broadcast source z coordinate
+        qj[k] = _mm256_broadcast_ss(Qj+j+k);                    //    Broadcast source value
+        keep[k] = zero;                                         //    Lanes not excluded
+        if( masked ) keep[k] = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(E[j+k]),bit),
+                                                                      _mm256_setzero_si256()));
+      }                                                         //   End loop over sources in tile
+      for( int k=0; k!=JT; ++k ) {                              //   Loop over sources in tile
+        P2PLaplaceAVX2Pair<masked>(xi,yi,zi,xj[k],yj[k],zj[k],qj[k],keep[k],pot,fx,fy,fz);
+      }                                                         //   End loop over sources in tile
+    }                                                           //  End loop over tiles of source bodies
+    for( ; j<nj; ++j ) {                                        //  Loop over remaining source bodies
+      __m256 keep = zero;                                       //   Lanes not excluded
+      if( masked ) keep = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(E[j]),bit),
+                                                                 _mm256_setzero_si256()));
+      P2PLaplaceAVX2Pair<masked>(xi,yi,zi,_mm256_broadcast_ss(Xj+j),_mm256_broadcast_ss(Yj+j),_mm256_broadcast_ss(Zj+j),
+                                 _mm256_broadcast_ss(Qj+j),keep,pot,fx,fy,fz);
+    }                                                           //  End loop over remaining source bodies
+    _mm256_maskstore_ps(Pi+i,mask,_mm256_add_ps(_mm256_maskload_ps(Pi+i,mask),pot));// Accumulate potential
+    _mm256_maskstore_ps(Fxi+i,mask,_mm256_sub_ps(_mm256_maskload_ps(Fxi+i,mask),fx));// Accumulate x force
+    _mm256_maskstore_ps(Fyi+i,mask,_mm256_sub_ps(_mm256_maskload_ps(Fyi+i,mask),fy));// Accumulate y force
+    _mm256_maskstore_ps(Fzi+i,mask,_mm256_sub_ps(_mm256_maskload_ps(Fzi+i,mask),fz));// Accumulate z force
+  }                                                             // End loop over target bodies
+}
+
+//! One source against 16 targets with AVX-512F (active is cleared in lanes of excluded pairs)
+__attribute__((target("avx512f"),always_inline)) inline
+void P2PLaplaceAVX512Pair(__m512 xi, __m512 yi, __m512 zi, __m512 xj, __m512 yj, __m512 zj, __m512 qj, __mmask16 active,
+                          __m512 &pot, __m512 &fx, __m512 &fy, __m512 &fz) {
+  __m512 dx = _mm512_sub_ps(xi,xj);                             // x distance from source to target
+  __m512 dy = _mm512_sub_ps(yi,yj);                             // y distance from source to target
+  __m512 dz = _mm512_sub_ps(zi,zj);                             // z distance from source to target
+  __m512 R2 = _mm512_fmadd_ps(dx,dx,_mm512_set1_ps(EPS2));      // R^2
+  R2 = _mm512_fmadd_ps(dy,dy,R2);                               // R^2
+  R2 = _mm512_fmadd_ps(dz,dz,R2);                               // R^2
+  active &= _mm512_cmp_ps_mask(R2,_mm512_setzero_ps(),_CMP_GT_OQ);// Exclude self interaction
+  __m512 invR = _mm512_maskz_rsqrt14_ps(active,R2);             // Approximate 1 / R
+  invR = _mm512_mul_ps(_mm512_mul_ps(_mm512_set1_ps(0.5f),invR),// Newton-Raphson refinement
+                       _mm512_fnmadd_ps(R2,_mm512_mul_ps(invR,invR),_mm512_set1_ps(3.0f)));
+  __m512 invR2 = _mm512_mul_ps(invR,invR);                      // 1 / R^2
+  invR = _mm512_mul_ps(invR,qj);                                // potential
+  invR2 = _mm512_mul_ps(invR2,invR);                            // force
+  pot = _mm512_add_ps(pot,invR);                                // accumulate potential
+  fx = _mm512_fmadd_ps(dx,invR2,fx);                            // accumulate x component of force
+  fy = _mm512_fmadd_ps(dy,invR2,fy);                            // accumulate y component of force
+  fz = _mm512_fmadd_ps(dz,invR2,fz);                            // accumulate z component of force
+}
+
+//! Laplace P2P on 16 targets x JT sources at a time with AVX-512F (masked tail, skips pairs set in exclude)
+template<bool masked>
+__attribute__((target("avx512f")))
+void P2PLaplaceAVX512Tiles(const real *Xi, const real *Yi, const real *Zi,
+                           real *Pi, real *Fxi, real *Fyi, real *Fzi, int ni,
+                           const real *Xj, const real *Yj, const real *Zj, const real *Qj, int nj,
+                           const unsigned *exclude) {
+  const int JT = 4;                                             // Sources per tile (32 registers)
+  const __m512 zero = _mm512_setzero_ps();                      // 0.0
+  for( int i=0; i<ni; i+=16 ) {                                 // Loop over target bodies in blocks of 16
+    const __mmask16 mask = ni - i >= 16 ? 0xFFFF : (1 << (ni - i)) - 1;// Mask of active lanes
+    const unsigned *E = masked ? exclude + i/16*nj : 0;         //  Exclusion words of block
+    const __m512 xi = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask,Xi+i),_mm512_set1_ps(Xperiodic[0]));// Target x
+    const __m512 yi = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask,Yi+i),_mm512_set1_ps(Xperiodic[1]));// Target y
+    const __m512 zi = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask,Zi+i),_mm512_set1_ps(Xperiodic[2]));// Target z
+    __m512 pot[2] = {zero,zero}, fx[2] = {zero,zero};           //  Two accumulators per value
+    __m512 fy[2] = {zero,zero}, fz[2] = {zero,zero};            //  for independent dependency chains
+    int j = 0;                                                  //  Source index
+    for( ; j+JT<=nj; j+=JT ) {                                  //  Loop over tiles of source bodies
+      __m512 xj[JT], yj[JT], zj[JT], qj[JT];                    //   Source tile held in registers
+      for( int k=0; k!=JT; ++k ) {                              //   Loop over sources in tile
+        xj[k] = _mm512_set1_ps(Xj[j+k]);                        //    Broadcast source x coordinate
+        yj[k] = _mm512_set1_ps(Yj[j+k]);                        //    Broadcast source y coordinate
+        zj[k] = _mm512_set1_ps(Zj[j+k]);                        //    Broadcast source z coordinate
+        qj[k] = _mm512_set1_ps(Qj[j+k]);                        //    Broadcast source value
+      }                                                         //   End loop over sources in tile
+      for( int k=0; k!=JT; ++k ) {                              //   Loop over sources in tile
+        P2PLaplaceAVX512Pair(xi,yi,zi,xj[k],yj[k],zj[k],qj[k],masked ? ~E[j+k] : 0xFFFF,
+                             pot[k&1],fx[k&1],fy[k&1],fz[k&1]);
+      }                                                         //   End loop over sources in tile
+    }                                                           //  End loop over tiles of source bodies
+    for( ; j<nj; ++j ) {                                        //  Loop over remaining source bodies
+      P2PLaplaceAVX512Pair(xi,yi,zi,_mm512_set1_ps(Xj[j]),_mm512_set1_ps(Yj[j]),_mm512_set1_ps(Zj[j]),
+                           _mm512_set1_ps(Qj[j]),masked ? ~E[j] : 0xFFFF,pot[0],fx[0],fy[0],fz[0]);
+    }                                                           //  End loop over remaining source bodies
+    _mm512_mask_storeu_ps(Pi+i,mask,_mm512_add_ps(_mm512_maskz_loadu_ps(mask,Pi+i),_mm512_add_ps(pot[0],pot[1])));// Potential
+    _mm512_mask_storeu_ps(Fxi+i,mask,_mm512_sub_ps(_mm512_maskz_loadu_ps(mask,Fxi+i),_mm512_add_ps(fx[0],fx[1])));// x force
+    _mm512_mask_storeu_ps(Fyi+i,mask,_mm512_sub_ps(_mm512_maskz_loadu_ps(mask,Fyi+i),_mm512_add_ps(fy[0],fy[1])));// y force
+    _mm512_mask_storeu_ps(Fzi+i,mask,_mm512_sub_ps(_mm512_maskz_loadu_ps(mask,Fzi+i),_mm512_add_ps(fz[0],fz[1])));// z force
+  }                                                             // End loop over target bodies
+}
+
+//! Mutual Laplace P2P on 4 sources at a time with SSE4.1 (remainder is scalar)
+__attribute__((target("sse4.1")))
+void P2PLaplaceMutualSSE(const real *Xi, const real *Yi, const real *Zi, const real *Qi,
+                         real *Pi, real *Fxi, real *Fyi, real *Fzi, int ni,
+                         const real *Xj, const real *Yj, const real *Zj, const real *Qj,
+                         real *Pj, real *Fxj, real *Fyj, real *Fzj, int nj, bool self) {
+  const __m128 half = _mm_set1_ps(0.5f);                        // 0.5
+  const __m128 three = _mm_set1_ps(3.0f);                       // 3.0
+  const __m128 zero = _mm_setzero_ps();                         // 0.0
+  const __m128 eps2 = _mm_set1_ps(EPS2);                        // Softening
+  for( int i=0; i<ni; ++i ) {                                   // Loop over target bodies
+    const real x = Xi[i] - Xperiodic[0];                        //  Target x coordinate with periodic offset
+    const real y = Yi[i] - Xperiodic[1];                        //  Target y coordinate with periodic offset
+    const real z = Zi[i] - Xperiodic[2];                        //  Target z coordinate with periodic offset
+    const __m128 xi = _mm_set1_ps(x), yi = _mm_set1_ps(y), zi = _mm_set1_ps(z);// Broadcast target coordinates
+    const __m128 qi = _mm_set1_ps(Qi[i]);                       //  Broadcast target value
+    __m128 pot = zero, fx = zero, fy = zero, fz = zero;         //  Initialize potential and force
+    int j = self ? i + 1 : 0;                                   //  Upper triangle if bodies interact with themselves
+    for( ; j+4<=nj; j+=4 ) {                                    //  Loop over source bodies in blocks of 4
+      __m128 dx = _mm_sub_ps(xi,_mm_loadu_ps(Xj+j));            //   x distance from source to target
+      __m128 dy = _mm_sub_ps(yi,_mm_loadu_ps(Yj+j));            //   y distance from source to target
+      __m128 dz = _mm_sub_ps(zi,_mm_loadu_ps(Zj+j));            //   z distance from source to target
+      __m128 R2 = _mm_add_ps(_mm_mul_ps(dx,dx),eps2);           //   R^2
+      R2 = _mm_add_ps(R2,_mm_mul_ps(dy,dy));                    //   R^2
+      R2 = _mm_add_ps(R2,_mm_mul_ps(dz,dz));                    //   R^2
+      __m128 invR = _mm_rsqrt_ps(R2);                           //   Approximate 1 / R
+      invR = _mm_mul_ps(_mm_mul_ps(half,invR),                  //   Newton-Raphson refinement
+                        _mm_sub_ps(three,_mm_mul_ps(R2,_mm_mul_ps(invR,invR))));
+      invR = _mm_and_ps(invR,_mm_cmpgt_ps(R2,zero));            //   Exclude self interaction
+      __m128 invR2 = _mm_mul_ps(invR,invR);                     //   1 / R^2
+      __m128 invRi = _mm_mul_ps(invR,_mm_loadu_ps(Qj+j));       //   potential on target
+      __m128 invRj = _mm_mul_ps(invR,qi);                       //   potential on source
+      __m128 invR3i = _mm_mul_ps(invR2,invRi);                  //   force on target
+      __m128 invR3j = _mm_mul_ps(invR2,invRj);                  //   force on source
+      pot = _mm_add_ps(pot,invRi);                              //   accumulate potential
+      fx = _mm_add_ps(fx,_mm_mul_ps(dx,invR3i));                //   accumulate x component of force
+      fy = _mm_add_ps(fy,_mm_mul_ps(dy,invR3i));                //   accumulate y component of force
+      fz = _mm_add_ps(fz,_mm_mul_ps(dz,invR3i));                //   accumulate z component of force
+      _mm_storeu_ps(Pj+j,_mm_add_ps(_mm_loadu_ps(Pj+j),invRj)); //   potential of source
+      _mm_storeu_ps(Fxj+j,_mm_add_ps(_mm_loadu_ps(Fxj+j),_mm_mul_ps(dx,invR3j)));// x force on source
+      _mm_storeu_ps(Fyj+j,_mm_add_ps(_mm_loadu_ps(Fyj+j),_mm_mul_ps(dy,invR3j)));// y force on source
+      _mm_storeu_ps(Fzj+j,_mm_add_ps(_mm_loadu_ps(Fzj+j),_mm_mul_ps(dz,invR3j)));// z force on source
+    }                                                           //  End loop over source bodies
+    float p[4], f0[4], f1[4], f2[4];                            //  Lanes of accumulators
+    _mm_storeu_ps(p,pot);                                       //  Store potential
+    _mm_storeu_ps(f0,fx);                                       //  Store x component of force
+    _mm_storeu_ps(f1,fy);                                       //  Store y component of force
+    _mm_storeu_ps(f2,fz);                                       //  Store z component of force
+    real P0 = 0, F0 = 0, F1 = 0, F2 = 0;                        //  Horizontal sums
+    for( int l=0; l!=4; ++l ) {                                 //  Loop over lanes
+      P0 += p[l]; F0 += f0[l]; F1 += f1[l]; F2 += f2[l];        //   Sum lanes
+    }                                                           //  End loop over lanes
+    P2PLaplaceMutualScalar(x,y,z,Qi[i],P0,F0,F1,F2,Xj,Yj,Zj,Qj,Pj,Fxj,Fyj,Fzj,j,nj);// Remainder
+    Pi[i] += P0;                                                //  potential
+    Fxi[i] -= F0;                                               //  x component of force
+    Fyi[i] -= F1;                                               //  y component of force
+    Fzi[i] -= F2;                                               //  z component of force
+  }                                                             // End loop over target bodies
+}
+
+//! Mutual Laplace P2P on 8 sources at a time with AVX2 + FMA (remainder is scalar)
+__attribute__((target("avx2,fma")))
+void P2PLaplaceMutualAVX2(const real *Xi, const real *Yi, const real *Zi, const real *Qi,
+                          real *Pi, real *Fxi, real *Fyi, real *Fzi, int ni,
+                          const real *Xj, const real *Yj, const real *Zj, const real *Qj,
+                          real *Pj, real *Fxj, real *Fyj, real *Fzj, int nj, bool self) {
+  const __m256 half = _mm256_set1_ps(0.5f);                     // 0.5
+  const __m256 three = _mm256_set1_ps(3.0f);                    // 3.0
+  const __m256 zero = _mm256_setzero_ps();                      // 0.0
+  const __m256 eps2 = _mm256_set1_ps(EPS2);                     // Softening
+  for( int i=0; i<ni; ++i ) {                                   // Loop over target bodies
+    const real x = Xi[i] - Xperiodic[0];                        //  Target x coordinate with periodic offset
+    const real y = Yi[i] - Xperiodic[1];                        //  Target y coordinate with periodic offset
+    const real z = Zi[i] - Xperiodic[2];                        //  Target z coordinate with periodic offset
+    const __m256 xi = _mm256_set1_ps(x), yi = _mm256_set1_ps(y), zi = _mm256_set1_ps(z);// Broadcast target coordinates
+    const __m256 qi = _mm256_set1_ps(Qi[i]);                    //  Broadcast target value
+    __m256 pot = zero, fx = zero, fy = zero, fz = zero;         //  Initialize potential and force
+    int j = self ? i + 1 : 0;                                   //  Upper triangle if bodies interact with themselves
+    for( ; j+8<=nj; j+=8 ) {                                    //  Loop over source bodies in blocks of 8
+      __m256 dx = _mm256_sub_ps(xi,_mm256_loadu_ps(Xj+j));      //   x distance from source to target
+      __m256 dy = _mm256_sub_ps(yi,_mm256_loadu_ps(Yj+j));      //   y distance from source to target
+      __m256 dz = _mm256_sub_ps(zi,_mm256_loadu_ps(Zj+j));      //   z distance from source to target
+      __m256 R2 = _mm256_fmadd_ps(dx,dx,eps2);                  //   R^2
+      R2 = _mm256_fmadd_ps(dy,dy,R2);                           //   R^2
+      R2 = _mm256_fmadd_ps(dz,dz,R2);                           //   R^2
+      __m256 invR = _mm256_rsqrt_ps(R2);                        //   Approximate 1 / R
+      invR = _mm256_mul_ps(_mm256_mul_ps(half,invR),            //   Newton-Raphson refinement
+                           _mm256_fnmadd_ps(R2,_mm256_mul_ps(invR,invR),three));
+      invR = _mm256_and_ps(invR,_mm256_cmp_ps(R2,zero,_CMP_GT_OQ));//   Exclude self interaction
+      __m256 invR2 = _mm256_mul_ps(invR,invR);                  //   1 / R^2
+      __m256 invRi = _mm256_mul_ps(invR,_mm256_loadu_ps(Qj+j)); //   potential on target
+      __m256 invRj = _mm256_mul_ps(invR,qi);                    //   potential on source
+      __m256 invR3i = _mm256_mul_ps(invR2,invRi);               //   force on target
+      __m256 invR3j = _mm256_mul_ps(invR2,invRj);               //   force on source
+      pot = _mm256_add_ps(pot,invRi);                           //   accumulate potential
+      fx = _mm256_fmadd_ps(dx,invR3i,fx);                       //   accumulate x component of force
+      fy = _mm256_fmadd_ps(dy,invR3i,fy);                       //   accumulate y component of force
+      fz = _mm256_fmadd_ps(dz,invR3i,fz);                       //   accumulate z component of force
+      _mm256_storeu_ps(Pj+j,_mm256_add_ps(_mm256_loadu_ps(Pj+j),invRj));// potential of source
+      _mm256_storeu_ps(Fxj+j,_mm256_fmadd_ps(dx,invR3j,_mm256_loadu_ps(Fxj+j)));// x force on source
+      _mm256_storeu_ps(Fyj+j,_mm256_fmadd_ps(dy,invR3j,_mm256_loadu_ps(Fyj+j)));// y force on source
+      _mm256_storeu_ps(Fzj+j,_mm256_fmadd_ps(dz,invR3j,_mm256_loadu_ps(Fzj+j)));// z force on source
+    }                                                           //  End loop over source bodies
+    float p[8], f0[8], f1[8], f2[8];                            //  Lanes of accumulators
+    _mm256_storeu_ps(p,pot);                                    //  Store potential
+    _mm256_storeu_ps(f0,fx);                                    //  Store x component of force
+    _mm256_storeu_ps(f1,fy);                                    //  Store y component of force
+    _mm256_storeu_ps(f2,fz);                                    //  Store z component of force
+    real P0 = 0, F0 = 0, F1 = 0, F2 = 0;                        //  Horizontal sums
+    for( int l=0; l!=8; ++l ) {                                 //  Loop over lanes
+      P0 += p[l]; F0 += f0[l]; F1 += f1[l]; F2 += f2[l];        //   Sum lanes
+    }                                                           //  End loop over lanes
+    P2PLaplaceMutualScalar(x,y,z,Qi[i],P0,F0,F1,F2,Xj,Yj,Zj,Qj,Pj,Fxj,Fyj,Fzj,j,nj);// Remainder
+    Pi[i] += P0;                                                //  potential
+    Fxi[i] -= F0;                                               //  x component of force
+    Fyi[i] -= F1;                                               //  y component of force
+    Fzi[i] -= F2;                                               //  z component of force
+  }                                                             // End loop over target bodies
+}
+
+//! Sum of the lanes of an AVX-512 vector (extracts with an explicit zero source, unlike _mm512_reduce_add_ps)
+__attribute__((target("avx512f"),always_inline)) inline
+float reduceAVX512(__m512 v) {
+  const __m256d zero = _mm256_setzero_pd();                     // Source of the masked extracts
+  __m256d low = _mm512_mask_extractf64x4_pd(zero,0xF,_mm512_castps_pd(v),0);// Lower 8 lanes
+  __m256d high = _mm512_mask_extractf64x4_pd(zero,0xF,_mm512_castps_pd(v),1);// Upper 8 lanes
+  __m256 sum8 = _mm256_add_ps(_mm256_castpd_ps(low),_mm256_castpd_ps(high));// Sum of halves
+  __m128 sum4 = _mm_add_ps(_mm256_castps256_ps128(sum8),_mm256_extractf128_ps(sum8,1));// Sum of quarters
+  sum4 = _mm_add_ps(sum4,_mm_movehl_ps(sum4,sum4));             // Sum of pairs
+  sum4 = _mm_add_ss(sum4,_mm_movehdup_ps(sum4));                // Sum of all lanes
+  return _mm_cvtss_f32(sum4);                                   // Lowest lane
+}
+
+//! Mutual Laplace P2P on 4 targets x 16 sources at a time with AVX-512F (masked tail)
+__attribute__((target("avx512f")))
+void P2PLaplaceMutualAVX512(const real *Xi, const real *Yi, const real *Zi, const real *Qi,
+                            real *Pi, real *Fxi, real *Fyi, real *Fzi, int ni,
+                            const real *Xj, const real *Yj, const real *Zj, const real *Qj,
+                            real *Pj, real *Fxj, real *Fyj, real *Fzj, int nj, bool self) {
+  const int NI = 4;                                             // Targets sharing each source block
+  const __m512 half = _mm512_set1_ps(0.5f);                     // 0.5
+  const __m512 three = _mm512_set1_ps(3.0f);                    // 3.0
+  const __m512 zero = _mm512_setzero_ps();                      // 0.0
+  const __m512 eps2 = _mm512_set1_ps(EPS2);                     // Softening
+  const __m512i lane = _mm512_set_epi32(15,14,13,12,11,10,9,8,7,6,5,4,3,2,1,0);// Lane index
+  for( int i0=0; i0<ni; i0+=NI ) {                              // Loop over blocks of target bodies
+    __m512 xi[NI], yi[NI], zi[NI], qi[NI];                      //  Broadcast targets
+    __m512 pot[NI], fx[NI], fy[NI], fz[NI];                     //  Target accumulators
+    for( int k=0; k!=NI; ++k ) {                                //  Loop over targets in block
+      const int i = i0 + k < ni ? i0 + k : i0;                  //   Repeat first target past the end (charge 0)
+      xi[k] = _mm512_set1_ps(Xi[i] - Xperiodic[0]);             //   Target x coordinate with periodic offset
+      yi[k] = _mm512_set1_ps(Yi[i] - Xperiodic[1]);             //   Target y coordinate with periodic offset
+      zi[k] = _mm512_set1_ps(Zi[i] - Xperiodic[2]);             //   Target z coordinate with periodic offset
+      qi[k] = _mm512_set1_ps(i0 + k < ni ? Qi[i] : 0);          //   Broadcast target value
+      pot[k] = fx[k] = fy[k] = fz[k] = zero;                    //   Initialize potential and force
+    }                                                           //  End loop over targets in block
+    for( int j=self ? i0+1 : 0; j<nj; j+=16 ) {                 //  Loop over source bodies in blocks of 16
+      const __mmask16 mask = nj - j >= 16 ? 0xFFFF : (1 << (nj - j)) - 1;// Mask of active lanes
+      const __m512 xj = _mm512_maskz_loadu_ps(mask,Xj+j);       //   Source x coordinates
+      const __m512 yj = _mm512_maskz_loadu_ps(mask,Yj+j);       //   Source y coordinates
+      const __m512 zj = _mm512_maskz_loadu_ps(mask,Zj+j);       //   Source z coordinates
+      const __m512 qj = _mm512_maskz_loadu_ps(mask,Qj+j);       //   Source values
+      __m512 pj = zero, fxj = zero, fyj = zero, fzj = zero;     //   Source accumulators
+      const __m512i jidx = _mm512_add_epi32(_mm512_set1_epi32(j),lane);// Source indices
+      for( int k=0; k!=NI; ++k ) {                              //   Loop over targets in block
+        __mmask16 active = mask;                                //    Active lanes
+        if( self ) active &= _mm512_cmpgt_epi32_mask(jidx,_mm512_set1_epi32(i0+k));// Upper triangle only
+        __m512 dx = _mm512_sub_ps(xi[k],xj);                    //    x distance from source to target
+        __m512 dy = _mm512_sub_ps(yi[k],yj);                    //    y distance from source to target
+        __m512 dz = _mm512_sub_ps(zi[k],zj);                    //    z distance from source to target
+        __m512 R2 = _mm512_fmadd_ps(dx,dx,eps2);                //    R^2
+        R2 = _mm512_fmadd_ps(dy,dy,R2);                         //    R^2
+        R2 = _mm512_fmadd_ps(dz,dz,R2);                         //    R^2
+        active &= _mm512_cmp_ps_mask(R2,zero,_CMP_GT_OQ);       //    Exclude self interaction
+        __m512 invR = _mm512_maskz_rsqrt14_ps(active,R2);       //    Approximate 1 / R
+        invR = _mm512_mul_ps(_mm512_mul_ps(half,invR),          //    Newton-Raphson refinement
+                             _mm512_fnmadd_ps(R2,_mm512_mul_ps(invR,invR),three));
+        __m512 invR2 = _mm512_mul_ps(invR,invR);                //    1 / R^2
+        __m512 invRi = _mm512_mul_ps(invR,qj);                  //    potential on target
+        __m512 invRj = _mm512_mul_ps(invR,qi[k]);               //    potential on source
+        __m512 invR3i = _mm512_mul_ps(invR2,invRi);             //    force on target
+        __m512 invR3j = _mm512_mul_ps(invR2,invRj);             //    force on source
+        pot[k] = _mm512_add_ps(pot[k],invRi);                   //    accumulate potential
+        fx[k] = _mm512_fmadd_ps(dx,invR3i,fx[k]);               //    accumulate x component of force
+        fy[k] = _mm512_fmadd_ps(dy,invR3i,fy[k]);               //    accumulate y component of force
+        fz[k] = _mm512_fmadd_ps(dz,invR3i,fz[k]);               //    accumulate z component of force
+        pj = _mm512_add_ps(pj,invRj);                           //    potential of source
+        fxj = _mm512_fmadd_ps(dx,invR3j,fxj);                   //    x component of force on source
+        fyj = _mm512_fmadd_ps(dy,invR3j,fyj);                   //    y component of force on source
+        fzj = _mm512_fmadd_ps(dz,invR3j,fzj);                   //    z component of force on source
+      }                                                         //   End loop over targets in block
+      _mm512_mask_storeu_ps(Pj+j,mask,_mm512_add_ps(_mm512_maskz_loadu_ps(mask,Pj+j),pj));// potential of source
+      _mm512_mask_storeu_ps(Fxj+j,mask,_mm512_add_ps(_mm512_maskz_loadu_ps(mask,Fxj+j),fxj));// x force on source
+      _mm512_mask_storeu_ps(Fyj+j,mask,_mm512_add_ps(_mm512_maskz_loadu_ps(mask,Fyj+j),fyj));// y force on source
+      _mm512_mask_storeu_ps(Fzj+j,mask,_mm512_add_ps(_mm512_maskz_loadu_ps(mask,Fzj+j),fzj));// z force on source
+    }                                                           //  End loop over source bodies
+    for( int k=0; k!=NI && i0+k<ni; ++k ) {                     //  Loop over targets in block
+      Pi[i0+k] += reduceAVX512(pot[k]);                 //   potential
+      Fxi[i0+k] -= reduceAVX512(fx[k]);                 //   x component of force
+      Fyi[i0+k] -= reduceAVX512(fy[k]);                 //   y component of force
+      Fzi[i0+k] -= reduceAVX512(fz[k]);                 //   z component of force
+    }                                                           //  End loop over targets in block
+  }                                                             // End loop over blocks of target bodies
+}
+
+//! Van der Waals P2P on 4 targets at a time with SSE4.1 (cutoff as mask)
+__attribute__((target("sse4.1")))
+void P2PVanDerWaalsSSE(const real *Xi, const real *Yi, const real *Zi, const real *Ti,
+                       real *Pi, real *Fxi, real *Fyi, real *Fzi, int ni,
+                       const real *Xj, const real *Yj, const real *Zj, const real *Tj, int nj,
+                       const real *rscale, const real *gscale, int atoms) {
+  const __m128 one = _mm_set1_ps(1.0f);                         // 1.0
+  const __m128 two = _mm_set1_ps(2.0f);                         // 2.0
+  const __m128 zero = _mm_setzero_ps();                         // 0.0
+  const __m128 r2min = _mm_set1_ps(R2MIN);                      // Minimum R^2
+  const __m128 r2max = _mm_set1_ps(R2MAX);                      // Maximum R^2
+  for( int i=0; i<ni; i+=4 ) {                                  // Loop over target bodies in blocks of 4
+    const int n = std::min(4,ni-i);                             //  Number of active lanes
+    float x[4] = {0}, y[4] = {0}, z[4] = {0};                   //  Target coordinates with padded tail
+    int offset[4] = {0};                                        //  Offset of target atom type in parameter table
+    for( int l=0; l!=n; ++l ) {                                 //  Loop over active lanes
+      x[l] = Xi[i+l] - Xperiodic[0];                            //   Target x coordinate with periodic offset
+      y[l] = Yi[i+l] - Xperiodic[1];                            //   Target y coordinate with periodic offset
+      z[l] = Zi[i+l] - Xperiodic[2];                            //   Target z coordinate with periodic offset
+      offset[l] = int(Ti[i+l]) * atoms;                         //   Row of target atom type
+    }                                                           //  End loop over active lanes
+    const __m128 xi = _mm_loadu_ps(x);                          //  Target x coordinates
+    const __m128 yi = _mm_loadu_ps(y);                          //  Target y coordinates
+    const __m128 zi = _mm_loadu_ps(z);                          //  Target z coordinates
+    __m128 pot = zero, fx = zero, fy = zero, fz = zero;         //  Initialize potential and force
+    for( int j=0; j<nj; ++j ) {                                 //  Loop over source bodies
+      const int atypej = int(Tj[j]);                            //   Atom type of source
+      float r[4], g[4];                                         //   Gathered parameters
+      for( int l=0; l!=4; ++l ) {                               //   Loop over lanes
+        r[l] = rscale[offset[l]+atypej];                        //    r scale
+        g[l] = gscale[offset[l]+atypej];                        //    g scale
+      }                                                         //   End loop over lanes
+      __m128 dx = _mm_sub_ps(xi,_mm_set1_ps(Xj[j]));            //   x distance from source to target
+      __m128 dy = _mm_sub_ps(yi,_mm_set1_ps(Yj[j]));            //   y distance from source to target
+      __m128 dz = _mm_sub_ps(zi,_mm_set1_ps(Zj[j]));            //   z distance from source to target
+      __m128 R2 = _mm_mul_ps(dx,dx);                            //   R^2
+      R2 = _mm_add_ps(R2,_mm_mul_ps(dy,dy));                    //   R^2
+      R2 = _mm_add_ps(R2,_mm_mul_ps(dz,dz));                    //   R^2
+      __m128 mask = _mm_and_ps(_mm_cmpge_ps(R2,r2min),_mm_cmplt_ps(R2,r2max));// Cutoff mask
+      mask = _mm_and_ps(mask,_mm_cmpneq_ps(R2,zero));           //   Exclude self interaction
+      __m128 gs = _mm_and_ps(_mm_loadu_ps(g),mask);             //   g scale (zero outside cutoff)
+      R2 = _mm_blendv_ps(one,R2,mask);                          //   Keep masked lanes finite
+      __m128 invR2 = _mm_div_ps(one,_mm_mul_ps(R2,_mm_loadu_ps(r)));//   1 / (R^2 * r scale)
+      __m128 invR6 = _mm_mul_ps(_mm_mul_ps(invR2,invR2),invR2); //   1 / R^6
+      __m128 gR6 = _mm_mul_ps(gs,invR6);                        //   g scale / R^6
+      __m128 dtmp = _mm_mul_ps(_mm_mul_ps(gR6,invR2),_mm_sub_ps(_mm_mul_ps(two,invR6),one));// Force scale
+      pot = _mm_add_ps(pot,_mm_mul_ps(gR6,_mm_sub_ps(invR6,one)));//  accumulate potential
+      fx = _mm_add_ps(fx,_mm_mul_ps(dx,dtmp));                  //   accumulate x component of force
+      fy = _mm_add_ps(fy,_mm_mul_ps(dy,dtmp));                  //   accumulate y component of force
+      fz = _mm_add_ps(fz,_mm_mul_ps(dz,dtmp));                  //   accumulate z component of force
+    }                                                           //  End loop over source bodies
+    _mm_storeu_ps(x,pot);                                       //  Store potential
+    for( int l=0; l!=n; ++l ) Pi[i+l] += x[l];                  //  Accumulate potential of active lanes
+    _mm_storeu_ps(x,fx);                                        //  Store x component of force
+    for( int l=0; l!=n; ++l ) Fxi[i+l] -= x[l];                 //  Accumulate x force of active lanes
+    _mm_storeu_ps(x,fy);                                        //  Store y component of force
+    for( int l=0; l!=n; ++l ) Fyi[i+l] -= x[l];                 //  Accumulate y force of active lanes
+    _mm_storeu_ps(x,fz);                                        //  Store z component of force
+    for( int l=0; l!=n; ++l ) Fzi[i+l] -= x[l];                 //  Accumulate z force of active lanes
+  }                                                             // End loop over target bodies
+}
+
+//! Van der Waals P2P on 8 targets at a time with AVX2 (gathered parameters, cutoff as mask)
+__attribute__((target("avx2,fma")))
+void P2PVanDerWaalsAVX2(const real *Xi, const real *Yi, const real *Zi, const real *Ti,
+                        real *Pi, real *Fxi, real *Fyi, real *Fzi, int ni,
+                        const real *Xj, const real *Yj, const real *Zj, const real *Tj, int nj,
+                        const real *rscale, const real *gscale, int atoms) {
+  const __m256 one = _mm256_set1_ps(1.0f);                      // 1.0
+  const __m256 two = _mm256_set1_ps(2.0f);                      // 2.0
+  const __m256 zero = _mm256_setzero_ps();                      // 0.0
+  const __m256 r2min = _mm256_set1_ps(R2MIN);                   // Minimum R^2
+  const __m256 r2max = _mm256_set1_ps(R2MAX);                   // Maximum R^2
+  const __m256i lane = _mm256_setr_epi32(0,1,2,3,4,5,6,7);      // Lane index
+  for( int i=0; i<ni; i+=8 ) {                                  // Loop over target bodies in blocks of 8
+    const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(ni-i),lane);// Mask of active lanes
+    const __m256 xi = _mm256_sub_ps(_mm256_maskload_ps(Xi+i,mask),_mm256_set1_ps(Xperiodic[0]));// Target x
+    const __m256 yi = _mm256_sub_ps(_mm256_maskload_ps(Yi+i,mask),_mm256_set1_ps(Xperiodic[1]));// Target y
+    const __m256 zi = _mm256_sub_ps(_mm256_maskload_ps(Zi+i,mask),_mm256_set1_ps(Xperiodic[2]));// Target z
+    const __m256i offset = _mm256_mullo_epi32(_mm256_cvttps_epi32(_mm256_maskload_ps(Ti+i,mask)),
+                                              _mm256_set1_epi32(atoms));// Row of target atom type
+    __m256 pot = zero, fx = zero, fy = zero, fz = zero;         //  Initialize potential and force
+    for( int j=0; j<nj; ++j ) {                                 //  Loop over source bodies
+      const __m256i index = _mm256_add_epi32(offset,_mm256_set1_epi32(int(Tj[j])));// Parameter index
+      const __m256 rs = _mm256_i32gather_ps(rscale,index,4);    //   Gather r scale
+      const __m256 gs = _mm256_i32gather_ps(gscale,index,4);    //   Gather g scale
+      __m256 dx = _mm256_sub_ps(xi,_mm256_broadcast_ss(Xj+j));  //   x distance from source to target
+      __m256 dy = _mm256_sub_ps(yi,_mm256_broadcast_ss(Yj+j));  //   y distance from source to target
+      __m256 dz = _mm256_sub_ps(zi,_mm256_broadcast_ss(Zj+j));  //   z distance from source to target
+      __m256 R2 = _mm256_mul_ps(dx,dx);                         //   R^2
+      R2 = _mm256_fmadd_ps(dy,dy,R2);                           //   R^2
+      R2 = _mm256_fmadd_ps(dz,dz,R2);                           //   R^2
+      __m256 cut = _mm256_and_ps(_mm256_cmp_ps(R2,r2min,_CMP_GE_OQ),_mm256_cmp_ps(R2,r2max,_CMP_LT_OQ));// Cutoff
+      cut = _mm256_and_ps(cut,_mm256_cmp_ps(R2,zero,_CMP_NEQ_OQ));//  Exclude self interaction
+      R2 = _mm256_blendv_ps(one,R2,cut);                        //   Keep masked lanes finite
+      __m256 invR2 = _mm256_div_ps(one,_mm256_mul_ps(R2,rs));   //   1 / (R^2 * r scale)
+      __m256 invR6 = _mm256_mul_ps(_mm256_mul_ps(invR2,invR2),invR2);//  1 / R^6
+      __m256 gR6 = _mm256_mul_ps(_mm256_and_ps(gs,cut),invR6);  //   g scale / R^6 (zero outside cutoff)
+      __m256 dtmp = _mm256_mul_ps(_mm256_mul_ps(gR6,invR2),_mm256_fmsub_ps(two,invR6,one));// Force scale
+      pot = _mm256_fmadd_ps(gR6,_mm256_sub_ps(invR6,one),pot);  //   accumulate potential
+      fx = _mm256_fmadd_ps(dx,dtmp,fx);                         //   accumulate x component of force
+      fy = _mm256_fmadd_ps(dy,dtmp,fy);                         //   accumulate y component of force
+      fz = _mm256_fmadd_ps(dz,dtmp,fz);                         //   accumulate z component of force
+    }                                                           //  End loop over source bodies
+    _mm256_maskstore_ps(Pi+i,mask,_mm256_add_ps(_mm256_maskload_ps(Pi+i,mask),pot));// Accumulate potential
+    _mm256_maskstore_ps(Fxi+i,mask,_mm256_sub_ps(_mm256_maskload_ps(Fxi+i,mask),fx));// Accumulate x force
+    _mm256_maskstore_ps(Fyi+i,mask,_mm256_sub_ps(_mm256_maskload_ps(Fyi+i,mask),fy));// Accumulate y force
+    _mm256_maskstore_ps(Fzi+i,mask,_mm256_sub_ps(_mm256_maskload_ps(Fzi+i,mask),fz));// Accumulate z force
+  }                                                             // End loop over target bodies
+}
+
+//! Van der Waals P2P on 16 targets at a time with AVX-512F (gathered parameters, cutoff as mask)
+__attribute__((target("avx512f")))
+void P2PVanDerWaalsAVX512(const real *Xi, const real *Yi, const real *Zi, const real *Ti,
+                          real *Pi, real *Fxi, real *Fyi, real *Fzi, int ni,
+                          const real *Xj, const real *Yj, const real *Zj, const real *Tj, int nj,
+                          const real *rscale, const real *gscale, int atoms) {
+  const __m512 one = _mm512_set1_ps(1.0f);                      // 1.0
+  const __m512 two = _mm512_set1_ps(2.0f);                      // 2.0
+  const __m512 zero = _mm512_setzero_ps();                      // 0.0
+  const __m512 r2min = _mm512_set1_ps(R2MIN);                   // Minimum R^2
+  const __m512 r2max = _mm512_set1_ps(R2MAX);                   // Maximum R^2
+  for( int i=0; i<ni; i+=16 ) {                                 // Loop over target bodies in blocks of 16
+    const __mmask16 mask = ni - i >= 16 ? 0xFFFF : (1 << (ni - i)) - 1;// Mask of active lanes
+    const __m512 xi = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask,Xi+i),_mm512_set1_ps(Xperiodic[0]));// Target x
+    const __m512 yi = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask,Yi+i),_mm512_set1_ps(Xperiodic[1]));// Target y
+    const __m512 zi = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask,Zi+i),_mm512_set1_ps(Xperiodic[2]));// Target z
+    const __m512i offset = _mm512_mullo_epi32(_mm512_maskz_cvttps_epi32(mask,_mm512_maskz_loadu_ps(mask,Ti+i)),
+                                              _mm512_set1_epi32(atoms));// Row of target atom type
+    __m512 pot = zero, fx = zero, fy = zero, fz = zero;         //  Initialize potential and force
+    for( int j=0; j<nj; ++j ) {                                 //  Loop over source bodies
+      const __m512i index = _mm512_add_epi32(offset,_mm512_set1_epi32(int(Tj[j])));// Parameter index
+      const __m512 rs = _mm512_mask_i32gather_ps(one,mask,index,rscale,4);// Gather r scale
+      const __m512 gs = _mm512_mask_i32gather_ps(zero,mask,index,gscale,4);// Gather g scale
+      __m512 dx = _mm512_sub_ps(xi,_mm512_set1_ps(Xj[j]));      //   x distance from source to target
+      __m512 dy = _mm512_sub_ps(yi,_mm512_set1_ps(Yj[j]));      //   y distance from source to target
+      __m512 dz = _mm512_sub_ps(zi,_mm512_set1_ps(Zj[j]));      //   z distance from source to target
+      __m512 R2 = _mm512_mul_ps(dx,dx);                         //   R^2
+      R2 = _mm512_fmadd_ps(dy,dy,R2);                           //   R^2
+      R2 = _mm512_fmadd_ps(dz,dz,R2);                           //   R^2
+      __mmask16 cut = _mm512_cmp_ps_mask(R2,r2min,_CMP_GE_OQ)   //   Cutoff mask
+                    & _mm512_cmp_ps_mask(R2,r2max,_CMP_LT_OQ)
+                    & _mm512_cmp_ps_mask(R2,zero,_CMP_NEQ_OQ);  //   Exclude self interaction
+      R2 = _mm512_mask_blend_ps(cut,one,R2);                    //   Keep masked lanes finite
+      __m512 invR2 = _mm512_div_ps(one,_mm512_mul_ps(R2,rs));   //   1 / (R^2 * r scale)
+      __m512 invR6 = _mm512_mul_ps(_mm512_mul_ps(invR2,invR2),invR2);//  1 / R^6
+      __m512 gR6 = _mm512_maskz_mul_ps(cut,gs,invR6);           //   g scale / R^6 (zero outside cutoff)
+      __m512 dtmp = _mm512_mul_ps(_mm512_mul_ps(gR6,invR2),_mm512_fmsub_ps(two,invR6,one));// Force scale
+      pot = _mm512_fmadd_ps(gR6,_mm512_sub_ps(invR6,one),pot);  //   accumulate potential
+      fx = _mm512_fmadd_ps(dx,dtmp,fx);                         //   accumulate x component of force
+      fy = _mm512_fmadd_ps(dy,dtmp,fy);                         //   accumulate y component of force
+      fz = _mm512_fmadd_ps(dz,dtmp,fz);                         //   accumulate z component of force
+    }                                                           //  End loop over source bodies
+    _mm512_mask_storeu_ps(Pi+i,mask,_mm512_add_ps(_mm512_maskz_loadu_ps(mask,Pi+i),pot));// Accumulate potential
+    _mm512_mask_storeu_ps(Fxi+i,mask,_mm512_sub_ps(_mm512_maskz_loadu_ps(mask,Fxi+i),fx));// Accumulate x force
+    _mm512_mask_storeu_ps(Fyi+i,mask,_mm512_sub_ps(_mm512_maskz_loadu_ps(mask,Fyi+i),fy));// Accumulate y force
+    _mm512_mask_storeu_ps(Fzi+i,mask,_mm512_sub_ps(_mm512_maskz_loadu_ps(mask,Fzi+i),fz));// Accumulate z force
+  }                                                             // End loop over target bodies
+}
+
+//! Laplace + Van der Waals P2P on 8 targets at a time with AVX2 (gathered parameters, cutoff as mask)
+__attribute__((target("avx2,fma")))
+void P2PCoulombVanDerWaalsAVX2(CoulombVanDerWaalsSoA &ibodies, const CoulombVanDerWaalsSoA &jbodies,
+                               const real *rscale, const real *gscale, int atoms) {
+  const __m256 half = _mm256_set1_ps(0.5f);                     // 0.5
+  const __m256 one = _mm256_set1_ps(1.0f);                      // 1.0
+  const __m256 two = _mm256_set1_ps(2.0f);                      // 2.0
+  const __m256 three = _mm256_set1_ps(3.0f);                    // 3.0
+  const __m256 zero = _mm256_setzero_ps();                      // 0.0
+  const __m256 eps2 = _mm256_set1_ps(EPS2);                     // Softening
+  const __m256 r2min = _mm256_set1_ps(R2MIN);                   // Minimum R^2
+  const __m256 r2max = _mm256_set1_ps(R2MAX);                   // Maximum R^2
+  const __m256i lane = _mm256_setr_epi32(0,1,2,3,4,5,6,7);      // Lane index
+  const int ni = ibodies.size(), nj = jbodies.size();           // Number of target and source bodies
+  for( int i=0; i<ni; i+=8 ) {                                  // Loop over target bodies in blocks of 8
+    const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(ni-i),lane);// Mask of active lanes
+    const __m256 xi = _mm256_sub_ps(_mm256_maskload_ps(&ibodies.X[0][i],mask),_mm256_set1_ps(Xperiodic[0]));// Target x
+    const __m256 yi = _mm256_sub_ps(_mm256_maskload_ps(&ibodies.X[1][i],mask),_mm256_set1_ps(Xperiodic[1]));// Target y
+    const __m256 zi = _mm256_sub_ps(_mm256_maskload_ps(&ibodies.X[2][i],mask),_mm256_set1_ps(Xperiodic[2]));// Target z
+    const __m256i offset = _mm256_mullo_epi32(_mm256_maskload_epi32(&ibodies.ATYPE[i],mask),
+                                              _mm256_set1_epi32(atoms));// Row of target atom type
+    __m256 pot = zero, fx = zero, fy = zero, fz = zero;         //  Initialize Coulomb potential and force
+    __m256 vpot = zero, gx = zero, gy = zero, gz = zero;        //  Initialize Van der Waals potential and force
+    for( int j=0; j<nj; ++j ) {                                 //  Loop over source bodies
+      __m256 dx = _mm256_sub_ps(xi,_mm256_broadcast_ss(&jbodies.X[0][j]));// x distance from source to target
+      __m256 dy = _mm256_sub_ps(yi,_mm256_broadcast_ss(&jbodies.X[1][j]));// y distance from source to target
+      __m256 dz = _mm256_sub_ps(zi,_mm256_broadcast_ss(&jbodies.X[2][j]));// z distance from source to target
+      __m256 R2 = _mm256_mul_ps(dx,dx);                         //   R^2
+      R2 = _mm256_fmadd_ps(dy,dy,R2);                           //   R^2
+      R2 = _mm256_fmadd_ps(dz,dz,R2);                           //   R^2
+      __m256 R2e = _mm256_add_ps(R2,eps2);                      //   Softened R^2 for Coulomb
+      __m256 invR = _mm256_rsqrt_ps(R2e);                       //   Approximate 1 / R
+      invR = _mm256_mul_ps(_mm256_mul_ps(half,invR),            //   Newton-Raphson refinement
+                           _mm256_fnmadd_ps(R2e,_mm256_mul_ps(invR,invR),three));
+      invR = _mm256_and_ps(invR,_mm256_cmp_ps(R2e,zero,_CMP_GT_OQ));//   Exclude self interaction
+      __m256 invRq = _mm256_mul_ps(invR,_mm256_broadcast_ss(&jbodies.SRC[j]));// Coulomb potential
+      __m256 invR3 = _mm256_mul_ps(_mm256_mul_ps(invR,invR),invRq);//   Coulomb force scale
+      pot = _mm256_add_ps(pot,invRq);                           //   accumulate Coulomb potential
+      fx = _mm256_fmadd_ps(dx,invR3,fx);                        //   accumulate x component of Coulomb force
+      fy = _mm256_fmadd_ps(dy,invR3,fy);                        //   accumulate y component of Coulomb force
+      fz = _mm256_fmadd_ps(dz,invR3,fz);                        //   accumulate z component of Coulomb force
+      __m256 cut = _mm256_and_ps(_mm256_cmp_ps(R2,r2min,_CMP_GE_OQ),_mm256_cmp_ps(R2,r2max,_CMP_LT_OQ));// Cutoff
+      cut = _mm256_and_ps(cut,_mm256_cmp_ps(R2,zero,_CMP_NEQ_OQ));//  Exclude self interaction
+      if( _mm256_movemask_ps(cut) == 0 ) continue;              //   Skip Van der Waals outside the cutoff
+      const __m256i index = _mm256_add_epi32(offset,_mm256_set1_epi32(jbodies.ATYPE[j]));// Parameter index
+      const __m256 rs = _mm256_i32gather_ps(rscale,index,4);    //   Gather r scale
+      const __m256 gs = _mm256_i32gather_ps(gscale,index,4);    //   Gather g scale
+      R2 = _mm256_blendv_ps(one,R2,cut);                        //   Keep masked lanes finite
+      __m256 invR2 = _mm256_div_ps(one,_mm256_mul_ps(R2,rs));   //   1 / (R^2 * r scale)
+      __m256 invR6 = _mm256_mul_ps(_mm256_mul_ps(invR2,invR2),invR2);//  1 / R^6
+      __m256 gR6 = _mm256_mul_ps(_mm256_and_ps(gs,cut),invR6);  //   g scale / R^6 (zero outside cutoff)
+      __m256 dtmp = _mm256_mul_ps(_mm256_mul_ps(gR6,invR2),_mm256_fmsub_ps(two,invR6,one));// Force scale
+      vpot = _mm256_fmadd_ps(gR6,_mm256_sub_ps(invR6,one),vpot);//   accumulate Van der Waals potential
+      gx = _mm256_fmadd_ps(dx,dtmp,gx);                         //   accumulate x component of Van der Waals force
+      gy = _mm256_fmadd_ps(dy,dtmp,gy);                         //   accumulate y component of Van der Waals force
+      gz = _mm256_fmadd_ps(dz,dtmp,gz);                         //   accumulate z component of Van der Waals force
+    }                                                           //  End loop over source bodies
+    const __m256 trg[8] = {pot,fx,fy,fz,vpot,gx,gy,gz};         //  Accumulators in output order
+    for( int d=0; d!=8; ++d ) {                                 //  Loop over target values
+      real *p = d < 4 ? &ibodies.TRG[d][i] : &ibodies.VDW[d-4][i];// Coulomb then Van der Waals
+      __m256 v = d % 4 == 0 ? trg[d] : _mm256_sub_ps(zero,trg[d]);// Force is accumulated with opposite sign
+      _mm256_maskstore_ps(p,mask,_mm256_add_ps(_mm256_maskload_ps(p,mask),v));// Accumulate active lanes
+    }                                                           //  End loop over target values
+  }                                                             // End loop over target bodies
+}
+
+//! Laplace + Van der Waals P2P on 16 targets at a time with AVX-512F (gathered parameters, cutoff as mask)
+__attribute__((target("avx512f")))
+void P2PCoulombVanDerWaalsAVX512(CoulombVanDerWaalsSoA &ibodies, const CoulombVanDerWaalsSoA &jbodies,
+                                 const real *rscale, const real *gscale, int atoms) {
+  const __m512 half = _mm512_set1_ps(0.5f);                     // 0.5
+  const __m512 one = _mm512_set1_ps(1.0f);                      // 1.0
+  const __m512 two = _mm512_set1_ps(2.0f);                      // 2.0
+  const __m512 three = _mm512_set1_ps(3.0f);                    // 3.0
+  const __m512 zero = _mm512_setzero_ps();                      // 0.0
+  const __m512 eps2 = _mm512_set1_ps(EPS2);                     // Softening
+  const __m512 r2min = _mm512_set1_ps(R2MIN);                   // Minimum R^2
+  const __m512 r2max = _mm512_set1_ps(R2MAX);                   // Maximum R^2
+  const int ni = ibodies.size(), nj = jbodies.size();           // Number of target and source bodies
+  for( int i=0; i<ni; i+=16 ) {                                 // Loop over target bodies in blocks of 16
+    const __mmask16 mask = ni - i >= 16 ? 0xFFFF : (1 << (ni - i)) - 1;// Mask of active lanes
+    const __m512 xi = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask,&ibodies.X[0][i]),_mm512_set1_ps(Xperiodic[0]));// Target x
+    const __m512 yi = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask,&ibodies.X[1][i]),_mm512_set1_ps(Xperiodic[1]));// Target y
+    const __m512 zi = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask,&ibodies.X[2][i]),_mm512_set1_ps(Xperiodic[2]));// Target z
+    const __m512i offset = _mm512_mullo_epi32(_mm512_maskz_loadu_epi32(mask,&ibodies.ATYPE[i]),
+                                              _mm512_set1_epi32(atoms));// Row of target atom type
+    __m512 pot = zero, fx = zero, fy = zero, fz = zero;         //  Initialize Coulomb potential and force
+    __m512 vpot = zero, gx = zero, gy = zero, gz = zero;        //  Initialize Van der Waals potential and force
+    for( int j=0; j<nj; ++j ) {                                 //  Loop over source bodies
+      __m512 dx = _mm512_sub_ps(xi,_mm512_set1_ps(jbodies.X[0][j]));// x distance from source to target
+      __m512 dy = _mm512_sub_ps(yi,_mm512_set1_ps(jbodies.X[1][j]));// y distance from source to target
+      __m512 dz = _mm512_sub_ps(zi,_mm512_set1_ps(jbodies.X[2][j]));// z distance from source to target
+      __m512 R2 = _mm512_mul_ps(dx,dx);                         //   R^2
+      R2 = _mm512_fmadd_ps(dy,dy,R2);                           //   R^2
+      R2 = _mm512_fmadd_ps(dz,dz,R2);                           //   R^2
+      __m512 R2e = _mm512_add_ps(R2,eps2);                      //   Softened R^2 for Coulomb
+      __m512 invR = _mm512_maskz_rsqrt14_ps(_mm512_cmp_ps_mask(R2e,zero,_CMP_GT_OQ),R2e);// Approximate 1 / R
+      invR = _mm512_mul_ps(_mm512_mul_ps(half,invR),            //   Newton-Raphson refinement
+                           _mm512_fnmadd_ps(R2e,_mm512_mul_ps(invR,invR),three));
+      __m512 invRq = _mm512_mul_ps(invR,_mm512_set1_ps(jbodies.SRC[j]));// Coulomb potential
+      __m512 invR3 = _mm512_mul_ps(_mm512_mul_ps(invR,invR),invRq);//   Coulomb force scale
+      pot = _mm512_add_ps(pot,invRq);                           //   accumulate Coulomb potential
+      fx = _mm512_fmadd_ps(dx,invR3,fx);                        //   accumulate x component of Coulomb force
+      fy = _mm512_fmadd_ps(dy,invR3,fy);                        //   accumulate y component of Coulomb force
+      fz = _mm512_fmadd_ps(dz,invR3,fz);                        //   accumulate z component of Coulomb force
+      __mmask16 cut = _mm512_cmp_ps_mask(R2,r2min,_CMP_GE_OQ)   //   Cutoff mask
+                    & _mm512_cmp_ps_mask(R2,r2max,_CMP_LT_OQ)
+                    & _mm512_cmp_ps_mask(R2,zero,_CMP_NEQ_OQ);  //   Exclude self interaction
+      if( cut == 0 ) continue;                                  //   Skip Van der Waals outside the cutoff
+      const __m512i index = _mm512_add_epi32(offset,_mm512_set1_epi32(jbodies.ATYPE[j]));// Parameter index
+      const __m512 rs = _mm512_mask_i32gather_ps(one,cut,index,rscale,4);// Gather r scale
+      const __m512 gs = _mm512_mask_i32gather_ps(zero,cut,index,gscale,4);// Gather g scale
+      R2 = _mm512_mask_blend_ps(cut,one,R2);                    //   Keep masked lanes finite
+      __m512 invR2 = _mm512_div_ps(one,_mm512_mul_ps(R2,rs));   //   1 / (R^2 * r scale)
+      __m512 invR6 = _mm512_mul_ps(_mm512_mul_ps(invR2,invR2),invR2);//  1 / R^6
+      __m512 gR6 = _mm512_mul_ps(gs,invR6);                     //   g scale / R^6 (zero outside cutoff)
+      __m512 dtmp = _mm512_mul_ps(_mm512_mul_ps(gR6,invR2),_mm512_fmsub_ps(two,invR6,one));// Force scale
+      vpot = _mm512_fmadd_ps(gR6,_mm512_sub_ps(invR6,one),vpot);//   accumulate Van der Waals potential
+      gx = _mm512_fmadd_ps(dx,dtmp,gx);                         //   accumulate x component of Van der Waals force
+      gy = _mm512_fmadd_ps(dy,dtmp,gy);                         //   accumulate y component of Van der Waals force
+      gz = _mm512_fmadd_ps(dz,dtmp,gz);                         //   accumulate z component of Van der Waals force
+    }                                                           //  End loop over source bodies
+    const __m512 trg[8] = {pot,fx,fy,fz,vpot,gx,gy,gz};         //  Accumulators in output order
+    for( int d=0; d!=8; ++d ) {                                 //  Loop over target values
+      real *p = d < 4 ? &ibodies.TRG[d][i] : &ibodies.VDW[d-4][i];// Coulomb then Van der Waals
+      __m512 v = d % 4 == 0 ? trg[d] : _mm512_sub_ps(zero,trg[d]);// Force is accumulated with opposite sign
+      _mm512_mask_storeu_ps(p,mask,_mm512_add_ps(_mm512_maskz_loadu_ps(mask,p),v));// Accumulate active lanes
+    }                                                           //  End loop over target values
+  }                                                             // End loop over target bodies
+}
+#else
+//! One source against 2 targets in double precision with SSE4.1 (sqrt and division, keep is zero for excluded pairs)
+template<bool masked>
+__attribute__((target("sse4.1"),always_inline)) inline
+void P2PLaplaceSSEPair(__m128d xi, __m128d yi, __m128d zi, __m128d xj, __m128d yj, __m128d zj, __m128d qj, __m128d keep,
+                       __m128d &pot, __m128d &fx, __m128d &fy, __m128d &fz) {
+  __m128d dx = _mm_sub_pd(xi,xj);                               // x distance from source to target
+  __m128d dy = _mm_sub_pd(yi,yj);                               // y distance from source to target
+  __m128d dz = _mm_sub_pd(zi,zj);                               // z distance from source to target
+  __m128d R2 = _mm_add_pd(_mm_mul_pd(dx,dx),_mm_set1_pd(EPS2)); // R^2
+  R2 = _mm_add_pd(R2,_mm_mul_pd(dy,dy));                        // R^2
+  R2 = _mm_add_pd(R2,_mm_mul_pd(dz,dz));                        // R^2
+  __m128d nonzero = _mm_cmpgt_pd(R2,_mm_setzero_pd());          // Exclude self interaction
+  if( masked ) nonzero = _mm_and_pd(nonzero,keep);              // Skip excluded pairs
+  __m128d invR = _mm_div_pd(_mm_set1_pd(1.0),_mm_sqrt_pd(_mm_blendv_pd(_mm_set1_pd(1.0),R2,nonzero)));// 1 / R
+  invR = _mm_and_pd(invR,nonzero);                              // Zero for skipped pairs
+  __m128d invR2 = _mm_mul_pd(invR,invR);                        // 1 / R^2
+  invR = _mm_mul_pd(invR,qj);                                   // potential
+  invR2 = _mm_mul_pd(invR2,invR);                               // force
+  pot = _mm_add_pd(pot,invR);                                   // accumulate potential
+  fx = _mm_add_pd(fx,_mm_mul_pd(dx,invR2));                     // accumulate x component of force
+  fy = _mm_add_pd(fy,_mm_mul_pd(dy,invR2));                     // accumulate y component of force
+  fz = _mm_add_pd(fz,_mm_mul_pd(dz,invR2));                     // accumulate z component of force
+}
+
+//! Laplace P2P on 2 targets x JT sources at a time in double precision with SSE4.1 (skips pairs set in exclude)
+template<bool masked>
+__attribute__((target("sse4.1")))
+void P2PLaplaceSSETiles(const real *Xi, const real *Yi, const real *Zi,
+                        real *Pi, real *Fxi, real *Fyi, real *Fzi, int ni,
+                        const real *Xj, const real *Yj, const real *Zj, const real *Qj, int nj,
+                        const unsigned *exclude) {
+  const int JT = 2;                                             // Sources per tile (16 registers)
+  const __m128d zero = _mm_setzero_pd();                        // 0.0
+  const __m128i bit = _mm_set_epi64x(2,1);                      // Exclusion bit of each lane
+  for( int i=0; i<ni; i+=2 ) {                                  // Loop over target bodies in blocks of 2
+    const int n = std::min(2,ni-i);                             //  Number of active lanes
+    const unsigned *E = masked ? exclude + i/2*nj : 0;          //  Exclusion words of block
+    double x[2] = {0}, y[2] = {0}, z[2] = {0};                  //  Target coordinates with padded tail
+    for( int l=0; l!=n; ++l ) {                                 //  Loop over active lanes
+      x[l] = Xi[i+l] - Xperiodic[0];                            //   Target x coordinate with periodic offset
+      y[l] = Yi[i+l] - Xperiodic[1];                            //   Target y coordinate with periodic offset
+      z[l] = Zi[i+l] - Xperiodic[2];                            //   Target z coordinate with periodic offset
+    }                                                           //  End loop over active lanes
+    const __m128d xi = _mm_loadu_pd(x);                         //  Target x coordinates
+    const __m128d yi = _mm_loadu_pd(y);                         //  Target y coordinates
+    const __m128d zi = _mm_loadu_pd(z);                         //  Target z coordinates
+    __m128d pot = zero, fx = zero, fy = zero, fz = zero;        //  Initialize potential and force
+    int j = 0;                                                  //  Source index
+    for( ; j+JT<=nj; j+=JT ) {                                  //  Loop over tiles of source bodies
+      __m128d xj[JT], yj[JT], zj[JT], qj[JT], keep[JT];         //   Source tile held in registers
+      for( int k=0; k!=JT; ++k ) {                              //   Loop over sources in tile
+        xj[k] = _mm_set1_pd(Xj[j+k]);                           //    Broadcast source x coordinate
+        yj[k] = _mm_set1_pd(Yj[j+k]);                           //    Broadcast source y coordinate
+        zj[k] = _mm_set1_pd(Zj[j+k]);                           //    Broadcast source z coordinate
+        qj[k] = _mm_set1_pd(Qj[j+k]);                           //    Broadcast source value
+        keep[k] = zero;                                         //    Lanes not excluded
+        if( masked ) keep[k] = _mm_castsi128_pd(_mm_cmpeq_epi64(_mm_and_si128(_mm_set1_epi64x(E[j+k]),bit),
+                                                                _mm_setzero_si128()));
+      }                                                         //   End loop over sources in tile
+      for( int k=0; k!=JT; ++k ) {                              //   Loop over sources in tile
+        P2PLaplaceSSEPair<masked>(xi,yi,zi,xj[k],yj[k],zj[k],qj[k],keep[k],pot,fx,fy,fz);
+      }                                                         //   End loop over sources in tile
+    }                                                           //  End loop over tiles of source bodies
+    for( ; j<nj; ++j ) {                                        //  Loop over remaining source bodies
+      __m128d keep = zero;                                      //   Lanes not excluded
+      if( masked ) keep = _mm_castsi128_pd(_mm_cmpeq_epi64(_mm_and_si128(_mm_set1_epi64x(E[j]),bit),
+                                                           _mm_setzero_si128()));
+      P2PLaplaceSSEPair<masked>(xi,yi,zi,_mm_set1_pd(Xj[j]),_mm_set1_pd(Yj[j]),_mm_set1_pd(Zj[j]),_mm_set1_pd(Qj[j]),
+                                keep,pot,fx,fy,fz);
+    }                                                           //  End loop over remaining source bodies
+    _mm_storeu_pd(x,pot);                                       //  Store potential
+    for( int l=0; l!=n; ++l ) Pi[i+l] += x[l];                  //  Accumulate potential of active lanes
+    _mm_storeu_pd(x,fx);                                        //  Store x component of force
+    for( int l=0; l!=n; ++l ) Fxi[i+l] -= x[l];                 //  Accumulate x force of active lanes
+    _mm_storeu_pd(x,fy);                                        //  Store y component of force
+    for( int l=0; l!=n; ++l ) Fyi[i+l] -= x[l];                 //  Accumulate y force of active lanes
+    _mm_storeu_pd(x,fz);                                        //  Store z component of force
+    for( int l=0; l!=n; ++l ) Fzi[i+l] -= x[l];                 //  Accumulate z force of active lanes
+  }                                                             // End loop over target bodies
+}
+
+//! One source against 4 targets in double precision with AVX2 + FMA (sqrt and division, keep is zero for excluded pairs)
+template<bool masked>
+__attribute__((target("avx2,fma"),always_inline)) inline
+void P2PLaplaceAVX2Pair(__m256d xi, __m256d yi, __m256d zi, __m256d xj, __m256d yj, __m256d zj, __m256d qj, __m256d keep,
+                        __m256d &pot, __m256d &fx, __m256d &fy, __m256d &fz) {
+  __m256d dx = _mm256_sub_pd(xi,xj);                            // x distance from source to target
+  __m256d dy = _mm256_sub_pd(yi,yj);                            // y distance from source to target
+  __m256d dz = _mm256_sub_pd(zi,zj);                            // z distance from source to target
+  __m256d R2 = _mm256_fmadd_pd(dx,dx,_mm256_set1_pd(EPS2));     // R^2
+  R2 = _mm256_fmadd_pd(dy,dy,R2);                               // R^2
+  R2 = _mm256_fmadd_pd(dz,dz,R2);                               // R^2
+  __m256d nonzero = _mm256_cmp_pd(R2,_mm256_setzero_pd(),_CMP_GT_OQ);// Exclude self interaction
+  if( masked ) nonzero = _mm256_and_pd(nonzero,keep);           // Skip excluded pairs
+  __m256d invR = _mm256_div_pd(_mm256_set1_pd(1.0),             // 1 / R
+                               _mm256_sqrt_pd(_mm256_blendv_pd(_mm256_set1_pd(1.0),R2,nonzero)));
+  invR = _mm256_and_pd(invR,nonzero);                           // Zero for skipped pairs
+  __m256d invR2 = _mm256_mul_pd(invR,invR);                     // 1 / R^2
+  invR = _mm256_mul_pd(invR,qj);                                // potential
+  invR2 = _mm256_mul_pd(invR2,invR);                            // force
+  pot = _mm256_add_pd(pot,invR);                                // accumulate potential
+  fx = _mm256_fmadd_pd(dx,invR2,fx);                            // accumulate x component of force
+  fy = _mm256_fmadd_pd(dy,invR2,fy);                            // accumulate y component of force
+  fz = _mm256_fmadd_pd(dz,invR2,fz);                            // accumulate z component of force
+}
+
+//! Laplace P2P on 4 targets x JT sources at a time in double precision with AVX2 + FMA (masked tail, skips pairs set in exclude)
+template<bool masked>
+__attribute__((target("avx2,fma")))
+void P2PLaplaceAVX2Tiles(const real *Xi, const real *Yi, const real *Zi,
+                         real *Pi, real *Fxi, real *Fyi, real *Fzi, int ni,
+                         const real *Xj, const real *Yj, const real *Zj, const real *Qj, int nj,
+                         const unsigned *exclude) {
+  const int JT = 2;                                             // Sources per tile (16 registers)
+  const __m256d zero = _mm256_setzero_pd();                     // 0.0
+  const __m256i lane = _mm256_setr_epi64x(0,1,2,3);             // Lane index
+  const __m256i bit = _mm256_setr_epi64x(1,2,4,8);              // Exclusion bit of each lane
+  for( int i=0; i<ni; i+=4 ) {                                  // Loop over target bodies in blocks of 4
+    const __m256i mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(ni-i),lane);// Mask of active lanes
+    const unsigned *E = masked ? exclude + i/4*nj : 0;          //  Exclusion words of block
+    const __m256d xi = _mm256_sub_pd(_mm256_maskload_pd(Xi+i,mask),_mm256_set1_pd(Xperiodic[0]));// Target x
+    const __m256d yi = _mm256_sub_pd(_mm256_maskload_pd(Yi+i,mask),_mm256_set1_pd(Xperiodic[1]));// Target y
+    const __m256d zi = _mm256_sub_pd(_mm256_maskload_pd(Zi+i,mask),_mm256_set1_pd(Xperiodic[2]));// Target z
+    __m256d pot = zero, fx = zero, fy = zero, fz = zero;        //  Initialize potential and force
+    int j = 0;                                                  //  Source index
+    for( ; j+JT<=nj; j+=JT ) {                                  //  Loop over tiles of source bodies
+      __m256d xj[JT], yj[JT], zj[JT], qj[JT], keep[JT];         //   Source tile held in registers
+      for( int k=0; k!=JT; ++k ) {                              //   Loop over sources in tile
+        xj[k] = _mm256_broadcast_sd(Xj+j+k);                    //    Broadcast source x coordinate
+        yj[k] = _mm256_broadcast_sd(Yj+j+k);                    //    Broadcast source y coordinate
+        zj[k] = _mm256_broadcast_sd(Zj+j+k);                    //    Broadcast source z coordinate
+        qj[k] = _mm256_broadcast_sd(Qj+j+k);                    //    Broadcast source value
+        keep[k] = zero;                                         //    Lanes not excluded
+        if( masked ) keep[k] = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x(E[j+k]),bit),
+                                                                      _mm256_setzero_si256()));
+      }                                                         //   End loop over sources in tile
+      for( int k=0; k!=JT; ++k ) {                              //   Loop over sources in tile
+        P2PLaplaceAVX2Pair<masked>(xi,yi,zi,xj[k],yj[k],zj[k],qj[k],keep[k],pot,fx,fy,fz);
+      }                                                         //   End loop over sources in tile
+    }                                                           //  End loop over tiles of source bodies
+    for( ; j<nj; ++j ) {                                        //  Loop over remaining source bodies
+      __m256d keep = zero;                                      //   Lanes not excluded
+      if( masked ) keep = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x(E[j]),bit),
+                                                                 _mm256_setzero_si256()));
+      P2PLaplaceAVX2Pair<masked>(xi,yi,zi,_mm256_broadcast_sd(Xj+j),_mm256_broadcast_sd(Yj+j),_mm256_broadcast_sd(Zj+j),
+                                 _mm256_broadcast_sd(Qj+j),keep,pot,fx,fy,fz);
+    }                                                           //  End loop over remaining source bodies
+    _mm256_maskstore_pd(Pi+i,mask,_mm256_add_pd(_mm256_maskload_pd(Pi+i,mask),pot));// Accumulate potential
+    _mm256_maskstore_pd(Fxi+i,mask,_mm256_sub_pd(_mm256_maskload_pd(Fxi+i,mask),fx));// Accumulate x force
+    _mm256_maskstore_pd(Fyi+i,mask,_mm256_sub_pd(_mm256_maskload_pd(Fyi+i,mask),fy));// Accumulate y force
+    _mm256_maskstore_pd(Fzi+i,mask,_mm256_sub_pd(_mm256_maskload_pd(Fzi+i,mask),fz));// Accumulate z force
+  }                                                             // End loop over target bodies
+}
+
+//! One source against 8 targets in double precision with AVX-512F (rsqrt + two Newton steps, active clears excluded pairs)
+__attribute__((target("avx512f"),always_inline)) inline
+void P2PLaplaceAVX512Pair(__m512d xi, __m512d yi, __m512d zi, __m512d xj, __m512d yj, __m512d zj, __m512d qj,
+                          __mmask8 active, __m512d &pot, __m512d &fx, __m512d &fy, __m512d &fz) {
+  __m512d dx = _mm512_sub_pd(xi,xj);                            // x distance from source to target
+  __m512d dy = _mm512_sub_pd(yi,yj);                            // y distance from source to target
+  __m512d dz = _mm512_sub_pd(zi,zj);                            // z distance from source to target
+  __m512d R2 = _mm512_fmadd_pd(dx,dx,_mm512_set1_pd(EPS2));     // R^2
+  R2 = _mm512_fmadd_pd(dy,dy,R2);                               // R^2
+  R2 = _mm512_fmadd_pd(dz,dz,R2);                               // R^2
+  active &= _mm512_cmp_pd_mask(R2,_mm512_setzero_pd(),_CMP_GT_OQ);// Exclude self interaction
+  __m512d invR = _mm512_maskz_rsqrt14_pd(active,R2);           // Approximate 1 / R
+  for( int it=0; it!=2; ++it ) {                                // 14 bits -> 28 bits -> full double precision
+    invR = _mm512_mul_pd(_mm512_mul_pd(_mm512_set1_pd(0.5),invR),//  Newton-Raphson refinement
+                         _mm512_fnmadd_pd(R2,_mm512_mul_pd(invR,invR),_mm512_set1_pd(3.0)));
+  }                                                             // End Newton-Raphson steps
+  __m512d invR2 = _mm512_mul_pd(invR,invR);                     // 1 / R^2
+  invR = _mm512_mul_pd(invR,qj);                                // potential
+  invR2 = _mm512_mul_pd(invR2,invR);                            // force
+  pot = _mm512_add_pd(pot,invR);                                // accumulate potential
+  fx = _mm512_fmadd_pd(dx,invR2,fx);                            // accumulate x component of force
+  fy = _mm512_fmadd_pd(dy,invR2,fy);                            // accumulate y component of force
+  fz = _mm512_fmadd_pd(dz,invR2,fz);                            // accumulate z component of force
+}
+
+//! Laplace P2P on 8 targets x JT sources at a time in double precision with AVX-512F (masked tail, skips pairs set in exclude)
+template<bool masked>
+__attribute__((target("avx512f")))
+void P2PLaplaceAVX512Tiles(const real *Xi, const real *Yi, const real *Zi,
+                           real *Pi, real *Fxi, real *Fyi, real *Fzi, int ni,
+                           const real *Xj, const real *Yj, const real *Zj, const real *Qj, int nj,
+                           const unsigned *exclude) {
+  const int JT = 4;                                             // Sources per tile (32 registers)
+  const __m512d zero = _mm512_setzero_pd();                     // 0.0
+  for( int i=0; i<ni; i+=8 ) {                                  // Loop over target bodies in blocks of 8
+    const __mmask8 mask = ni - i >= 8 ? 0xFF : (1 << (ni - i)) - 1;// Mask of active lanes
+    const unsigned *E = masked ? exclude + i/8*nj : 0;          //  Exclusion words of block
+    const __m512d xi = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask,Xi+i),_mm512_set1_pd(Xperiodic[0]));// Target x
+    const __m512d yi = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask,Yi+i),_mm512_set1_pd(Xperiodic[1]));// Target y
+    const __m512d zi = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask,Zi+i),_mm512_set1_pd(Xperiodic[2]));// Target z
+    __m512d pot[2] = {zero,zero}, fx[2] = {zero,zero};          //  Two accumulators per value
+    __m512d fy[2] = {zero,zero}, fz[2] = {zero,zero};           //  for independent dependency chains
+    int j = 0;                                                  //  Source index
+    for( ; j+JT<=nj; j+=JT ) {                                  //  Loop over tiles of source bodies
+      __m512d xj[JT], yj[JT], zj[JT], qj[JT];                   //   Source tile held in registers
+      for( int k=0; k!=JT; ++k ) {                              //   Loop over sources in tile
+        xj[k] = _mm512_set1_pd(Xj[j+k]);                        //    Broadcast source x coordinate
+        yj[k] = _mm512_set1_pd(Yj[j+k]);                        //    Broadcast source y coordinate
+        zj[k] = _mm512_set1_pd(Zj[j+k]);                        //    Broadcast source z coordinate
+        qj[k] = _mm512_set1_pd(Qj[j+k]);                        //    Broadcast source value
+      }                                                         //   End loop over sources in tile
+      for( int k=0; k!=JT; ++k ) {                              //   Loop over sources in tile
+        P2PLaplaceAVX512Pair(xi,yi,zi,xj[k],yj[k],zj[k],qj[k],masked ? ~E[j+k] : 0xFF,
+                             pot[k&1],fx[k&1],fy[k&1],fz[k&1]);
+      }                                                         //   End loop over sources in tile
+    }                                                           //  End loop over tiles of source bodies
+    for( ; j<nj; ++j ) {                                        //  Loop over remaining source bodies
+      P2PLaplaceAVX512Pair(xi,yi,zi,_mm512_set1_pd(Xj[j]),_mm512_set1_pd(Yj[j]),_mm512_set1_pd(Zj[j]),
+                           _mm512_set1_pd(Qj[j]),masked ? ~E[j] : 0xFF,pot[0],fx[0],fy[0],fz[0]);
+    }                                                           //  End loop over remaining source bodies
+    _mm512_mask_storeu_pd(Pi+i,mask,_mm512_add_pd(_mm512_maskz_loadu_pd(mask,Pi+i),_mm512_add_pd(pot[0],pot[1])));// Potential
+    _mm512_mask_storeu_pd(Fxi+i,mask,_mm512_sub_pd(_mm512_maskz_loadu_pd(mask,Fxi+i),_mm512_add_pd(fx[0],fx[1])));// x force
+    _mm512_mask_storeu_pd(Fyi+i,mask,_mm512_sub_pd(_mm512_maskz_loadu_pd(mask,Fyi+i),_mm512_add_pd(fy[0],fy[1])));// y force
+    _mm512_mask_storeu_pd(Fzi+i,mask,_mm512_sub_pd(_mm512_maskz_loadu_pd(mask,Fzi+i),_mm512_add_pd(fz[0],fz[1])));// z force
+  }                                                             // End loop over target bodies
+}
+#endif
+
+//! Laplace P2P with SSE4.1 (the exclusion test is compiled out when there are no excluded pairs)
+__attribute__((target("sse4.1")))
+void P2PLaplaceSSE(const real *Xi, const real *Yi, const real *Zi,
+                   real *Pi, real *Fxi, real *Fyi, real *Fzi, int ni,
+                   const real *Xj, const real *Yj, const real *Zj, const real *Qj, int nj,
+                   const unsigned *exclude) {
+  if( exclude ) P2PLaplaceSSETiles<true>(Xi,Yi,Zi,Pi,Fxi,Fyi,Fzi,ni,Xj,Yj,Zj,Qj,nj,exclude);
+  else P2PLaplaceSSETiles<false>(Xi,Yi,Zi,Pi,Fxi,Fyi,Fzi,ni,Xj,Yj,Zj,Qj,nj,exclude);
+}
+
+//! Laplace P2P with AVX2 + FMA (the exclusion test is compiled out when there are no excluded pairs)
+__attribute__((target("avx2,fma")))
+void P2PLaplaceAVX2(const real *Xi, const real *Yi, const real *Zi,
+                    real *Pi, real *Fxi, real *Fyi, real *Fzi, int ni,
+                    const real *Xj, const real *Yj, const real *Zj, const real *Qj, int nj,
+                    const unsigned *exclude) {
+  if( exclude ) P2PLaplaceAVX2Tiles<true>(Xi,Yi,Zi,Pi,Fxi,Fyi,Fzi,ni,Xj,Yj,Zj,Qj,nj,exclude);
+  else P2PLaplaceAVX2Tiles<false>(Xi,Yi,Zi,Pi,Fxi,Fyi,Fzi,ni,Xj,Yj,Zj,Qj,nj,exclude);
+}
+
+//! Laplace P2P with AVX-512F (the exclusion test is compiled out when there are no excluded pairs)
+__attribute__((target("avx512f")))
+void P2PLaplaceAVX512(const real *Xi, const real *Yi, const real *Zi,
+                      real *Pi, real *Fxi, real *Fyi, real *Fzi, int ni,
+                      const real *Xj, const real *Yj, const real *Zj, const real *Qj, int nj,
+                      const unsigned *exclude) {
+  if( exclude ) P2PLaplaceAVX512Tiles<true>(Xi,Yi,Zi,Pi,Fxi,Fyi,Fzi,ni,Xj,Yj,Zj,Qj,nj,exclude);
+  else P2PLaplaceAVX512Tiles<false>(Xi,Yi,Zi,Pi,Fxi,Fyi,Fzi,ni,Xj,Yj,Zj,Qj,nj,exclude);
+}
+}
+#endif
+
+namespace {
+//! Gather bodies of cell pair into structure of arrays and run the P2P kernel on them
+template<Equation equation>
+void P2PCells(const Kernel<equation> &kernel, C_iter Ci, C_iter Cj, const unsigned *exclude=0) {
+  static thread_local BodiesSoA ibodies, jbodies;              // Per thread, capacity grows to the largest cell
+  ibodies.gather(Ci->LEAF,Ci->LEAF+Ci->NDLEAF);                 // Gather target bodies
+  jbodies.gather(Cj->LEAF,Cj->LEAF+Cj->NDLEAF);                 // Gather source bodies
+  kernel.P2P(ibodies,0,ibodies.size(),jbodies,0,jbodies.size(),exclude);// Evaluate P2P kernel
+  for( int i=0; i<Ci->NDLEAF; ++i ) {                           // Loop over target bodies
+    B_iter B = Ci->LEAF + i;                                    //  Target body iterator
+    for( int d=0; d!=4; ++d ) B->TRG[d] += ibodies.TRG[d][i];   //  Accumulate target values
+  }                                                             // End loop over target bodies
+}
+
+//! Add target values of structure of arrays to bodies starting at begin
+void addTargets(const BodiesSoA &soa, B_iter begin) {
+  for( int i=0; i<soa.size(); ++i ) {                           // Loop over bodies
+    for( int d=0; d!=4; ++d ) begin[i].TRG[d] += soa.TRG[d][i]; //  Accumulate target values
+  }                                                             // End loop over bodies
+}
+
+//! Gather bodies of cell pair and run the mutual P2P kernel, which updates both cells
+template<Equation equation>
+void P2PMutualCells(const Kernel<equation> &kernel, C_iter Ci, C_iter Cj) {
+  static thread_local BodiesSoA ibodies, jbodies;              // Per thread, capacity grows to the largest cell
+  ibodies.gather(Ci->LEAF,Ci->LEAF+Ci->NDLEAF);                 // Gather bodies of first cell
+  if( Ci == Cj ) {                                              // If cell interacts with itself
+    const int n = ibodies.size();                               //  Number of bodies
+    kernel.P2P(ibodies,0,n,ibodies,0,n);                        //  Full square vectorizes better than triangle
+  } else {                                                      // If cells are distinct
+    jbodies.gather(Cj->LEAF,Cj->LEAF+Cj->NDLEAF);               //  Gather bodies of second cell
+    kernel.P2PMutual(ibodies,0,ibodies.size(),jbodies,0,jbodies.size());// Each pair once, both sides updated
+    addTargets(jbodies,Cj->LEAF);                               //  Accumulate target values of second cell
+  }                                                             // Endif for self interaction
+  addTargets(ibodies,Ci->LEAF);                                 // Accumulate target values of first cell
+}
+
+//! Coulomb for all pairs and Van der Waals within R2MAX, loading each pair once (mutual also updates sources)
+//! Pairs with a nonzero word i*nj+j in exclude are skipped by both parts (one-sided only)
+template<bool mutual>
+void P2PCoulombVanDerWaalsSoA(CoulombVanDerWaalsSoA &ibodies, CoulombVanDerWaalsSoA &jbodies,
+                              const real *rscale, const real *gscale, int atoms, const unsigned *exclude=0) {
+  const bool self = &ibodies == &jbodies;                       // Bodies interact with themselves
+  const int nj = jbodies.size();                                // Number of source bodies
+  const real *Xj = &jbodies.X[0][0], *Yj = &jbodies.X[1][0], *Zj = &jbodies.X[2][0];// Source coordinates
+  const real *Qj = &jbodies.SRC[0];                             // Source charges
+  const int *Tj = &jbodies.ATYPE[0];                            // Source atom types
+  real *Pj = &jbodies.TRG[0][0], *Fxj = &jbodies.TRG[1][0];     // Source Coulomb potential and x force
+  real *Fyj = &jbodies.TRG[2][0], *Fzj = &jbodies.TRG[3][0];    // Source Coulomb y and z force
+  real *Vj = &jbodies.VDW[0][0], *Gxj = &jbodies.VDW[1][0];     // Source Van der Waals potential and x force
+  real *Gyj = &jbodies.VDW[2][0], *Gzj = &jbodies.VDW[3][0];    // Source Van der Waals y and z force
+  for( int i=0; i<ibodies.size(); ++i ) {                       // Loop over target bodies
+    const real xi = ibodies.X[0][i] - Xperiodic[0];             //  Target x coordinate with periodic offset
+    const real yi = ibodies.X[1][i] - Xperiodic[1];             //  Target y coordinate with periodic offset
+    const real zi = ibodies.X[2][i] - Xperiodic[2];             //  Target z coordinate with periodic offset
+    const real qi = ibodies.SRC[i];                             //  Target charge
+    const int ti = ibodies.ATYPE[i];                            //  Target atom type
+    real P0 = 0, F0 = 0, F1 = 0, F2 = 0;                        //  Coulomb potential and force
+    real V0 = 0, G0 = 0, G1 = 0, G2 = 0;                        //  Van der Waals potential and force
+    const unsigned *Ej = exclude ? exclude + i * nj : 0;        //  Excluded pairs of target
+#pragma omp simd reduction(+:P0,F0,F1,F2,V0,G0,G1,G2)
+    for( int j=mutual && self ? i+1 : 0; j<nj; ++j ) {          //  Loop over source bodies (upper triangle if mutual self)
+      real dx = xi - Xj[j];                                     //   x distance from source to target
+      real dy = yi - Yj[j];                                     //   y distance from source to target
+      real dz = zi - Zj[j];                                     //   z distance from source to target
+      real R2 = dx * dx + dy * dy + dz * dz;                    //   R^2
+      real R2e = R2 + EPS2;                                     //   Softened R^2 for Coulomb
+      real invR2e = R2e == 0 || (Ej && Ej[j]) ? 0 : 1 / R2e;    //   1 / R^2 (exclude self interaction and excluded pairs)
+      real invR = std::sqrt(invR2e);                            //   1 / R
+      real invRi = Qj[j] * invR;                                //   Coulomb potential on target
+      real invR3i = invR2e * invRi;                             //   Coulomb force on target
+      P0 += invRi;                                              //   Accumulate Coulomb potential
+      F0 += dx * invR3i;                                        //   Accumulate x component of Coulomb force
+      F1 += dy * invR3i;                                        //   Accumulate y component of Coulomb force
+      F2 += dz * invR3i;                                        //   Accumulate z component of Coulomb force
+      real cutoff = R2 != 0 && R2MIN <= R2 && R2 < R2MAX && !(Ej && Ej[j]);// 1 inside the Van der Waals cutoff, 0 outside
+      real invR2 = cutoff == 0 ? 0 : 1 / R2;                    //   1 / R^2 without softening
+      int ij = ti * atoms + Tj[j];                              //   Parameter index seen from target
+      real invR2s = invR2 / rscale[ij];                         //   1 / (R^2 * r scale)
+      real invR6 = invR2s * invR2s * invR2s;                    //   1 / R^6
+      real gsR6 = gscale[ij] * invR6;                           //   g scale / R^6
+      real dtmp = gsR6 * invR2s * (2 * invR6 - 1);              //   g scale / R^2 * (2 / R^12 - 1 / R^6)
+      V0 += gsR6 * (invR6 - 1);                                 //   Accumulate Van der Waals potential
+      G0 += dx * dtmp;                                          //   Accumulate x component of Van der Waals force
+      G1 += dy * dtmp;                                          //   Accumulate y component of Van der Waals force
+      G2 += dz * dtmp;                                          //   Accumulate z component of Van der Waals force
+      if( mutual ) {                                            //   If sources are updated as well
+        real invRj = qi * invR;                                 //    Coulomb potential on source
+        real invR3j = invR2e * invRj;                           //    Coulomb force on source
+        Pj[j] += invRj;                                         //    Coulomb potential of source
+        Fxj[j] += dx * invR3j;                                  //    x component of Coulomb force (opposite sign)
+        Fyj[j] += dy * invR3j;                                  //    y component of Coulomb force (opposite sign)
+        Fzj[j] += dz * invR3j;                                  //    z component of Coulomb force (opposite sign)
+        int ji = Tj[j] * atoms + ti;                            //    Parameter index seen from source
+        real invR2sj = invR2 / rscale[ji];                      //    1 / (R^2 * r scale)
+        real invR6j = invR2sj * invR2sj * invR2sj;              //    1 / R^6
+        real gsR6j = gscale[ji] * invR6j;                       //    g scale / R^6
+        real dtmpj = gsR6j * invR2sj * (2 * invR6j - 1);        //    g scale / R^2 * (2 / R^12 - 1 / R^6)
+        Vj[j] += gsR6j * (invR6j - 1);                          //    Van der Waals potential of source
+        Gxj[j] += dx * dtmpj;                                   //    x component of Van der Waals force (opposite sign)
+        Gyj[j] += dy * dtmpj;                                   //    y component of Van der Waals force (opposite sign)
+        Gzj[j] += dz * dtmpj;                                   //    z component of Van der Waals force (opposite sign)
+      }                                                         //   Endif for mutual
+    }                                                           //  End loop over source bodies
+    ibodies.TRG[0][i] += P0;                                    //  Coulomb potential
+    ibodies.TRG[1][i] -= F0;                                    //  x component of Coulomb force
+    ibodies.TRG[2][i] -= F1;                                    //  y component of Coulomb force
+    ibodies.TRG[3][i] -= F2;                                    //  z component of Coulomb force
+    ibodies.VDW[0][i] += V0;                                    //  Van der Waals potential
+    ibodies.VDW[1][i] -= G0;                                    //  x component of Van der Waals force
+    ibodies.VDW[2][i] -= G1;                                    //  y component of Van der Waals force
+    ibodies.VDW[3][i] -= G2;                                    //  z component of Van der Waals force
+  }                                                             // End loop over target bodies
+}
+}
+
+template<>
+void Kernel<Laplace>::P2P(BodiesSoA &ibodies, int ibegin, int iend,
+                          const BodiesSoA &jbodies, int jbegin, int jend,
+                          const unsigned *exclude) const {      // Laplace P2P kernel on CPU
+#if SIMD
+  if( SIMDLEVEL != SIMDNone ) {                                 // If SIMD kernels are available
+    void (*kernel)(const real*, const real*, const real*, real*, real*, real*, real*, int,
+                   const real*, const real*, const real*, const real*, int,
+                   const unsigned*) = P2PLaplaceSSE;            //  SIMD kernel
+    if( SIMDLEVEL == SIMDAVX2 ) kernel = P2PLaplaceAVX2;        //  Use AVX2 kernel
+    if( SIMDLEVEL == SIMDAVX512 ) kernel = P2PLaplaceAVX512;    //  Use AVX-512 kernel
+    if( ibegin == iend || jbegin == jend ) return;              //  Nothing to do for empty ranges
+    kernel(&ibodies.X[0][ibegin],&ibodies.X[1][ibegin],&ibodies.X[2][ibegin],
+           &ibodies.TRG[0][ibegin],&ibodies.TRG[1][ibegin],&ibodies.TRG[2][ibegin],&ibodies.TRG[3][ibegin],iend-ibegin,
+           &jbodies.X[0][jbegin],&jbodies.X[1][jbegin],&jbodies.X[2][jbegin],&jbodies.SRC[jbegin],jend-jbegin,
+           exclude);
+    return;                                                     //  Skip scalar kernel
+  }                                                             // Endif for SIMD kernels
+#endif
+  const real *Xj = &jbodies.X[0][0];                            // Source x coordinates
+  const real *Yj = &jbodies.X[1][0];                            // Source y coordinates
+  const real *Zj = &jbodies.X[2][0];                            // Source z coordinates
+  const real *Qj = &jbodies.SRC[0];                             // Source values
+  for( int i=ibegin; i<iend; ++i ) {                            // Loop over target bodies
+    const real xi = ibodies.X[0][i] - Xperiodic[0];             //  Target x coordinate with periodic offset
+    const real yi = ibodies.X[1][i] - Xperiodic[1];             //  Target y coordinate with periodic offset
+    const real zi = ibodies.X[2][i] - Xperiodic[2];             //  Target z coordinate with periodic offset
+    const unsigned *Ej = exclude ? exclude + (i-ibegin) * (jend-jbegin) - jbegin : 0;// Exclusions of target
+    real P0 = 0, F0 = 0, F1 = 0, F2 = 0;                        //  Initialize potential and force
+#pragma omp simd reduction(+:P0,F0,F1,F2)
+    for( int j=jbegin; j<jend; ++j ) {                          //  Loop over source bodies
+      real dx = xi - Xj[j];                                     //   x distance from source to target
+      real dy = yi - Yj[j];                                     //   y distance from source to target
+      real dz = zi - Zj[j];                                     //   z distance from source to target
+      real R2 = dx * dx + dy * dy + dz * dz + EPS2;             //   R^2
+      real invR2 = R2 == 0 || (Ej && Ej[j]) ? 0 : 1 / R2;       //   1 / R^2 (exclude self interaction and excluded pairs)
+      real invR = Qj[j] * std::sqrt(invR2);                     //   potential
+      real invR3 = invR2 * invR;                                //   force
+      P0 += invR;                                               //   accumulate potential
+      F0 += dx * invR3;                                         //   accumulate x component of force
+      F1 += dy * invR3;                                         //   accumulate y component of force
+      F2 += dz * invR3;                                         //   accumulate z component of force
+    }                                                           //  End loop over source bodies
+    ibodies.TRG[0][i] += P0;                                    //  potential
+    ibodies.TRG[1][i] -= F0;                                    //  x component of force
+    ibodies.TRG[2][i] -= F1;                                    //  y component of force
+    ibodies.TRG[3][i] -= F2;                                    //  z component of force
+  }                                                             // End loop over target bodies
+}
+
+template<>
+void Kernel<Laplace>::P2PCoulombVanDerWaals(C_iter Ci, C_iter Cj, bool mutual) const {// Laplace + Van der Waals P2P kernel on CPU
+  static thread_local CoulombVanDerWaalsSoA ibodies, jbodies;  // Per thread, capacity grows to the largest cell
+  const bool self = Ci == Cj;                                   // Cell interacts with itself
+  assert( !mutual || VDWI0 == VDWJ0 );                          // Reaction is added to target side array
+  std::vector<unsigned> imask, jmask;                           // Excluded pairs in each direction (one word per pair)
+  const bool iexclude = skipExclusions(Ci,Cj,1,imask);          // Mark excluded pairs from Cj to Ci
+  const bool jexclude = mutual && !self && skipExclusions(Cj,Ci,1,jmask);// Mark excluded pairs from Ci to Cj
+  ibodies.gather(Ci->LEAF,Ci->LEAF+Ci->NDLEAF,&VDWITYPE[Ci->LEAF-VDWI0]);// Gather target bodies
+  if( !self ) jbodies.gather(Cj->LEAF,Cj->LEAF+Cj->NDLEAF,&VDWJTYPE[Cj->LEAF-VDWJ0]);// Gather source bodies
+  CoulombVanDerWaalsSoA &sources = self ? ibodies : jbodies;    // Sources of target cell
+  if( iexclude || jexclude ) {                                  // If cell pair has excluded pairs
+    P2PCoulombVanDerWaalsSoA<false>(ibodies,sources,&RSCALE[0],&GSCALE[0],ATOMS,iexclude ? &imask[0] : 0);// Skip them
+    ibodies.add(Ci->LEAF,&VDWTRG[Ci->LEAF-VDWI0]);              //  Accumulate target values of target cell
+    if( mutual && !self ) {                                     //  If source cell is updated as well
+      ibodies.gather(Cj->LEAF,Cj->LEAF+Cj->NDLEAF,&VDWITYPE[Cj->LEAF-VDWI0]);// Source cell as targets
+      jbodies.gather(Ci->LEAF,Ci->LEAF+Ci->NDLEAF,&VDWJTYPE[Ci->LEAF-VDWJ0]);// Target cell as sources
+      P2PCoulombVanDerWaalsSoA<false>(ibodies,jbodies,&RSCALE[0],&GSCALE[0],ATOMS,jexclude ? &jmask[0] : 0);// Opposite direction
+      ibodies.add(Cj->LEAF,&VDWTRG[Cj->LEAF-VDWI0]);            //   Accumulate target values of source cell
+    }                                                           //  Endif for mutual
+    return;                                                     //  Skip kernels without exclusions
+  }                                                             // Endif for excluded pairs
+#if SIMD && !FP64
+  if( (SIMDLEVEL == SIMDAVX2 || SIMDLEVEL == SIMDAVX512) && (!mutual || self) ) {// If gathers are available (one-sided only)
+    void (*kernel)(CoulombVanDerWaalsSoA&, const CoulombVanDerWaalsSoA&,
+                   const real*, const real*, int) = P2PCoulombVanDerWaalsAVX2;// SIMD kernel
+    if( SIMDLEVEL == SIMDAVX512 ) kernel = P2PCoulombVanDerWaalsAVX512;// Use AVX-512 kernel
+    kernel(ibodies,sources,&RSCALE[0],&GSCALE[0],ATOMS);        //  Full square vectorizes better than triangle
+    ibodies.add(Ci->LEAF,&VDWTRG[Ci->LEAF-VDWI0]);              //  Accumulate target values of target cell
+    return;                                                     //  Skip scalar kernel
+  }                                                             // Endif for SIMD kernels
+#endif
+  if( mutual ) {                                                // If both cells are updated
+    P2PCoulombVanDerWaalsSoA<true>(ibodies,sources,&RSCALE[0],&GSCALE[0],ATOMS);// Each pair once
+    if( !self ) jbodies.add(Cj->LEAF,&VDWTRG[Cj->LEAF-VDWI0]);  //  Accumulate target values of source cell
+  } else {                                                      // If only target cell is updated
+    P2PCoulombVanDerWaalsSoA<false>(ibodies,sources,&RSCALE[0],&GSCALE[0],ATOMS);// Target side only
+  }                                                             // Endif for mutual
+  ibodies.add(Ci->LEAF,&VDWTRG[Ci->LEAF-VDWI0]);                // Accumulate target values of target cell
+}
+
 template<>
 void Kernel<Laplace>::P2P(C_iter Ci, C_iter Cj) const {         // Laplace P2P kernel on CPU
-#ifndef SPARC_SIMD
+  if( COULOMBVDW && hasVanDerWaalsTypes(Ci,Cj) ) {             // If Van der Waals is evaluated together
+    P2PCoulombVanDerWaals(Ci,Cj,false);                         //  Run combined kernel
+    return;                                                     //  Skip Laplace only kernel
+  }                                                             // Endif for combined kernel
+  std::vector<unsigned> mask;                                   // Bits of excluded pairs
+  const bool exclude = skipExclusions(Ci,Cj,getSIMDWidth(),mask);// Mark excluded pairs of cell pair
+  if( hasBodiesSoA(Ci,Cj) ) {                                   // If bodies were gathered for the downward phase
+    const int ibegin = Ci->LEAF - SOAI0, jbegin = Cj->LEAF - SOAJ0;// First target and source in the arrays
+    P2P(SOAI,ibegin,ibegin+Ci->NDLEAF,getSourcesSoA(),jbegin,jbegin+Cj->NDLEAF,exclude ? &mask[0] : 0);// Run in place
+  } else {                                                      // If cells are not in the arrays
+    P2PCells(*this,Ci,Cj,exclude ? &mask[0] : 0);               //  Gather cell pair
+  }                                                             // Endif for gathered bodies
+}
+
+template<>
+void Kernel<Laplace>::P2PMutual(BodiesSoA &ibodies, int ibegin, int iend,
+                                BodiesSoA &jbodies, int jbegin, int jend) const {// Laplace mutual P2P kernel on CPU
+  const bool self = &ibodies == &jbodies && ibegin == jbegin;   // Bodies interact with themselves
+  const int ni = iend - ibegin, nj = jend - jbegin;             // Number of target and source bodies
+  if( ni == 0 || nj == 0 ) return;                              // Nothing to do for empty cells
+  const real *Xj = &jbodies.X[0][jbegin];                       // Source x coordinates
+  const real *Yj = &jbodies.X[1][jbegin];                       // Source y coordinates
+  const real *Zj = &jbodies.X[2][jbegin];                       // Source z coordinates
+  const real *Qj = &jbodies.SRC[jbegin];                        // Source values
+  real *Pj = &jbodies.TRG[0][jbegin];                           // Source potential
+  real *Fxj = &jbodies.TRG[1][jbegin];                          // Source x force
+  real *Fyj = &jbodies.TRG[2][jbegin];                          // Source y force
+  real *Fzj = &jbodies.TRG[3][jbegin];                          // Source z force
+#if SIMD && !FP64
+  if( SIMDLEVEL != SIMDNone ) {                                 // If SIMD kernels are available
+    void (*kernel)(const real*, const real*, const real*, const real*, real*, real*, real*, real*, int,
+                   const real*, const real*, const real*, const real*, real*, real*, real*, real*, int,
+                   bool) = P2PLaplaceMutualSSE;                 //  SIMD kernel
+    if( SIMDLEVEL == SIMDAVX2 ) kernel = P2PLaplaceMutualAVX2;  //  Use AVX2 kernel
+    if( SIMDLEVEL == SIMDAVX512 ) kernel = P2PLaplaceMutualAVX512;// Use AVX-512 kernel
+    kernel(&ibodies.X[0][ibegin],&ibodies.X[1][ibegin],&ibodies.X[2][ibegin],&ibodies.SRC[ibegin],
+           &ibodies.TRG[0][ibegin],&ibodies.TRG[1][ibegin],&ibodies.TRG[2][ibegin],&ibodies.TRG[3][ibegin],ni,
+           Xj,Yj,Zj,Qj,Pj,Fxj,Fyj,Fzj,nj,self);
+    return;                                                     //  Skip scalar kernel
+  }                                                             // Endif for SIMD kernels
+#endif
+  for( int i=0; i<ni; ++i ) {                                   // Loop over target bodies
+    const int b = ibegin + i;                                   //  Target index in the arrays
+    const real xi = ibodies.X[0][b] - Xperiodic[0];             //  Target x coordinate with periodic offset
+    const real yi = ibodies.X[1][b] - Xperiodic[1];             //  Target y coordinate with periodic offset
+    const real zi = ibodies.X[2][b] - Xperiodic[2];             //  Target z coordinate with periodic offset
+    real P0 = 0, F0 = 0, F1 = 0, F2 = 0;                        //  Initialize potential and force
+    P2PLaplaceMutualScalar(xi,yi,zi,ibodies.SRC[b],P0,F0,F1,F2,Xj,Yj,Zj,Qj,Pj,Fxj,Fyj,Fzj,self ? i+1 : 0,nj);// Sources
+    ibodies.TRG[0][b] += P0;                                    //  potential
+    ibodies.TRG[1][b] -= F0;                                    //  x component of force
+    ibodies.TRG[2][b] -= F1;                                    //  y component of force
+    ibodies.TRG[3][b] -= F2;                                    //  z component of force
+  }                                                             // End loop over target bodies
+}
+
+template<>
+void Kernel<Laplace>::P2PMutual(C_iter Ci, C_iter Cj) const {   // Laplace mutual P2P kernel on CPU
+  if( COULOMBVDW && hasVanDerWaalsTypes(Ci,Cj) ) {             // If Van der Waals is evaluated together
+    P2PCoulombVanDerWaals(Ci,Cj,true);                          //  Run combined kernel
+    return;                                                     //  Skip Laplace only kernel
+  }                                                             // Endif for combined kernel
+  std::vector<unsigned> imask, jmask;                           // Bits of excluded pairs in each direction
+  const int width = getSIMDWidth();                             // Targets per word of mask
+  const bool iexclude = skipExclusions(Ci,Cj,width,imask);      // Mark excluded pairs from Cj to Ci
+  const bool jexclude = Ci != Cj && skipExclusions(Cj,Ci,width,jmask);// Mark excluded pairs from Ci to Cj
+  if( hasBodiesSoA(Ci,Cj) ) {                                   // If bodies were gathered for the downward phase
+    assert( &getSourcesSoA() == &SOAI );                        //  Reaction is added to the target arrays
+    const int ibegin = Ci->LEAF - SOAI0, iend = ibegin + Ci->NDLEAF;// Range of first cell
+    const int jbegin = Cj->LEAF - SOAI0, jend = jbegin + Cj->NDLEAF;// Range of second cell
+    if( iexclude || jexclude ) {                                //  If cell pair has excluded pairs
+      P2P(SOAI,ibegin,iend,SOAI,jbegin,jend,iexclude ? &imask[0] : 0);// One-sided kernel skips them
+      if( Ci != Cj ) P2P(SOAI,jbegin,jend,SOAI,ibegin,iend,jexclude ? &jmask[0] : 0);// Opposite direction
+    } else if( Ci == Cj ) {                                     //  If cell interacts with itself
+      P2P(SOAI,ibegin,iend,SOAI,ibegin,iend);                   //   Full square vectorizes better than triangle
+    } else {                                                    //  If cells are distinct
+      P2PMutual(SOAI,ibegin,iend,SOAI,jbegin,jend);             //   Each pair once, both sides updated
+    }                                                           //  Endif for cell pair type
+    return;                                                     //  Skip gather
+  }                                                             // Endif for gathered bodies
+  if( iexclude || jexclude ) {                                  // If cell pair has excluded pairs
+    P2PCells(*this,Ci,Cj,iexclude ? &imask[0] : 0);             //  One-sided kernel skips them
+    if( Ci != Cj ) P2PCells(*this,Cj,Ci,jexclude ? &jmask[0] : 0);// Opposite direction
+    return;                                                     //  Skip mutual kernel
+  }                                                             // Endif for excluded pairs
+  P2PMutualCells(*this,Ci,Cj);                                  // Run on structure of arrays
+}
+
+template<>
+void Kernel<Laplace>::subtractExclusions() const {              // Laplace exclusion correction on CPU
+  const int ni = EXCLUDEOFFSET.size() - 1;                      // Number of target bodies
+  const real L = 2 * R0;                                        // Size of periodic box
 #pragma omp parallel for
-  for( int i=0; i<Ci->NDLEAF; ++i ) {                           // Loop over target bodies
-    B_iter Bi = Ci->LEAF+i;                                     //  Target body iterator
-    real P0 = 0;                                                //  Initialize potential
-    vect F0 = 0;                                                //  Initialize force
-    for( B_iter Bj=Cj->LEAF; Bj!=Cj->LEAF+Cj->NDLEAF; ++Bj ) {  //  Loop over source bodies
-      vect dist = Bi->X - Bj->X - Xperiodic;                    //   Distance vector from source to target
-      real R2 = norm(dist) + EPS2;                              //   R^2
-      real invR2 = 1.0 / R2;                                    //   1 / R^2
-      if( R2 == 0 ) invR2 = 0;                                  //   Exclude self interaction
+  for( int i=0; i<ni; ++i ) {                                   // Loop over target bodies in tree order
+    B_iter Bi = EXCLUDEI0 + i;                                  //  Target body iterator
+    real P0 = 0, F0 = 0, F1 = 0, F2 = 0;                        //  Initialize potential and force
+    for( int e=EXCLUDEOFFSET[i]; e<EXCLUDEOFFSET[i+1]; ++e ) {  //  Loop over excluded sources
+      if( EXCLUDESKIP[e] ) {                                    //   If P2P has skipped the pair
+        EXCLUDESKIP[e] = 0;                                     //    Reset flag for next traversal
+        continue;                                               //    Nothing to subtract
+      }                                                         //   Endif for skipped pair
+      B_iter Bj = EXCLUDEJ0 + EXCLUDE[e];                       //   Source body iterator
+      vect dX = Bi->X - Bj->X;                                  //   Distance vector from source to target
+      if( IMAGES != 0 ) {                                       //   If periodic boundary condition
+        for( int d=0; d!=3; ++d ) dX[d] -= L * std::floor((dX[d] + R0) / L);// Nearest image
+      }                                                         //   Endif for periodic boundary condition
+      real R2 = norm(dX) + EPS2;                                //   R^2
+      real invR2 = R2 == 0 ? 0 : 1 / R2;                        //   1 / R^2 (exclude self interaction)
       real invR = Bj->SRC * std::sqrt(invR2);                   //   potential
-      dist *= invR2 * invR;                                     //   force
+      real invR3 = invR2 * invR;                                //   force
       P0 += invR;                                               //   accumulate potential
-      F0 += dist;                                               //   accumulate force
-    }                                                           //  End loop over source bodies
-    Bi->TRG[0] += P0;                                           //  potential
-    Bi->TRG[1] -= F0[0];                                        //  x component of force
-    Bi->TRG[2] -= F0[1];                                        //  y component of force
-    Bi->TRG[3] -= F0[2];                                        //  z component of force
+      F0 += dX[0] * invR3;                                      //   accumulate x component of force
+      F1 += dX[1] * invR3;                                      //   accumulate y component of force
+      F2 += dX[2] * invR3;                                      //   accumulate z component of force
+    }                                                           //  End loop over excluded sources
+    Bi->TRG[0] -= P0;                                           //  Remove potential of excluded pairs
+    Bi->TRG[1] += F0;                                           //  Remove x force of excluded pairs
+    Bi->TRG[2] += F1;                                           //  Remove y force of excluded pairs
+    Bi->TRG[3] += F2;                                           //  Remove z force of excluded pairs
   }                                                             // End loop over target bodies
-#else
-  real (* cbi)[10] =  (real (*)[10])(&(Ci->LEAF->IBODY));
-  real (* cbj)[10] =  (real (*)[10])(&(Cj->LEAF->IBODY));
-  real xp[3] = {Xperiodic[0],Xperiodic[1],Xperiodic[2]};
-  int ni = Ci->NDLEAF;
-  int nj = Cj->NDLEAF;
-  int i,j;
-#pragma loop norecurrence
-  for(i=0;i<ni;i++){
-    for(j=0;j<nj;j++){
-      real dist_x = cbi[i][2] - cbj[j][2] - xp[0];
-      real dist_y = cbi[i][3] - cbj[j][3] - xp[1];
-      real dist_z = cbi[i][4] - cbj[j][4] - xp[2];
-      real R2 = EPS2+dist_x*dist_x+dist_y*dist_y+dist_z*dist_z;
-      real invR = 1.0/sqrt(R2);
-      if( R2 == 0 ) invR = 0;
-      real invR3 = cbj[j][5] * invR * invR * invR;
-      cbi[i][6] += cbj[j][5] * invR;
-      cbi[i][7] -= dist_x * invR3;
-      cbi[i][8] -= dist_y * invR3;
-      cbi[i][9] -= dist_z * invR3;
-    }
-  }
-#endif
 }
 
 template<>
-void Kernel<VanDerWaals>::P2P(C_iter Ci, C_iter Cj) const {     // Van der Waals P2P kernel on CPU
-  for( B_iter Bi=Ci->LEAF; Bi!=Ci->LEAF+Ci->NDLEAF; ++Bi ) {    // Loop over target bodies
-    int atypei = int(Bi->SRC);                                  //  Atom type of target
-    for( B_iter Bj=Cj->LEAF; Bj!=Cj->LEAF+Cj->NDLEAF; ++Bj ) {  //  Loop over source bodies
-      int atypej = int(Bj->SRC);                                //   Atom type of source
-      vect dist = Bi->X - Bj->X - Xperiodic;                    //   Distance vector from source to target
-      real R2 = norm(dist);                                     //   R squared
+void Kernel<VanDerWaals>::P2P(BodiesSoA &ibodies, int ibegin, int iend,
+                              const BodiesSoA &jbodies, int jbegin, int jend,
+                              const unsigned*) const {          // Van der Waals P2P kernel on CPU
+#if SIMD && !FP64
+  if( SIMDLEVEL != SIMDNone ) {                                 // If SIMD kernels are available
+    if( ibegin == iend || jbegin == jend ) return;              //  Nothing to do for empty ranges
+    void (*kernel)(const real*, const real*, const real*, const real*, real*, real*, real*, real*, int,
+                   const real*, const real*, const real*, const real*, int,
+                   const real*, const real*, int) = P2PVanDerWaalsSSE;// SIMD kernel
+    if( SIMDLEVEL == SIMDAVX2 ) kernel = P2PVanDerWaalsAVX2;    //  Use AVX2 kernel
+    if( SIMDLEVEL == SIMDAVX512 ) kernel = P2PVanDerWaalsAVX512;//  Use AVX-512 kernel
+    kernel(&ibodies.X[0][ibegin],&ibodies.X[1][ibegin],&ibodies.X[2][ibegin],&ibodies.SRC[ibegin],
+           &ibodies.TRG[0][ibegin],&ibodies.TRG[1][ibegin],&ibodies.TRG[2][ibegin],&ibodies.TRG[3][ibegin],iend-ibegin,
+           &jbodies.X[0][jbegin],&jbodies.X[1][jbegin],&jbodies.X[2][jbegin],&jbodies.SRC[jbegin],jend-jbegin,
+           &RSCALE[0],&GSCALE[0],ATOMS);
+    return;                                                     //  Skip scalar kernel
+  }                                                             // Endif for SIMD kernels
+#endif
+  for( int i=ibegin; i<iend; ++i ) {                            // Loop over target bodies
+    int atypei = int(ibodies.SRC[i]);                           //  Atom type of target
+    for( int j=jbegin; j<jend; ++j ) {                          //  Loop over source bodies
+      int atypej = int(jbodies.SRC[j]);                         //   Atom type of source
+      real dx = ibodies.X[0][i] - jbodies.X[0][j] - Xperiodic[0];//   x distance from source to target
+      real dy = ibodies.X[1][i] - jbodies.X[1][j] - Xperiodic[1];//   y distance from source to target
+      real dz = ibodies.X[2][i] - jbodies.X[2][j] - Xperiodic[2];//   z distance from source to target
+      real R2 = dx * dx + dy * dy + dz * dz;                    //   R squared
       if( R2 != 0 ) {                                           //   Exclude self interaction
         real rs = RSCALE[atypei*ATOMS+atypej];                  //    r scale
         real gs = GSCALE[atypei*ATOMS+atypej];                  //    g scale
@@ -88,12 +1413,103 @@ void Kernel<VanDerWaals>::P2P(C_iter Ci, C_iter Cj) const {     // Van der Waals
           real invR2 = 1.0 / R2s;                               //     1 / R^2
           real invR6 = invR2 * invR2 * invR2;                   //     1 / R^6
           real dtmp = gs * invR6 * invR2 * (2.0 * invR6 - 1.0); //     g scale / R^2 * (2 / R^12 + 1 / R^6)
-          Bi->TRG[0] += gs * invR6 * (invR6 - 1.0);             //     Van der Waals potential
-          Bi->TRG[1] -= dist[0] * dtmp;                         //     x component of Van der Waals force
-          Bi->TRG[2] -= dist[1] * dtmp;                         //     y component of Van der Waals force
-          Bi->TRG[3] -= dist[2] * dtmp;                         //     z component of Van der Waals force
+          ibodies.TRG[0][i] += gs * invR6 * (invR6 - 1.0);      //     Van der Waals potential
+          ibodies.TRG[1][i] -= dx * dtmp;                       //     x component of Van der Waals force
+          ibodies.TRG[2][i] -= dy * dtmp;                       //     y component of Van der Waals force
+          ibodies.TRG[3][i] -= dz * dtmp;                       //     z component of Van der Waals force
         }                                                       //    End if for outlier values
-      }                                                         //   End if for self interaction 
+      }                                                         //   End if for self interaction
     }                                                           //  End loop over source bodies
   }                                                             // End loop over target bodies
 }
+
+template<>
+void Kernel<VanDerWaals>::P2P(C_iter Ci, C_iter Cj) const {     // Van der Waals P2P kernel on CPU
+  if( CUTOFFSKIP ) {                                            // If cell pairs outside the cutoff are skipped
+    if( getR2min(Ci,Cj) >= R2MAX ) return;                      //  No pair can be inside the cutoff
+  }                                                             // Endif for cutoff skip
+  if( hasBodiesSoA(Ci,Cj) ) {                                   // If bodies were gathered for the downward phase
+    const int ibegin = Ci->LEAF - SOAI0, jbegin = Cj->LEAF - SOAJ0;// First target and source in the arrays
+    P2P(SOAI,ibegin,ibegin+Ci->NDLEAF,getSourcesSoA(),jbegin,jbegin+Cj->NDLEAF);// Run in place
+  } else {                                                      // If cells are not in the arrays
+    P2PCells(*this,Ci,Cj);                                      //  Gather cell pair
+  }                                                             // Endif for gathered bodies
+}
+
+template<>
+void Kernel<VanDerWaals>::P2PMutual(BodiesSoA &ibodies, int ibegin, int iend,
+                                    BodiesSoA &jbodies, int jbegin, int jend) const {// Van der Waals mutual P2P kernel on CPU
+  const bool self = &ibodies == &jbodies && ibegin == jbegin;   // Bodies interact with themselves
+  for( int i=ibegin; i<iend; ++i ) {                            // Loop over target bodies
+    int atypei = int(ibodies.SRC[i]);                           //  Atom type of target
+    for( int j=self ? i+1 : jbegin; j<jend; ++j ) {             //  Loop over source bodies (upper triangle if self)
+      int atypej = int(jbodies.SRC[j]);                         //   Atom type of source
+      real dx = ibodies.X[0][i] - jbodies.X[0][j] - Xperiodic[0];//   x distance from source to target
+      real dy = ibodies.X[1][i] - jbodies.X[1][j] - Xperiodic[1];//   y distance from source to target
+      real dz = ibodies.X[2][i] - jbodies.X[2][j] - Xperiodic[2];//   z distance from source to target
+      real R2 = dx * dx + dy * dy + dz * dz;                    //   R squared
+      if( R2 != 0 && R2MIN <= R2 && R2 < R2MAX ) {              //   Exclude self interaction and outlier values
+        for( int side=0; side!=2; ++side ) {                    //    Loop over target and source side
+          int ij = side == 0 ? atypei*ATOMS+atypej : atypej*ATOMS+atypei;// Parameter index seen from this side
+          real invR2 = 1.0 / (R2 * RSCALE[ij]);                 //     1 / R^2
+          real invR6 = invR2 * invR2 * invR2;                   //     1 / R^6
+          real gs = GSCALE[ij];                                 //     g scale
+          real dtmp = gs * invR6 * invR2 * (2.0 * invR6 - 1.0); //     g scale / R^2 * (2 / R^12 + 1 / R^6)
+          BodiesSoA &B = side == 0 ? ibodies : jbodies;         //     Bodies on this side
+          int b = side == 0 ? i : j;                            //     Index on this side
+          real sign = side == 0 ? 1 : -1;                       //     Distance vector points the other way for source
+          B.TRG[0][b] += gs * invR6 * (invR6 - 1.0);            //     Van der Waals potential
+          B.TRG[1][b] -= sign * dx * dtmp;                      //     x component of Van der Waals force
+          B.TRG[2][b] -= sign * dy * dtmp;                      //     y component of Van der Waals force
+          B.TRG[3][b] -= sign * dz * dtmp;                      //     z component of Van der Waals force
+        }                                                       //    End loop over sides
+      }                                                         //   End if for self interaction and outlier values
+    }                                                           //  End loop over source bodies
+  }                                                             // End loop over target bodies
+}
+
+template<>
+void Kernel<VanDerWaals>::P2PMutual(C_iter Ci, C_iter Cj) const {// Van der Waals mutual P2P kernel on CPU
+  if( CUTOFFSKIP && Ci != Cj ) {                                // If cell pairs outside the cutoff are skipped
+    if( getR2min(Ci,Cj) >= R2MAX ) return;                      //  No pair can be inside the cutoff
+  }                                                             // Endif for cutoff skip
+  if( hasBodiesSoA(Ci,Cj) ) {                                   // If bodies were gathered for the downward phase
+    assert( &getSourcesSoA() == &SOAI );                        //  Reaction is added to the target arrays
+    const int ibegin = Ci->LEAF - SOAI0, iend = ibegin + Ci->NDLEAF;// Range of first cell
+    const int jbegin = Cj->LEAF - SOAI0, jend = jbegin + Cj->NDLEAF;// Range of second cell
+    if( Ci == Cj ) P2P(SOAI,ibegin,iend,SOAI,ibegin,iend);      //  Full square vectorizes better than triangle
+    else P2PMutual(SOAI,ibegin,iend,SOAI,jbegin,jend);          //  Each pair once, both sides updated
+    return;                                                     //  Skip gather
+  }                                                             // Endif for gathered bodies
+  P2PMutualCells(*this,Ci,Cj);                                  // Run on structure of arrays
+}
+
+template<>
+void Kernel<VanDerWaals>::subtractExclusions() const {          // Van der Waals exclusion correction on CPU
+  const int ni = EXCLUDEOFFSET.size() - 1;                      // Number of target bodies
+  const real L = 2 * R0;                                        // Size of periodic box
+#pragma omp parallel for
+  for( int i=0; i<ni; ++i ) {                                   // Loop over target bodies in tree order
+    B_iter Bi = EXCLUDEI0 + i;                                  //  Target body iterator
+    int atypei = int(Bi->SRC);                                  //  Atom type of target
+    for( int e=EXCLUDEOFFSET[i]; e<EXCLUDEOFFSET[i+1]; ++e ) {  //  Loop over excluded sources (P2P never skips them)
+      B_iter Bj = EXCLUDEJ0 + EXCLUDE[e];                       //   Source body iterator
+      vect dX = Bi->X - Bj->X;                                  //   Distance vector from source to target
+      if( IMAGES != 0 ) {                                       //   If periodic boundary condition
+        for( int d=0; d!=3; ++d ) dX[d] -= L * std::floor((dX[d] + R0) / L);// Nearest image
+      }                                                         //   Endif for periodic boundary condition
+      real R2 = norm(dX);                                       //   R squared
+      if( R2 != 0 && R2MIN <= R2 && R2 < R2MAX ) {              //   Exclude self interaction and outlier values
+        int ij = atypei * ATOMS + int(Bj->SRC);                 //    Parameter index
+        real invR2 = 1.0 / (R2 * RSCALE[ij]);                   //    1 / R^2
+        real invR6 = invR2 * invR2 * invR2;                     //    1 / R^6
+        real gs = GSCALE[ij];                                   //    g scale
+        real dtmp = gs * invR6 * invR2 * (2.0 * invR6 - 1.0);   //    g scale / R^2 * (2 / R^12 + 1 / R^6)
+        Bi->TRG[0] -= gs * invR6 * (invR6 - 1.0);               //    Remove Van der Waals potential
+        Bi->TRG[1] += dX[0] * dtmp;                             //    Remove x component of Van der Waals force
+        Bi->TRG[2] += dX[1] * dtmp;                             //    Remove y component of Van der Waals force
+        Bi->TRG[3] += dX[2] * dtmp;                             //    Remove z component of Van der Waals force
+      }                                                         //   End if for self interaction and outlier values
+    }                                                           //  End loop over excluded sources
+  }                                                             // End loop over target bodies
+}
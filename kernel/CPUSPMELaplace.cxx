@@ -0,0 +1,279 @@
+/*
+Copyright (C) 2011 by Rio Yokota, Simon Layton, Lorena Barba
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+#define KERNEL
+#include "kernel.h"
+#undef KERNEL
+
+namespace {
+typedef std::complex<double> dcomplex;                          // Mesh values are kept in double precision
+
+//! Cardinal B-spline weights M_n(w+n-1-j) and their derivatives for fractional coordinate w
+void bspline(double w, int n, double *theta, double *dtheta) {
+  theta[n-1] = 0;                                               // Start from second order
+  theta[1] = w;                                                 // M_2(w)
+  theta[0] = 1 - w;                                             // M_2(w+1)
+  for( int k=3; k<n; ++k ) {                                    // Loop up to order n-1
+    double div = 1. / (k - 1);                                  //  Recursion M_k from M_k-1
+    theta[k-1] = div * w * theta[k-2];                          //  Last weight
+    for( int j=1; j<k-1; ++j ) {                                //  Loop over inner weights
+      theta[k-j-1] = div * ((w + j) * theta[k-j-2] + (k - j - w) * theta[k-j-1]);
+    }                                                           //  End loop over inner weights
+    theta[0] = div * (1 - w) * theta[0];                        //  First weight
+  }                                                             // End loop up to order n-1
+  dtheta[0] = -theta[0];                                        // M_n'(x) = M_n-1(x) - M_n-1(x-1)
+  for( int j=1; j<n; ++j ) {                                    // Loop over weights
+    dtheta[j] = theta[j-1] - theta[j];                          //  Derivative from order n-1
+  }                                                             // End loop over weights
+  double div = 1. / (n - 1);                                    // Last step to order n
+  theta[n-1] = div * w * theta[n-2];                            // Last weight
+  for( int j=1; j<n-1; ++j ) {                                  // Loop over inner weights
+    theta[n-j-1] = div * ((w + j) * theta[n-j-2] + (n - j - w) * theta[n-j-1]);
+  }                                                             // End loop over inner weights
+  theta[0] = div * (1 - w) * theta[0];                          // First weight
+}
+
+//! Grid plane of the last B-spline weight and fractional coordinate w
+int gridIndex(real x, double scale, int M, double &w) {
+  double u = x * scale;                                         // Coordinate in grid units
+  double base = std::floor(u);                                  // Grid point below u
+  w = u - base;                                                 // Fractional part
+  int i = int(base) % M;                                        // Wrap into the grid
+  return i < 0 ? i + M : i;                                     // Keep index positive
+}
+
+//! In-place radix-2 complex FFT of length n using twiddles w[k] = exp(2 pi i k/m) (n divides m)
+void fft(dcomplex *a, int n, const dcomplex *w, int m, int sign) {
+  for( int i=1, j=0; i<n; ++i ) {                               // Bit reversal permutation
+    int bit = n >> 1;                                           //  Highest bit
+    for( ; j & bit; bit >>= 1 ) j ^= bit;                       //  Reversed increment
+    j ^= bit;                                                   //  Set bit
+    if( i < j ) std::swap(a[i],a[j]);                           //  Swap once per pair
+  }                                                             // End bit reversal permutation
+  for( int len=2; len<=n; len<<=1 ) {                           // Loop over butterfly stages
+    int step = m / len;                                         //  Stride in twiddle table
+    for( int k=0; k<len/2; ++k ) {                              //  Loop over twiddles of stage
+      dcomplex wk = sign > 0 ? w[k*step] : std::conj(w[k*step]);//   Twiddle factor
+      for( int i=k; i<n; i+=len ) {                             //   Loop over butterflies
+        dcomplex t = a[i+len/2] * wk;                           //    Odd part
+        a[i+len/2] = a[i] - t;                                  //    Lower half
+        a[i] += t;                                              //    Upper half
+      }                                                         //   End loop over butterflies
+    }                                                           //  End loop over twiddles of stage
+  }                                                             // End loop over butterfly stages
+}
+
+//! Real-to-complex FFT of a line of m reals packed in h=m/2 complex values (h+1 outputs)
+void realFFT(dcomplex *a, const dcomplex *w, int m) {
+  int h = m / 2;                                                // Half length
+  fft(a,h,w,m,1);                                               // Even and odd samples at once
+  dcomplex z = a[0];                                            // Zero and Nyquist frequencies
+  a[0] = z.real() + z.imag();                                   // Sum of even and odd
+  a[h] = z.real() - z.imag();                                   // Difference of even and odd
+  for( int k=1; k<=h/2; ++k ) {                                 // Loop over pairs k, h-k
+    dcomplex A = a[k], B = a[h-k];                              //  Packed spectra
+    dcomplex E = .5 * (A + std::conj(B));                       //  Spectrum of even samples
+    dcomplex O = dcomplex(0,-.5) * (A - std::conj(B));          //  Spectrum of odd samples
+    a[k] = E + w[k] * O;                                        //  Frequency k
+    a[h-k] = std::conj(E - w[k] * O);                           //  Frequency h-k from Hermitian symmetry
+  }                                                             // End loop over pairs
+}
+
+//! Complex-to-real inverse FFT of h+1 Hermitian values into m reals packed in h complex values
+void realIFFT(dcomplex *a, const dcomplex *w, int m) {
+  int h = m / 2;                                                // Half length
+  dcomplex X0 = a[0], Xh = a[h];                                // Zero and Nyquist frequencies
+  a[0] = (X0 + std::conj(Xh)) + dcomplex(0,1) * (X0 - std::conj(Xh));// Even and odd parts
+  for( int k=1; k<=h/2; ++k ) {                                 // Loop over pairs k, h-k
+    dcomplex A = a[k], B = a[h-k];                              //  Spectra at k and h-k
+    dcomplex E = A + std::conj(B);                              //  Spectrum of even samples
+    dcomplex O = (A - std::conj(B)) * std::conj(w[k]);          //  Spectrum of odd samples
+    a[k] = E + dcomplex(0,1) * O;                               //  Pack at k
+    a[h-k] = std::conj(E - dcomplex(0,1) * O);                  //  Pack at h-k from Hermitian symmetry
+  }                                                             // End loop over pairs
+  fft(a,h,w,m,-1);                                              // Even samples real, odd samples imaginary
+}
+
+//! Forward (sign=1) or inverse (sign=-1) 3-D FFT of an m^3 real grid with lines padded to m+2
+void fft3d(double *grid, const dcomplex *w, int m, int sign) {
+  int h = m / 2, nz = h + 1;                                    // Complex values per z line
+  dcomplex *a = reinterpret_cast<dcomplex*>(grid);              // Complex view of the grid
+  if( sign > 0 ) {                                              // Forward transform starts in z
+#pragma omp parallel for
+    for( int i=0; i<m*m; ++i ) realFFT(a+i*nz,w,m);             //  Real to complex along z
+  }                                                             // End if for forward transform
+#pragma omp parallel
+  {                                                             // Lines in y and x
+    std::vector<dcomplex> line(m);                              //  Buffer for one strided line
+#pragma omp for
+    for( int ix=0; ix<m; ++ix ) {                               //  Loop over x planes
+      for( int iz=0; iz<nz; ++iz ) {                            //   Loop over z frequencies
+        dcomplex *p = a + ix * m * nz + iz;                     //    First value of y line
+        for( int iy=0; iy<m; ++iy ) line[iy] = p[iy*nz];        //    Gather
+        fft(&line[0],m,w,m,sign);                               //    Transform along y
+        for( int iy=0; iy<m; ++iy ) p[iy*nz] = line[iy];        //    Scatter
+      }                                                         //   End loop over z frequencies
+    }                                                           //  End loop over x planes
+#pragma omp for
+    for( int iy=0; iy<m; ++iy ) {                               //  Loop over y planes
+      for( int iz=0; iz<nz; ++iz ) {                            //   Loop over z frequencies
+        dcomplex *p = a + iy * nz + iz;                         //    First value of x line
+        for( int ix=0; ix<m; ++ix ) line[ix] = p[ix*m*nz];      //    Gather
+        fft(&line[0],m,w,m,sign);                               //    Transform along x
+        for( int ix=0; ix<m; ++ix ) p[ix*m*nz] = line[ix];      //    Scatter
+      }                                                         //   End loop over z frequencies
+    }                                                           //  End loop over y planes
+  }                                                             // End parallel region
+  if( sign < 0 ) {                                              // Inverse transform ends in z
+#pragma omp parallel for
+    for( int i=0; i<m*m; ++i ) realIFFT(a+i*nz,w,m);            //  Complex to real along z
+  }                                                             // End if for inverse transform
+}
+}
+
+template<>
+void Kernel<Laplace>::EwaldSPME(Bodies &bodies) const {         // Ewald wave part by smooth particle mesh on CPU
+  const int M = SPMEGRID, n = SPMEORDER, h = M / 2, nz = M + 2; // Grid size, spline order, padded z length
+  assert( M >= 4 && (M & (M - 1)) == 0 );                       // Radix-2 FFT
+  assert( 3 <= n && n <= M );                                   // Spline has to fit in the grid
+  const double scale = M_PI / R0;                               // Wave number of K = 1
+  const double gscale = M / (2 * R0);                           // Grid points per unit length
+  const double factor = .5 * .25 / M_PI / M_PI / SIGMA / R0;   // Same as EwaldWave, halved for full k-space
+  const double coef2 = scale * scale / (4 * ALPHA * ALPHA);     // Exponent of Gaussian screening
+
+  std::vector<dcomplex> twiddle(h);                             // Twiddle factors for length M
+  for( int k=0; k<h; ++k ) {                                    // Loop over half the circle
+    twiddle[k] = dcomplex(std::cos(2 * M_PI * k / M),std::sin(2 * M_PI * k / M));
+  }                                                             // End loop over half the circle
+
+  std::vector<double> theta(n), dtheta(n), moduli(M);           // |b(m)|^2 of Euler exponential splines
+  bspline(0,n,&theta[0],&dtheta[0]);                            // M_n at integers
+  for( int m=0; m<M; ++m ) {                                    // Loop over grid frequencies
+    dcomplex sum = 0;                                           //  Interpolated Fourier factor
+    for( int k=0; k<n-1; ++k ) {                                //  Loop over M_n(k+1)
+      sum += theta[n-2-k] * std::polar(1.,2 * M_PI * m * k / M);//   Accumulate
+    }                                                           //  End loop over M_n(k+1)
+    moduli[m] = std::norm(sum) < 1e-10 ? 0 : 1 / std::norm(sum);//  Zero only at Nyquist of odd orders
+  }                                                             // End loop over grid frequencies
+  for( int m=0; m<M; ++m ) {                                    // Loop over grid frequencies
+    if( moduli[m] == 0 ) moduli[m] = .5 * (moduli[(m+M-1)%M] + moduli[(m+1)%M]);// Average neighbors
+  }                                                             // End loop over grid frequencies
+
+  int nchunk = 1;                                               // Chunks per dimension for spreading
+  while( M / (2 * nchunk) >= n ) nchunk *= 2;                   // Chunks at least n planes wide
+  const int width = M / nchunk;                                 // Planes per chunk
+  std::vector<int> offset(nchunk*nchunk+1,0), chunk(bodies.size()), index(bodies.size());
+  for( int i=0; i<int(bodies.size()); ++i ) {                   // Loop over bodies
+    double w;                                                   //  Fractional coordinate (unused)
+    int ix = gridIndex(bodies[i].X[0],gscale,M,w);              //  x plane of body
+    int iy = gridIndex(bodies[i].X[1],gscale,M,w);              //  y plane of body
+    chunk[i] = ix / width * nchunk + iy / width;                //  Chunk of body
+    offset[chunk[i]+1]++;                                       //  Count bodies in chunk
+  }                                                             // End loop over bodies
+  for( int c=0; c<nchunk*nchunk; ++c ) offset[c+1] += offset[c];// Scan counts
+  std::vector<int> next(offset.begin(),offset.end()-1);         // Fill position of each chunk
+  for( int i=0; i<int(bodies.size()); ++i ) index[next[chunk[i]]++] = i;// Bucket bodies by chunk
+
+  std::vector<double> grid(M*M*nz,0);                           // Charge grid, z lines padded for r2c FFT
+  for( int phase=0; phase<4; ++phase ) {                        // Chunks two apart in x or y never overlap
+#pragma omp parallel
+    {
+      std::vector<double> th(3*n), dth(3*n);                    //  B-spline weights of one body
+#pragma omp for schedule(dynamic)
+      for( int c=0; c<nchunk*nchunk; ++c ) {                    //  Loop over chunks
+        if( (c / nchunk) % 2 + 2 * (c % nchunk % 2) != phase ) continue;// Chunk belongs to other phase
+        for( int b=offset[c]; b<offset[c+1]; ++b ) {            //   Loop over bodies in chunk
+          B_iter B = bodies.begin() + index[b];                 //    Body iterator
+          int i0[3];                                            //    First grid point in each dimension
+          for( int d=0; d<3; ++d ) {                            //    Loop over dimensions
+            double w;                                           //     Fractional coordinate
+            i0[d] = gridIndex(B->X[d],gscale,M,w) - n + 1 + M;  //     Last weight is at the body's plane
+            bspline(w,n,&th[d*n],&dth[d*n]);                    //     Weights
+          }                                                     //    End loop over dimensions
+          for( int jx=0; jx<n; ++jx ) {                         //    Loop over x weights
+            int gx = (i0[0] + jx) % M;                          //     Grid x index
+            for( int jy=0; jy<n; ++jy ) {                       //     Loop over y weights
+              int gy = (i0[1] + jy) % M;                        //      Grid y index
+              double q = B->SRC * th[jx] * th[n+jy];            //      Charge times x, y weights
+              double *g = &grid[(gx*M+gy)*nz];                  //      z line
+              for( int jz=0; jz<n; ++jz ) {                     //      Loop over z weights
+                g[(i0[2]+jz)%M] += q * th[2*n+jz];              //       Spread charge
+              }                                                 //      End loop over z weights
+            }                                                   //     End loop over y weights
+          }                                                     //    End loop over x weights
+        }                                                       //   End loop over bodies in chunk
+      }                                                         //  End loop over chunks
+    }                                                           // End parallel region
+  }                                                             // End loop over phases
+
+  fft3d(&grid[0],&twiddle[0],M,1);                              // Structure factor on the grid
+  dcomplex *spectrum = reinterpret_cast<dcomplex*>(&grid[0]);   // Complex view of transformed grid
+#pragma omp parallel for
+  for( int kx=0; kx<M; ++kx ) {                                 // Loop over x frequencies
+    int Kx = kx <= h ? kx : kx - M;                             //  Signed wave number
+    for( int ky=0; ky<M; ++ky ) {                               //  Loop over y frequencies
+      int Ky = ky <= h ? ky : ky - M;                           //   Signed wave number
+      for( int kz=0; kz<=h; ++kz ) {                            //   Loop over non-negative z frequencies
+        double R2 = Kx * Kx + Ky * Ky + kz * kz;                //    |K|^2
+        double influence = R2 == 0 ? 0 : factor * std::exp(-R2 * coef2) / R2 * moduli[kx] * moduli[ky] * moduli[kz];
+        spectrum[(kx*M+ky)*(h+1)+kz] *= influence;              //    Influence function
+      }                                                         //   End loop over z frequencies
+    }                                                           //  End loop over y frequencies
+  }                                                             // End loop over x frequencies
+  fft3d(&grid[0],&twiddle[0],M,-1);                             // Potential on the grid
+
+#pragma omp parallel
+  {
+    std::vector<double> th(3*n), dth(3*n);                      // B-spline weights of one body
+#pragma omp for
+    for( int i=0; i<int(bodies.size()); ++i ) {                 // Loop over bodies
+      B_iter B = bodies.begin() + i;                            //  Body iterator
+      int i0[3];                                                //  First grid point in each dimension
+      for( int d=0; d<3; ++d ) {                                //  Loop over dimensions
+        double w;                                               //   Fractional coordinate
+        i0[d] = gridIndex(B->X[d],gscale,M,w) - n + 1 + M;      //   Last weight is at the body's plane
+        bspline(w,n,&th[d*n],&dth[d*n]);                        //   Weights and derivatives
+      }                                                         //  End loop over dimensions
+      double TRG[4] = {0, 0, 0, 0};                             //  Potential and gradient
+      for( int jx=0; jx<n; ++jx ) {                             //  Loop over x weights
+        int gx = (i0[0] + jx) % M;                              //   Grid x index
+        for( int jy=0; jy<n; ++jy ) {                           //   Loop over y weights
+          int gy = (i0[1] + jy) % M;                            //    Grid y index
+          const double *g = &grid[(gx*M+gy)*nz];                //    z line
+          double phi = 0, dphi = 0;                             //    Line sums of weights and derivatives
+          for( int jz=0; jz<n; ++jz ) {                         //    Loop over z weights
+            double value = g[(i0[2]+jz)%M];                     //     Grid potential
+            phi += th[2*n+jz] * value;                          //     Weighted sum
+            dphi += dth[2*n+jz] * value;                        //     Derivative in z
+          }                                                     //    End loop over z weights
+          TRG[0] += th[jx] * th[n+jy] * phi;                    //    Potential
+          TRG[1] += dth[jx] * th[n+jy] * phi;                   //    x derivative
+          TRG[2] += th[jx] * dth[n+jy] * phi;                   //    y derivative
+          TRG[3] += th[jx] * th[n+jy] * dphi;                   //    z derivative
+        }                                                       //   End loop over y weights
+      }                                                         //  End loop over x weights
+      B->TRG[0] = TRG[0];                                       //  Overwrite like EwaldWave
+      for( int d=0; d<3; ++d ) B->TRG[d+1] = TRG[d+1] * gscale; //  Gradient in physical units
+    }                                                           // End loop over bodies
+  }                                                             // End parallel region
+
+  dipoleCorrection(bodies);                                     // Same correction as EwaldWave
+}
@@ -64,7 +64,8 @@ void Kernel<Laplace>::initialize() {}
 template<>
 void Kernel<Laplace>::P2M(C_iter Cj) {
   real Rmax = 0;
-  complex Ynm[P*P], YnmTheta[P*P];
+  complex Ynm[PMAX*PMAX], YnmTheta[PMAX*PMAX];
+  Coef *Mj = getM(Cj);
   for( B_iter B=Cj->LEAF; B!=Cj->LEAF+Cj->NCLEAF; ++B ) {
     vect dist = B->X - Cj->X;
     real R = std::sqrt(norm(dist));
@@ -72,11 +73,11 @@ void Kernel<Laplace>::P2M(C_iter Cj) {
     real rho, alpha, beta;
     cart2sph(rho,alpha,beta,dist);
     evalMultipole(rho,alpha,-beta,Ynm,YnmTheta);
-    for( int n=0; n!=P; ++n ) {
+    for( int n=0; n!=ORDER; ++n ) {
       for( int m=0; m<=n; ++m ) {
         int nm  = n * n + n + m;
         int nms = n * (n + 1) / 2 + m;
-        Cj->M[nms] += B->SRC * Ynm[nm];
+        Mj[nms] += B->SRC * Ynm[nm];
       }
     }
   }
@@ -87,16 +88,18 @@ void Kernel<Laplace>::P2M(C_iter Cj) {
 template<>
 void Kernel<Laplace>::M2M(C_iter Ci) {
   const complex I(0.,1.);
-  complex Ynm[P*P], YnmTheta[P*P];
+  complex Ynm[PMAX*PMAX], YnmTheta[PMAX*PMAX];
+  Coef *Mi = getM(Ci);
   real Rmax = Ci->RMAX;
   for( C_iter Cj=Cj0+Ci->CHILD; Cj!=Cj0+Ci->CHILD+Ci->NCHILD; ++Cj ) {
+    const Coef *Mj = getM(Cj);
     vect dist = Ci->X - Cj->X;
     real R = std::sqrt(norm(dist)) + Cj->RCRIT;
     if( R > Rmax ) Rmax = R;
     real rho, alpha, beta;
     cart2sph(rho,alpha,beta,dist);
     evalMultipole(rho,alpha,-beta,Ynm,YnmTheta);
-    for( int j=0; j!=P; ++j ) {
+    for( int j=0; j!=ORDER; ++j ) {
       for( int k=0; k<=j; ++k ) {
         int jk = j * j + j + k;
         int jks = j * (j + 1) / 2 + k;
@@ -107,7 +110,7 @@ void Kernel<Laplace>::M2M(C_iter Ci) {
               int jnkm  = (j - n) * (j - n) + j - n + k - m;
               int jnkms = (j - n) * (j - n + 1) / 2 + k - m;
               int nm    = n * n + n + m;
-              M += Cj->M[jnkms] * std::pow(I,real(m-abs(m))) * Ynm[nm]
+              M += Mj[jnkms] * std::pow(I,real(m-abs(m))) * Ynm[nm]
                  * real(ODDEVEN(n) * Anm[nm] * Anm[jnkm] / Anm[jk]);
             }
           }
@@ -116,12 +119,12 @@ void Kernel<Laplace>::M2M(C_iter Ci) {
               int jnkm  = (j - n) * (j - n) + j - n + k - m;
               int jnkms = (j - n) * (j - n + 1) / 2 - k + m;
               int nm    = n * n + n + m;
-              M += std::conj(Cj->M[jnkms]) * Ynm[nm]
+              M += std::conj(Mj[jnkms]) * Ynm[nm]
                  * real(ODDEVEN(k+n+m) * Anm[nm] * Anm[jnkm] / Anm[jk]);
             }
           }
         }
-        Ci->M[jks] += M * EPS;
+        Mi[jks] += M * EPS;
       }
     }
   }
@@ -131,33 +134,87 @@ void Kernel<Laplace>::M2M(C_iter Ci) {
 
 template<>
 void Kernel<Laplace>::M2L(C_iter Ci, C_iter Cj) const {
-  complex Ynm[P*P], YnmTheta[P*P];
+  const Coef *Mj = getM(Cj);
+  Coef *Li = getL(Ci);
   vect dist = Ci->X - Cj->X - Xperiodic;
   real rho, alpha, beta;
   cart2sph(rho,alpha,beta,dist);
+  if( ROTATEM2L ) {                                             // Rotate to z axis, translate along z, rotate back
+    const complex I(0.,1.);                                     // Imaginary unit
+    std::vector<real> scratch;                                  // Rotation coefficients if not cached
+    const real *forward = getRotation(alpha,scratch);           // Rotation by alpha about y axis
+    const real *backward = forward + ORDER * (ORDER + 1) * (2 * ORDER + 1) / 3;// Rotation by -alpha about y axis
+    complex eim[PMAX], Mnm[PMAX*(PMAX+1)/2], Mrot[PMAX*(PMAX+1)/2];
+    real rhon[2*PMAX];
+    eim[0] = 1;                                                 // exp(i * 0 * beta)
+    for( int m=1; m!=ORDER; ++m ) eim[m] = eim[m-1] * std::exp(I * beta);// exp(i * m * beta)
+    rhon[0] = 1 / rho;                                          // rho^(-1)
+    for( int n=1; n!=2*ORDER; ++n ) rhon[n] = rhon[n-1] / rho;  // rho^(-n-1)
+    for( int n=0; n!=ORDER; ++n ) {
+      for( int m=0; m<=n; ++m ) {
+        int nms = n * (n + 1) / 2 + m;
+        Mnm[nms] = Mj[nms] * eim[m];                            // Rotate by beta about z axis
+      }
+    }
+    for( int n=0; n!=ORDER; ++n ) {
+      for( int k=0; k<=n; ++k ) {
+        complex M = 0;
+        for( int m=0; m<=n; ++m, forward+=2 ) {
+          int nms = n * (n + 1) / 2 + m;
+          M += complex(std::real(Mnm[nms]) * forward[0], std::imag(Mnm[nms]) * forward[1]);
+        }
+        Mrot[n*(n+1)/2+k] = M;                                  // Rotate by alpha about y axis
+      }
+    }
+    for( int j=0; j!=ORDER; ++j ) {
+      for( int k=0; k<=j; ++k ) {
+        int jk = j * j + j + k;
+        int jks = j * (j + 1) / 2 + k;
+        complex L = 0;
+        for( int n=k; n<ORDER-j; ++n ) {                        // Only order k couples along the z axis
+          int nks  = n * (n + 1) / 2 + k;
+          int jknm = jk * PMAX * PMAX + n * n + n + k;
+          L += Mrot[nks] * std::real(Cnm[jknm]) * rhon[j+n];
+        }
+        Mnm[jks] = L;                                           // Reuse buffer for rotated local expansion
+      }
+    }
+    for( int j=0; j!=ORDER; ++j ) {
+      for( int k=0; k<=j; ++k ) {
+        complex L = 0;
+        for( int m=0; m<=j; ++m, backward+=2 ) {
+          int jms = j * (j + 1) / 2 + m;
+          L += complex(std::real(Mnm[jms]) * backward[0], std::imag(Mnm[jms]) * backward[1]);
+        }
+        Li[j*(j+1)/2+k] += L * std::conj(eim[k]);               // Rotate back by -alpha and -beta
+      }
+    }
+    return;
+  }
+  complex Ynm[PMAX*PMAX], YnmTheta[PMAX*PMAX];
   evalLocal(rho,alpha,beta,Ynm,YnmTheta);
-  for( int j=0; j!=P; ++j ) {
+  for( int j=0; j!=ORDER; ++j ) {
     for( int k=0; k<=j; ++k ) {
       int jk = j * j + j + k;
       int jks = j * (j + 1) / 2 + k;
       complex L = 0;
-      for( int n=0; n!=P-j; ++n ) {
+      for( int n=0; n!=ORDER-j; ++n ) {
         for( int m=-n; m<0; ++m ) {
           int nm   = n * n + n + m;
           int nms  = n * (n + 1) / 2 - m;
-          int jknm = jk * P * P + nm;
+          int jknm = jk * PMAX * PMAX + nm;
           int jnkm = (j + n) * (j + n) + j + n + m - k;
-          L += std::conj(Cj->M[nms]) * Cnm[jknm] * Ynm[jnkm];
+          L += std::conj(Mj[nms]) * Cnm[jknm] * Ynm[jnkm];
         }
         for( int m=0; m<=n; ++m ) {
           int nm   = n * n + n + m;
           int nms  = n * (n + 1) / 2 + m;
-          int jknm = jk * P * P + nm;
+          int jknm = jk * PMAX * PMAX + nm;
           int jnkm = (j + n) * (j + n) + j + n + m - k;
-          L += Cj->M[nms] * Cnm[jknm] * Ynm[jnkm];
+          L += Mj[nms] * Cnm[jknm] * Ynm[jnkm];
         }
       }
-      Ci->L[jks] += L;
+      Li[jks] += L;
     }
   }
 }
@@ -165,7 +222,8 @@ void Kernel<Laplace>::M2L(C_iter Ci, C_iter Cj) const {
 template<>
 void Kernel<Laplace>::M2P(C_iter Ci, C_iter Cj) const {
   const complex I(0.,1.);                                       // Imaginary unit
-  complex Ynm[P*P], YnmTheta[P*P];
+  complex Ynm[PMAX*PMAX], YnmTheta[PMAX*PMAX];
+  const Coef *Mj = getM(Cj);
   for( B_iter B=Ci->LEAF; B!=Ci->LEAF+Ci->NDLEAF; ++B ) {
     vect dist = B->X - Cj->X - Xperiodic;
     vect spherical = 0;
@@ -173,19 +231,19 @@ void Kernel<Laplace>::M2P(C_iter Ci, C_iter Cj) const {
     real r, theta, phi;
     cart2sph(r,theta,phi,dist);
     evalLocal(r,theta,phi,Ynm,YnmTheta);
-    for( int n=0; n!=P; ++n ) {
+    for( int n=0; n!=ORDER; ++n ) {
       int nm  = n * n + n;
       int nms = n * (n + 1) / 2;
-      B->TRG[0] += std::real(Cj->M[nms] * Ynm[nm]);
-      spherical[0] -= std::real(Cj->M[nms] * Ynm[nm]) / r * (n+1);
-      spherical[1] += std::real(Cj->M[nms] * YnmTheta[nm]);
+      B->TRG[0] += std::real(Mj[nms] * Ynm[nm]);
+      spherical[0] -= std::real(Mj[nms] * Ynm[nm]) / r * (n+1);
+      spherical[1] += std::real(Mj[nms] * YnmTheta[nm]);
       for( int m=1; m<=n; ++m ) {
         nm  = n * n + n + m;
         nms = n * (n + 1) / 2 + m;
-        B->TRG[0] += 2 * std::real(Cj->M[nms] * Ynm[nm]);
-        spherical[0] -= 2 * std::real(Cj->M[nms] *Ynm[nm]) / r * (n+1);
-        spherical[1] += 2 * std::real(Cj->M[nms] *YnmTheta[nm]);
-        spherical[2] += 2 * std::real(Cj->M[nms] *Ynm[nm] * I) * m;
+        B->TRG[0] += 2 * std::real(Mj[nms] * Ynm[nm]);
+        spherical[0] -= 2 * std::real(Mj[nms] *Ynm[nm]) / r * (n+1);
+        spherical[1] += 2 * std::real(Mj[nms] *YnmTheta[nm]);
+        spherical[2] += 2 * std::real(Mj[nms] *Ynm[nm] * I) * m;
       }
     }
     sph2cart(r,theta,phi,spherical,cartesian);
@@ -198,23 +256,25 @@ void Kernel<Laplace>::M2P(C_iter Ci, C_iter Cj) const {
 template<>
 void Kernel<Laplace>::L2L(C_iter Ci) const {
   const complex I(0.,1.);
-  complex Ynm[P*P], YnmTheta[P*P];
+  complex Ynm[PMAX*PMAX], YnmTheta[PMAX*PMAX];
   C_iter Cj = Ci0 + Ci->PARENT;
+  const Coef *Lj = getL(Cj);
+  Coef *Li = getL(Ci);
   vect dist = Ci->X - Cj->X;
   real rho, alpha, beta;
   cart2sph(rho,alpha,beta,dist);
   evalMultipole(rho,alpha,beta,Ynm,YnmTheta);
-  for( int j=0; j!=P; ++j ) {
+  for( int j=0; j!=ORDER; ++j ) {
     for( int k=0; k<=j; ++k ) {
       int jk = j * j + j + k;
       int jks = j * (j + 1) / 2 + k;
       complex L = 0;
-      for( int n=j; n!=P; ++n ) {
+      for( int n=j; n!=ORDER; ++n ) {
         for( int m=j+k-n; m<0; ++m ) {
           int jnkm = (n - j) * (n - j) + n - j + m - k;
           int nm   = n * n + n - m;
           int nms  = n * (n + 1) / 2 - m;
-          L += std::conj(Cj->L[nms]) * Ynm[jnkm]
+          L += std::conj(Lj[nms]) * Ynm[jnkm]
              * real(ODDEVEN(k) * Anm[jnkm] * Anm[jk] / Anm[nm]);
         }
         for( int m=0; m<=n; ++m ) {
@@ -222,12 +282,12 @@ void Kernel<Laplace>::L2L(C_iter Ci) const {
             int jnkm = (n - j) * (n - j) + n - j + m - k;
             int nm   = n * n + n + m;
             int nms  = n * (n + 1) / 2 + m;
-            L += Cj->L[nms] * std::pow(I,real(m-k-abs(m-k)))
+            L += Lj[nms] * std::pow(I,real(m-k-abs(m-k)))
                * Ynm[jnkm] * Anm[jnkm] * Anm[jk] / Anm[nm];
           }
         }
       }
-      Ci->L[jks] += L * EPS;
+      Li[jks] += L * EPS;
     }
   }
 }
@@ -235,7 +295,8 @@ void Kernel<Laplace>::L2L(C_iter Ci) const {
 template<>
 void Kernel<Laplace>::L2P(C_iter Ci) const {
   const complex I(0.,1.);                                       // Imaginary unit
-  complex Ynm[P*P], YnmTheta[P*P];
+  complex Ynm[PMAX*PMAX], YnmTheta[PMAX*PMAX];
+  const Coef *Li = getL(Ci);
   for( B_iter B=Ci->LEAF; B!=Ci->LEAF+Ci->NCLEAF; ++B ) {
     vect dist = B->X - Ci->X;
     vect spherical = 0;
@@ -243,19 +304,19 @@ void Kernel<Laplace>::L2P(C_iter Ci) const {
     real r, theta, phi;
     cart2sph(r,theta,phi,dist);
     evalMultipole(r,theta,phi,Ynm,YnmTheta);
-    for( int n=0; n!=P; ++n ) {
+    for( int n=0; n!=ORDER; ++n ) {
       int nm  = n * n + n;
       int nms = n * (n + 1) / 2;
-      B->TRG[0] += std::real(Ci->L[nms] * Ynm[nm]);
-      spherical[0] += std::real(Ci->L[nms] * Ynm[nm]) / r * n;
-      spherical[1] += std::real(Ci->L[nms] * YnmTheta[nm]);
+      B->TRG[0] += std::real(Li[nms] * Ynm[nm]);
+      spherical[0] += std::real(Li[nms] * Ynm[nm]) / r * n;
+      spherical[1] += std::real(Li[nms] * YnmTheta[nm]);
       for( int m=1; m<=n; ++m ) {
         nm  = n * n + n + m;
         nms = n * (n + 1) / 2 + m;
-        B->TRG[0] += 2 * std::real(Ci->L[nms] * Ynm[nm]);
-        spherical[0] += 2 * std::real(Ci->L[nms] * Ynm[nm]) / r * n;
-        spherical[1] += 2 * std::real(Ci->L[nms] * YnmTheta[nm]);
-        spherical[2] += 2 * std::real(Ci->L[nms] * Ynm[nm] * I) * m;
+        B->TRG[0] += 2 * std::real(Li[nms] * Ynm[nm]);
+        spherical[0] += 2 * std::real(Li[nms] * Ynm[nm]) / r * n;
+        spherical[1] += 2 * std::real(Li[nms] * YnmTheta[nm]);
+        spherical[2] += 2 * std::real(Li[nms] * Ynm[nm] * I) * m;
       }
     }
     sph2cart(r,theta,phi,spherical,cartesian);
@@ -269,3 +330,4 @@ template<>
 void Kernel<Laplace>::finalize() {}
 
 #include "../kernel/CPUEwaldLaplace.cxx"
+#include "../kernel/CPUSPMELaplace.cxx"
@@ -46,13 +46,13 @@ void Evaluator<equation>::setSourceCell(bool isM) {             // Set source bu
     sourceHost.push_back(Cj->X[2]);                             //  Copy z position to GPU buffer
     if( isM ) {                                                 //  If source is M
       for( int i=0; i!=NTERM; ++i ) {                           //   Loop over coefs in source cell
-        sourceHost.push_back(std::real(Cj->M[i]));              //    Copy real multipole to GPU buffer
-        sourceHost.push_back(std::imag(Cj->M[i]));              //    Copy imaginary multipole to GPU buffer
+        sourceHost.push_back(std::real(getM(Cj)[i]));           //    Copy real multipole to GPU buffer
+        sourceHost.push_back(std::imag(getM(Cj)[i]));           //    Copy imaginary multipole to GPU buffer
       }                                                         //   End loop over coefs
     } else {                                                    //  If source is L
       for( int i=0; i!=NTERM; ++i ) {                           //   Loop over coefs in source cell
-        sourceHost.push_back(std::real(Cj->L[i]));              //    Copy real multipole to GPU buffer
-        sourceHost.push_back(std::imag(Cj->L[i]));              //    Copy imaginary multipole to GPU buffer
+        sourceHost.push_back(std::real(getL(Cj)[i]));           //    Copy real multipole to GPU buffer
+        sourceHost.push_back(std::imag(getL(Cj)[i]));           //    Copy imaginary multipole to GPU buffer
       }                                                         //   End loop over coefs
     }                                                           //  Endif for source type
   }                                                             // End loop over source map
@@ -60,22 +60,22 @@ void Evaluator<equation>::setSourceCell(bool isM) {             // Set source bu
 }
 
 template<Equation equation>
-void Evaluator<equation>::setTargetBody(Lists lists, Maps flags) {// Set target buffer for bodies
+void Evaluator<equation>::setTargetBody(const InteractionList &list, C_iter CjB) {// Set target buffer for bodies
   startTimer("Set targetB");                                    // Start timer
   int key = 0;                                                  // Initialize key to range of coefs in source cells
   for( C_iter Ci=CiB; Ci!=CiE; ++Ci ) {                         // Loop over target cells
-    if( !lists[Ci-Ci0].empty() ) {                              //  If the interation list is not empty
+    if( list.size(Ci-Ci0) != 0 ) {                              //  If the interation list is not empty
       int blocks = (Ci->NDLEAF - 1) / THREADS + 1;              //   Number of thread blocks needed for this target cell
       for( int i=0; i!=blocks; ++i ) {                          //   Loop over thread blocks
         keysHost.push_back(key);                                //    Save key to range of leafs in source cells
       }                                                         //   End loop over thread blocks
-      key += 3*lists[Ci-Ci0].size()+1;                          //   Increment key counter
-      rangeHost.push_back(lists[Ci-Ci0].size());                //   Save size of interaction list
-      for( LC_iter L=lists[Ci-Ci0].begin(); L!=lists[Ci-Ci0].end(); ++L ) {//  Loop over interaction list
-        C_iter Cj = *L;                                         //   Set source cell
+      key += 3*list.size(Ci-Ci0)+1;                             //   Increment key counter
+      rangeHost.push_back(list.size(Ci-Ci0));                   //   Save size of interaction list
+      for( const Interaction *I=list.begin(Ci-Ci0); I!=list.end(Ci-Ci0); ++I ) {// Loop over interaction list
+        C_iter Cj = CjB + I->CELL;                              //    Set source cell
         rangeHost.push_back(sourceBegin[Cj]);                   //    Set begin index of coefs in source cell
         rangeHost.push_back(sourceSize[Cj]);                    //    Set number of coefs in source cell
-        rangeHost.push_back(flags[Ci-Ci0][Cj]);                 //    Set periodic image flag of source cell
+        rangeHost.push_back(I->IPERIODIC);                      //    Set periodic image flag of source cell
       }                                                         //   End loop over interaction list
       targetBegin[Ci] = targetHost.size() / 4;                  //   Key : iterator, Value : offset of target leafs
       for( B_iter B=Ci->LEAF; B!=Ci->LEAF+Ci->NDLEAF; ++B ) {   //   Loop over leafs in target cell
@@ -97,21 +97,21 @@ void Evaluator<equation>::setTargetBody(Lists lists, Maps flags) {// Set target
 }
 
 template<Equation equation>
-void Evaluator<equation>::setTargetCell(Lists lists, Maps flags) {// Set target buffer for cells
+void Evaluator<equation>::setTargetCell(const InteractionList &list, C_iter CjB) {// Set target buffer for cells
   startTimer("Set targetC");                                    // Start timer
   int key = 0;                                                  // Initialize key to range of coefs in target cells
   for( C_iter Ci=CiB; Ci!=CiE; ++Ci ) {                         // Loop over target cells
-    if( !lists[Ci-Ci0].empty() ) {                              //  If the interation list is not empty
+    if( list.size(Ci-Ci0) != 0 ) {                              //  If the interation list is not empty
       keysHost.push_back(key);                                  //   Save key to range of coefs in target cells
-      key += 3*lists[Ci-Ci0].size()+1;                          //   Increment key counter
-      rangeHost.push_back(lists[Ci-Ci0].size());                //   Save size of interaction list
-      for( LC_iter L=lists[Ci-Ci0].begin(); L!=lists[Ci-Ci0].end(); ++L ) {//  Loop over interaction list
-        C_iter Cj = *L;                                         //    Set target cell
+      key += 3*list.size(Ci-Ci0)+1;                             //   Increment key counter
+      rangeHost.push_back(list.size(Ci-Ci0));                   //   Save size of interaction list
+      for( const Interaction *I=list.begin(Ci-Ci0); I!=list.end(Ci-Ci0); ++I ) {// Loop over interaction list
+        C_iter Cj = CjB + I->CELL;                              //    Set source cell
         int begin = sourceBegin[Cj];                            //    Get begin index of coefs in source cell
         int size = sourceSize[Cj];                              //    Get number of coefs in source cell
         rangeHost.push_back(begin);                             //    Set begin index of coefs in source cell
         rangeHost.push_back(size);                              //    Set number of coefs in source cell
-        rangeHost.push_back(flags[Ci-Ci0][Cj]);                 //    Set periodic image flag of source cell
+        rangeHost.push_back(I->IPERIODIC);                      //    Set periodic image flag of source cell
       }                                                         //   End loop over interaction list
       targetBegin[Ci] = targetHost.size();                      //   Key : iterator, Value : offset of target coefs
       targetHost.push_back(Ci->X[0]);                           //   Copy x position to GPU buffer
@@ -131,10 +131,10 @@ void Evaluator<equation>::setTargetCell(Lists lists, Maps flags) {// Set target
 }
 
 template<Equation equation>
-void Evaluator<equation>::getTargetBody(Lists &lists) {         // Get body values from target buffer
+void Evaluator<equation>::getTargetBody(const InteractionList &list) {// Get body values from target buffer
   startTimer("Get targetB");                                    // Start timer
   for( C_iter Ci=CiB; Ci!=CiE; ++Ci ) {                         // Loop over target cells
-    if( !lists[Ci-Ci0].empty() ) {                              //  If the interation list is not empty
+    if( list.size(Ci-Ci0) != 0 ) {                              //  If the interation list is not empty
       int begin = targetBegin[Ci];                              //   Offset of target leafs
         for( B_iter B=Ci->LEAF; B!=Ci->LEAF+Ci->NDLEAF; ++B ) { //    Loop over target bodies
           B->TRG[0] += targetHost[4*(begin+B-Ci->LEAF)+0];      //     Copy 1st target value from GPU buffer
@@ -142,30 +142,28 @@ void Evaluator<equation>::getTargetBody(Lists &lists) {         // Get body valu
           B->TRG[2] += targetHost[4*(begin+B-Ci->LEAF)+2];      //     Copy 3rd target value from GPU buffer
           B->TRG[3] += targetHost[4*(begin+B-Ci->LEAF)+3];      //     Copy 4th target value from GPU buffer
         }                                                       //    End loop over target bodies
-      lists[Ci-Ci0].clear();                                    //   Clear interaction list
     }                                                           //  End if for empty interation list
   }                                                             // End loop over target cells
   stopTimer("Get targetB");                                     // Stop timer
 }
 
 template<Equation equation>
-void Evaluator<equation>::getTargetCell(Lists &lists, bool isM) {// Get body values from target buffer
+void Evaluator<equation>::getTargetCell(const InteractionList &list, bool isM) {// Get body values from target buffer
   startTimer("Get targetC");                                    // Start timer
   for( C_iter Ci=CiB; Ci!=CiE; ++Ci ) {                         // Loop over target cells
-    if( !lists[Ci-Ci0].empty() ) {                              //  If the interation list is not empty
+    if( list.size(Ci-Ci0) != 0 ) {                              //  If the interation list is not empty
       int begin = targetBegin[Ci];                              //   Offset of target coefs
       if( isM ) {                                               //   If target is M
         for( int i=0; i!=NTERM; ++i ) {                         //    Loop over coefs in target cell
-          Ci->M[i].real() += targetHost[begin+2*i+0];           //     Copy real target values from GPU buffer
-          Ci->M[i].imag() += targetHost[begin+2*i+1];           //     Copy imaginary target values from GPU buffer
+          getM(Ci)[i].real() += targetHost[begin+2*i+0];        //     Copy real target values from GPU buffer
+          getM(Ci)[i].imag() += targetHost[begin+2*i+1];        //     Copy imaginary target values from GPU buffer
         }                                                       //    End loop over coefs
       } else {                                                  //   If target is L
         for( int i=0; i!=NTERM; ++i ) {                         //    Loop over coefs in target cell
-          Ci->L[i].real() += targetHost[begin+2*i+0];           //     Copy real target values from GPU buffer
-          Ci->L[i].imag() += targetHost[begin+2*i+1];           //     Copy imaginary target values from GPU buffer
+          getL(Ci)[i].real() += targetHost[begin+2*i+0];        //     Copy real target values from GPU buffer
+          getL(Ci)[i].imag() += targetHost[begin+2*i+1];        //     Copy imaginary target values from GPU buffer
         }                                                       //    End loop over coefs
       }                                                         //   Endif for target type
-      lists[Ci-Ci0].clear();                                    //   Clear interaction list
     }                                                           //  End if for empty interation list
   }                                                             // End loop over target cells
   stopTimer("Get targetC");                                     // Stop timer
@@ -275,7 +273,7 @@ void Evaluator<equation>::evalP2P(Bodies &ibodies, Bodies &jbodies, bool onCPU)
 }
 
 template<Equation equation>
-void Evaluator<equation>::evalP2M(Cells &cells) {               // Evaluate all P2M kernels
+void Evaluator<equation>::evalP2M(Cells &cells) {             // Evaluate all P2M kernels
   startTimer("evalP2M");                                        // Start timer
   Ci0 = cells.begin();                                          // Set begin iterator for target
   const int numCell = MAXCELL/NCRIT/4;                          // Number of cells per icall
@@ -286,19 +284,23 @@ void Evaluator<equation>::evalP2M(Cells &cells) {               // Evaluate all
     CiE = cells.begin()+std::min(ioffset+numCell,int(cells.size()));// Set end iterator for target per call
     constHost.push_back(2*R0);                                  //  Copy domain size to GPU buffer
     startTimer("Get list");                                     //  Start timer
-    Lists listP2M(cells.size());                                //  Define P2M interation list vector
-    Maps  flagP2M(cells.size());                                //  Define P2M periodic image flag
+    InteractionList listP2M;                                    //  Define P2M interation list
+    listP2M.initialize(1);                                      //  Single thread pushes into list
     for( C_iter Ci=CiB; Ci!=CiE; ++Ci ) {                       //  Loop over target cells
-      Ci->M = Ci->L = 0;                                        //   Initialize multipole & local coefficients
+      if( Ci->ICOEF < 0 ) {                                     //   If cell has no coefficients yet
+        newCoef(*Ci);                                           //    Allocate zeroed multipole & local coefficients
+      } else {                                                  //   Else reuse coefficients of cell
+        std::fill(getM(Ci),getM(Ci)+getNumM(),Coef(0));         //    Initialize multipole coefficients
+      }                                                         //   Endif for allocation
       if( Ci->NCHILD == 0 ) {                                   //   If cell is a twig
-        listP2M[Ci-Ci0].push_back(Ci);                          //    Push source cell into P2M interaction list
-        flagP2M[Ci-Ci0][Ci] |= Icenter;                         //    Flip bit of periodic image flag
+        listP2M.push(0,Ci-Ci0,Ci-Ci0,Icenter);                  //    Push source cell into P2M interaction list
         sourceSize[Ci] = Ci->NDLEAF;                            //    Key : iterator, Value : number of leafs
       }                                                         //   End loop over cells topdown
     }                                                           //  End loop over source map
+    listP2M.build(cells.size());                                //  Build P2M interaction list
     stopTimer("Get list");                                      //  Stop timer
     setSourceBody();                                            //  Set source buffer for bodies
-    setTargetCell(listP2M,flagP2M);                             //  Set target buffer for cells
+    setTargetCell(listP2M,Ci0);                                 //  Set target buffer for cells
     allocate();                                                 //  Allocate GPU memory
     hostToDevice();                                             //  Copy from host to device
     P2M();                                                      //  Perform P2M kernel
@@ -325,21 +327,21 @@ void Evaluator<equation>::evalM2M(Cells &cells, Cells &jcells) {// Evaluate all
       CiE = cells.begin()+std::min(ioffset+numCell,int(cells.size()));// Set end iterator for target per call
       constHost.push_back(2*R0);                                //   Copy domain size to GPU buffer
       startTimer("Get list");                                   //   Start timer
-      Lists listM2M(cells.size());                              //   Define M2M interation list vector
-      Maps  flagM2M(cells.size());                              //   Define M2M periodic image flag
+      InteractionList listM2M;                                  //   Define M2M interation list
+      listM2M.initialize(1);                                    //   Single thread pushes into list
       for( C_iter Ci=CiB; Ci!=CiE; ++Ci ) {                     //   Loop over cells bottomup (except root cell)
         if( getLevel(Ci->ICELL) == level ) {                    //    If target cell is at current level
           for( int i=0; i<Ci->NCHILD; ++i ) {                   //     Loop over child cells
             C_iter Cj = Cj0 + Ci->CHILD+i;                      //      Set iterator for source cell
-            listM2M[Ci-Ci0].push_back(Cj);                      //      Push source cell into M2M interaction list
-            flagM2M[Ci-Ci0][Cj] |= Icenter;                     //      Flip bit of periodic image flag
+            listM2M.push(0,Ci-Ci0,Cj-Cj0,Icenter);              //      Push source cell into M2M interaction list
             sourceSize[Cj] = 2 * NTERM;                         //      Key : iterator, Value : number of coefs
           }                                                     //     End loop over child cells
         }                                                       //    Endif for current level
       }                                                         //   End loop over cells
+      listM2M.build(cells.size());                              //   Build M2M interaction list
       stopTimer("Get list");                                    //   Stop timer
       setSourceCell(true);                                      //   Set source buffer for cells
-      setTargetCell(listM2M,flagM2M);                           //   Set target buffer for cells
+      setTargetCell(listM2M,Cj0);                               //   Set target buffer for cells
       allocate();                                               //   Allocate GPU memory
       hostToDevice();                                           //   Copy from host to device
       M2M();                                                    //   Perform M2M kernel
@@ -355,8 +357,8 @@ void Evaluator<equation>::evalM2M(Cells &cells, Cells &jcells) {// Evaluate all
 
 template<Equation equation>
 void Evaluator<equation>::evalM2L(C_iter Ci, C_iter Cj) {       // Queue single M2L kernel
-  listM2L[Ci-Ci0].push_back(Cj);                                // Push source cell into M2L interaction list
-  flagM2L[Ci-Ci0][Cj] |= Iperiodic;                             // Flip bit of periodic image flag
+  listM2L.push(getThreadNum(),Ci-Ci0,Cj-Cj0,Iperiodic);         // Push source cell into M2L interaction list
+#pragma omp atomic
   NM2L++;                                                       // Count M2L kernel execution
 }
 
@@ -373,14 +375,14 @@ void Evaluator<equation>::evalM2L(Cells &cells) {               // Evaluate queu
     constHost.push_back(2*R0);                                  //  Copy domain size to GPU buffer
     startTimer("Get list");                                     //  Start timer
     for( C_iter Ci=CiB; Ci!=CiE; ++Ci ) {                       //  Loop over target cells
-      for( LC_iter L=listM2L[Ci-Ci0].begin(); L!=listM2L[Ci-Ci0].end(); ++L ) {//  Loop over interaction list
-        C_iter Cj = *L;                                         //    Set source cell
+      for( const Interaction *I=listM2L.begin(Ci-Ci0); I!=listM2L.end(Ci-Ci0); ++I ) {// Loop over interaction list
+        C_iter Cj = Cj0 + I->CELL;                              //    Set source cell
         sourceSize[Cj] = 2 * NTERM;                             //    Key : iterator, Value : number of coefs
       }                                                         //   End loop over interaction list
     }                                                           //  End loop over target cells
     stopTimer("Get list");                                      //  Stop timer
     setSourceCell(true);                                        //  Set source buffer for cells
-    setTargetCell(listM2L,flagM2L);                             //  Set target buffer for cells
+    setTargetCell(listM2L,Cj0);                                 //  Set target buffer for cells
     allocate();                                                 //  Allocate GPU memory
     hostToDevice();                                             //  Copy from host to device
     M2L();                                                      //  Perform M2L kernel
@@ -390,14 +392,13 @@ void Evaluator<equation>::evalM2L(Cells &cells) {               // Evaluate queu
     ioffset += numCell;                                         //  Increment ioffset
   }                                                             // End loop over icall
   listM2L.clear();                                              // Clear interaction lists
-  flagM2L.clear();                                              // Clear periodic image flags
   stopTimer("evalM2L");                                         // Stop timer
 }
 
 template<Equation equation>
 void Evaluator<equation>::evalM2P(C_iter Ci, C_iter Cj) {       // Queue single M2P kernel
-  listM2P[Ci-Ci0].push_back(Cj);                                // Push source cell into M2P interaction list
-  flagM2P[Ci-Ci0][Cj] |= Iperiodic;                             // Flip bit of periodic image flag
+  listM2P.push(getThreadNum(),Ci-Ci0,Cj-Cj0,Iperiodic);         // Push source cell into M2P interaction list
+#pragma omp atomic
   NM2P++;                                                       // Count M2P kernel execution
 }
 
@@ -414,14 +415,14 @@ void Evaluator<equation>::evalM2P(Cells &cells) {               // Evaluate queu
     constHost.push_back(2*R0);                                  //  Copy domain size to GPU buffer
     startTimer("Get list");                                     //  Start timer
     for( C_iter Ci=CiB; Ci!=CiE; ++Ci ) {                       //  Loop over target cells
-      for( LC_iter L=listM2P[Ci-Ci0].begin(); L!=listM2P[Ci-Ci0].end(); ++L ) {//  Loop over interaction list
-        C_iter Cj = *L;                                         //    Set source cell
+      for( const Interaction *I=listM2P.begin(Ci-Ci0); I!=listM2P.end(Ci-Ci0); ++I ) {// Loop over interaction list
+        C_iter Cj = Cj0 + I->CELL;                              //    Set source cell
         sourceSize[Cj] = 2 * NTERM;                             //    Key : iterator, Value : number of coefs
       }                                                         //   End loop over interaction list
     }                                                           //  End loop over target cells
     stopTimer("Get list");                                      //  Stop timer
     setSourceCell(true);                                        //  Set source buffer for cells
-    setTargetBody(listM2P,flagM2P);                             //  Set target buffer for bodies
+    setTargetBody(listM2P,Cj0);                                 //  Set target buffer for bodies
     allocate();                                                 //  Allocate GPU memory
     hostToDevice();                                             //  Copy from host to device
     M2P();                                                      //  Perform M2P kernel
@@ -431,17 +432,22 @@ void Evaluator<equation>::evalM2P(Cells &cells) {               // Evaluate queu
     ioffset += numCell;                                         //  Increment ioffset
   }                                                             // End loop over icall
   listM2P.clear();                                              // Clear interaction lists
-  flagM2P.clear();                                              // Clear periodic image flags
   stopTimer("evalM2P");                                         // Stop timer
 }
 
 template<Equation equation>
 void Evaluator<equation>::evalP2P(C_iter Ci, C_iter Cj) {       // Queue single P2P kernel
-  listP2P[Ci-Ci0].push_back(Cj);                                // Push source cell into P2P interaction list
-  flagP2P[Ci-Ci0][Cj] |= Iperiodic;                             // Flip bit of periodic image flag
+  listP2P.push(getThreadNum(),Ci-Ci0,Cj-Cj0,Iperiodic);         // Push source cell into P2P interaction list
+#pragma omp atomic
   NP2P++;                                                       // Count P2P kernel execution
 }
 
+template<Equation equation>
+void Evaluator<equation>::evalP2PMutual(C_iter Ci, C_iter Cj) { // Queue single P2P kernel for both cells
+  evalP2P(Ci,Cj);                                               // Queue P2P from Cj to Ci
+  if( Ci != Cj ) evalP2P(Cj,Ci);                                // Queue P2P from Ci to Cj
+}
+
 template<Equation equation>
 void Evaluator<equation>::evalP2P(Cells &cells) {               // Evaluate queued P2P kernels
   startTimer("evalP2P");                                        // Start timer
@@ -455,14 +461,14 @@ void Evaluator<equation>::evalP2P(Cells &cells) {               // Evaluate queu
     constHost.push_back(2*R0);                                  //  Copy domain size to GPU buffer
     startTimer("Get list");                                     //  Start timer
     for( C_iter Ci=CiB; Ci!=CiE; ++Ci ) {                       //  Loop over target cells
-      for( LC_iter L=listP2P[Ci-Ci0].begin(); L!=listP2P[Ci-Ci0].end(); ++L ) {//  Loop over interaction list
-        C_iter Cj = *L;                                         //    Set source cell
+      for( const Interaction *I=listP2P.begin(Ci-Ci0); I!=listP2P.end(Ci-Ci0); ++I ) {// Loop over interaction list
+        C_iter Cj = Cj0 + I->CELL;                              //    Set source cell
         sourceSize[Cj] = Cj->NDLEAF;                            //    Key : iterator, Value : number of leafs
       }                                                         //   End loop over interaction list
     }                                                           //  End loop over target cells
     stopTimer("Get list");                                      //  Stop timer
     setSourceBody();                                            //  Set source buffer for bodies
-    setTargetBody(listP2P,flagP2P);                             //  Set target buffer for bodies
+    setTargetBody(listP2P,Cj0);                                 //  Set target buffer for bodies
     allocate();                                                 //  Allocate GPU memory
     hostToDevice();                                             //  Copy from host to device
     P2P();                                                      //  Perform P2P kernel
@@ -472,7 +478,6 @@ void Evaluator<equation>::evalP2P(Cells &cells) {               // Evaluate queu
     ioffset += numCell;                                         //  Increment ioffset
   }                                                             // End loop over icall
   listP2P.clear();                                              // Clear interaction lists
-  flagP2P.clear();                                              // Clear periodic image flags
   stopTimer("evalP2P");                                         // Stop timer
 }
 
@@ -491,21 +496,21 @@ void Evaluator<equation>::evalL2L(Cells &cells) {               // Evaluate all
       CiE = cells.begin()+std::min(ioffset+numCell,int(cells.size()));// Set end iterator for target per call
       constHost.push_back(2*R0);                                //   Copy domain size to GPU buffer
       startTimer("Get list");                                   //   Start timer
-      Lists listL2L(cells.size());                              //   Define L2L interation list vector
-      Maps  flagL2L(cells.size());                              //   Define L2L periodic image flag
+      InteractionList listL2L;                                  //   Define L2L interation list
+      listL2L.initialize(1);                                    //   Single thread pushes into list
       for( C_iter Ci=CiE-2; Ci!=CiB-1; --Ci ) {                 //   Loop over cells topdown (except root cell)
         if( getLevel(Ci->ICELL) == level ) {                    //    If target cell is at current level
           C_iter Cj = Ci0 + Ci->PARENT;                         //     Set source cell iterator
-          listL2L[Ci-Ci0].push_back(Cj);                        //     Push source cell into L2L interaction list
-          flagL2L[Ci-Ci0][Cj] |= Icenter;                       //     Flip bit of periodic image flag
+          listL2L.push(0,Ci-Ci0,Cj-Ci0,Icenter);                //     Push source cell into L2L interaction list
           if( sourceSize[Cj] == 0 ) {                           //     If the source cell has not been stored yet
             sourceSize[Cj] = 2 * NTERM;                         //      Key : iterator, Value : number of coefs
           }                                                     //     Endif for current level
         }                                                       //    Endif for stored source cell
       }                                                         //   End loop over cells topdown
+      listL2L.build(cells.size());                              //   Build L2L interaction list
       stopTimer("Get list");                                    //   Stop timer
       setSourceCell(false);                                     //   Set source buffer for cells
-      setTargetCell(listL2L,flagL2L);                           //   Set target buffer for cells
+      setTargetCell(listL2L,Ci0);                               //   Set target buffer for cells
       allocate();                                               //   Allocate GPU memory
       hostToDevice();                                           //   Copy from host to device
       L2L();                                                    //   Perform L2L kernel
@@ -531,18 +536,18 @@ void Evaluator<equation>::evalL2P(Cells &cells) {               // Evaluate all
     CiE = cells.begin()+std::min(ioffset+numCell,int(cells.size()));// Set end iterator for target per call
     constHost.push_back(2*R0);                                  //  Copy domain size to GPU buffer
     startTimer("Get list");                                     //  Start timer
-    Lists listL2P(cells.size());                                //  Define L2P interation list vector
-    Maps  flagL2P(cells.size());                                //  Define L2P periodic image flag
+    InteractionList listL2P;                                    //  Define L2P interation list
+    listL2P.initialize(1);                                      //  Single thread pushes into list
     for( C_iter Ci=CiB; Ci!=CiE; ++Ci ) {                       //  Loop over cells
       if( Ci->NCHILD == 0 ) {                                   //   If cell is a twig evaluate L2P kernel
-        listL2P[Ci-Ci0].push_back(Ci);                          //    Push source cell into L2P interaction list
-        flagL2P[Ci-Ci0][Ci] |= Icenter;                         //    Flip bit of periodic image flag
+        listL2P.push(0,Ci-Ci0,Ci-Ci0,Icenter);                  //    Push source cell into L2P interaction list
         sourceSize[Ci] = 2 * NTERM;                             //    Key : iterator, Value : number of coefs
       }                                                         //   Endif for twig cells
     }                                                           //  End loop over cells topdown
+    listL2P.build(cells.size());                                //  Build L2P interaction list
     stopTimer("Get list");                                      //  Stop timer
     setSourceCell(false);                                       //  Set source buffer for cells
-    setTargetBody(listL2P,flagL2P);                             //  Set target buffer for bodies
+    setTargetBody(listL2P,Ci0);                                 //  Set target buffer for bodies
     allocate();                                                 //  Allocate GPU memory
     hostToDevice();                                             //  Copy from host to device
     L2P();                                                      //  Perform L2P kernel
@@ -554,12 +559,6 @@ void Evaluator<equation>::evalL2P(Cells &cells) {               // Evaluate all
   stopTimer("evalL2P");                                         // Stop timer
 }
 
-template<Equation equation>
-void Evaluator<equation>::evalEwaldReal(C_iter Ci, C_iter Cj) { // Queue single Ewald real kernel
-  listP2P[Ci-Ci0].push_back(Cj);                                // Push source cell into P2P interaction list
-  flagP2P[Ci-Ci0][Cj] |= Iperiodic;                             // Flip bit of periodic image flag
-}
-
 template<Equation equation>
 void Evaluator<equation>::evalEwaldReal(Cells &cells) {         // Evaluate queued Ewald real kernels
   startTimer("evalEwaldReal");                                  // Start timer
@@ -574,14 +573,14 @@ void Evaluator<equation>::evalEwaldReal(Cells &cells) {         // Evaluate queu
     constHost.push_back(ALPHA);                                 //  Copy Ewald scaling to GPU buffer
     startTimer("Get list");                                     //  Start timer
     for( C_iter Ci=CiB; Ci!=CiE; ++Ci ) {                       //  Loop over target cells
-      for( LC_iter L=listP2P[Ci-Ci0].begin(); L!=listP2P[Ci-Ci0].end(); ++L ) {//  Loop over interaction list
-        C_iter Cj = *L;                                         //    Set source cell
+      for( const Interaction *I=listP2P.begin(Ci-Ci0); I!=listP2P.end(Ci-Ci0); ++I ) {// Loop over interaction list
+        C_iter Cj = Cj0 + I->CELL;                              //    Set source cell
         sourceSize[Cj] = Cj->NDLEAF;                            //    Key : iterator, Value : number of leafs
       }                                                         //   End loop over interaction list
     }                                                           //  End loop over target cells
     stopTimer("Get list");                                      //  Stop timer
     setSourceBody();                                            //  Set source buffer for bodies
-    setTargetBody(listP2P,flagP2P);                             //  Set target buffer for bodies
+    setTargetBody(listP2P,Cj0);                                 //  Set target buffer for bodies
     allocate();                                                 //  Allocate GPU memory
     hostToDevice();                                             //  Copy from host to device
     EwaldReal();                                                //  Perform Ewald real kernel
@@ -591,7 +590,6 @@ void Evaluator<equation>::evalEwaldReal(Cells &cells) {         // Evaluate queu
     ioffset += numCell;                                         //  Increment ioffset
   }                                                             // End loop over icall
   listP2P.clear();                                              // Clear interaction lists
-  flagP2P.clear();                                              // Clear periodic image flags
   stopTimer("evalEwaldReal");                                   // Stop timer
 }
 
@@ -616,19 +614,20 @@ void Evaluator<equation>::timeKernels() {                       // Time all kern
     Cj->NDLEAF = 100;                                           //  Number of leafs in source cell
     Cj->LEAF = jbodies.begin();                                 //  Leaf iterator in source cell
   }                                                             // End loop over source cells
-  listM2L.resize(icells.size());                                // Resize M2L interaction list
-  listM2P.resize(icells.size());                                // Resize M2P interaction list
-  listP2P.resize(icells.size());                                // Resize P2P interaction list
-  flagM2L.resize(icells.size());                                // Resize M2L periodic image flag
-  flagM2P.resize(icells.size());                                // Resize M2P periodic image flag
-  flagP2P.resize(icells.size());                                // Resize P2P periodic image flag
+  Cj0 = jcells.begin();                                         // Set global begin iterator for source
+  listM2L.initialize(1);                                        // Single thread pushes into M2L list
+  listM2P.initialize(1);                                        // Single thread pushes into M2P list
+  listP2P.initialize(1);                                        // Single thread pushes into P2P list
   for( C_iter Ci=icells.begin(); Ci!=icells.end(); ++Ci ) {     // Loop over target cells
     for( C_iter Cj=jcells.begin(); Cj!=jcells.end(); ++Cj ) {   //  Loop over source cells
-      listP2P[Ci-Ci0].push_back(Cj);                            //   Push source cell into P2P interaction list
-      listM2P[Ci-Ci0].push_back(Cj);                            //   Push source cell into P2P interaction list
-      listM2L[Ci-Ci0].push_back(Cj);                            //   Push source cell into P2P interaction list
+      listP2P.push(0,Ci-Ci0,Cj-Cj0,Icenter);                    //   Push source cell into P2P interaction list
+      listM2P.push(0,Ci-Ci0,Cj-Cj0,Icenter);                    //   Push source cell into M2P interaction list
+      listM2L.push(0,Ci-Ci0,Cj-Cj0,Icenter);                    //   Push source cell into M2L interaction list
     }                                                           //  End loop over source cells
   }                                                             // End loop over target cells
+  listP2P.build(icells.size());                                 // Build P2P interaction list
+  listM2P.build(icells.size());                                 // Build M2P interaction list
+  listM2L.build(icells.size());                                 // Build M2L interaction list
   startTimer("P2P kernel");                                     // Start timer
   evalP2P(icells);                                              // Evaluate queued P2P kernels
   timeP2P = stopTimer("P2P kernel") / 100 / 100;                // Stop timer
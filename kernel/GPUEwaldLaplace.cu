@@ -308,15 +308,5 @@ void Kernel<Laplace>::EwaldWave(Bodies &bodies) const {     // Ewald wave part o
     for( int d=0; d<3; d++ ) B->TRG[d+1] *= scale;
   }
 
-  vect dipole = 0;
-  for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {
-    dipole += (B->X - R0) * B->SRC;
-  }
-  coef = M_PI / (6 * R0 * R0 * R0);
-  for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {
-    B->TRG[0] += coef * norm(dipole) / bodies.size() / B->SRC;
-    for( int d=0; d!=3; ++d ) {
-      B->TRG[d+1] += coef * dipole[d];
-    }
-  }
+  dipoleCorrection(bodies);
 }
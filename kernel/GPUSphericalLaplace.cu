@@ -922,3 +922,4 @@ void Kernel<Laplace>::L2P() {
 }
 
 #include "../kernel/GPUEwaldLaplace.cu"
+#include "../kernel/CPUSPMELaplace.cxx"
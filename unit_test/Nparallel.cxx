@@ -43,6 +43,7 @@ int main() {
     FMM.setGlobDomain(bodies);                                  //  Set global domain size of FMM
     FMM.octsection(bodies);                                     //  Partition domain and redistribute bodies
     cells.clear();                                              //  Make sure cells vector is empty
+    FMM.clearCoef();                                            //  Release coefficients of previous cells
 #ifdef TOPDOWN
     FMM.topdown(bodies,cells);                                  //  Tree construction (top down) & upward sweep
 #else
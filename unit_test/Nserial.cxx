@@ -42,6 +42,7 @@ int main() {
     FMM.startTimer("FMM");                                      //  Start timer
     FMM.setDomain(bodies);                                      //  Set domain size of FMM
     cells.clear();                                              //  Make sure cells vector is empty
+    FMM.clearCoef();                                            //  Release coefficients of previous cells
 #ifdef TOPDOWN
     FMM.topdown(bodies,cells);                                  //  Tree construction (top down) & upward sweep
 #else
@@ -0,0 +1,182 @@
+/*
+Copyright (C) 2011 by Rio Yokota, Simon Layton, Lorena Barba
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+#include "serialfmm.h"
+
+int main() {
+  const int numBodies = 20000;                                  // Number of bodies
+  const int numTarget = 100;                                    // Number of target points to be used for error eval
+  const int atoms = 4;                                          // Number of atom types
+  IMAGES = 0;                                                   // Level of periodic image tree (0 for non-periodic)
+  THETA = 0.5;                                                  // Multipole acceptance criteria
+  Bodies bodies(numBodies);                                     // Define vector of bodies
+  Cells cells, jcells;                                          // Define vector of cells
+  SerialFMM<Laplace> FMM;                                       // Instantiate SerialFMM class
+  FMM.initialize();                                             // Initialize FMM
+  FMM.printNow = true;                                          // Print timer
+
+  double rscale[atoms*atoms], gscale[atoms*atoms];              // Van der Waals parameters
+  for( int i=0; i!=atoms; ++i ) {                               // Loop over atom types
+    rscale[i*atoms+i] = drand48() + .5;                         //  Set pre scaling factor
+    gscale[i*atoms+i] = drand48() * 1e-6;                       //  Set post scaling factor
+  }                                                             // End loop over atom types
+  for( int i=0; i!=atoms; ++i ) {                               // Loop over target atom types
+    for( int j=0; j!=atoms; ++j ) {                             //  Loop over source atom types
+      if( i == j ) continue;                                    //   Diagonal is already set
+      gscale[i*atoms+j] = std::sqrt(gscale[i*atoms+i] * gscale[j*atoms+j]);// Set post scaling factor
+      rscale[i*atoms+j] = (std::sqrt(rscale[i*atoms+i]) + std::sqrt(rscale[j*atoms+j])) * 0.5;
+      rscale[i*atoms+j] *= rscale[i*atoms+j];                   //   Set pre scaling factor
+    }                                                           //  End loop over source atom types
+  }                                                             // End loop over target atom types
+
+  FMM.cube(bodies);                                             // Initialize bodies in a cube
+  std::vector<int> atype(numBodies);                            // Atom types in initial order
+  for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {        // Loop over bodies
+    B->X *= 5;                                                  //  Make box larger than the Van der Waals cutoff
+    atype[B->IBODY] = int(drand48() * atoms);                   //  Initialize atom type
+  }                                                             // End loop over bodies
+  Bodies vbodies = bodies;                                      // Copy bodies for separate Van der Waals pass
+
+  std::cout << "Combined" << std::endl;                         // Print pass type
+  FMM.setCoulombVanDerWaals(atoms,rscale,gscale);               // Laplace P2P also evaluates Van der Waals
+  FMM.startTimer("Total FMM");                                  // Start timer
+  FMM.setDomain(bodies);                                        // Set domain size of FMM
+  FMM.bottomup(bodies,cells);                                   // Tree construction (bottom up) & upward sweep
+  FMM.setVanDerWaalsTypes(bodies,bodies,&atype[0],&atype[0]);   // Atom types in tree order
+  jcells = cells;                                               // Vector of source cells
+  FMM.downward(cells,jcells);                                   // Downward sweep
+  FMM.stopTimer("Total FMM",FMM.printNow);                      // Stop timer
+  FMM.resetTimer();                                             // Erase all events in timer
+  std::vector<vec<4,real> > vdw(numBodies);                     // Van der Waals target values in initial order
+  for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {        // Loop over bodies
+    vdw[B->IBODY] = FMM.getVanDerWaals(B);                      //  Copy from side array of combined mode
+  }                                                             // End loop over bodies
+  std::vector<int> ibody(numBodies);                            // Initial index of bodies in tree order
+  for( int b=0; b!=numBodies; ++b ) ibody[b] = bodies[b].IBODY; // Save initial index
+  FMM.initTarget(bodies);                                       // Clear target values of both parts
+  FMM.downward(cells,jcells);                                   // Evaluate again to check that nothing accumulates
+  real diff = 0, norm = 0;                                      // Difference between the two evaluations
+  for( int b=0; b!=numBodies; ++b ) {                           // Loop over bodies
+    bodies[b].IBODY = ibody[b];                                 //  Restore initial index
+    real V = FMM.getVanDerWaals(bodies.begin()+b)[0];           //  Van der Waals potential of second evaluation
+    diff += (V - vdw[ibody[b]][0]) * (V - vdw[ibody[b]][0]);    //  Difference of potential
+    norm += vdw[ibody[b]][0] * vdw[ibody[b]][0];                //  Value of potential
+  }                                                             // End loop over bodies
+  assert( diff <= 1e-10 * norm );                               // Second evaluation must not add to the first
+
+  std::cout << "Separate" << std::endl;                         // Print pass type
+  SerialFMM<VanDerWaals> VDW;                                   // Instantiate SerialFMM class for Van der Waals
+  VDW.initialize();                                             // Initialize FMM
+  VDW.printNow = true;                                          // Print timer
+  Bodies cbodies = vbodies;                                     // Copy bodies for separate Coulomb pass
+  for( B_iter B=vbodies.begin(); B!=vbodies.end(); ++B ) {      // Loop over bodies
+    B->SRC = atype[B->IBODY] + .5;                              //  Atom type is the source of Van der Waals
+  }                                                             // End loop over bodies
+  SerialFMM<Laplace> COULOMB;                                   // Instantiate SerialFMM class for Coulomb
+  COULOMB.initialize();                                         // Initialize FMM
+  COULOMB.startTimer("Total FMM");                              // Start timer
+  COULOMB.setDomain(cbodies);                                   // Set domain size of FMM
+  COULOMB.bottomup(cbodies,cells);                              // Tree construction (bottom up) & upward sweep
+  jcells = cells;                                               // Vector of source cells
+  COULOMB.downward(cells,jcells);                               // Downward sweep
+  VDW.setVanDerWaals(atoms,rscale,gscale);                      // Set Van der Waals parameters
+  VDW.setDomain(vbodies);                                       // Set domain size of FMM
+  VDW.bottomup(vbodies,cells);                                  // Tree construction (bottom up) & upward sweep
+  jcells = cells;                                               // Vector of source cells
+  VDW.downward(cells,jcells);                                   // Downward sweep
+  COULOMB.stopTimer("Total FMM",FMM.printNow);                  // Stop timer
+  VDW.finalize();                                               // Finalize FMM
+  COULOMB.finalize();                                           // Finalize FMM
+
+  std::cout << "Coulomb" << std::endl;                          // Print Coulomb error against direct summation
+  Bodies jbodies = bodies;                                      // Copy source bodies
+  Bodies ibodies = bodies;                                      // Copy target bodies
+  FMM.sampleBodies(ibodies,numTarget);                          // Shrink target bodies vector to save time
+  FMM.buffer = ibodies;                                         // Define new bodies vector for direct sum
+  FMM.initTarget(FMM.buffer);                                   // Reinitialize target values
+  FMM.evalP2P(FMM.buffer,jbodies);                              // Direct summation between buffer and jbodies
+  real diff1 = 0, norm1 = 0, diff2 = 0, norm2 = 0;              // Initialize accumulators
+  FMM.evalError(ibodies,FMM.buffer,diff1,norm1,diff2,norm2);    // Evaluate error on the reduced set of bodies
+  FMM.printError(diff1,norm1,diff2,norm2);                      // Print the L2 norm error
+
+  std::cout << "Van der Waals" << std::endl;                    // Print Van der Waals error against separate pass
+  std::sort(vbodies.begin(),vbodies.end());                     // Sort separate bodies by initial index
+  diff1 = norm1 = diff2 = norm2 = 0;                            // Initialize accumulators
+  for( int i=0; i!=numBodies; ++i ) {                           // Loop over bodies
+    diff1 += (vdw[i][0] - vbodies[i].TRG[0]) * (vdw[i][0] - vbodies[i].TRG[0]);// Difference of potential
+    norm1 += vbodies[i].TRG[0] * vbodies[i].TRG[0];             //  Value of potential
+    for( int d=1; d!=4; ++d ) {                                 //  Loop over force components
+      diff2 += (vdw[i][d] - vbodies[i].TRG[d]) * (vdw[i][d] - vbodies[i].TRG[d]);// Difference of force
+      norm2 += vbodies[i].TRG[d] * vbodies[i].TRG[d];           //   Value of force
+    }                                                           //  End loop over force components
+  }                                                             // End loop over bodies
+  FMM.printError(diff1,norm1,diff2,norm2);                      // Print the L2 norm error
+
+  std::cout << "Combined with exclusions" << std::endl;         // Print pass type
+  std::vector<int> itree(numBodies);                            // Tree position of initial index
+  for( int b=0; b!=numBodies; ++b ) itree[bodies[b].IBODY] = b; // Invert permutation
+  for( int b=0; b!=numBodies; ++b ) {                           // Loop over bodies
+    B_iter B = bodies.begin() + b;                              //  Body iterator
+    if( B->IBODY % 3 == 0 ) continue;                           //  First atom of molecule stays in place
+    B_iter B0 = bodies.begin() + itree[B->IBODY - B->IBODY % 3];//  First atom of molecule
+    for( int d=0; d!=3; ++d ) B->X[d] = B0->X[d] + (drand48() - .5) * .4;// Bond to first atom, inside the cutoff
+  }                                                             // End loop over bodies
+  std::vector<int> numex(numBodies), natex;                     // Exclusions within molecules (each pair listed once)
+  for( int i=0; i!=numBodies; ++i ) {                           // Loop over bodies
+    numex[i] = std::min(2 - i % 3,numBodies - 1 - i);           //  Number of later atoms in the same molecule
+    for( int j=i+1; j<=i+numex[i]; ++j ) natex.push_back(j);    //  Exclude later atoms of molecule
+  }                                                             // End loop over bodies
+  FMM.setDomain(bodies);                                        // Set domain size of FMM
+  FMM.bottomup(bodies,cells);                                   // Tree construction (bottom up) & upward sweep
+  for( int b=0; b!=numBodies; ++b ) ibody[b] = bodies[b].IBODY; // Save initial index
+  FMM.initTarget(bodies);                                       // Clear target values
+  for( int b=0; b!=numBodies; ++b ) bodies[b].IBODY = ibody[b]; // Restore initial index (natex refers to it)
+  FMM.setVanDerWaalsTypes(bodies,bodies,&atype[0],&atype[0]);   // Atom types in tree order
+  FMM.setExclusions(bodies,bodies,&numex[0],&natex[0],0,true);  // Exclusion lists in tree order
+  jcells = cells;                                               // Vector of source cells
+  FMM.downward(cells,jcells);                                   // Downward sweep
+  FMM.clearExclusions();                                        // Exclusions are only valid for these bodies
+  double cdiff = 0, cnorm = 0, vdiff = 0, vnorm = 0;            // Coulomb and Van der Waals potential errors
+  for( int b=0; b<numBodies; b+=numBodies/numTarget ) {         // Loop over sampled targets in tree order
+    B_iter Bi = bodies.begin() + b;                             //  Target body iterator
+    int first = Bi->IBODY - Bi->IBODY % 3;                      //  First atom of molecule
+    double P0 = 0, V0 = 0;                                      //  Direct sums in double precision
+    for( B_iter Bj=bodies.begin(); Bj!=bodies.end(); ++Bj ) {   //  Loop over sources
+      if( first <= Bj->IBODY && Bj->IBODY < first+3 ) continue; //   Skip atoms of the same molecule
+      double R2 = 0;                                            //   R^2
+      for( int d=0; d!=3; ++d ) R2 += (Bi->X[d] - Bj->X[d]) * (Bi->X[d] - Bj->X[d]);
+      P0 += Bj->SRC / std::sqrt(R2);                            //   Coulomb potential
+      if( R2 < R2MIN || R2MAX <= R2 ) continue;                 //   Van der Waals only inside the cutoff
+      int ij = atype[Bi->IBODY] * atoms + atype[Bj->IBODY];     //   Parameter index
+      double invR6 = std::pow(R2 * rscale[ij],-3.);             //   1 / R^6
+      V0 += gscale[ij] * invR6 * (invR6 - 1);                   //   Van der Waals potential
+    }                                                           //  End loop over sources
+    cdiff += (Bi->TRG[0] - P0) * (Bi->TRG[0] - P0);             //  Difference of Coulomb potential
+    cnorm += P0 * P0;                                           //  Value of Coulomb potential
+    real V = FMM.getVanDerWaals(Bi)[0];                         //  Van der Waals potential of combined mode
+    vdiff += (V - V0) * (V - V0);                               //  Difference of Van der Waals potential
+    vnorm += V0 * V0;                                           //  Value of Van der Waals potential
+  }                                                             // End loop over sampled targets
+  std::cout << std::setw(20) << std::left << "Error (Coulomb)" << " : " << std::sqrt(cdiff/cnorm) << std::endl;
+  std::cout << std::setw(20) << std::left << "Error (VdW)" << " : " << std::sqrt(vdiff/vnorm) << std::endl;
+  assert( cdiff <= 1e-6 * cnorm && vdiff <= 1e-8 * vnorm );     // Excluded pairs must be left out of both parts
+  FMM.finalize();                                               // Finalize FMM
+}
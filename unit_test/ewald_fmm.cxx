@@ -3,8 +3,7 @@
 int main() {
   const int numBodies = 1000;                                   // Number of bodies
   const real xmax = 100.0;                                      // Size of domain
-  const real ksize = 44.0;                                      // Ewald wave number
-  const real alpha = 0.2;                                       // Ewald alpha value
+  const real accuracy = 1e-4;                                   // Ewald relative force error
   const real sigma = .25 / M_PI;                                // Ewald sigma value
   IMAGES = 8;                                                   // Level of periodic image tree (0 for non-periodic)
   THETA = 1 / sqrt(4);                                          // Multipole acceptance criteria
@@ -40,7 +39,8 @@ int main() {
   FMM.eraseTimer("Set domain");                                 // Erase entry from timer to avoid timer overlap
 
   FMM.bottomup(bodies,cells);                                   // Tree construction (bottom up) & upward sweep
-  FMM.setEwald(ksize,alpha,sigma);                              // Set Ewald method paramters
+  real timeEwald = FMM.tuneEwald(bodies,cells,accuracy,sigma);  // Set Ewald method paramters for accuracy
+  std::cout << "Ewald predicted      : " << timeEwald << std::endl;// Print predicted time of Ewald
   jcells = cells;                                               // Copy cells to jcells
   FMM.Ewald(bodies,cells,jcells);                               // Ewald summation
 
@@ -0,0 +1,112 @@
+/*
+Copyright (C) 2011 by Rio Yokota, Simon Layton, Lorena Barba
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+#include "serialfmm.h"
+
+int main() {
+  const int numBodies = 30000;                                  // Number of bodies (molecules of three atoms)
+  const int numTarget = 100;                                    // Number of target points to be used for error eval
+  IMAGES = 0;                                                   // Level of periodic image tree (0 for non-periodic)
+  THETA = 0.5;                                                  // Multipole acceptance criteria
+  Bodies bodies(numBodies);                                     // Define vector of bodies
+  Bodies jbodies;                                               // Define vector of source bodies
+  Cells cells, jcells;                                          // Define vector of cells
+  SerialFMM<Laplace> FMM;                                       // Instantiate SerialFMM class
+  FMM.initialize();                                             // Initialize FMM
+  FMM.printNow = true;                                          // Print timer
+
+  FMM.cube(bodies);                                             // Initialize bodies in a cube
+  for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {        // Loop over bodies
+    int b = B - bodies.begin();                                 //  Index of body
+    if( b % 3 != 0 ) {                                          //  If body is bonded to first atom of molecule
+      for( int d=0; d!=3; ++d ) {                               //   Loop over dimensions
+        B->X[d] = bodies[b-b%3].X[d] + (drand48() - .5) * .02;  //    Place next to first atom
+      }                                                         //   End loop over dimensions
+    }                                                           //  Endif for bonded body
+  }                                                             // End loop over bodies
+  std::vector<int> numex(numBodies), natex;                     // Exclusions within molecules (each pair listed once)
+  for( int i=0; i!=numBodies; ++i ) {                           // Loop over bodies
+    numex[i] = 2 - i % 3;                                       //  Number of later atoms in the same molecule
+    for( int j=i+1; j<=i+numex[i]; ++j ) natex.push_back(j);    //  Exclude later atoms of molecule
+  }                                                             // End loop over bodies
+  FMM.setDomain(bodies);                                        // Set domain size of FMM
+  FMM.bottomup(bodies,cells);                                   // Tree construction (bottom up) & upward sweep
+  std::vector<int> ibody(numBodies), itree(numBodies);          // Initial index of bodies in tree order, and inverse
+  for( int b=0; b!=numBodies; ++b ) {                           // Loop over bodies in tree order
+    ibody[b] = bodies[b].IBODY;                                 //  Save initial index (natex refers to it)
+    itree[ibody[b]] = b;                                        //  Tree position of initial index
+  }                                                             // End loop over bodies
+  for( int mutual=0; mutual!=2; ++mutual ) {                    // Loop over one-sided and mutual traversal
+    std::cout << (mutual ? "Mutual" : "One-sided") << std::endl;//  Print traversal type
+    FMM.initTarget(bodies);                                     //  Reinitialize target values
+    for( int b=0; b!=numBodies; ++b ) bodies[b].IBODY = ibody[b];// Restore initial index
+    FMM.setExclusions(bodies,bodies,&numex[0],&natex[0],0,true);//  Exclusion lists in tree order
+    int wrong = 0;                                              //  Number of targets with wrong exclusion lists
+    for( int b=0; b!=numBodies; ++b ) {                         //  Loop over targets in tree order
+      int first = ibody[b] - ibody[b] % 3;                      //   First atom of molecule
+      std::vector<int> partners;                                //   Other atoms of molecule in tree order
+      for( int a=first; a!=first+3; ++a ) {                     //   Loop over atoms of molecule
+        if( a != ibody[b] ) partners.push_back(itree[a]);       //    Add partner
+      }                                                         //   End loop over atoms of molecule
+      std::sort(partners.begin(),partners.end());               //   Exclusion lists are sorted
+      if( FMM.getNumExclusions(b) != 2 ||                       //   If list does not hold exactly the partners
+          !std::equal(partners.begin(),partners.end(),FMM.getExclusions(b)) ) wrong++;
+    }                                                           //  End loop over targets
+    assert( wrong == 0 );                                       //  Every target excludes its two partners
+    FMM.startTimer("Downward");                                 //  Start timer
+    if( mutual ) {                                              //  If targets are the sources
+      FMM.downward(cells,cells);                                //   Downward sweep with mutual interactions
+    } else {                                                    //  If sources are a separate vector
+      jcells = cells;                                           //   Vector of source cells
+      FMM.downward(cells,jcells);                               //   Downward sweep
+    }                                                           //  Endif for mutual
+    FMM.stopTimer("Downward",FMM.printNow);                     //  Stop timer
+    FMM.clearExclusions();                                      //  Direct summation includes all pairs
+
+    jbodies = bodies;                                           //  Copy source bodies
+    Bodies ibodies = bodies;                                    //  Copy target bodies
+    FMM.sampleBodies(ibodies,numTarget);                        //  Shrink target bodies vector to save time
+    FMM.buffer = ibodies;                                       //  Define new bodies vector for direct sum
+    for( B_iter B=FMM.buffer.begin(); B!=FMM.buffer.end(); ++B ) {// Loop over sampled targets
+      int first = B->IBODY - B->IBODY % 3;                      //   First atom of molecule
+      double P0 = 0, F[3] = {0, 0, 0};                          //   Direct sum in double precision
+      for( B_iter Bj=jbodies.begin(); Bj!=jbodies.end(); ++Bj ) {// Loop over sources
+        if( first <= Bj->IBODY && Bj->IBODY < first+3 ) continue;//   Skip atoms of the same molecule
+        double dx[3], R2 = 0;                                   //    Distance vector and R^2
+        for( int d=0; d!=3; ++d ) {                             //    Loop over dimensions
+          dx[d] = B->X[d] - Bj->X[d];                           //     Distance from source to target
+          R2 += dx[d] * dx[d];                                  //     Accumulate R^2
+        }                                                       //    End loop over dimensions
+        double invR = Bj->SRC / std::sqrt(R2);                  //    Potential
+        P0 += invR;                                             //    Accumulate potential
+        for( int d=0; d!=3; ++d ) F[d] -= dx[d] * invR / R2;    //    Accumulate force
+      }                                                         //   End loop over sources
+      B->TRG[0] = P0;                                           //   Potential without excluded pairs
+      for( int d=0; d!=3; ++d ) B->TRG[d+1] = F[d];             //   Force without excluded pairs
+    }                                                           //  End loop over sampled targets
+    real diff1 = 0, norm1 = 0, diff2 = 0, norm2 = 0;            //  Initialize accumulators
+    FMM.evalError(ibodies,FMM.buffer,diff1,norm1,diff2,norm2);  //  Evaluate error on the reduced set of bodies
+    FMM.printError(diff1,norm1,diff2,norm2);                    //  Print the L2 norm error
+    assert( diff1 <= 1e-6 * norm1 && diff2 <= 1e-6 * norm2 );   //  Excluded pairs must be left out
+    FMM.resetTimer();                                           //  Erase all events in timer
+  }                                                             // End loop over traversal types
+  FMM.finalize();                                               // Finalize FMM
+}
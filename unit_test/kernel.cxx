@@ -33,78 +33,108 @@ int main() {
   Evaluator<Laplace> FMM;                                       // Instantiate Evaluator class
   FMM.initialize();                                             // Initialize FMM
   FMM.preCalculation();                                         // Kernel pre-processing
+#if Spherical && CPU
+  const int orders[] = {4, 6, 8, 10, 12, 16};                   // Orders of expansions to test
+#else
+  const int orders[] = {P};                                     // Order of expansions is fixed
+#endif
 
-  for( int it=0; it!=5; ++it ) {                                // Loop over kernel iterations
-    real dist = (1 << it) / 2;                                  //  Distance between source and target
-    for( B_iter B=ibodies.begin(); B!=ibodies.end(); ++B ) {    //  Loop over target bodies
-      for( int d=0; d!=3; ++d ) {                               //   Loop over dimensions
-        B->X[d] = -drand48() - dist;                            //    Initialize positions
-      }                                                         //   End loop over dimensions
-    }                                                           //  End loop over target bodies
-    for( B_iter B=jbodies.begin(); B!=jbodies.end(); ++B ) {    //  Loop over source bodies
-      for( int d=0; d!=3; ++d ) {                               //   Loop over dimensions
-        B->X[d] = drand48();                                    //    Initialize positions
-      }                                                         //   End loop over dimensions
-    }                                                           //  End loop over source bodies
-    FMM.initSource(jbodies);                                    //  Initialize source values
-    bool IeqJ = false;                                          //  Target == Source ?
-    FMM.initTarget(ibodies,IeqJ);                               //  Initialize target values
+  for( int io=0; io!=int(sizeof(orders)/sizeof(int)); ++io ) {  // Loop over orders of expansions
+    FMM.setOrder(orders[io]);                                   //  Set order of expansions
+    std::cout << "Order         : " << orders[io] << std::endl; //  Print order of expansions
+    for( int it=0; it!=5; ++it ) {                              //  Loop over kernel iterations
+      real dist = (1 << it) / 2;                                //   Distance between source and target
+      for( B_iter B=ibodies.begin(); B!=ibodies.end(); ++B ) {  //   Loop over target bodies
+        for( int d=0; d!=3; ++d ) {                             //    Loop over dimensions
+          B->X[d] = -drand48() - dist;                          //     Initialize positions
+        }                                                       //    End loop over dimensions
+      }                                                         //   End loop over target bodies
+      for( B_iter B=jbodies.begin(); B!=jbodies.end(); ++B ) {  //   Loop over source bodies
+        for( int d=0; d!=3; ++d ) {                             //    Loop over dimensions
+          B->X[d] = drand48();                                  //     Initialize positions
+        }                                                       //    End loop over dimensions
+      }                                                         //   End loop over source bodies
+      FMM.initSource(jbodies);                                  //   Initialize source values
+      bool IeqJ = false;                                        //   Target == Source ?
+      FMM.initTarget(ibodies,IeqJ);                             //   Initialize target values
 
-    Cell cell;                                                  //  Define cell
-    cell.NDLEAF   = numBodies;                                  //  Number of leafs
-    cell.LEAF     = jbodies.begin();                            //  Iterator of first leaf
-    cell.X        = 0.5;                                        //  Position
-    cell.M        = 0;                                          //  Initialize multipole coefficients
-    cell.ICELL    = 8;                                          //  Cell index
-    cell.NCHILD   = 0;                                          //  Number of child cells
-    cell.PARENT   = 1;                                          //  Iterator offset of parent cell
-    jcells.push_back(cell);                                     //  Push cell into source cell vector
-    FMM.evalP2M(jcells);                                        //  Evaluate P2M kernel
-    cell.X        = 1;                                          //  Position
-    cell.M        = 0;                                          //  Initialize multipole coefficients
-    cell.ICELL    = 0;                                          //  Cell index
-    cell.NCHILD   = 1;                                          //  Number of child cells
-    cell.CHILD    = 0;                                          //  Iterator offset of child cell
-    jcells.push_back(cell);                                     //  Push cell into source cell vector
-    FMM.evalM2M(jcells,jcells);                                 //  Evaluate M2M kernel
-    jcells.erase(jcells.begin());                               //  Erase first source cell
-    cell.X        = -1 - dist;                                  //  Position
-    cell.M        = 1;                                          //  Initialize multipole coefficients
-    cell.L        = 0;                                          //  Initialize local coefficients
-    cell.ICELL    = 0;                                          //  Cell index
-    icells.push_back(cell);                                     //  Push cell into target cell vector
-    FMM.addM2L(jcells.begin());                                 //  Add source cell to M2L list
-    FMM.evalM2L(icells);                                        //  Evaluate M2L kernel
-    cell.NDLEAF    = numBodies;                                 //  Number of leafs
-    cell.LEAF     = ibodies.begin();                            //  Iterator of first leaf
-    cell.X        = -0.5 - dist;                                //  Position
-    cell.L        = 0;                                          //  Initialize local coefficients
-    cell.ICELL    = 1;                                          //  Cell index
-    cell.NCHILD   = 0;                                          //  Number of child cells
-    cell.PARENT   = 1;                                          //  Iterator offset of parent cell
-    icells.insert(icells.begin(),cell);                         //  Insert cell to begining of target cell vector
-    FMM.evalL2L(icells);                                        //  Evaluate L2L kernel
-    icells.pop_back();                                          //  Pop back target cell vector
-    FMM.evalL2P(icells);                                        //  Evaluate L2P kernel
+      Cell cell;                                                //   Define cell
+      cell.NCLEAF   = numBodies;                                //   Number of leafs
+      cell.NDLEAF   = numBodies;                                //   Number of leafs
+      cell.LEAF     = jbodies.begin();                          //   Iterator of first leaf
+      cell.X        = 0.5;                                      //   Position
+      cell.ICELL    = 8;                                        //   Cell index
+      cell.NCHILD   = 0;                                        //   Number of child cells
+      cell.PARENT   = 1;                                        //   Iterator offset of parent cell
+      cell.ICOEF    = -1;                                       //   Coefficients are allocated by P2M
+      jcells.push_back(cell);                                   //   Push cell into source cell vector
+      FMM.evalP2M(jcells);                                      //   Evaluate P2M kernel
+      cell.X        = 1;                                        //   Position
+      FMM.newCoef(cell);                                        //   Allocate zeroed multipole coefficients
+      cell.ICELL    = 0;                                        //   Cell index
+      cell.NCHILD   = 1;                                        //   Number of child cells
+      cell.CHILD    = 0;                                        //   Iterator offset of child cell
+      jcells.push_back(cell);                                   //   Push cell into source cell vector
+      FMM.evalM2M(jcells,jcells);                               //   Evaluate M2M kernel
+      jcells.erase(jcells.begin());                             //   Erase first source cell
+      cell.X        = -1 - dist;                                //   Position
+      FMM.newCoef(cell);                                        //   Allocate zeroed local coefficients
+      std::fill(FMM.getM(cell),FMM.getM(cell)+FMM.getNumM(),Coef(1));//   Initialize multipole coefficients
+      cell.ICELL    = 0;                                        //   Cell index
+      icells.push_back(cell);                                   //   Push cell into target cell vector
+#if Spherical
+      FMM.setM2LRotation(false);                                //   Use direct M2L
+      FMM.addM2L(jcells.begin());                               //   Add source cell to M2L list
+      FMM.evalM2L(icells);                                      //   Evaluate M2L kernel
+      Coef *L = FMM.getL(icells.back());                        //   Local coefficients of target cell
+      Coefs Ldirect(L,L+FMM.getNumL());                         //   Keep local coefficients of direct M2L
+      std::fill(L,L+FMM.getNumL(),Coef(0));                     //   Reinitialize local coefficients
+      FMM.setM2LRotation(true);                                 //   Use rotation based M2L
+      FMM.addM2L(jcells.begin());                               //   Add source cell to M2L list
+      FMM.evalM2L(icells);                                      //   Evaluate M2L kernel
+      real diffL = 0, normL = 0;                                //   Initialize accumulators
+      for( int i=0; i!=FMM.getNumL(); ++i ) {                   //   Loop over local coefficients
+        diffL += std::norm(L[i] - Ldirect[i]);                  //    Difference between rotation and direct
+        normL += std::norm(Ldirect[i]);                         //    Norm of direct
+      }                                                         //   End loop over local coefficients
+      std::cout << "Error (M2L rot)     : " << std::sqrt(diffL/normL) << std::endl;//   Print rotation vs direct M2L
+#else
+      FMM.addM2L(jcells.begin());                               //   Add source cell to M2L list
+      FMM.evalM2L(icells);                                      //   Evaluate M2L kernel
+#endif
+      cell.NCLEAF   = numBodies;                                //   Number of leafs
+      cell.NDLEAF   = numBodies;                                //   Number of leafs
+      cell.LEAF     = ibodies.begin();                          //   Iterator of first leaf
+      cell.X        = -0.5 - dist;                              //   Position
+      FMM.newCoef(cell);                                        //   Allocate zeroed local coefficients
+      cell.ICELL    = 1;                                        //   Cell index
+      cell.NCHILD   = 0;                                        //   Number of child cells
+      cell.PARENT   = 1;                                        //   Iterator offset of parent cell
+      icells.insert(icells.begin(),cell);                       //   Insert cell to begining of target cell vector
+      FMM.evalL2L(icells);                                      //   Evaluate L2L kernel
+      icells.pop_back();                                        //   Pop back target cell vector
+      FMM.evalL2P(icells);                                      //   Evaluate L2P kernel
 
-    ibodies2 = ibodies;                                         //  Copy target bodies
-    FMM.initTarget(ibodies2,IeqJ);                              //  Reinitialize target values
-    FMM.evalP2P(ibodies2,jbodies);                              //  Evaluate P2P kernel
+      ibodies2 = ibodies;                                       //   Copy target bodies
+      FMM.initTarget(ibodies2,IeqJ);                            //   Reinitialize target values
+      FMM.evalP2P(ibodies2,jbodies);                            //   Evaluate P2P kernel
 
-    real diff1 = 0, norm1 = 0, diff2 = 0, norm2 = 0;            //  Initialize accumulators
-    FMM.evalError(ibodies,ibodies2,diff1,norm1,diff2,norm2);    //  Evaluate error
-    std::cout << "Distance      : " << dist << std::endl;       //  Print distance between target and source
-    FMM.printError(diff1,norm1,diff2,norm2);                    //  Print the L2 norm error
+      real diff1 = 0, norm1 = 0, diff2 = 0, norm2 = 0;          //   Initialize accumulators
+      FMM.evalError(ibodies,ibodies2,diff1,norm1,diff2,norm2);  //   Evaluate error
+      std::cout << "Distance      : " << dist << std::endl;     //   Print distance between target and source
+      FMM.printError(diff1,norm1,diff2,norm2);                  //   Print the L2 norm error
 
-    FMM.initTarget(ibodies);                                    //  Reinitialize target values
-    FMM.addM2P(jcells.begin());                                 //  Add source cell to M2P list
-    FMM.evalM2P(icells);                                        //  Evaluate M2P kernel
-    icells.clear();                                             //  Clear target cell vector
-    jcells.clear();                                             //  Clear source cell vector
-    diff1 = norm1 = diff2 = norm2 = 0;                          //  Reinitialize accumulators
-    FMM.evalError(ibodies,ibodies2,diff1,norm1,diff2,norm2);    //  Evaluate error
-    FMM.printError(diff1,norm1,diff2,norm2);                    //  Print the L2 norm error
-  }                                                             // End loop over kernel iterations
+      FMM.initTarget(ibodies);                                  //   Reinitialize target values
+      FMM.addM2P(jcells.begin());                               //   Add source cell to M2P list
+      FMM.evalM2P(icells);                                      //   Evaluate M2P kernel
+      icells.clear();                                           //   Clear target cell vector
+      jcells.clear();                                           //   Clear source cell vector
+      FMM.clearCoef();                                          //   Release coefficients of all cells
+      diff1 = norm1 = diff2 = norm2 = 0;                        //   Reinitialize accumulators
+      FMM.evalError(ibodies,ibodies2,diff1,norm1,diff2,norm2);  //   Evaluate error
+      FMM.printError(diff1,norm1,diff2,norm2);                  //   Print the L2 norm error
+    }                                                           //  End loop over kernel iterations
+  }                                                             // End loop over orders of expansions
   FMM.postCalculation();                                        // Kernel post-processing
   FMM.finalize();                                               // Finalize FMM
 }
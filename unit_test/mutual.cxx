@@ -0,0 +1,64 @@
+/*
+Copyright (C) 2011 by Rio Yokota, Simon Layton, Lorena Barba
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+#include "serialfmm.h"
+
+int main() {
+  const int numBodies = 100000;                                 // Number of bodies
+  const int numTarget = 100;                                    // Number of target points to be used for error eval
+  IMAGES = 0;                                                   // Level of periodic image tree (0 for non-periodic)
+  THETA = 0.5;                                                  // Multipole acceptance criteria
+  Bodies bodies(numBodies);                                     // Define vector of bodies
+  Bodies jbodies;                                               // Define vector of source bodies
+  Cells cells, jcells;                                          // Define vector of cells
+  SerialFMM<Laplace> FMM;                                       // Instantiate SerialFMM class
+  FMM.initialize();                                             // Initialize FMM
+  FMM.printNow = true;                                          // Print timer
+
+  FMM.cube(bodies);                                             // Initialize bodies in a cube
+  FMM.setDomain(bodies);                                        // Set domain size of FMM
+  FMM.bottomup(bodies,cells);                                   // Tree construction (bottom up) & upward sweep
+  for( int mutual=0; mutual!=2; ++mutual ) {                    // Loop over one-sided and mutual traversal
+    std::cout << (mutual ? "Mutual" : "One-sided") << std::endl;//  Print traversal type
+    FMM.initTarget(bodies);                                     //  Reinitialize target values
+    FMM.resetCounters();                                        //  Count kernel calls of this traversal only
+    FMM.startTimer("Downward");                                 //  Start timer
+    if( mutual ) {                                              //  If targets are the sources
+      FMM.downward(cells,cells);                                //   Downward sweep with mutual interactions
+    } else {                                                    //  If sources are a separate vector
+      jcells = cells;                                           //   Vector of source cells
+      FMM.downward(cells,jcells);                               //   Downward sweep
+    }                                                           //  Endif for mutual
+    FMM.stopTimer("Downward",FMM.printNow);                     //  Stop timer
+
+    jbodies = bodies;                                           //  Copy source bodies
+    Bodies ibodies = bodies;                                    //  Copy target bodies
+    FMM.sampleBodies(ibodies,numTarget);                        //  Shrink target bodies vector to save time
+    FMM.buffer = ibodies;                                       //  Define new bodies vector for direct sum
+    FMM.initTarget(FMM.buffer);                                 //  Reinitialize target values
+    FMM.evalP2P(FMM.buffer,jbodies);                            //  Direct summation between buffer and jbodies
+    real diff1 = 0, norm1 = 0, diff2 = 0, norm2 = 0;            //  Initialize accumulators
+    FMM.evalError(ibodies,FMM.buffer,diff1,norm1,diff2,norm2);  //  Evaluate error on the reduced set of bodies
+    FMM.printError(diff1,norm1,diff2,norm2);                    //  Print the L2 norm error
+    FMM.resetTimer();                                           //  Erase all events in timer
+  }                                                             // End loop over traversal types
+  FMM.finalize();                                               // Finalize FMM
+}
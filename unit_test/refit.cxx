@@ -0,0 +1,97 @@
+/*
+Copyright (C) 2011 by Rio Yokota, Simon Layton, Lorena Barba
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+#include "serialfmm.h"
+
+int main() {
+  const int numBodies = 100000;                                 // Number of bodies
+  const int numTarget = 100;                                    // Number of target points to be used for error eval
+  const int numSteps = 5;                                       // Number of time steps
+  IMAGES = 0;                                                   // Level of periodic image tree (0 for non-periodic)
+  THETA = 0.5;                                                  // Multipole acceptance criteria
+  Bodies bodies(numBodies);                                     // Define vector of bodies
+  Bodies jbodies;                                               // Define vector of source bodies
+  Cells cells, jcells;                                          // Define vector of cells
+  SerialFMM<Laplace> FMM;                                       // Instantiate SerialFMM class
+  FMM.initialize();                                             // Initialize FMM
+  FMM.printNow = true;                                          // Print timer
+
+  FMM.cube(bodies);                                             // Initialize bodies in a cube
+  FMM.setDomain(bodies,0,1.1*M_PI);                             // Set domain size of FMM with room to move
+  FMM.bottomup(bodies,cells);                                   // Tree construction (bottom up) & upward sweep
+
+  for( C_iter C=cells.begin(); C!=cells.end(); ++C ) {          // Loop over cells
+    if( C->NCHILD == 0 ) {                                      //  If cell is a twig
+      for( B_iter B=C->LEAF; B!=C->LEAF+C->NDLEAF; ++B ) {      //   Loop over bodies in twig
+        B->X += (C->X - B->X) * real(1e-2);                     //    Move body towards twig center (no crossings)
+      }                                                         //   End loop over bodies in twig
+    }                                                           //  Endif for twig
+  }                                                             // End loop over cells
+  bool refitted = FMM.refit(bodies,cells);                      // Refit tree without any body changing twigs
+  assert( refitted );                                           // Small displacements must not need a rebuild
+  Bodies bodies2 = bodies;                                      // Copy bodies for a fresh build
+  Cells cells2;                                                 // Cells of fresh build
+  FMM.bottomup(bodies2,cells2);                                 // Tree construction from scratch
+  assert( cells2.size() == cells.size() );                      // Refit must keep the topology
+  real diff = 0, norm = 0;                                      // Initialize accumulators
+  for( int c=0; c!=int(cells.size()); ++c ) {                   // Loop over cells
+    Coef *M = FMM.getM(cells[c]);                               //  Multipole of refitted cell
+    Coef *M2 = FMM.getM(cells2[c]);                             //  Multipole of freshly built cell
+    for( int i=0; i!=FMM.getNumM(); ++i ) {                     //  Loop over multipole coefficients
+      diff += std::norm(M[i] - M2[i]);                          //   Difference between refit and fresh build
+      norm += std::norm(M2[i]);                                 //   Norm of fresh build
+    }                                                           //  End loop over multipole coefficients
+  }                                                             // End loop over cells
+  std::cout << "Error (refit M)     : " << std::sqrt(diff/norm) << std::endl;// Print refit vs fresh build
+  assert( diff <= 1e-10 * norm );                               // Refit must reproduce the fresh build
+  FMM.freeCoef(cells2);                                         // Release coefficients of fresh build
+  FMM.resetTimer();                                             // Erase all events in timer
+
+  for( int step=0; step!=numSteps; ++step ) {                   // Loop over time steps
+    std::cout << "Step          : " << step << std::endl;       //  Print time step
+    real dx = FMM.getR0() * (step < numSteps-1 ? 1e-3 : 1e-1);  //  Small displacement, large in last step
+    for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {      //  Loop over bodies
+      for( int d=0; d!=3; ++d ) {                               //   Loop over dimensions
+        B->X[d] += dx * (drand48() - .5);                       //    Move body
+      }                                                         //   End loop over dimensions
+    }                                                           //  End loop over bodies
+    FMM.initTarget(bodies);                                     //  Reinitialize target values
+    if( !FMM.refit(bodies,cells) ) {                            //  If tree can not be refitted
+      std::cout << "Rebuild tree" << std::endl;                 //   Print rebuild
+      FMM.setDomain(bodies,0,1.1*M_PI);                         //   Set domain size of FMM with room to move
+      FMM.bottomup(bodies,cells);                               //   Tree construction (bottom up) & upward sweep
+    }                                                           //  Endif for refit
+    jcells = cells;                                             //  Vector of source cells
+    FMM.downward(cells,jcells);                                 //  Downward sweep
+
+    jbodies = bodies;                                           //  Copy source bodies
+    Bodies ibodies = bodies;                                    //  Copy target bodies
+    FMM.sampleBodies(ibodies,numTarget);                        //  Shrink target bodies vector to save time
+    FMM.buffer = ibodies;                                       //  Define new bodies vector for direct sum
+    FMM.initTarget(FMM.buffer);                                 //  Reinitialize target values
+    FMM.evalP2P(FMM.buffer,jbodies);                            //  Direct summation between buffer and jbodies
+    real diff1 = 0, norm1 = 0, diff2 = 0, norm2 = 0;            //  Initialize accumulators
+    FMM.evalError(ibodies,FMM.buffer,diff1,norm1,diff2,norm2);  //  Evaluate error on the reduced set of bodies
+    FMM.printError(diff1,norm1,diff2,norm2);                    //  Print the L2 norm error
+    FMM.resetTimer();                                           //  Erase all events in timer
+  }                                                             // End loop over time steps
+  FMM.finalize();                                               // Finalize FMM
+}
@@ -0,0 +1,90 @@
+/*
+Copyright (C) 2011 by Rio Yokota, Simon Layton, Lorena Barba
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+#include "evaluator.h"
+
+//! Compare every supported SIMD P2P kernel against the scalar kernel
+template<Equation equation>
+int checkP2P(Evaluator<equation> &FMM, BodiesSoA &ibodies, BodiesSoA &jbodies) {
+  const char *names[] = {"None","SSE","AVX2","AVX512"};         // Names of SIMD instruction sets
+  FMM.setSIMD(SIMDNone);                                        // Reference is the scalar kernel
+  BodiesSoA reference = ibodies;                                // Copy targets
+  FMM.P2P(reference,0,ibodies.size(),jbodies,0,jbodies.size()); // Evaluate scalar P2P kernel
+  int fail = 0;                                                 // Number of failed instruction sets
+  for( int simd=SIMDSSE; simd<=SIMDAVX512; ++simd ) {           // Loop over SIMD instruction sets
+    FMM.setSIMD(SIMDType(simd));                                //  Select instruction set
+    if( FMM.getSIMD() != simd ) continue;                       //  Skip if not supported on this CPU/build
+    BodiesSoA result = ibodies;                                 //  Copy targets
+    FMM.P2P(result,0,ibodies.size(),jbodies,0,jbodies.size());  //  Evaluate SIMD P2P kernel
+    real diff1 = 0, norm1 = 0, diff2 = 0, norm2 = 0;            //  Initialize accumulators
+    for( int i=0; i!=ibodies.size(); ++i ) {                    //  Loop over targets
+      diff1 += (result.TRG[0][i] - reference.TRG[0][i]) * (result.TRG[0][i] - reference.TRG[0][i]);// Potential diff
+      norm1 += reference.TRG[0][i] * reference.TRG[0][i];       //   Potential norm
+      for( int d=1; d!=4; ++d ) {                               //   Loop over force components
+        diff2 += (result.TRG[d][i] - reference.TRG[d][i]) * (result.TRG[d][i] - reference.TRG[d][i]);// Force diff
+        norm2 += reference.TRG[d][i] * reference.TRG[d][i];     //    Force norm
+      }                                                         //   End loop over force components
+    }                                                           //  End loop over targets
+    std::cout << "SIMD          : " << names[simd] << std::endl;//  Print instruction set
+    FMM.printError(diff1,norm1,diff2,norm2);                    //  Print the L2 norm error
+    if( !(diff1 <= 1e-10 * norm1 && diff2 <= 1e-10 * norm2) ) fail++;// Check error (single precision)
+  }                                                             // End loop over SIMD instruction sets
+  return fail;                                                  // Return number of failures
+}
+
+int main() {
+  const int numTarget = 1003;                                   // Number of target bodies (not a multiple of 16)
+  const int numSource = 517;                                    // Number of source bodies
+  const int atoms = 4;                                          // Number of atom types
+  IMAGES = 0;                                                   // Level of periodic image tree (0 for non-periodic)
+  Xperiodic = .25;                                              // Test periodic offset in the kernels
+  BodiesSoA ibodies, jbodies;                                   // Structure of arrays for targets/sources
+  ibodies.resize(numTarget);                                    // Allocate targets
+  jbodies.resize(numSource);                                    // Allocate sources
+  for( int i=0; i!=numTarget; ++i ) {                           // Loop over targets
+    for( int d=0; d!=3; ++d ) ibodies.X[d][i] = 10 * drand48(); //  Initialize positions
+    ibodies.SRC[i] = int(drand48() * atoms) + .5;               //  Initialize atom types
+  }                                                             // End loop over targets
+  for( int j=0; j!=numSource; ++j ) {                           // Loop over sources
+    for( int d=0; d!=3; ++d ) jbodies.X[d][j] = 10 * drand48(); //  Initialize positions
+  }                                                             // End loop over sources
+  for( int d=0; d!=3; ++d ) jbodies.X[d][7] = ibodies.X[d][11] - Xperiodic[d];// Coincident pair (R2 == 0)
+
+  int fail = 0;                                                 // Number of failures
+  Evaluator<Laplace> FMM;                                       // Instantiate Evaluator class
+  FMM.initialize();                                             // Initialize FMM
+  for( int j=0; j!=numSource; ++j ) jbodies.SRC[j] = drand48() / numSource;// Initialize charges
+  std::cout << "Laplace" << std::endl;                          // Print equation
+  fail += checkP2P(FMM,ibodies,jbodies);                        // Check Laplace kernels
+  FMM.finalize();                                               // Finalize FMM
+
+  Evaluator<VanDerWaals> VDW;                                   // Instantiate Evaluator class
+  double rscale[atoms*atoms], gscale[atoms*atoms];              // Van der Waals parameters
+  for( int i=0; i!=atoms*atoms; ++i ) {                         // Loop over pairs of atom types
+    rscale[i] = 1 + drand48();                                  //  r scale
+    gscale[i] = drand48();                                      //  g scale
+  }                                                             // End loop over pairs of atom types
+  VDW.setVanDerWaals(atoms,rscale,gscale);                      // Set Van der Waals parameters
+  for( int j=0; j!=numSource; ++j ) jbodies.SRC[j] = int(drand48() * atoms) + .5;// Initialize atom types
+  std::cout << "Van der Waals" << std::endl;                    // Print equation
+  fail += checkP2P(VDW,ibodies,jbodies);                        // Check Van der Waals kernels
+  return fail;                                                  // Return number of failures
+}
@@ -0,0 +1,80 @@
+#ifndef coulombVdW_h
+#define coulombVdW_h
+
+// Handle based interface for MD codes that call FMM every time step.
+// A handle keeps precalculated tables, buffers, and the trees of the previous call alive.
+// Each engine of a handle (Coulomb, Van der Waals, combined) is created on its first use.
+// FMMcalccoulomb_ij and FMMcalcvdw_ij use a default handle that is created on their first call.
+// When the sources are the targets (same xj, qj, atypej arrays as xi, qi, atypei), one tree is built and each pair
+// is evaluated once for both atoms. This mutual mode is non-periodic only: with periodicflag set the tree is
+// traversed one-sided against a copy of itself. The parallel library uses it for pairs within the local tree.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct FMMHandle FMMHandle;
+
+FMMHandle *FMMcreate();
+void FMMsetparameters(FMMHandle *handle, double theta, double threshold);
+void FMMdestroy(FMMHandle *handle);
+
+// Pairs left out of the following evaluations (numex[i] sources of target i in natex, numbered from base).
+// When xi == xj a pair listed once is excluded in both directions. Passing numex = NULL clears the lists.
+// FMMevalcoulombvdw_ij leaves them out of both the Coulomb and the Van der Waals part.
+void FMMsetexclusions(FMMHandle *handle, int *numex, int *natex, int base);
+
+void FMMevalcoulomb_ij(FMMHandle *handle, int ni, double* xi, double* qi, double* fi,
+  int nj, double* xj, double* qj, double rscale, int tblno, double size, int periodicflag);
+
+// Caller-owned array of 3-D vectors: component d of atom i is at (d == 0 ? x : d == 1 ? y : z)[i*stride].
+// Interleaved xyz arrays are {a, a+1, a+2, 3}, separate x, y, z arrays are {x, y, z, 1}.
+typedef struct FMMvec3 {
+  double *x, *y, *z;
+  int stride;
+} FMMvec3;
+
+// FMMevalcoulomb_ij on caller-owned strided or SoA arrays, read and written in place through the body permutation.
+// Charges are q[i*qstride]. For tblno = 1 the potential of atom i goes to fi.x[i*fi.stride].
+void FMMevalcoulomb_strided(FMMHandle *handle, int ni, FMMvec3 xi, double* qi, int qistride, FMMvec3 fi,
+  int nj, FMMvec3 xj, double* qj, int qjstride, int tblno, double size, int periodicflag);
+
+void FMMevalvdw_ij(FMMHandle *handle, int ni, double* xi, int* atypei, double* fi,
+  int nj, double* xj, int* atypej, int nat, double* gscale, double* rscale,
+  int tblno, double size, int periodicflag);
+
+// Coulomb by FMM and Van der Waals within the cutoff on the same tree (fi gets the sum of both, tblno as Coulomb).
+// The parallel library evaluates the two parts with separate engines.
+void FMMevalcoulombvdw_ij(FMMHandle *handle, int ni, double* xi, double* qi, int* atypei, double* fi,
+  int nj, double* xj, double* qj, int* atypej, int nat, double* gscale, double* rscale,
+  int tblno, double size, int periodicflag);
+
+void FMMcalccoulomb_ij(int ni, double* xi, double* qi, double* fi,
+  int nj, double* xj, double* qj, double rscale, int tblno, double size, int periodicflag);
+
+void FMMcalcvdw_ij(int ni, double* xi, int* atypei, double* fi,
+  int nj, double* xj, int* atypej, int nat, double* gscale, double* rscale,
+  int tblno, double size, int periodicflag);
+
+// Fortran bindings (handle is an integer*8 holding the pointer)
+void fmmcreate_(FMMHandle **handle);
+void fmmsetparameters_(FMMHandle **handle, double *theta, double *threshold);
+void fmmdestroy_(FMMHandle **handle);
+void fmmsetexclusions_(FMMHandle **handle, int *numex, int *natex);
+
+void fmmevalcoulomb_ij_(FMMHandle **handle, int *ni, double* xi, double* qi, double* fi,
+  int *nj, double* xj, double* qj, double *rscale, int *tblno, double *size, int *periodicflag);
+
+void fmmevalvdw_ij_(FMMHandle **handle, int *ni, double* xi, int* atypei, double* fi,
+  int *nj, double* xj, int* atypej, int *nat, double* gscale, double* rscale,
+  int *tblno, double *size, int *periodicflag);
+
+void fmmevalcoulombvdw_ij_(FMMHandle **handle, int *ni, double* xi, double* qi, int* atypei, double* fi,
+  int *nj, double* xj, double* qj, int* atypej, int *nat, double* gscale, double* rscale,
+  int *tblno, double *size, int *periodicflag);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
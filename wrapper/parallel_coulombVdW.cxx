@@ -3,89 +3,253 @@ extern "C" {
 #include "md.h"
 #include "vtgrapeproto.h"
 }
+#include "coulombVdW.h"
 
-extern "C" void FMMcalccoulomb_ij(int ni, double* xi, double* qi, double* fi,
-  int nj, double* xj, double* qj, double, int tblno, double size, int periodicflag) {
+//! Interleaved xyz array as a strided array
+static FMMvec3 interleaved(double *x) {
+  FMMvec3 v = {x, x+1, x+2, 3};
+  return v;
+}
+
+//! Component d of atom i in a caller's strided array
+static inline double &component(const FMMvec3 &v, int i, int d) {
+  return (d == 0 ? v.x : d == 1 ? v.y : v.z)[i*v.stride];
+}
+
+//! Correction for the dipole moment of the periodic box (forces for tblno = 0, potentials otherwise)
+static void dipoleCorrection(int ni, const FMMvec3 &xi, const double *qi, int qistride,
+                             const FMMvec3 &fi, int tblno, double size) {
+  double fc[3];
+  for( int d=0; d!=3; ++d ) fc[d]=0;
+  for( int i=0; i!=ni; ++i ) {
+    for( int d=0; d!=3; ++d ) {
+      fc[d] += qi[i*qistride] * component(xi,i,d);
+    }
+  }
+  if( tblno == 0 ) {
+    for( int i=0; i!=ni; ++i ) {
+      for( int d=0; d!=3; ++d ) {
+        component(fi,i,d) -= 4.0 * M_PI * qi[i*qistride] * fc[d] / (3.0 * size * size * size);
+      }
+    }
+  } else {
+    for( int i=0; i!=ni; ++i ) {
+      component(fi,i,0) += M_PI / (3.0 * size * size * size)
+                        * (fc[0] * fc[0] + fc[1] * fc[1] + fc[2] * fc[2]) / ni;
+    }
+  }
+}
+
+//! FMM engine and buffers of one equation that persist across calls
+template<Equation equation>
+struct FMMContext {
+  ParallelFMM<equation> FMM;                                    //!< FMM engine (keeps communicators and precalculated tables)
+  Bodies bodies;                                                //!< Target bodies
+  Bodies jbodies;                                               //!< Source bodies
+  Cells  cells;                                                 //!< Target cells
+  Cells  jcells;                                                //!< Source cells
+  bool   self;                                                  //!< Sources are the targets (one local tree, mutual downward phase)
+
+//! Constructor
+  FMMContext() : FMM(), bodies(), jbodies(), cells(), jcells(), self(false) {
+    FMM.initialize();                                           // Initialize FMM
+  }
+//! Destructor
+  ~FMMContext() {
+    FMM.finalize();                                             // Finalize FMM
+  }
+
+//! Copy positions into bodies (wrapped into the box) in the caller's order
+  void setPositions(Bodies &B0, int n, const FMMvec3 &x, double L) {
+    B0.resize(n);                                               // Bodies come back from other ranks in any order
+#pragma omp parallel for
+    for( int i=0; i<n; ++i ) {                                  // Loop over bodies
+      B_iter B = B0.begin() + i;                                //  Body iterator
+      for( int d=0; d!=3; ++d ) {                               //  Loop over dimensions
+        B->X[d] = component(x,i,d);                             //   Copy position
+        if( B->X[d] < -L/2 ) B->X[d] += L;                      //   Wrap into box from below
+        if( B->X[d] >  L/2 ) B->X[d] -= L;                      //   Wrap into box from above
+      }                                                         //  End loop over dimensions
+      B->IBODY = i;                                             //  Tag body with index in caller's arrays
+      B->IPROC = MPIRANK;                                       //  Tag body with MPI rank
+    }                                                           // End loop over bodies
+  }
+
+//! Copy positions of targets and sources (sources are not copied if they are the targets)
+  void setBodies(int ni, const FMMvec3 &xi, int nj, const FMMvec3 &xj, double L, bool same) {
+    self = same;                                                // Save if sources are the targets
+    setPositions(bodies,ni,xi,L);                               // Copy target positions
+    if( self ) jbodies.clear();                                 // Target bodies are used for both
+    else setPositions(jbodies,nj,xj,L);                         // Copy source positions
+  }
+
+//! Partition bodies, build trees, and exchange the local essential tree
+  void buildTrees(double L) {
+    cells.clear();                                              // Clear target cells of previous call
+    jcells.clear();                                             // Clear source cells of previous call
+    FMM.clearCoef();                                            // Release coefficients of previous cells
+    FMM.setGlobDomain(bodies,0,L/2);                            // Set global domain size of FMM
+    FMM.octsection(bodies);                                     // Partition domain and redistribute targets
+    if( !self ) FMM.octsection(jbodies);                        // Partition domain and redistribute sources
+    FMM.bottomup(bodies,cells);                                 // Tree construction (bottom up) & upward sweep
+    if( self ) {                                                // If sources are the targets
+      FMM.commBodies(cells);                                    //  Send bodies (not receiving yet)
+      return;                                                   //  Cells are communicated after the local phase
+    }                                                           // Endif for self
+    FMM.bottomup(jbodies,jcells);                               // Tree construction (bottom up) & upward sweep
+    FMM.commBodies(jcells);                                     // Send bodies (not receiving yet)
+    FMM.commCells(jbodies,jcells);                              // Communicate cells (receive bodies here)
+  }
+
+//! Downward phase, mutual on the local tree and one-sided for the rest of the LET if self
+  void downward() {
+    if( !self ) {                                               // If sources are different bodies
+      FMM.downward(cells,jcells);                               //  One-sided downward phase
+      return;                                                   //  Done
+    }                                                           // Endif for different bodies
+    FMM.downward(cells,cells,MPISIZE == 1);                     // Local tree with itself (periodic images with the LET)
+    if( MPISIZE == 1 ) return;                                  // No other ranks
+    jbodies = bodies;                                           // Local bodies are sent from the source copy
+    jcells = cells;                                             // Local tree is the base of the LET
+    FMM.commCells(jbodies,jcells);                              // Communicate cells (receive bodies here)
+    FMM.eraseLocalTree(jcells);                                 // Local tree was already evaluated
+    FMM.downward(cells,jcells);                                 // Rest of the LET
+  }
+
+//! Subtract excluded pairs from targets in the caller's order (sources of other ranks are not in the lists)
+  void subtractExclusions(Bodies &sources, int *numex, int *natex, int base, bool symmetric) {
+    FMM.setExclusions(bodies,sources,numex,natex,base,symmetric);// Exclusion lists in order of unpartitioned bodies
+    FMM.subtractExclusions();                                   // Subtract all excluded pairs in parallel
+    FMM.clearExclusions();                                      // Exclusions are only valid for these bodies
+  }
+};
+
+//! State of the MD interface that persists across calls
+struct FMMHandle {
+  FMMContext<Laplace>     *coulomb;                             //!< Coulomb engine (created on first use)
+  FMMContext<VanDerWaals> *vdw;                                 //!< Van der Waals engine (created on first use)
+  double theta;                                                 //!< Multipole acceptance criteria
+  double threshold;                                             //!< Unused, trees are rebuilt every call across ranks
+  int   *numex;                                                 //!< Number of excluded sources of each target
+  int   *natex;                                                 //!< Excluded sources of all targets
+  int    base;                                                  //!< Index of first body in natex
+
+//! Constructor
+  FMMHandle() : coulomb(), vdw(), theta(.5), threshold(.1), numex(), natex(), base() {}
+//! Destructor
+  ~FMMHandle() {
+    delete coulomb;                                             // Finalize Coulomb engine
+    delete vdw;                                                 // Finalize Van der Waals engine
+  }
+
+//! Get engine, creating it on first use (all ranks make the same calls)
+  template<Equation equation>
+  FMMContext<equation> &getContext(FMMContext<equation> *&context) {
+    if( !context ) context = new FMMContext<equation>;          // Only the engines a caller uses are built
+    return *context;                                            // Return engine
+  }
+
+private:
+  FMMHandle(const FMMHandle&);                                  //!< Engines are owned, handles are not copied
+  FMMHandle &operator=(const FMMHandle&);                       //!< Engines are owned, handles are not copied
+};
+
+//! Handle used by the interface without explicit handles
+static FMMHandle *defaultHandle() {
+  static FMMHandle *handle = new FMMHandle;                     // Created on first call, lives until exit
+  return handle;
+}
+
+extern "C" FMMHandle *FMMcreate() {
+  return new FMMHandle;
+}
+
+extern "C" void FMMsetparameters(FMMHandle *handle, double theta, double threshold) {
+  handle->theta = theta;
+  handle->threshold = threshold;
+}
+
+extern "C" void FMMdestroy(FMMHandle *handle) {
+  delete handle;
+}
+
+extern "C" void FMMsetexclusions(FMMHandle *handle, int *numex, int *natex, int base) {
+  handle->numex = numex;
+  handle->natex = natex;
+  handle->base = base;
+}
+
+extern "C" void FMMevalcoulomb_strided(FMMHandle *handle, int ni, FMMvec3 xi, double* qi, int qistride, FMMvec3 fi,
+  int nj, FMMvec3 xj, double* qj, int qjstride, int tblno, double size, int periodicflag) {
   std::cout << "tblno: " << tblno << std::endl;
   IMAGES = ((periodicflag & 0x1) == 0) ? 0 : 3;
-  THETA = .5;
-  Bodies bodies(ni),jbodies(nj);
-  Cells cells,jcells;
-  ParallelFMM<Laplace> FMM;
-
-  for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {
-    int i = B-bodies.begin();
-    B->X[0] = xi[3*i+0];
-    B->X[1] = xi[3*i+1];
-    B->X[2] = xi[3*i+2];
-    if( B->X[0] < -size/2 ) B->X[0] += size;
-    if( B->X[1] < -size/2 ) B->X[1] += size;
-    if( B->X[2] < -size/2 ) B->X[2] += size;
-    if( B->X[0] >  size/2 ) B->X[0] -= size;
-    if( B->X[1] >  size/2 ) B->X[1] -= size;
-    if( B->X[2] >  size/2 ) B->X[2] -= size;
-    B->SRC  = qi[i];
+  THETA = handle->theta;
+  FMMContext<Laplace> &context = handle->getContext(handle->coulomb);
+  ParallelFMM<Laplace> &FMM = context.FMM;
+  Bodies &bodies = context.bodies, &jbodies = context.jbodies;
+  bool self = ni == nj && xi.x == xj.x && xi.stride == xj.stride && qi == qj && qistride == qjstride;
+  context.setBodies(ni,xi,nj,xj,size,self);
+
+#pragma omp parallel for
+  for( int b=0; b<int(bodies.size()); ++b ) {
+    B_iter B = bodies.begin() + b;
+    int i = B->IBODY;
+    B->SRC  = qi[i*qistride];
+    B->TRG  = 0;
     switch (tblno) {
     case 0 :
-      B->TRG[1] = -fi[3*i+0];
-      B->TRG[2] = -fi[3*i+1];
-      B->TRG[3] = -fi[3*i+2];
+      B->TRG[1] = -component(fi,i,0);
+      B->TRG[2] = -component(fi,i,1);
+      B->TRG[3] = -component(fi,i,2);
       break;
     case 1 :
-      B->TRG[0] = fi[3*i+0];
+      B->TRG[0] = component(fi,i,0);
       break;
     }
-    B->IBODY = i;
-    B->IPROC = MPIRANK;
   }
 
-  for( B_iter B=jbodies.begin(); B!=jbodies.end(); ++B ) {
-    int i = B-jbodies.begin();
-    B->X[0] = xj[3*i+0];
-    B->X[1] = xj[3*i+1];
-    B->X[2] = xj[3*i+2];
-    if( B->X[0] < -size/2 ) B->X[0] += size;
-    if( B->X[1] < -size/2 ) B->X[1] += size;
-    if( B->X[2] < -size/2 ) B->X[2] += size;
-    if( B->X[0] >  size/2 ) B->X[0] -= size;
-    if( B->X[1] >  size/2 ) B->X[1] -= size;
-    if( B->X[2] >  size/2 ) B->X[2] -= size;
-    B->SRC  = qj[i];
+#pragma omp parallel for
+  for( int b=0; b<int(jbodies.size()); ++b ) {
+    B_iter B = jbodies.begin() + b;
+    int i = B->IBODY;
+    B->SRC  = qj[i*qjstride];
   }
 
-  FMM.initialize();
-  FMM.setGlobDomain(bodies,0,size/2);
-  FMM.octsection(bodies);
-  FMM.octsection(jbodies);
-  FMM.bottomup(bodies,cells);
-  FMM.bottomup(jbodies,jcells);
-  FMM.commBodies(jcells);
-  FMM.commCells(jbodies,jcells);
-
-  FMM.downward(cells,jcells);
+  context.buildTrees(size);
+  context.downward();
   FMM.unpartition(bodies);
-  std::sort(bodies.begin(),bodies.end());
+  if( handle->numex ) {
+    Bodies sources;
+    context.setPositions(sources,nj,xj,size);
+    for( int j=0; j<nj; ++j ) sources[j].SRC = qj[j*qjstride];
+    context.subtractExclusions(sources,handle->numex,handle->natex,handle->base,xi.x==xj.x);
+  }
   if( MPIRANK == 0 ) FMM.writeTime();
-  FMM.finalize();
+  FMM.resetTimer();
 
-#if 1
-  for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {
-    int i = B-bodies.begin();
-//    xi[3*i+0] = B->X[0];
-//    xi[3*i+1] = B->X[1];
-//    xi[3*i+2] = B->X[2];
-//    qi[i]     = B->SRC;
+#pragma omp parallel for
+  for( int b=0; b<int(bodies.size()); ++b ) {
+    B_iter B = bodies.begin() + b;
+    int i = B->IBODY;
     switch (tblno) {
     case 0 :
-      fi[3*i+0] = -B->SRC * B->TRG[1];
-      fi[3*i+1] = -B->SRC * B->TRG[2];
-      fi[3*i+2] = -B->SRC * B->TRG[3];
+      component(fi,i,0) = -B->SRC * B->TRG[1];
+      component(fi,i,1) = -B->SRC * B->TRG[2];
+      component(fi,i,2) = -B->SRC * B->TRG[3];
       break;
     case 1 :
-      fi[3*i+0] = 0.5 * B->SRC * B->TRG[0];
+      component(fi,i,0) = 0.5 * B->SRC * B->TRG[0];
       break;
     }
   }
+  dipoleCorrection(ni,xi,qi,qistride,fi,tblno,size);
+}
+
+extern "C" void FMMevalcoulomb_ij(FMMHandle *handle, int ni, double* xi, double* qi, double* fi,
+  int nj, double* xj, double* qj, double, int tblno, double size, int periodicflag) {
+#if 1
+  FMMevalcoulomb_strided(handle,ni,interleaved(xi),qi,1,interleaved(fi),
+                         nj,interleaved(xj),qj,1,tblno,size,periodicflag);
 #else
   for( int irank=0; irank!=MPISIZE; ++irank ) {
     MPI_Shift(xj,3*nj,MPISIZE,MPIRANK);
@@ -128,50 +292,28 @@ extern "C" void FMMcalccoulomb_ij(int ni, double* xi, double* qi, double* fi,
       break;
     }
   }
+  dipoleCorrection(ni,interleaved(xi),qi,1,interleaved(fi),tblno,size);
 #endif
-  double fc[3];
-  for( int d=0; d!=3; ++d ) fc[d]=0;
-  for( int i=0; i!=ni; ++i ) {
-    for( int d=0; d!=3; ++d ) {
-      fc[d] += qi[i] * xi[3*i+d];
-    }
-  }
-  if( tblno == 0 ) {
-    for( int i=0; i!=ni; ++i ) {
-      for( int d=0; d!=3; ++d ) {
-        fi[3*i+d] -= 4.0 * M_PI * qi[i] * fc[d] / (3.0 * size * size * size);
-      }
-    }
-  } else {
-    for( int i=0; i!=ni; ++i ) {
-      fi[3*i+0] += M_PI / (3.0 * size * size * size)
-                * (fc[0] * fc[0] + fc[1] * fc[1] + fc[2] * fc[2]) / ni;
-    }
-  }
 }
 
-extern "C" void FMMcalcvdw_ij(int ni, double* xi, int* atypei, double* fi,
+extern "C" void FMMevalvdw_ij(FMMHandle *handle, int ni, double* xi, int* atypei, double* fi,
   int nj, double* xj, int* atypej, int nat, double* gscale, double* rscale,
   int tblno, double size, int periodicflag) {
   std::cout << "tblno: " << tblno << std::endl;
   IMAGES = ((periodicflag & 0x1) == 0) ? 0 : 3;
-  THETA = .5;
-  Bodies bodies(ni),jbodies(nj);
-  Cells cells,jcells;
-  ParallelFMM<VanDerWaals> FMM;
-
-  for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {
-    int i = B-bodies.begin();
-    B->X[0] = xi[3*i+0];
-    B->X[1] = xi[3*i+1];
-    B->X[2] = xi[3*i+2];
-    if( B->X[0] < -size/2 ) B->X[0] += size;
-    if( B->X[1] < -size/2 ) B->X[1] += size;
-    if( B->X[2] < -size/2 ) B->X[2] += size;
-    if( B->X[0] >  size/2 ) B->X[0] -= size;
-    if( B->X[1] >  size/2 ) B->X[1] -= size;
-    if( B->X[2] >  size/2 ) B->X[2] -= size;
+  THETA = handle->theta;
+  FMMContext<VanDerWaals> &context = handle->getContext(handle->vdw);
+  ParallelFMM<VanDerWaals> &FMM = context.FMM;
+  Bodies &bodies = context.bodies, &jbodies = context.jbodies;
+  bool self = ni == nj && xi == xj && atypei == atypej;
+  context.setBodies(ni,interleaved(xi),nj,interleaved(xj),size,self);
+
+#pragma omp parallel for
+  for( int b=0; b<int(bodies.size()); ++b ) {
+    B_iter B = bodies.begin() + b;
+    int i = B->IBODY;
     B->SRC  = atypei[i] + .5;
+    B->TRG  = 0;
     switch (tblno) {
     case 2 :
       B->TRG[1] = -fi[3*i+0];
@@ -182,43 +324,33 @@ extern "C" void FMMcalcvdw_ij(int ni, double* xi, int* atypei, double* fi,
       B->TRG[0] = fi[3*i+0];
       break;
     }
-    B->IBODY = i;
-    B->IPROC = MPIRANK;
   }
 
-  for( B_iter B=jbodies.begin(); B!=jbodies.end(); ++B ) {
-    int i = B-jbodies.begin();
-    B->X[0] = xj[3*i+0];
-    B->X[1] = xj[3*i+1];
-    B->X[2] = xj[3*i+2];
-    if( B->X[0] < -size/2 ) B->X[0] += size;
-    if( B->X[1] < -size/2 ) B->X[1] += size;
-    if( B->X[2] < -size/2 ) B->X[2] += size;
-    if( B->X[0] >  size/2 ) B->X[0] -= size;
-    if( B->X[1] >  size/2 ) B->X[1] -= size;
-    if( B->X[2] >  size/2 ) B->X[2] -= size;
+#pragma omp parallel for
+  for( int b=0; b<int(jbodies.size()); ++b ) {
+    B_iter B = jbodies.begin() + b;
+    int i = B->IBODY;
     B->SRC  = atypej[i] + .5;
   }
 
-  FMM.initialize();
-  FMM.setGlobDomain(bodies,0,size/2);
   FMM.setVanDerWaals(nat,rscale,gscale);
-  FMM.octsection(bodies);
-  FMM.octsection(jbodies);
-  FMM.bottomup(bodies,cells);
-  FMM.bottomup(jbodies,jcells);
-  FMM.commBodies(jcells);
-  FMM.commCells(jbodies,jcells);
-
-  FMM.downward(cells,jcells);
+  context.buildTrees(size);
+  context.downward();
   FMM.unpartition(bodies);
-  std::sort(bodies.begin(),bodies.end());
+  if( handle->numex ) {
+    Bodies sources;
+    context.setPositions(sources,nj,interleaved(xj),size);
+    for( int j=0; j<nj; ++j ) sources[j].SRC = atypej[j] + .5;
+    context.subtractExclusions(sources,handle->numex,handle->natex,handle->base,xi==xj);
+  }
   if( MPIRANK == 0 ) FMM.writeTime();
-  FMM.finalize();
+  FMM.resetTimer();
 
 #if 1
-  for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {
-    int i = B-bodies.begin();
+#pragma omp parallel for
+  for( int b=0; b<int(bodies.size()); ++b ) {
+    B_iter B = bodies.begin() + b;
+    int i = B->IBODY;
 //    xi[3*i+0] = B->X[0];
 //    xi[3*i+1] = B->X[1];
 //    xi[3*i+2] = B->X[2];
@@ -293,6 +425,27 @@ extern "C" void FMMcalcvdw_ij(int ni, double* xi, int* atypei, double* fi,
 #endif
 }
 
+extern "C" void FMMevalcoulombvdw_ij(FMMHandle *handle, int ni, double* xi, double* qi, int* atypei, double* fi,
+  int nj, double* xj, double* qj, int* atypej, int nat, double* gscale, double* rscale,
+  int tblno, double size, int periodicflag) {
+  // Atom types do not travel with bodies across ranks, so both parts are evaluated by their own engines
+  std::vector<double> fcoulomb(3*ni,0);
+  FMMevalcoulomb_ij(handle,ni,xi,qi,&fcoulomb[0],nj,xj,qj,0,tblno,size,periodicflag);
+  FMMevalvdw_ij(handle,ni,xi,atypei,fi,nj,xj,atypej,nat,gscale,rscale,tblno+2,size,periodicflag);
+  for( int i=0; i<3*ni; ++i ) fi[i] += fcoulomb[i];
+}
+
+extern "C" void FMMcalccoulomb_ij(int ni, double* xi, double* qi, double* fi,
+  int nj, double* xj, double* qj, double rscale, int tblno, double size, int periodicflag) {
+  FMMevalcoulomb_ij(defaultHandle(),ni,xi,qi,fi,nj,xj,qj,rscale,tblno,size,periodicflag);
+}
+
+extern "C" void FMMcalcvdw_ij(int ni, double* xi, int* atypei, double* fi,
+  int nj, double* xj, int* atypej, int nat, double* gscale, double* rscale,
+  int tblno, double size, int periodicflag) {
+  FMMevalvdw_ij(defaultHandle(),ni,xi,atypei,fi,nj,xj,atypej,nat,gscale,rscale,tblno,size,periodicflag);
+}
+
 extern "C" void fmmcalccoulomb_ij_(int *ni, double* xi, double* qi, double* fi,
   int *nj, double* xj, double* qj, double *rscale, int *tblno, double *size, int *periodicflag) {
   std::cout << "Starting FMM" << std::endl;
@@ -303,68 +456,9 @@ extern "C" void fmmcalccoulomb_ij_exlist_(int *ni, double* xi, double* qi, doubl
   int *nj, double* xj, double* qj, double *rscale, int *tblno, double *size, int *periodicflag,
   int *numex, int* natex) {
   std::cout << "Starting FMM" << std::endl;
+  FMMsetexclusions(defaultHandle(),numex,natex,1);
   FMMcalccoulomb_ij(*ni,xi,qi,fi,*nj,xj,qj,*rscale,*tblno-6,*size,*periodicflag);
-  switch (*tblno-6) {
-  case 0 :
-#if 1
-    for( int i=0,ic=0; i<*ni; i++ ) {
-      for( int j=0; j<numex[i]; j++,ic++ ) natex[ic]--;
-    }
-    MR3calccoulomb_nlist_ij_host(*ni,xi,qi,fi,*nj,xj,qj,
-                                *rscale,*tblno-6,*size,*periodicflag&3,numex,natex,-1.0);
-//    MR3calccoulomb_nlist_ij_emu(*ni,xi,qi,fi,*nj,xj,qj,
-//			        *rscale,*tblno-6,*size,*periodicflag&3,numex,natex,-1.0);
-    for( int i=0,ic=0; i<*ni; i++ ) {
-      for( int j=0; j<numex[i]; j++,ic++ ) natex[ic]++;
-    }
-#else
-    for( int i=0,ic=0; i!=*ni; ++i ) {
-      double Fx = 0, Fy = 0, Fz = 0;
-      for( int in=0; in!=numex[i]; in++,ic++ ) {
-        int j = natex[ic]-1;
-        double dx = xi[3*i+0] - xj[3*j+0];
-        double dy = xi[3*i+1] - xj[3*j+1];
-        double dz = xi[3*i+2] - xj[3*j+2];
-        double R2 = dx * dx + dy * dy + dz * dz;
-        double invR = 1 / std::sqrt(R2);
-        if( R2 == 0 ) invR = 0;
-        double invR3 = qj[j] * invR * invR * invR;
-        Fx += dx * invR3;
-        Fy += dy * invR3;
-        Fz += dz * invR3;
-        fi[3*j+0] += qi[i] * Fx;
-        fi[3*j+1] += qi[i] * Fy;
-        fi[3*j+2] += qi[i] * Fz;
-      }
-      fi[3*i+0] -= qi[i] * Fx;
-      fi[3*i+1] -= qi[i] * Fy;
-      fi[3*i+2] -= qi[i] * Fz;
-    }
-#endif
-    break;
-  case 1:
-    double Total = 0;
-    int ic = 0;
-    for( int i=0; i!=*ni; ++i ) {
-      double Po = 0;
-      for( int in=0; in!=numex[i]; in++,ic++ ) {
-        int j = natex[ic]-1;
-        double dx = xi[3*i+0] - xj[3*j+0];
-        double dy = xi[3*i+1] - xj[3*j+1];
-        double dz = xi[3*i+2] - xj[3*j+2];
-        double R2 = dx * dx + dy * dy + dz * dz;
-        double invR = 1 / std::sqrt(R2);
-        assert( i != j );
-        if( R2 == 0 ) invR = 0;
-        Po += qj[j] * invR;
-      }
-      fi[3*i+0] -= qi[i] * Po;
-      Total -= qi[i] * Po;
-    }
-    std::cout << "Total exclusion: " << Total << std::endl;
-    std::cout << "Total # of exclusion: " << ic << std::endl;
-    break;
-  }
+  FMMsetexclusions(defaultHandle(),0,0,0);
 }
 
 
@@ -385,22 +479,51 @@ extern "C" void fmmcalcvdw_ij_exlist_(int *ni, double* xi, int* atypei, double*
   std::cout << "Starting FMM" << std::endl;
   for( int i=0; i<*ni; i++ ) atypei[i]--;
   for( int i=0; i<*nj; i++ ) atypej[i]--;
-  for( int i=0,ic=0; i<*ni; i++ ) {
-    for( int j=0; j<numex[i]; j++,ic++ ) natex[ic]--;
-  }
-#if 0
-  MR3calcvdw_ij(*ni,xi,atypei,fi,*nj,xj,atypej,*nat,gscale,rscale,*tblno,*size,*periodicflag);
-  MR3calcvdw_nlist_ij_emu(*ni,xi,atypei,fi,*nj,xj,atypej,*nat,gscale,rscale,*tblno,
-                          *size,(*periodicflag & 3),numex,natex,-1.0);
-#else
+  FMMsetexclusions(defaultHandle(),numex,natex,1);
   FMMcalcvdw_ij(*ni,xi,atypei,fi,*nj,xj,atypej,*nat,gscale,rscale,*tblno,*size,*periodicflag);
-  MR3calcvdw_nlist_ij_host(*ni,xi,atypei,fi,*nj,xj,atypej,*nat,gscale,rscale,*tblno,
-                          *size,(*periodicflag & 3),numex,natex,-1.0);
-#endif
+  FMMsetexclusions(defaultHandle(),0,0,0);
   for( int i=0; i<*ni; i++ ) atypei[i]++;
   for( int i=0; i<*nj; i++ ) atypej[i]++;
-  for( int i=0,ic=0; i<*ni; i++ ) {
-    for( int j=0; j<numex[i]; j++,ic++ ) natex[ic]++;
-  }
 }
 
+extern "C" void fmmcreate_(FMMHandle **handle) {
+  *handle = FMMcreate();
+}
+
+extern "C" void fmmsetparameters_(FMMHandle **handle, double *theta, double *threshold) {
+  FMMsetparameters(*handle,*theta,*threshold);
+}
+
+extern "C" void fmmdestroy_(FMMHandle **handle) {
+  FMMdestroy(*handle);
+  *handle = NULL;
+}
+
+extern "C" void fmmsetexclusions_(FMMHandle **handle, int *numex, int *natex) {
+  FMMsetexclusions(*handle,numex,natex,1);
+}
+
+extern "C" void fmmevalcoulomb_ij_(FMMHandle **handle, int *ni, double* xi, double* qi, double* fi,
+  int *nj, double* xj, double* qj, double *rscale, int *tblno, double *size, int *periodicflag) {
+  FMMevalcoulomb_ij(*handle,*ni,xi,qi,fi,*nj,xj,qj,*rscale,*tblno-6,*size,*periodicflag);
+}
+
+extern "C" void fmmevalvdw_ij_(FMMHandle **handle, int *ni, double* xi, int* atypei, double* fi,
+  int *nj, double* xj, int* atypej, int *nat, double* gscale, double* rscale,
+  int *tblno, double *size, int *periodicflag) {
+  for( int i=0; i<*ni; i++ ) atypei[i]--;
+  for( int i=0; i<*nj; i++ ) atypej[i]--;
+  FMMevalvdw_ij(*handle,*ni,xi,atypei,fi,*nj,xj,atypej,*nat,gscale,rscale,*tblno,*size,*periodicflag);
+  for( int i=0; i<*ni; i++ ) atypei[i]++;
+  for( int i=0; i<*nj; i++ ) atypej[i]++;
+}
+
+extern "C" void fmmevalcoulombvdw_ij_(FMMHandle **handle, int *ni, double* xi, double* qi, int* atypei, double* fi,
+  int *nj, double* xj, double* qj, int* atypej, int *nat, double* gscale, double* rscale,
+  int *tblno, double *size, int *periodicflag) {
+  for( int i=0; i<*ni; i++ ) atypei[i]--;
+  for( int i=0; i<*nj; i++ ) atypej[i]--;
+  FMMevalcoulombvdw_ij(*handle,*ni,xi,qi,atypei,fi,*nj,xj,qj,atypej,*nat,gscale,rscale,*tblno-6,*size,*periodicflag);
+  for( int i=0; i<*ni; i++ ) atypei[i]++;
+  for( int i=0; i<*nj; i++ ) atypej[i]++;
+}
@@ -3,84 +3,250 @@ extern "C" {
 #include "md.h"
 #include "vtgrapeproto.h"
 }
+#include "coulombVdW.h"
 
-extern "C" void FMMcalccoulomb_ij(int ni, double* xi, double* qi, double* fi,
-  int nj, double* xj, double* qj, double, int tblno, double size, int periodicflag) {
+//! Interleaved xyz array as a strided array
+static FMMvec3 interleaved(double *x) {
+  FMMvec3 v = {x, x+1, x+2, 3};
+  return v;
+}
+
+//! Component d of atom i in a caller's strided array
+static inline double &component(const FMMvec3 &v, int i, int d) {
+  return (d == 0 ? v.x : d == 1 ? v.y : v.z)[i*v.stride];
+}
+
+//! Correction for the dipole moment of the periodic box (forces for tblno = 0, potentials otherwise)
+static void dipoleCorrection(int ni, const FMMvec3 &xi, const double *qi, int qistride,
+                             const FMMvec3 &fi, int tblno, double size) {
+  double fc[3];
+  for( int d=0; d!=3; ++d ) fc[d]=0;
+  for( int i=0; i!=ni; ++i ) {
+    for( int d=0; d!=3; ++d ) {
+      fc[d] += qi[i*qistride] * component(xi,i,d);
+    }
+  }
+  if( tblno == 0 ) {
+    for( int i=0; i!=ni; ++i ) {
+      for( int d=0; d!=3; ++d ) {
+        component(fi,i,d) -= 4.0 * M_PI * qi[i*qistride] * fc[d] / (3.0 * size * size * size);
+      }
+    }
+  } else {
+    for( int i=0; i!=ni; ++i ) {
+      component(fi,i,0) += M_PI / (3.0 * size * size * size)
+                        * (fc[0] * fc[0] + fc[1] * fc[1] + fc[2] * fc[2]) / ni;
+    }
+  }
+}
+
+//! FMM engine, bodies, and trees of one equation that persist across calls
+template<Equation equation>
+struct FMMContext {
+  SerialFMM<equation> FMM;                                      //!< FMM engine (keeps precalculated tables)
+  Bodies bodies;                                                //!< Target bodies in tree order
+  Bodies jbodies;                                               //!< Source bodies in tree order (empty if self)
+  Cells  cells;                                                 //!< Target cells of previous call
+  Cells  jcells;                                                //!< Source cells of previous call (empty if self)
+  double size;                                                  //!< Box size of previous call
+  int    images;                                                //!< Periodic images of previous call
+  bool   self;                                                  //!< Sources are the targets (one tree, mutual downward phase)
+
+//! Constructor
+  FMMContext() : FMM(), bodies(), jbodies(), cells(), jcells(), size(0), images(-1), self(false) {
+    FMM.initialize();                                           // Initialize FMM
+  }
+//! Destructor
+  ~FMMContext() {
+    FMM.finalize();                                             // Finalize FMM
+  }
+
+//! Copy positions into bodies (wrapped into the box) without changing the order of bodies
+  bool setPositions(Bodies &B0, int n, const FMMvec3 &x, double L) {
+    bool resized = int(B0.size()) != n;                         // Number of bodies has changed
+    if( resized ) {                                             // If number of bodies has changed
+      B0.resize(n);                                             //  Resize bodies
+      for( int b=0; b<n; ++b ) {                                //  Loop over bodies
+        B0[b].IBODY = b;                                        //   Tag body with index in caller's arrays
+      }                                                         //  End loop over bodies
+    }                                                           // Endif for resize
+#pragma omp parallel for
+    for( int b=0; b<n; ++b ) {                                  // Loop over bodies in tree order
+      B_iter B = B0.begin() + b;                                //  Body iterator
+      int i = B->IBODY;                                         //  Gather from caller's arrays through permutation
+      for( int d=0; d!=3; ++d ) {                               //  Loop over dimensions
+        B->X[d] = component(x,i,d);                             //   Copy position
+        if( B->X[d] < -L/2 ) B->X[d] += L;                      //   Wrap into box from below
+        if( B->X[d] >  L/2 ) B->X[d] -= L;                      //   Wrap into box from above
+      }                                                         //  End loop over dimensions
+      B->IPROC = MPIRANK;                                       //  Tag body with MPI rank
+    }                                                           // End loop over bodies
+    return resized;                                             // Caller has to rebuild trees if resized
+  }
+
+//! Copy positions of targets and sources, and decide if trees of previous call can be refitted
+  bool setBodies(int ni, const FMMvec3 &xi, int nj, const FMMvec3 &xj, double L, bool same) {
+    bool rebuild = setPositions(bodies,ni,xi,L);                // Copy target positions
+    if( same ) {                                                // If sources are the targets
+      FMM.freeCoef(jcells);                                     //  Release coefficients of source tree
+      jcells.clear();                                           //  Target tree is used for both
+      jbodies.clear();                                          //  Target bodies are used for both
+    } else {                                                    // If sources are different bodies
+      rebuild |= setPositions(jbodies,nj,xj,L);                 //  Copy source positions
+    }                                                           // Endif for same bodies
+    rebuild |= L != size || IMAGES != images || same != self;   // Domain or sources have changed
+    size = L;                                                   // Save box size
+    images = IMAGES;                                            // Save periodic images
+    self = same;                                                // Save if sources are the targets
+    return rebuild;                                             // Trees have to be rebuilt
+  }
+
+//! Source bodies (the target bodies if self)
+  Bodies &sources() {
+    return self ? bodies : jbodies;                             // One set of bodies if self
+  }
+
+//! Source cells (the target cells if self, which makes the downward phase mutual)
+  Cells &sourceCells() {
+    return self ? cells : jcells;                               // One tree if self
+  }
+
+//! Refit trees of previous call, or rebuild them if bodies moved too much
+  void buildTrees(bool rebuild, double threshold) {
+    if( !rebuild ) rebuild = !FMM.refit(bodies,cells,threshold);// Refit target tree
+    if( !rebuild && !self ) rebuild = !FMM.refit(jbodies,jcells,threshold);// Refit source tree
+    if( rebuild ) {                                             // If trees have to be rebuilt
+      FMM.setDomain(bodies,0,size/2);                           //  Set domain size of FMM
+      FMM.bottomup(bodies,cells);                               //  Tree construction (bottom up) & upward sweep
+      if( !self ) FMM.bottomup(jbodies,jcells);                 //  Tree construction (bottom up) & upward sweep
+    }                                                           // Endif for rebuild
+  }
+};
+
+//! State of the MD interface that persists across calls
+struct FMMHandle {
+  FMMContext<Laplace>     *coulomb;                             //!< Coulomb engine (created on first use)
+  FMMContext<VanDerWaals> *vdw;                                 //!< Van der Waals engine (created on first use)
+  FMMContext<Laplace>     *coulombvdw;                          //!< Combined Coulomb + Van der Waals engine (created on first use)
+  double theta;                                                 //!< Multipole acceptance criteria
+  double threshold;                                             //!< Fraction of bodies leaving their twig that forces a rebuild
+  int   *numex;                                                 //!< Number of excluded sources of each target
+  int   *natex;                                                 //!< Excluded sources of all targets
+  int    base;                                                  //!< Index of first body in natex
+
+//! Constructor
+  FMMHandle() : coulomb(), vdw(), coulombvdw(), theta(.5), threshold(.1), numex(), natex(), base() {}
+//! Destructor
+  ~FMMHandle() {
+    delete coulomb;                                             // Finalize Coulomb engine
+    delete vdw;                                                 // Finalize Van der Waals engine
+    delete coulombvdw;                                          // Finalize combined engine
+  }
+
+//! Get engine, creating it on first use
+  template<Equation equation>
+  FMMContext<equation> &getContext(FMMContext<equation> *&context) {
+    if( !context ) context = new FMMContext<equation>;          // Only the engines a caller uses are built
+    return *context;                                            // Return engine
+  }
+
+private:
+  FMMHandle(const FMMHandle&);                                  //!< Engines are owned, handles are not copied
+  FMMHandle &operator=(const FMMHandle&);                       //!< Engines are owned, handles are not copied
+};
+
+//! Handle used by the interface without explicit handles
+static FMMHandle *defaultHandle() {
+  static FMMHandle *handle = new FMMHandle;                     // Created on first call, lives until exit
+  return handle;
+}
+
+extern "C" FMMHandle *FMMcreate() {
+  return new FMMHandle;
+}
+
+extern "C" void FMMsetparameters(FMMHandle *handle, double theta, double threshold) {
+  handle->theta = theta;
+  handle->threshold = threshold;
+}
+
+extern "C" void FMMdestroy(FMMHandle *handle) {
+  delete handle;
+}
+
+extern "C" void FMMsetexclusions(FMMHandle *handle, int *numex, int *natex, int base) {
+  handle->numex = numex;
+  handle->natex = natex;
+  handle->base = base;
+}
+
+
+extern "C" void FMMevalcoulomb_strided(FMMHandle *handle, int ni, FMMvec3 xi, double* qi, int qistride, FMMvec3 fi,
+  int nj, FMMvec3 xj, double* qj, int qjstride, int tblno, double size, int periodicflag) {
   std::cout << "tblno: " << tblno << std::endl;
   IMAGES = ((periodicflag & 0x1) == 0) ? 0 : 3;
-  THETA = .5;
-  Bodies bodies(ni),jbodies(nj);
-  Cells cells,jcells;
-  SerialFMM<Laplace> FMM;
-
-  for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {
-    int i = B-bodies.begin();
-    B->X[0] = xi[3*i+0];
-    B->X[1] = xi[3*i+1];
-    B->X[2] = xi[3*i+2];
-    if( B->X[0] < -size/2 ) B->X[0] += size;
-    if( B->X[1] < -size/2 ) B->X[1] += size;
-    if( B->X[2] < -size/2 ) B->X[2] += size;
-    if( B->X[0] >  size/2 ) B->X[0] -= size;
-    if( B->X[1] >  size/2 ) B->X[1] -= size;
-    if( B->X[2] >  size/2 ) B->X[2] -= size;
-    B->SRC  = qi[i];
+  THETA = handle->theta;
+  FMMContext<Laplace> &context = handle->getContext(handle->coulomb);
+  SerialFMM<Laplace> &FMM = context.FMM;
+  Bodies &bodies = context.bodies, &jbodies = context.jbodies;
+  bool self = ni == nj && xi.x == xj.x && xi.stride == xj.stride && qi == qj && qistride == qjstride;
+  bool rebuild = context.setBodies(ni,xi,nj,xj,size,self);
+
+#pragma omp parallel for
+  for( int b=0; b<int(bodies.size()); ++b ) {
+    B_iter B = bodies.begin() + b;
+    int i = B->IBODY;
+    B->SRC  = qi[i*qistride];
+    B->TRG  = 0;
     switch (tblno) {
     case 0 :
-      B->TRG[1] = -fi[3*i+0];
-      B->TRG[2] = -fi[3*i+1];
-      B->TRG[3] = -fi[3*i+2];
+      B->TRG[1] = -component(fi,i,0);
+      B->TRG[2] = -component(fi,i,1);
+      B->TRG[3] = -component(fi,i,2);
       break;
     case 1 :
-      B->TRG[0] = fi[3*i+0];
+      B->TRG[0] = component(fi,i,0);
       break;
     }
-    B->IBODY = i;
-    B->IPROC = MPIRANK;
   }
 
-  for( B_iter B=jbodies.begin(); B!=jbodies.end(); ++B ) {
-    int i = B-jbodies.begin();
-    B->X[0] = xj[3*i+0];
-    B->X[1] = xj[3*i+1];
-    B->X[2] = xj[3*i+2];
-    if( B->X[0] < -size/2 ) B->X[0] += size;
-    if( B->X[1] < -size/2 ) B->X[1] += size;
-    if( B->X[2] < -size/2 ) B->X[2] += size;
-    if( B->X[0] >  size/2 ) B->X[0] -= size;
-    if( B->X[1] >  size/2 ) B->X[1] -= size;
-    if( B->X[2] >  size/2 ) B->X[2] -= size;
-    B->SRC  = qj[i];
+#pragma omp parallel for
+  for( int b=0; b<int(jbodies.size()); ++b ) {
+    B_iter B = jbodies.begin() + b;
+    int i = B->IBODY;
+    B->SRC  = qj[i*qjstride];
   }
 
-  FMM.initialize();
-  FMM.setDomain(bodies,0,size/2);
-  FMM.bottomup(bodies,cells);
-  FMM.bottomup(jbodies,jcells);
-
-  FMM.downward(cells,jcells);
-  std::sort(bodies.begin(),bodies.end());
+  context.buildTrees(rebuild,handle->threshold);
+  if( handle->numex ) FMM.setExclusions(bodies,context.sources(),handle->numex,handle->natex,handle->base,xi.x==xj.x);
+  FMM.downward(context.cells,context.sourceCells());
+  FMM.clearExclusions();
   FMM.writeTime();
-  FMM.finalize();
+  FMM.resetTimer();
 
-#if 1
-  for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {
-    int i = B-bodies.begin();
-//    xi[3*i+0] = B->X[0];
-//    xi[3*i+1] = B->X[1];
-//    xi[3*i+2] = B->X[2];
-//    qi[i]     = B->SRC;
+#pragma omp parallel for
+  for( int b=0; b<int(bodies.size()); ++b ) {
+    B_iter B = bodies.begin() + b;
+    int i = B->IBODY;
     switch (tblno) {
     case 0 :
-      fi[3*i+0] = -B->SRC * B->TRG[1];
-      fi[3*i+1] = -B->SRC * B->TRG[2];
-      fi[3*i+2] = -B->SRC * B->TRG[3];
+      component(fi,i,0) = -B->SRC * B->TRG[1];
+      component(fi,i,1) = -B->SRC * B->TRG[2];
+      component(fi,i,2) = -B->SRC * B->TRG[3];
       break;
     case 1 :
-      fi[3*i+0] = 0.5 * B->SRC * B->TRG[0];
+      component(fi,i,0) = 0.5 * B->SRC * B->TRG[0];
       break;
     }
   }
+  dipoleCorrection(ni,xi,qi,qistride,fi,tblno,size);
+}
+
+extern "C" void FMMevalcoulomb_ij(FMMHandle *handle, int ni, double* xi, double* qi, double* fi,
+  int nj, double* xj, double* qj, double, int tblno, double size, int periodicflag) {
+#if 1
+  FMMevalcoulomb_strided(handle,ni,interleaved(xi),qi,1,interleaved(fi),
+                         nj,interleaved(xj),qj,1,tblno,size,periodicflag);
 #else
   switch (tblno) {
   case 0 :
@@ -119,50 +285,28 @@ extern "C" void FMMcalccoulomb_ij(int ni, double* xi, double* qi, double* fi,
     }
     break;
   }
+  dipoleCorrection(ni,interleaved(xi),qi,1,interleaved(fi),tblno,size);
 #endif
-  double fc[3];
-  for( int d=0; d!=3; ++d ) fc[d]=0;
-  for( int i=0; i!=ni; ++i ) { 
-    for( int d=0; d!=3; ++d ) { 
-      fc[d] += qi[i] * xi[3*i+d];
-    }   
-  }
-  if( tblno == 0 ) { 
-    for( int i=0; i!=ni; ++i ) { 
-      for( int d=0; d!=3; ++d ) {
-        fi[3*i+d] -= 4.0 * M_PI * qi[i] * fc[d] / (3.0 * size * size * size);
-      }
-    }   
-  } else {
-    for( int i=0; i!=ni; ++i ) { 
-      fi[3*i+0] += M_PI / (3.0 * size * size * size)
-                * (fc[0] * fc[0] + fc[1] * fc[1] + fc[2] * fc[2]) / ni;
-    }   
-  }
 }
 
-extern "C" void FMMcalcvdw_ij(int ni, double* xi, int* atypei, double* fi,
+extern "C" void FMMevalvdw_ij(FMMHandle *handle, int ni, double* xi, int* atypei, double* fi,
   int nj, double* xj, int* atypej, int nat, double* gscale, double* rscale,
   int tblno, double size, int periodicflag) {
   std::cout << "tblno: " << tblno << std::endl;
   IMAGES = ((periodicflag & 0x1) == 0) ? 0 : 3;
-  THETA = .5;
-  Bodies bodies(ni),jbodies(nj);
-  Cells cells,jcells;
-  SerialFMM<VanDerWaals> FMM;
-
-  for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {
-    int i = B-bodies.begin();
-    B->X[0] = xi[3*i+0];
-    B->X[1] = xi[3*i+1];
-    B->X[2] = xi[3*i+2];
-    if( B->X[0] < -size/2 ) B->X[0] += size;
-    if( B->X[1] < -size/2 ) B->X[1] += size;
-    if( B->X[2] < -size/2 ) B->X[2] += size;
-    if( B->X[0] >  size/2 ) B->X[0] -= size;
-    if( B->X[1] >  size/2 ) B->X[1] -= size;
-    if( B->X[2] >  size/2 ) B->X[2] -= size;
+  THETA = handle->theta;
+  FMMContext<VanDerWaals> &context = handle->getContext(handle->vdw);
+  SerialFMM<VanDerWaals> &FMM = context.FMM;
+  Bodies &bodies = context.bodies, &jbodies = context.jbodies;
+  bool self = ni == nj && xi == xj && atypei == atypej;
+  bool rebuild = context.setBodies(ni,interleaved(xi),nj,interleaved(xj),size,self);
+
+#pragma omp parallel for
+  for( int b=0; b<int(bodies.size()); ++b ) {
+    B_iter B = bodies.begin() + b;
+    int i = B->IBODY;
     B->SRC  = atypei[i] + .5;
+    B->TRG  = 0;
     switch (tblno) {
     case 2 :
       B->TRG[1] = -fi[3*i+0];
@@ -173,38 +317,28 @@ extern "C" void FMMcalcvdw_ij(int ni, double* xi, int* atypei, double* fi,
       B->TRG[0] = fi[3*i+0];
       break;
     }
-    B->IBODY = i;
-    B->IPROC = MPIRANK;
   }
 
-  for( B_iter B=jbodies.begin(); B!=jbodies.end(); ++B ) {
-    int i = B-jbodies.begin();
-    B->X[0] = xj[3*i+0];
-    B->X[1] = xj[3*i+1];
-    B->X[2] = xj[3*i+2];
-    if( B->X[0] < -size/2 ) B->X[0] += size;
-    if( B->X[1] < -size/2 ) B->X[1] += size;
-    if( B->X[2] < -size/2 ) B->X[2] += size;
-    if( B->X[0] >  size/2 ) B->X[0] -= size;
-    if( B->X[1] >  size/2 ) B->X[1] -= size;
-    if( B->X[2] >  size/2 ) B->X[2] -= size;
+#pragma omp parallel for
+  for( int b=0; b<int(jbodies.size()); ++b ) {
+    B_iter B = jbodies.begin() + b;
+    int i = B->IBODY;
     B->SRC  = atypej[i] + .5;
   }
 
-  FMM.initialize();
-  FMM.setDomain(bodies,0,size/2);
   FMM.setVanDerWaals(nat,rscale,gscale);
-  FMM.bottomup(bodies,cells);
-  FMM.bottomup(jbodies,jcells);
-
-  FMM.downward(cells,jcells);
-  std::sort(bodies.begin(),bodies.end());
+  context.buildTrees(rebuild,handle->threshold);
+  if( handle->numex ) FMM.setExclusions(bodies,context.sources(),handle->numex,handle->natex,handle->base,xi==xj);
+  FMM.downward(context.cells,context.sourceCells());
+  FMM.clearExclusions();
   FMM.writeTime();
-  FMM.finalize();
+  FMM.resetTimer();
 
 #if 1
-  for( B_iter B=bodies.begin(); B!=bodies.end(); ++B ) {
-    int i = B-bodies.begin();
+#pragma omp parallel for
+  for( int b=0; b<int(bodies.size()); ++b ) {
+    B_iter B = bodies.begin() + b;
+    int i = B->IBODY;
 //    xi[3*i+0] = B->X[0];
 //    xi[3*i+1] = B->X[1];
 //    xi[3*i+2] = B->X[2];
@@ -275,6 +409,72 @@ extern "C" void FMMcalcvdw_ij(int ni, double* xi, int* atypei, double* fi,
 #endif
 }
 
+extern "C" void FMMevalcoulombvdw_ij(FMMHandle *handle, int ni, double* xi, double* qi, int* atypei, double* fi,
+  int nj, double* xj, double* qj, int* atypej, int nat, double* gscale, double* rscale,
+  int tblno, double size, int periodicflag) {
+  std::cout << "tblno: " << tblno << std::endl;
+  IMAGES = ((periodicflag & 0x1) == 0) ? 0 : 3;
+  THETA = handle->theta;
+  FMMContext<Laplace> &context = handle->getContext(handle->coulombvdw);
+  SerialFMM<Laplace> &FMM = context.FMM;
+  Bodies &bodies = context.bodies, &jbodies = context.jbodies;
+  bool self = ni == nj && xi == xj && qi == qj && atypei == atypej;
+  bool rebuild = context.setBodies(ni,interleaved(xi),nj,interleaved(xj),size,self);
+
+#pragma omp parallel for
+  for( int b=0; b<int(bodies.size()); ++b ) {
+    B_iter B = bodies.begin() + b;
+    int i = B->IBODY;
+    B->SRC  = qi[i];
+    B->TRG  = 0;
+  }
+
+#pragma omp parallel for
+  for( int b=0; b<int(jbodies.size()); ++b ) {
+    B_iter B = jbodies.begin() + b;
+    int i = B->IBODY;
+    B->SRC  = qj[i];
+  }
+
+  FMM.setCoulombVanDerWaals(nat,rscale,gscale);
+  context.buildTrees(rebuild,handle->threshold);
+  FMM.setVanDerWaalsTypes(bodies,context.sources(),atypei,atypej);
+  if( handle->numex ) FMM.setExclusions(bodies,context.sources(),handle->numex,handle->natex,handle->base,xi==xj);
+  FMM.downward(context.cells,context.sourceCells());
+  FMM.clearExclusions();
+  FMM.writeTime();
+  FMM.resetTimer();
+
+#pragma omp parallel for
+  for( int b=0; b<int(bodies.size()); ++b ) {
+    B_iter B = bodies.begin() + b;
+    int i = B->IBODY;
+    switch (tblno) {
+    case 0 :
+      fi[3*i+0] -= B->SRC * B->TRG[1] + FMM.getVanDerWaals(B)[1];
+      fi[3*i+1] -= B->SRC * B->TRG[2] + FMM.getVanDerWaals(B)[2];
+      fi[3*i+2] -= B->SRC * B->TRG[3] + FMM.getVanDerWaals(B)[3];
+      break;
+    case 1 :
+      fi[3*i+0] += 0.5 * B->SRC * B->TRG[0] + FMM.getVanDerWaals(B)[0];
+      break;
+    }
+  }
+
+  dipoleCorrection(ni,interleaved(xi),qi,1,interleaved(fi),tblno,size);
+}
+
+extern "C" void FMMcalccoulomb_ij(int ni, double* xi, double* qi, double* fi,
+  int nj, double* xj, double* qj, double rscale, int tblno, double size, int periodicflag) {
+  FMMevalcoulomb_ij(defaultHandle(),ni,xi,qi,fi,nj,xj,qj,rscale,tblno,size,periodicflag);
+}
+
+extern "C" void FMMcalcvdw_ij(int ni, double* xi, int* atypei, double* fi,
+  int nj, double* xj, int* atypej, int nat, double* gscale, double* rscale,
+  int tblno, double size, int periodicflag) {
+  FMMevalvdw_ij(defaultHandle(),ni,xi,atypei,fi,nj,xj,atypej,nat,gscale,rscale,tblno,size,periodicflag);
+}
+
 extern "C" void fmmcalccoulomb_ij_(int *ni, double* xi, double* qi, double* fi,
   int *nj, double* xj, double* qj, double *rscale, int *tblno, double *size, int *periodicflag) {
   std::cout << "Starting FMM" << std::endl;
@@ -285,68 +485,9 @@ extern "C" void fmmcalccoulomb_ij_exlist_(int *ni, double* xi, double* qi, doubl
   int *nj, double* xj, double* qj, double *rscale, int *tblno, double *size, int *periodicflag,
   int *numex, int* natex) {
   std::cout << "Starting FMM" << std::endl;
+  FMMsetexclusions(defaultHandle(),numex,natex,1);
   FMMcalccoulomb_ij(*ni,xi,qi,fi,*nj,xj,qj,*rscale,*tblno-6,*size,*periodicflag);
-  switch (*tblno-6) {
-  case 0 :
-#if 1
-    for( int i=0,ic=0; i<*ni; i++ ) {
-      for( int j=0; j<numex[i]; j++,ic++ ) natex[ic]--;
-    }
-    MR3calccoulomb_nlist_ij_host(*ni,xi,qi,fi,*nj,xj,qj,
-                                *rscale,*tblno-6,*size,*periodicflag&3,numex,natex,-1.0);
-//    MR3calccoulomb_nlist_ij_emu(*ni,xi,qi,fi,*nj,xj,qj,
-//			        *rscale,*tblno-6,*size,*periodicflag&3,numex,natex,-1.0);
-    for( int i=0,ic=0; i<*ni; i++ ) {
-      for( int j=0; j<numex[i]; j++,ic++ ) natex[ic]++;
-    }
-#else
-    for( int i=0,ic=0; i!=*ni; ++i ) {
-      double Fx = 0, Fy = 0, Fz = 0;
-      for( int in=0; in!=numex[i]; in++,ic++ ) {
-        int j = natex[ic]-1;
-        double dx = xi[3*i+0] - xj[3*j+0];
-        double dy = xi[3*i+1] - xj[3*j+1];
-        double dz = xi[3*i+2] - xj[3*j+2];
-        double R2 = dx * dx + dy * dy + dz * dz;
-        double invR = 1 / std::sqrt(R2);
-        if( R2 == 0 ) invR = 0;
-        double invR3 = qj[j] * invR * invR * invR;
-        Fx += dx * invR3;
-        Fy += dy * invR3;
-        Fz += dz * invR3;
-        fi[3*j+0] += qi[i] * Fx;
-        fi[3*j+1] += qi[i] * Fy;
-        fi[3*j+2] += qi[i] * Fz;
-      }
-      fi[3*i+0] -= qi[i] * Fx;
-      fi[3*i+1] -= qi[i] * Fy;
-      fi[3*i+2] -= qi[i] * Fz;
-    }
-#endif
-    break;
-  case 1:
-    double Total = 0;
-    int ic = 0;
-    for( int i=0; i!=*ni; ++i ) {
-      double Po = 0;
-      for( int in=0; in!=numex[i]; in++,ic++ ) {
-        int j = natex[ic]-1;
-        double dx = xi[3*i+0] - xj[3*j+0];
-        double dy = xi[3*i+1] - xj[3*j+1];
-        double dz = xi[3*i+2] - xj[3*j+2];
-        double R2 = dx * dx + dy * dy + dz * dz;
-        double invR = 1 / std::sqrt(R2);
-        assert( i != j );
-        if( R2 == 0 ) invR = 0;
-        Po += qj[j] * invR;
-      }
-      fi[3*i+0] -= qi[i] * Po;
-      Total -= qi[i] * Po;
-    }
-    std::cout << "Total exclusion: " << Total << std::endl;
-    std::cout << "Total # of exclusion: " << ic << std::endl;
-    break;
-  }
+  FMMsetexclusions(defaultHandle(),0,0,0);
 }
 
 
@@ -367,22 +508,51 @@ extern "C" void fmmcalcvdw_ij_exlist_(int *ni, double* xi, int* atypei, double*
   std::cout << "Starting FMM" << std::endl;
   for( int i=0; i<*ni; i++ ) atypei[i]--;
   for( int i=0; i<*nj; i++ ) atypej[i]--;
-  for( int i=0,ic=0; i<*ni; i++ ) {
-    for( int j=0; j<numex[i]; j++,ic++ ) natex[ic]--;
-  }
-#if 0
-  MR3calcvdw_ij(*ni,xi,atypei,fi,*nj,xj,atypej,*nat,gscale,rscale,*tblno,*size,*periodicflag);
-  MR3calcvdw_nlist_ij_emu(*ni,xi,atypei,fi,*nj,xj,atypej,*nat,gscale,rscale,*tblno,
-                          *size,(*periodicflag & 3),numex,natex,-1.0);
-#else
+  FMMsetexclusions(defaultHandle(),numex,natex,1);
   FMMcalcvdw_ij(*ni,xi,atypei,fi,*nj,xj,atypej,*nat,gscale,rscale,*tblno,*size,*periodicflag);
-  MR3calcvdw_nlist_ij_host(*ni,xi,atypei,fi,*nj,xj,atypej,*nat,gscale,rscale,*tblno,
-                          *size,(*periodicflag & 3),numex,natex,-1.0);
-#endif
+  FMMsetexclusions(defaultHandle(),0,0,0);
   for( int i=0; i<*ni; i++ ) atypei[i]++;
   for( int i=0; i<*nj; i++ ) atypej[i]++;
-  for( int i=0,ic=0; i<*ni; i++ ) {
-    for( int j=0; j<numex[i]; j++,ic++ ) natex[ic]++;
-  }
 }
 
+extern "C" void fmmcreate_(FMMHandle **handle) {
+  *handle = FMMcreate();
+}
+
+extern "C" void fmmsetparameters_(FMMHandle **handle, double *theta, double *threshold) {
+  FMMsetparameters(*handle,*theta,*threshold);
+}
+
+extern "C" void fmmdestroy_(FMMHandle **handle) {
+  FMMdestroy(*handle);
+  *handle = NULL;
+}
+
+extern "C" void fmmsetexclusions_(FMMHandle **handle, int *numex, int *natex) {
+  FMMsetexclusions(*handle,numex,natex,1);
+}
+
+extern "C" void fmmevalcoulomb_ij_(FMMHandle **handle, int *ni, double* xi, double* qi, double* fi,
+  int *nj, double* xj, double* qj, double *rscale, int *tblno, double *size, int *periodicflag) {
+  FMMevalcoulomb_ij(*handle,*ni,xi,qi,fi,*nj,xj,qj,*rscale,*tblno-6,*size,*periodicflag);
+}
+
+extern "C" void fmmevalvdw_ij_(FMMHandle **handle, int *ni, double* xi, int* atypei, double* fi,
+  int *nj, double* xj, int* atypej, int *nat, double* gscale, double* rscale,
+  int *tblno, double *size, int *periodicflag) {
+  for( int i=0; i<*ni; i++ ) atypei[i]--;
+  for( int i=0; i<*nj; i++ ) atypej[i]--;
+  FMMevalvdw_ij(*handle,*ni,xi,atypei,fi,*nj,xj,atypej,*nat,gscale,rscale,*tblno,*size,*periodicflag);
+  for( int i=0; i<*ni; i++ ) atypei[i]++;
+  for( int i=0; i<*nj; i++ ) atypej[i]++;
+}
+
+extern "C" void fmmevalcoulombvdw_ij_(FMMHandle **handle, int *ni, double* xi, double* qi, int* atypei, double* fi,
+  int *nj, double* xj, double* qj, int* atypej, int *nat, double* gscale, double* rscale,
+  int *tblno, double *size, int *periodicflag) {
+  for( int i=0; i<*ni; i++ ) atypei[i]--;
+  for( int i=0; i<*nj; i++ ) atypej[i]--;
+  FMMevalcoulombvdw_ij(*handle,*ni,xi,qi,atypei,fi,*nj,xj,qj,atypej,*nat,gscale,rscale,*tblno-6,*size,*periodicflag);
+  for( int i=0; i<*ni; i++ ) atypei[i]++;
+  for( int i=0; i<*nj; i++ ) atypej[i]++;
+}
@@ -0,0 +1,75 @@
+#include "serial_coulombVdW.cxx"
+
+int main() {
+  const int N = 2000;
+  const int nat = 4;
+  const double size = 4;
+  double *xi     = new double [3*N];
+  double *qi     = new double [N];
+  double *fi     = new double [3*N];
+  double *fd     = new double [3*N];
+  int *atypei    = new int [N];
+  double *rscale = new double [nat*nat];
+  double *gscale = new double [nat*nat];
+
+  srand48(0);
+  double average = 0;
+  for( int i=0; i<N; i++ ) {
+    xi[3*i+0] = drand48() * size - size/2;
+    xi[3*i+1] = drand48() * size - size/2;
+    xi[3*i+2] = drand48() * size - size/2;
+    qi[i] = drand48()*2.0-1.0;
+    average += qi[i];
+    atypei[i] = drand48() * nat;
+  }
+  average /= N;
+  for( int i=0; i<N; i++ ) {
+    qi[i] -= average;
+  }
+  for( int i=0; i<nat*nat; i++ ) {
+    rscale[i] = 1;
+    gscale[i] = 1e-6;
+  }
+
+  FMMHandle *handle = FMMcreate();
+  assert( !handle->coulomb && !handle->vdw && !handle->coulombvdw );// Engines are built on first use
+  FMMsetparameters(handle,.4,.1);
+  int numCoef = 0;
+  for( int step=0; step<5; step++ ) {
+    for( int i=0; i<3*N; i++ ) {
+      xi[i] += (drand48() - .5) * 1e-3 * size;
+      fi[i] = 0;
+    }
+    FMMevalcoulomb_ij(handle,N,xi,qi,fi,N,xi,qi,0.0,0,size,1);
+    FMMContext<Laplace> &context = *handle->coulomb;
+    if( step == 0 ) numCoef = context.FMM.getNumCoef();
+    std::cout << "Coefficients         : " << context.FMM.getNumCoef() << std::endl;
+    assert( context.FMM.getNumCoef() <= numCoef );             // Refits and rebuilds release old coefficients
+  }
+  assert( !handle->vdw && !handle->coulombvdw );                // Coulomb alone builds one engine
+
+  FMMHandle *fresh = FMMcreate();
+  FMMsetparameters(fresh,.4,.1);
+  for( int i=0; i<3*N; i++ ) fd[i] = 0;
+  FMMevalcoulomb_ij(fresh,N,xi,qi,fd,N,xi,qi,0.0,0,size,1);
+  double diff = 0, norm = 0;
+  for( int i=0; i<3*N; i++ ) {
+    diff += (fi[i] - fd[i]) * (fi[i] - fd[i]);
+    norm += fd[i] * fd[i];
+  }
+  std::cout << "Refit vs rebuild     : " << std::sqrt(diff/norm) << std::endl;
+  assert( diff <= 1e-6 * norm );                                // Refitted trees give the same forces
+
+  FMMevalvdw_ij(handle,N,xi,atypei,fi,N,xi,atypei,nat,gscale,rscale,2,size,1);
+  assert( handle->vdw && std::abs(THETA - .4) < 1e-6 );         // Van der Waals uses the theta of the handle
+  FMMdestroy(fresh);
+  FMMdestroy(handle);
+
+  delete[] xi;
+  delete[] qi;
+  delete[] fi;
+  delete[] fd;
+  delete[] atypei;
+  delete[] rscale;
+  delete[] gscale;
+}